@@ -0,0 +1,247 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "accesstrace.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "page.h"
+#include "exceptions/trace_io_exception.h"
+
+namespace badgerdb {
+
+const std::size_t AccessTraceWriter::BUFFER_SIZE;
+
+namespace {
+
+const char SIGNATURE[8] = {'B', 'D', 'B', 'T', 'R', 'A', 'C', '1'};
+
+// Tag of the record naming a file; events use their kind.  The kind is in the
+// low four bits of the tag and the hint or dirty flag in the rest.
+const std::uint8_t FILE_NAME = 0;
+
+// Bytes read from the trace at a time.
+const std::size_t READ_SIZE = 64 * 1024;
+
+bool writeAll(const int fd, const char* data, std::size_t length) {
+  while (length > 0) {
+    const ssize_t n = ::write(fd, data, length);
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    length -= n;
+  }
+  return true;
+}
+
+}
+
+AccessTraceWriter::AccessTraceWriter() : open_(false), failed_(false), fd_(-1) {}
+
+AccessTraceWriter::~AccessTraceWriter() {
+  try {
+    close();
+  } catch (...) {
+  }
+}
+
+void AccessTraceWriter::open(const std::string& name) {
+  close();
+  std::lock_guard<std::mutex> lock(mutex_);
+  fd_ = ::open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    throw TraceIOException(name, "create");
+  }
+  name_ = name;
+  failed_ = false;
+  file_ids_.clear();
+  buffer_.assign(SIGNATURE, sizeof(SIGNATURE));
+  open_ = true;
+}
+
+void AccessTraceWriter::close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (fd_ < 0) {
+    return;
+  }
+  open_ = false;
+  if (!failed_) {
+    writeBuffer();
+  }
+  buffer_.clear();
+  ::close(fd_);
+  fd_ = -1;
+  if (failed_) {
+    throw TraceIOException(name_, "write");
+  }
+}
+
+void AccessTraceWriter::record(const TraceEvent::Kind kind, const File* file,
+                               const PageId page_number, const AccessHint hint,
+                               const bool dirty) {
+  if (!open_) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  // The trace may have been closed since the check above.
+  if (!open_) {
+    return;
+  }
+
+  std::map<std::string, std::uint32_t>::iterator it =
+      file_ids_.find(file->filename());
+  if (it == file_ids_.end()) {
+    it = file_ids_.insert(std::make_pair(file->filename(),
+                                         static_cast<std::uint32_t>(file_ids_.size()))).first;
+    buffer_.push_back(static_cast<char>(FILE_NAME));
+    putNumber(it->second);
+    putNumber(it->first.size());
+    buffer_.append(it->first);
+  }
+
+  std::uint8_t flag = 0;
+  if (kind == TraceEvent::READ) {
+    flag = static_cast<std::uint8_t>(hint);
+  } else if (kind == TraceEvent::UNPIN) {
+    flag = dirty ? 1 : 0;
+  }
+  buffer_.push_back(static_cast<char>(kind | (flag << 4)));
+  putNumber(it->second);
+  if (kind != TraceEvent::FLUSH) {
+    putNumber(page_number);
+  }
+
+  if (buffer_.size() >= BUFFER_SIZE) {
+    writeBuffer();
+  }
+}
+
+void AccessTraceWriter::putNumber(std::uint64_t value) {
+  while (value >= 0x80) {
+    buffer_.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  buffer_.push_back(static_cast<char>(value));
+}
+
+void AccessTraceWriter::writeBuffer() {
+  if (!writeAll(fd_, buffer_.data(), buffer_.size())) {
+    failed_ = true;
+    open_ = false;
+  }
+  buffer_.clear();
+}
+
+AccessTraceReader::AccessTraceReader(const std::string& name)
+    : name_(name), position_(0) {
+  fd_ = ::open(name.c_str(), O_RDONLY);
+  if (fd_ < 0) {
+    throw TraceIOException(name_, "open");
+  }
+  char signature[sizeof(SIGNATURE)];
+  for (std::size_t i = 0; i < sizeof(signature); ++i) {
+    std::uint8_t byte;
+    if (!getByte(byte)) {
+      ::close(fd_);
+      throw TraceIOException(name_, "recognize");
+    }
+    signature[i] = byte;
+  }
+  if (memcmp(signature, SIGNATURE, sizeof(SIGNATURE)) != 0) {
+    ::close(fd_);
+    throw TraceIOException(name_, "recognize");
+  }
+}
+
+AccessTraceReader::~AccessTraceReader() {
+  ::close(fd_);
+}
+
+bool AccessTraceReader::next(TraceEvent& event) {
+  while (true) {
+    std::uint8_t tag;
+    std::uint64_t file;
+    if (!getByte(tag) || !getNumber(file)) {
+      return false;
+    }
+
+    if (tag == FILE_NAME) {
+      std::uint64_t length;
+      if (!getNumber(length)) {
+        return false;
+      }
+      std::string file_name;
+      for (std::uint64_t i = 0; i < length; ++i) {
+        std::uint8_t byte;
+        if (!getByte(byte)) {
+          return false;
+        }
+        file_name.push_back(byte);
+      }
+      if (file != file_names_.size()) {
+        throw TraceIOException(name_, "parse");
+      }
+      file_names_.push_back(file_name);
+      continue;
+    }
+
+    const std::uint8_t kind = tag & 0x0f;
+    const std::uint8_t flag = tag >> 4;
+    if (kind < TraceEvent::READ || kind > TraceEvent::FLUSH ||
+        file >= file_names_.size() || flag > ACCESS_ONCE) {
+      throw TraceIOException(name_, "parse");
+    }
+    std::uint64_t page_number = Page::INVALID_NUMBER;
+    if (kind != TraceEvent::FLUSH && !getNumber(page_number)) {
+      return false;
+    }
+    event.kind = static_cast<TraceEvent::Kind>(kind);
+    event.file = file;
+    event.page_number = page_number;
+    event.hint = kind == TraceEvent::READ ? static_cast<AccessHint>(flag)
+                                          : ACCESS_RANDOM;
+    event.dirty = kind == TraceEvent::UNPIN && flag != 0;
+    return true;
+  }
+}
+
+bool AccessTraceReader::getByte(std::uint8_t& byte) {
+  if (position_ == buffer_.size()) {
+    buffer_.resize(READ_SIZE);
+    const ssize_t n = ::read(fd_, &buffer_[0], buffer_.size());
+    if (n < 0) {
+      throw TraceIOException(name_, "read");
+    }
+    buffer_.resize(n);
+    position_ = 0;
+    if (n == 0) {
+      return false;
+    }
+  }
+  byte = buffer_[position_++];
+  return true;
+}
+
+bool AccessTraceReader::getNumber(std::uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    std::uint8_t byte;
+    if (!getByte(byte)) {
+      return false;
+    }
+    value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  throw TraceIOException(name_, "parse");
+}
+
+}
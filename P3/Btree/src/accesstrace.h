@@ -0,0 +1,275 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "replacementpolicy.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief One call into the buffer manager, as recorded in an access trace.
+ */
+struct TraceEvent {
+  /**
+   * Calls that are recorded.
+   */
+  enum Kind {
+    /**
+     * readPage(), with the access hint it was given.
+     */
+    READ = 1,
+
+    /**
+     * allocPage(), with the number of the page allocated.
+     */
+    ALLOC = 2,
+
+    /**
+     * unPinPage(), or a PageHandle letting go of its page, with whether the
+     * page was changed.
+     */
+    UNPIN = 3,
+
+    /**
+     * disposePage().
+     */
+    DISPOSE = 4,
+
+    /**
+     * flushFile().  Has no page number.
+     */
+    FLUSH = 5
+  };
+
+  /**
+   * Which call this was.
+   */
+  Kind kind;
+
+  /**
+   * Index of the file in AccessTraceReader::fileNames().
+   */
+  std::uint32_t file;
+
+  /**
+   * Number of the page, or Page::INVALID_NUMBER for FLUSH.
+   */
+  PageId page_number;
+
+  /**
+   * How the page was going to be used.  Only set for READ.
+   */
+  AccessHint hint;
+
+  /**
+   * True if the page was unpinned dirty.  Only set for UNPIN.
+   */
+  bool dirty;
+};
+
+/**
+ * @brief Records the calls made into the buffer manager to a compact binary
+ * file, for replaying against other pool sizes and replacement policies.
+ *
+ * A trace starts with an eight byte signature, followed by one record per
+ * event: a tag byte holding the kind of event and its hint or dirty flag, then
+ * the file and page number as variable length integers of seven bits a byte.
+ * Files are given small numbers in the order they first appear; the first
+ * event of a file is preceded by a record naming it.  A typical event takes
+ * three to five bytes.
+ *
+ * Recording is threadsafe.  Events from different threads are written in the
+ * order they take the writer's lock, which is close to, but not exactly, the
+ * order the buffer manager saw them in.  When no trace is open, record() costs
+ * a single atomic load.
+ */
+class AccessTraceWriter {
+ public:
+  AccessTraceWriter();
+
+  /**
+   * Closes the trace, ignoring errors.
+   */
+  ~AccessTraceWriter();
+
+  /**
+   * Starts a new trace, closing any trace already open.
+   *
+   * @param name  Name of the trace file, which is replaced if it exists.
+   * @throws TraceIOException If the file can't be created.
+   */
+  void open(const std::string& name);
+
+  /**
+   * Writes out the events still buffered and closes the trace.  Does nothing
+   * if no trace is open.
+   *
+   * @throws TraceIOException If any of the trace could not be written.  The
+   *                          events up to the failure are in the file.
+   */
+  void close();
+
+  /**
+   * Returns true if a trace is open.
+   */
+  bool isOpen() const { return open_; }
+
+  /**
+   * Appends an event to the trace, if one is open.  Never throws; a failed
+   * write stops the trace and is reported by close().
+   *
+   * @param kind         Which call was made.
+   * @param file         File the call was for.
+   * @param page_number  Number of the page, or Page::INVALID_NUMBER.
+   * @param hint         Access hint of a READ.
+   * @param dirty        Dirty flag of an UNPIN.
+   */
+  void record(const TraceEvent::Kind kind, const File* file,
+              const PageId page_number, const AccessHint hint = ACCESS_RANDOM,
+              const bool dirty = false);
+
+ private:
+  /**
+   * Appends a variable length integer to the buffer.
+   */
+  void putNumber(std::uint64_t value);
+
+  /**
+   * Writes the buffer to the file and empties it.  Stops the trace if the
+   * write fails.
+   */
+  void writeBuffer();
+
+  /**
+   * Number of buffered bytes that makes record() write the buffer out.
+   */
+  static const std::size_t BUFFER_SIZE = 64 * 1024;
+
+  /**
+   * Guards everything but <open_>.
+   */
+  std::mutex mutex_;
+
+  /**
+   * True while a trace is open, for record() to check without the lock.
+   */
+  std::atomic<bool> open_;
+
+  /**
+   * True if writing the trace failed.
+   */
+  bool failed_;
+
+  /**
+   * Descriptor of the trace file, or -1.
+   */
+  int fd_;
+
+  /**
+   * Name of the trace file.
+   */
+  std::string name_;
+
+  /**
+   * Events not yet written.
+   */
+  std::string buffer_;
+
+  /**
+   * Number given to each file seen so far, by name.
+   */
+  std::map<std::string, std::uint32_t> file_ids_;
+
+  AccessTraceWriter(const AccessTraceWriter&);
+  AccessTraceWriter& operator=(const AccessTraceWriter&);
+};
+
+/**
+ * @brief Reads back a trace written by AccessTraceWriter, one event at a time.
+ */
+class AccessTraceReader {
+ public:
+  /**
+   * Opens a trace.
+   *
+   * @param name  Name of the trace file.
+   * @throws TraceIOException If the file can't be opened or isn't a trace.
+   */
+  explicit AccessTraceReader(const std::string& name);
+
+  ~AccessTraceReader();
+
+  /**
+   * Reads the next event.
+   *
+   * @param event  Set to the event read.
+   * @return  False at the end of the trace.  A trace cut short in the middle
+   *          of an event, as by a crash, ends before that event.
+   * @throws TraceIOException If the file can't be read or is corrupt.
+   */
+  bool next(TraceEvent& event);
+
+  /**
+   * Returns the names of the files seen so far, indexed by TraceEvent::file.
+   */
+  const std::vector<std::string>& fileNames() const { return file_names_; }
+
+ private:
+  /**
+   * Reads the next byte.
+   *
+   * @return  False at the end of the file.
+   */
+  bool getByte(std::uint8_t& byte);
+
+  /**
+   * Reads a variable length integer.
+   *
+   * @return  False at the end of the file.
+   */
+  bool getNumber(std::uint64_t& value);
+
+  /**
+   * Name of the trace file.
+   */
+  std::string name_;
+
+  /**
+   * Descriptor of the trace file.
+   */
+  int fd_;
+
+  /**
+   * Bytes read from the file and not yet used, from <position_> on.
+   */
+  std::string buffer_;
+
+  /**
+   * Position of the next unused byte in <buffer_>.
+   */
+  std::size_t position_;
+
+  /**
+   * Names of the files, by number.
+   */
+  std::vector<std::string> file_names_;
+
+  AccessTraceReader(const AccessTraceReader&);
+  AccessTraceReader& operator=(const AccessTraceReader&);
+};
+
+}
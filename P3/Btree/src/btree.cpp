@@ -26,7 +26,8 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
 		std::string & outIndexName,
 		BufMgr *bufMgrIn,
 		const int attrByteOffset,
-		const Datatype attrType)
+		const Datatype attrType,
+		const bool compressed)
 {
   std::ostringstream	idxStr;
   idxStr << relationName << '.' << attrByteOffset;
@@ -35,30 +36,28 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
   this->bufMgr = bufMgrIn;
   this->attrByteOffset = attrByteOffset;
   this->attributeType = attrType;
+  this->scanExecuting = false;
 
   if (true == badgerdb::BlobFile::exists(indexName)) {
     this->file = new BlobFile(indexName, false);
+    this->bufMgr->warmUp(this->file);
     this->headerPageNum = this->file->getFirstPageNo();
-    Page *headerPage;
-    this->bufMgr->readPage(this->file, this->headerPageNum, headerPage);
-    IndexMetaInfo* metaData = reinterpret_cast<IndexMetaInfo*>(headerPage);
+    PageHandle headerPage = this->bufMgr->readPage(this->file, this->headerPageNum);
+    IndexMetaInfo* metaData = reinterpret_cast<IndexMetaInfo*>(headerPage.get());
     this->rootPageNum = metaData->rootPageNo;
-    this->bufMgr->unPinPage(this->file, this->headerPageNum, false);
   } else {
-    this->file = new BlobFile(indexName, true);
-
-    Page *headerPage, *rootPage;
+    this->file = new BlobFile(indexName, true, compressed);
 
-    this->bufMgr->allocPage(this->file, this->headerPageNum, headerPage);
-    this->bufMgr->allocPage(this->file, this->rootPageNum, rootPage);
+    PageHandle headerPage = this->bufMgr->allocPage(this->file, this->headerPageNum);
+    PageHandle rootPage = this->bufMgr->allocPage(this->file, this->rootPageNum);
     IndexMetaInfo metaData;
     metaData.attrByteOffset = this->attrByteOffset;
     metaData.attrType = this->attributeType;
     strncpy(metaData.relationName, relationName.c_str(), sizeof(metaData.relationName)-1);
     metaData.relationName[19] = '\0';
     metaData.rootPageNo = this->rootPageNum;
-    memcpy(headerPage, &metaData, sizeof(IndexMetaInfo));
-    this->bufMgr->unPinPage(this->file, this->headerPageNum, true);
+    memcpy(headerPage.write(), &metaData, sizeof(IndexMetaInfo));
+    headerPage.release();
 
     switch (this->attributeType) {
     case INTEGER:
@@ -76,23 +75,18 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
 
     {
       FileScan fscan(relationName, bufMgr);
-      try
+      RecordId scanRid;
+      while(fscan.tryScanNext(scanRid))
       {
-        RecordId scanRid;
-        while(1)
-        {
-          fscan.scanNext(scanRid);
-          //Assuming RECORD.i is our key, lets extract the key, which we know is INTEGER and whose byte offset is also know inside the record.
-          std::string recordStr = fscan.getRecord();
-          const char *record = recordStr.c_str();
-          void* key = (void*)(record + this->attrByteOffset);
-          this->insertEntry(key, scanRid);
+        //Assuming RECORD.i is our key, lets extract the key, which we know is INTEGER and whose byte offset is also know inside the record.
+        std::string recordStr = fscan.getRecord();
+        const char *record = recordStr.c_str();
+        void* key = (void*)(record + this->attrByteOffset);
+        this->insertEntry(key, scanRid);
 #ifdef DEBUG
-          this->bufMgr->flushFile(this->file);
+        this->bufMgr->flushFile(this->file);
 #endif
-        }
       }
-      catch(EndOfFileException e) { }
     }
     // filescan goes out of scope here, so relation file gets closed.
   }
@@ -105,6 +99,8 @@ BTreeIndex::BTreeIndex(const std::string & relationName,
 
 BTreeIndex::~BTreeIndex()
 {
+  // A scan left open still pins its leaf.
+  this->currentPage.release();
   this->bufMgr->flushFile(this->file);
   delete this->file;
 }
@@ -201,26 +197,26 @@ const void BTreeIndex::startScan(const void* lowValParm,
 // -----------------------------------------------------------------------------
 
 const void BTreeIndex::scanNext(RecordId& outRid) 
+{
+  if (!this->tryScanNext(outRid)) throw IndexScanCompletedException();
+}
+
+// -----------------------------------------------------------------------------
+// BTreeIndex::tryScanNext
+// -----------------------------------------------------------------------------
+
+bool BTreeIndex::tryScanNext(RecordId& outRid) 
 {
   if(this->scanExecuting == false) throw ScanNotInitializedException();
   switch (this->attributeType) {
     case INTEGER:
-    {
-      this->scanNextTemplate<int>(outRid);
-      break;
-    }
+      return this->tryScanNextTemplate<int>(outRid);
     case DOUBLE:
-    {
-      this->scanNextTemplate<double>(outRid);
-      break;
-    }
+      return this->tryScanNextTemplate<double>(outRid);
     case STRING:
-    {
-      this->scanNextTemplate<char*>(outRid);
-      break;
-    }
+      return this->tryScanNextTemplate<char*>(outRid);
     default:
-      break;
+      return false;
   }
 }
 
@@ -232,6 +228,7 @@ const void BTreeIndex::endScan()
 {
   if (this->scanExecuting == false) throw ScanNotInitializedException();
   this->scanExecuting = false;
+  this->currentPage.release();
 }
 
 }
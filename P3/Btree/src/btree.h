@@ -11,6 +11,7 @@
 #include <string>
 #include "string.h"
 #include <sstream>
+#include <map>
 #include <vector>
 
 #include "types.h"
@@ -305,6 +306,15 @@ struct LeafNodeString{
 	PageId rightSibPageNo;
 };
 
+static_assert(sizeof(NonLeafNodeInt) <= Page::SIZE &&
+              sizeof(NonLeafNodeDouble) <= Page::SIZE &&
+              sizeof(NonLeafNodeString) <= Page::SIZE,
+              "Non-leaf nodes must fit in a page.");
+static_assert(sizeof(LeafNodeInt) <= Page::SIZE &&
+              sizeof(LeafNodeDouble) <= Page::SIZE &&
+              sizeof(LeafNodeString) <= Page::SIZE,
+              "Leaf nodes must fit in a page.");
+
 /**
  * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
  * relation. This index supports only one scan at a time.
@@ -353,6 +363,12 @@ class BTreeIndex {
    */
 	int		nodeOccupancy;
 
+  /**
+   * Where the non-leaf nodes were last found in the buffer pool, so descending the tree reads them without pinning
+   * them or looking them up.
+   */
+	std::map<PageId, PageLocation>	nodeLocations;
+
 
 	// MEMBERS SPECIFIC TO SCANNING
 
@@ -362,19 +378,19 @@ class BTreeIndex {
 	bool		scanExecuting;
 
   /**
-   * Index of next entry to be scanned in current leaf being scanned.
+   * Frames the scan reads leaves into, so a long scan doesn't evict the rest of the index from the buffer pool.
    */
-	int		nextEntry;
+	BufferRing	scanRing;
 
   /**
-   * Page number of current page being scanned.
+   * Index of next entry to be scanned in current leaf being scanned.
    */
-	PageId	currentPageNum;
+	int		nextEntry;
 
   /**
-   * Current Page being scanned.
+   * Current Page being scanned, pinned until the scan moves off it or ends.
    */
-	Page		*currentPageData;
+	PageHandle	currentPage;
 
   /**
    * Low INTEGER value for scan.
@@ -429,10 +445,12 @@ class BTreeIndex {
    * @param bufMgrIn						Buffer Manager Instance
    * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
    * @param attrType						Datatype of attribute over which index is built
+   * @param compressed					Whether a newly created index file stores its pages compressed. Ignored when the index file already exists.
    * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
    */
 	BTreeIndex(const std::string & relationName, std::string & outIndexName,
-						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType,
+						const bool compressed = false);
 	
 
   /**
@@ -485,6 +503,16 @@ class BTreeIndex {
 	const void scanNext(RecordId& outRid);  // returned record id
 
 
+  /**
+	 * Fetch the record id of the next index entry that matches the scan, like scanNext, but report the end of the scan
+	 * through the return value instead of an exception.  Once the scan is completed every further call returns false.
+   * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+   * @return  False if no more records, satisfying the scan criteria, are left to be scanned.
+	 * @throws ScanNotInitializedException If no scan has been initialized.
+	**/
+	bool tryScanNext(RecordId& outRid);
+
+
   /**
 	 * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
 	 * @throws ScanNotInitializedException If no scan has been initialized.
@@ -503,17 +531,17 @@ private:
 	template <typename keyType, typename traits=keyTraits<keyType> >
 	const void startScanTemplate(const void* lowVal, const void* highVal);
 
-	///@brief Templated routine with keyType as template parameter for call from scanNext routine.
+	///@brief Templated routine with keyType as template parameter for call from tryScanNext routine.
   template <typename keyType, typename traits=keyTraits<keyType> >
-  const void scanNextTemplate(RecordId& outRid);
+  bool tryScanNextTemplate(RecordId& outRid);
 
   ///@brief Templated routine with keyType as template parameter for call from insertKeyTemplate routine.
 	template <typename keyType, typename traits=keyTraits<keyType> >
-  void getPageNoAndOffsetOfKeyInsert(const void* key, Page* rootPage, PageId& pageNo, int& insertAt, int& endOfRecordsOffset, PageId& lastPageNo, bool insert = true);
+  void getPageNoAndOffsetOfKeyInsert(const void* key, PageId& pageNo, int& insertAt, int& endOfRecordsOffset, PageId& lastPageNo, bool insert = true);
 
 	///@brief Templated routine with keyType as template parameter for call from constructor.
 	template <typename keyType, typename traits=keyTraits<keyType> >
-	void createRoot(Page*& rootPage);
+	void createRoot(PageHandle& rootPage);
 
 	///@brief Templated routine with keyType as template parameter for call from insertKey routine.
   template <typename keyType, typename traits=keyTraits<keyType> >
@@ -537,7 +565,7 @@ private:
   
   ///@brief Templated routine with keyType as template parameter for getting left and right sibling page occupancy
   template<typename keyType, typename traits=keyTraits<keyType>>
-  void getLeftRightSiblingOccupancy (Page* currPage, PageId& leftSibling, Page*& leftSib, int& leftOccupancy, PageId& rightSibling, Page*& rightSib, int& rightOccupancy, std::vector<std::pair<int,PageId>>& pathOfTraversal, bool dataPage, PageId parentPageId);
+  void getLeftRightSiblingOccupancy (Page* currPage, PageId& leftSibling, PageHandle& leftSib, int& leftOccupancy, PageId& rightSibling, PageHandle& rightSib, int& rightOccupancy, std::vector<std::pair<int,PageId>>& pathOfTraversal, bool dataPage, PageId parentPageId);
   
   ///@brief Templated routine with keyType as template parameter for deleting entry in non-leaf page
   template<typename keyType, typename traits=keyTraits<keyType>>
@@ -732,70 +760,72 @@ public:
 };
 
 /**
- * @param rootPage  The root page in which root page is to be created.
+ * @param rootPage  The root page in which root page is to be created.  Unpinned once written.
  */
 template<typename keyType, typename traits>
-void BTreeIndex::createRoot(Page*& rootPage) {
+void BTreeIndex::createRoot(PageHandle& rootPage) {
   typedef typename traits::nonLeafType nonLeafType;
   nonLeafType rootData;
   memset(&rootData, 0, sizeof(nonLeafType));
   rootData.level = 1;
-  memcpy(rootPage, &rootData, sizeof(nonLeafType));
-  this->bufMgr->unPinPage(this->file, this->rootPageNum, true);
+  memcpy(rootPage.write(), &rootData, sizeof(nonLeafType));
+  rootPage.release();
 }
 
 template<typename keyType, typename traits>
-void BTreeIndex::getPageNoAndOffsetOfKeyInsert(const void* key, Page* rootPage, PageId& pageNo, int& insertAt, int& endOfRecordsOffset, PageId& lastPageNo, bool insert)
+void BTreeIndex::getPageNoAndOffsetOfKeyInsert(const void* key, PageId& pageNo, int& insertAt, int& endOfRecordsOffset, PageId& lastPageNo, bool insert)
 {
   typedef typename traits::leafType leafType;
   typedef typename traits::nonLeafType nonLeafType;
   int i = 0, depth = 1;
   keyType keyValue = traits::getKeyValue(key);
-  nonLeafType* rootData = reinterpret_cast<nonLeafType*>(rootPage);
-  nonLeafType* currPage = rootData;
   // <going to pade index , coming from page id>
   std::vector<std::pair<int,PageId>> pathOfTraversal;
   PageId lastPage = this->rootPageNum;
-  Page* tempPage;
-  while (depth < rootData->level) {
-    if (traits::less(keyValue,currPage->keyArray[0])) {
-      // Case smaller than all keys
-      i = 0;
-      pathOfTraversal.push_back(std::pair<int,PageId>(i, lastPage));
-    } else {
-      // invariant page[i] contains keys >= key[i-1]
-      // invariant page[i] contains keys < key [i]
-      for (i = 0; i < traits::NONLEAFSIZE; i++) {
-        if (currPage->pageNoArray[i+1] == Page::INVALID_NUMBER) {
-          pathOfTraversal.push_back(std::pair<int,PageId>(i, lastPage));
+  // The non-leaf nodes are read without pinning them.  A node may change while it is read, in which case it is read
+  // again, so the readers only work out where to go next and nothing is done with it until the read succeeds.
+  int rootLevel = 0;
+  this->bufMgr->readOptimistic(this->file, lastPage, [&rootLevel](const Page& page) {
+    rootLevel = reinterpret_cast<const nonLeafType*>(&page)->level;
+  }, &this->nodeLocations[lastPage]);
+  while (depth < rootLevel) {
+    PageId nextPage = Page::INVALID_NUMBER;
+    this->bufMgr->readOptimistic(this->file, lastPage, [&](const Page& page) {
+      // the key comparisons take non-const keys, but only read them
+      nonLeafType* currPage = reinterpret_cast<nonLeafType*>(const_cast<Page*>(&page));
+      if (traits::less(keyValue,currPage->keyArray[0])) {
+        // Case smaller than all keys
+        i = 0;
+      } else {
+        // invariant page[i] contains keys >= key[i-1]
+        // invariant page[i] contains keys < key [i]
+        for (i = 0; i < traits::NONLEAFSIZE; i++) {
+          if (currPage->pageNoArray[i+1] == Page::INVALID_NUMBER) {
+            break;
+          }
+          /* 1st page contains keys greater than key[0] so if keyValue is greater than key[1]:
+           * the key must lie in page[2] or ahead. Since page[2] contains keys greater than key[1] */
+          if (traits::lessE(currPage->keyArray[i],keyValue)) {
+            // If the next page is not invalid, it might contain the key, so continue.
+            continue; // means if this was the last page in the node, we need to add to this page only otherwise continue
+          }
           break;
         }
-        /* 1st page contains keys greater than key[0] so if keyValue is greater than key[1]:
-         * the key must lie in page[2] or ahead. Since page[2] contains keys greater than key[1] */
-        if (traits::lessE(currPage->keyArray[i],keyValue)) {
-          // If the next page is not invalid, it might contain the key, so continue.
+      }
+      nextPage = currPage->pageNoArray[i];
+    }, &this->nodeLocations[lastPage]);
 #ifdef DEBUG
-          // keys all smaller than keyArray[i] should lie in this page so it should be valid
-          assert(currPage->pageNoArray[i] != Page::INVALID_NUMBER);
-          // keys all greater than equal to keyArray[i] should lie in page[i+1] or ahead.
-          assert(currPage->pageNoArray[i+1] != Page::INVALID_NUMBER);
+    // keys all smaller than keyArray[i] should lie in this page so it should be valid
+    assert(nextPage != Page::INVALID_NUMBER);
 #endif
-            continue; // means if this was the last page in the node, we need to add to this page only otherwise continue
-        }
-        pathOfTraversal.push_back(std::pair<int,PageId>(i, lastPage));
-        break;
-      }
-    }
-    if (i == traits::NONLEAFSIZE) {
-      pathOfTraversal.push_back(std::pair<int,PageId>(i, lastPage));
-    }
     // TODO karantalreja : if i == traits::NONLEAFSIZE then need to split page
-    this->bufMgr->unPinPage(this->file, lastPage, false);
-    this->bufMgr->readPage(this->file, currPage->pageNoArray[i], tempPage);
-    lastPage = currPage->pageNoArray[i];
-    currPage = reinterpret_cast<nonLeafType*>(tempPage);
+    pathOfTraversal.push_back(std::pair<int,PageId>(i, lastPage));
+    lastPage = nextPage;
     depth++;
   }
+  // Page the traversal ends on, the leaf, which is pinned.
+  PageHandle tempPage = this->bufMgr->readPage(this->file, lastPage);
+  nonLeafType* currPage = reinterpret_cast<nonLeafType*>(tempPage.get());
   pageNo = lastPage;
   i = 0;
   insertAt = traits::LEAFSIZE;
@@ -814,22 +844,23 @@ void BTreeIndex::getPageNoAndOffsetOfKeyInsert(const void* key, Page* rootPage,
   bool done = false;
   if (i == traits::LEAFSIZE) {
     // split data page
-    Page* greaterKey;
+    PageHandle greaterKey;
     int medianIdx = traits::LEAFSIZE/2;
     PageId GparentPageId;
     int Goffset;
     nonLeafType* GparentData;
+    // The parent the new data page goes into stays pinned until it is added there.
+    PageHandle GparentPage;
     int k=0;
     while (pathOfTraversal.size() >= 1) {
       PageId parentPageId;
       int offset;
-      Page* parentPage;
       nonLeafType* parentData;
       parentPageId = pathOfTraversal.back().second;
       offset = pathOfTraversal.back().first;  // The page idx in parent pageArray in which the key wants to go.
       pathOfTraversal.pop_back();
-      this->bufMgr->readPage(this->file, parentPageId, parentPage);
-      parentData = reinterpret_cast<nonLeafType*>(parentPage);
+      PageHandle parentPage = this->bufMgr->readPage(this->file, parentPageId);
+      parentData = reinterpret_cast<nonLeafType*>(parentPage.get());
       if (done == false) {
         GparentPageId = parentPageId;
         Goffset = offset;
@@ -841,22 +872,23 @@ void BTreeIndex::getPageNoAndOffsetOfKeyInsert(const void* key, Page* rootPage,
 
       // Split parent page
       if (k == traits::NONLEAFSIZE+1) {
-        Page* greaterParentPage;
+        PageHandle greaterParentPage;
         int medianIdxParent = traits::NONLEAFSIZE/2;
         nonLeafType newRootData;
-        Page* newRoot;
+        PageHandle newRoot;
         int parentParentOffset = 0;
         PageId parentParentPageId;
+        parentPage.markDirty();
         if (pathOfTraversal.empty()) {
-          this->bufMgr->allocPage(this->file, this->rootPageNum, newRoot);
+          newRoot = this->bufMgr->allocPage(this->file, this->rootPageNum);
           parentParentPageId = this->rootPageNum;
           memset(&newRootData, 0, sizeof(nonLeafType));
           newRootData.level = parentData->level+1;
           newRootData.pageNoArray[0] = parentPageId;
         } else {
           parentParentPageId = pathOfTraversal.back().second;
-          this->bufMgr->readPage(this->file, parentParentPageId, newRoot);
-          newRootData = *reinterpret_cast<nonLeafType*>(newRoot);
+          newRoot = this->bufMgr->readPage(this->file, parentParentPageId);
+          newRootData = *reinterpret_cast<nonLeafType*>(newRoot.get());
           parentParentOffset = pathOfTraversal.back().first;
         }
         for (k = parentParentOffset; k <= traits::NONLEAFSIZE; k++) {
@@ -869,7 +901,7 @@ void BTreeIndex::getPageNoAndOffsetOfKeyInsert(const void* key, Page* rootPage,
 #ifdef DEBUG
         assert(newRootData.pageNoArray[parentParentOffset+1] == Page::INVALID_NUMBER || newRootData.pageNoArray[parentParentOffset] == newRootData.pageNoArray[parentParentOffset+1]);
 #endif
-        this->bufMgr->allocPage(this->file, newRootData.pageNoArray[parentParentOffset+1], greaterParentPage);
+        greaterParentPage = this->bufMgr->allocPage(this->file, newRootData.pageNoArray[parentParentOffset+1]);
         traits::assign(newRootData.keyArray[parentParentOffset], parentData->keyArray[medianIdxParent]);
 
         nonLeafType dataPageRight;
@@ -888,7 +920,7 @@ void BTreeIndex::getPageNoAndOffsetOfKeyInsert(const void* key, Page* rootPage,
 
         if (done == false) {
           if (traits::greatE(keyValue,newRootData.keyArray[parentParentOffset])) {
-            GparentData = reinterpret_cast<nonLeafType*>(greaterParentPage);
+            GparentData = reinterpret_cast<nonLeafType*>(greaterParentPage.get());
             Goffset = offset - medianIdxParent - 1;
             i = Goffset - 1;
             GparentPageId = newRootData.pageNoArray[parentParentOffset+1];
@@ -901,26 +933,16 @@ void BTreeIndex::getPageNoAndOffsetOfKeyInsert(const void* key, Page* rootPage,
           }
         }
 
-        memcpy(newRoot, &newRootData, sizeof(nonLeafType));
-        memcpy(greaterParentPage, &dataPageRight, sizeof(nonLeafType));
+        memcpy(newRoot.write(), &newRootData, sizeof(nonLeafType));
+        memcpy(greaterParentPage.write(), &dataPageRight, sizeof(nonLeafType));
 
-        this->bufMgr->unPinPage(this->file, parentParentPageId, true);
-        if (traits::greatE(keyValue, newRootData.keyArray[parentParentOffset])) {
-          this->bufMgr->unPinPage(this->file, newRootData.pageNoArray[parentParentOffset], true);
-          if (newRootData.level >= 4)
-            this->bufMgr->unPinPage(this->file, newRootData.pageNoArray[parentParentOffset+1], true);
-        } else {
-          this->bufMgr->unPinPage(this->file, newRootData.pageNoArray[parentParentOffset+1], true);
-          if (newRootData.level >= 4)
-            this->bufMgr->unPinPage(this->file, newRootData.pageNoArray[parentParentOffset], true);
-        }
+        if (GparentPageId == parentPageId) GparentPage = std::move(parentPage);
+        else if (GparentPageId == newRootData.pageNoArray[parentParentOffset+1]) GparentPage = std::move(greaterParentPage);
       } else {
-        if (GparentPageId != parentPageId)
-          this->bufMgr->unPinPage(this->file, parentPageId, true);
+        if (GparentPageId == parentPageId) GparentPage = std::move(parentPage);
         break;
       }
     }
-    PageId parentPageId = GparentPageId;
     int offset = Goffset;
     nonLeafType* parentData = GparentData;
 
@@ -944,7 +966,9 @@ void BTreeIndex::getPageNoAndOffsetOfKeyInsert(const void* key, Page* rootPage,
     // if its the first empty slot its value should be Page::INVALID_NUMBER
     assert(parentData->pageNoArray[offset+1] == Page::INVALID_NUMBER || parentData->pageNoArray[offset] == parentData->pageNoArray[offset+1]);
 #endif
-    this->bufMgr->allocPage(this->file, parentData->pageNoArray[offset+1], greaterKey);
+    GparentPage.markDirty();
+    tempPage.markDirty();
+    greaterKey = this->bufMgr->allocPage(this->file, parentData->pageNoArray[offset+1]);
     leafType dataPageRight;
     memset(&dataPageRight, 0, sizeof(leafType));
     dataPageRight.rightSibPageNo = dataPage->rightSibPageNo;
@@ -970,7 +994,7 @@ void BTreeIndex::getPageNoAndOffsetOfKeyInsert(const void* key, Page* rootPage,
       dataPage->ridArray[i].page_number = Page::INVALID_NUMBER;
       dataPage->ridArray[i].slot_number = 0;
     }
-    memcpy(greaterKey, &dataPageRight, sizeof(leafType));
+    memcpy(greaterKey.write(), &dataPageRight, sizeof(leafType));
 #ifdef DEBUG
     if (traits::great(keyValue,dataPageRight.keyArray[0])) {
       assert(insertAt == 0 || traits::less(dataPageRight.keyArray[insertAt-1], keyValue));
@@ -980,11 +1004,11 @@ void BTreeIndex::getPageNoAndOffsetOfKeyInsert(const void* key, Page* rootPage,
       assert(insertAt == traits::LEAFSIZE || insertAt == endOfRecordsOffset || traits::great(dataPage->keyArray[insertAt],keyValue));
     }
 #endif
-    this->bufMgr->unPinPage(this->file, lastPage, true);
-    this->bufMgr->unPinPage(this->file, parentPageId, true);
-    this->bufMgr->unPinPage(this->file, parentData->pageNoArray[offset+1], true);
+    tempPage.release();
+    GparentPage.release();
+    greaterKey.release();
   } else {
-    this->bufMgr->unPinPage(this->file, lastPage, false);
+    tempPage.release();
     endOfRecordsOffset = i;
     lastPageNo = pageNo;
   }
@@ -998,17 +1022,14 @@ void BTreeIndex::getPageNoAndOffsetOfKeyInsert(const void* key, Page* rootPage,
 
 
 template <typename keyType, class traits>
-const void BTreeIndex::scanNextTemplate(RecordId& outRid) {
-  if (this->currentPageData == NULL) throw IndexScanCompletedException();
+bool BTreeIndex::tryScanNextTemplate(RecordId& outRid) {
+  if (!this->currentPage) return false;
   typedef typename traits::leafType leafType;
-  leafType* dataPage = reinterpret_cast<leafType*>(this->currentPageData);
-  if (this->highOp == LT && traits::greatE(dataPage->keyArray[this->nextEntry],traits::getUpperBound(this))) {
-    this->bufMgr->unPinPage(this->file, this->currentPageNum, false);
-    throw IndexScanCompletedException();
-  }
-  if (this->highOp == LTE && traits::great(dataPage->keyArray[this->nextEntry],traits::getUpperBound(this))) {
-    this->bufMgr->unPinPage(this->file, this->currentPageNum, false);
-    throw IndexScanCompletedException();
+  leafType* dataPage = reinterpret_cast<leafType*>(this->currentPage.get());
+  if ((this->highOp == LT && traits::greatE(dataPage->keyArray[this->nextEntry],traits::getUpperBound(this))) ||
+      (this->highOp == LTE && traits::great(dataPage->keyArray[this->nextEntry],traits::getUpperBound(this)))) {
+    this->currentPage.release();
+    return false;
   }
   outRid = dataPage->ridArray[this->nextEntry];
   #ifdef DEBUG
@@ -1017,39 +1038,39 @@ const void BTreeIndex::scanNextTemplate(RecordId& outRid) {
   #endif
   if (this->nextEntry + 1 == traits::LEAFSIZE || dataPage->ridArray[this->nextEntry+1].page_number == Page::INVALID_NUMBER) {
     this->nextEntry = 0;
-    this->bufMgr->unPinPage(this->file, this->currentPageNum, false);
-    this->currentPageNum = dataPage->rightSibPageNo;
-    if (this->currentPageNum == Page::INVALID_NUMBER) {
-      this->currentPageData = NULL;
-    } else this->bufMgr->readPage(this->file, this->currentPageNum, this->currentPageData);
+    // Unpin the leaf before reading the next one, so the scan ring can reuse its frame.
+    PageId nextPageNum = dataPage->rightSibPageNo;
+    this->currentPage.release();
+    if (nextPageNum != Page::INVALID_NUMBER) {
+      this->currentPage = this->bufMgr->readPage(this->file, nextPageNum, ACCESS_SEQUENTIAL, &this->scanRing);
+      // Start reading the next leaf while this one is scanned.
+      PageId nextLeaf = reinterpret_cast<leafType*>(this->currentPage.get())->rightSibPageNo;
+      if (nextLeaf != Page::INVALID_NUMBER) this->bufMgr->prefetch(this->file, std::vector<PageId>(1, nextLeaf));
+    }
   } else this->nextEntry++;
+  return true;
 }
 
 template <typename keyType, class traits>
 const void BTreeIndex::startScanTemplate(const void* lowVal, const void* highVal) {
   traits::setScanBounds(this, lowVal, highVal);
   typedef typename traits::leafType leafType;
-  Page* rootPage;
-  this->bufMgr->readPage(this->file, this->rootPageNum, rootPage);
   int insertAt, endOfRecordsOffset;
   PageId dataPageNum, dataPageNumPrev;
-  this->getPageNoAndOffsetOfKeyInsert<keyType>(lowVal, rootPage, dataPageNum, insertAt, endOfRecordsOffset, dataPageNumPrev, false);
+  this->getPageNoAndOffsetOfKeyInsert<keyType>(lowVal, dataPageNum, insertAt, endOfRecordsOffset, dataPageNumPrev, false);
   if (dataPageNumPrev == dataPageNum) { //TODO karantalreja : Handle the non equal case
-    this->currentPageNum = dataPageNum;
-    this->bufMgr->readPage(this->file, this->currentPageNum, this->currentPageData);
+    this->currentPage = this->bufMgr->readPage(this->file, dataPageNum, ACCESS_SEQUENTIAL, &this->scanRing);
     this->nextEntry = insertAt;
-    leafType* dataPage = reinterpret_cast<leafType*>(this->currentPageData);
+    leafType* dataPage = reinterpret_cast<leafType*>(this->currentPage.get());
     if (dataPage->ridArray[this->nextEntry].page_number == Page::INVALID_NUMBER) {
       if (Page::INVALID_NUMBER != dataPage->rightSibPageNo) {
         this->nextEntry = 0;
-        this->bufMgr->unPinPage(this->file, this->currentPageNum, false);
-        this->currentPageNum = dataPage->rightSibPageNo;
-        if (this->currentPageNum == Page::INVALID_NUMBER) {
-          this->currentPageData = NULL;
-          throw NoSuchKeyFoundException();
-        } else this->bufMgr->readPage(this->file, this->currentPageNum, this->currentPageData);
+        PageId nextPageNum = dataPage->rightSibPageNo;
+        this->currentPage.release();
+        this->currentPage = this->bufMgr->readPage(this->file, nextPageNum, ACCESS_SEQUENTIAL, &this->scanRing);
+        dataPage = reinterpret_cast<leafType*>(this->currentPage.get());
       } else {
-        this->bufMgr->unPinPage(this->file, this->currentPageNum, false);
+        this->currentPage.release();
         throw NoSuchKeyFoundException();
       }
     }
@@ -1057,18 +1078,19 @@ const void BTreeIndex::startScanTemplate(const void* lowVal, const void* highVal
       if (traits::equal(dataPage->keyArray[this->nextEntry],traits::getLowBound(this))) {
         if (this->nextEntry + 1 == traits::LEAFSIZE || dataPage->ridArray[this->nextEntry+1].page_number == Page::INVALID_NUMBER) {
           this->nextEntry = 0;
-          this->bufMgr->unPinPage(this->file, this->currentPageNum, false);
-          this->currentPageNum = dataPage->rightSibPageNo;
-          this->bufMgr->readPage(this->file, this->currentPageNum, this->currentPageData);
+          PageId nextPageNum = dataPage->rightSibPageNo;
+          this->currentPage.release();
+          this->currentPage = this->bufMgr->readPage(this->file, nextPageNum, ACCESS_SEQUENTIAL, &this->scanRing);
+          dataPage = reinterpret_cast<leafType*>(this->currentPage.get());
         } else this->nextEntry++;
       }
     }
     if (traits::great(dataPage->keyArray[this->nextEntry],traits::getUpperBound(this))) {
-      this->bufMgr->unPinPage(this->file, this->currentPageNum, false);
+      this->currentPage.release();
       throw NoSuchKeyFoundException();
     }
     else if (this->highOp == LT && traits::equal(dataPage->keyArray[this->nextEntry], traits::getUpperBound(this))){
-      this->bufMgr->unPinPage(this->file, this->currentPageNum, false);
+      this->currentPage.release();
       throw NoSuchKeyFoundException();
     }
   } else {
@@ -1083,14 +1105,13 @@ template <typename keyType, class traits>
 const void BTreeIndex::insertKeyTemplate(const void* key, const RecordId rid) {
   typedef typename traits::nonLeafType nonLeafType;
   typedef typename traits::leafType leafType;
-  Page* rootPage;
   keyType keyValue = traits::getKeyValue(key);
-  this->bufMgr->readPage(this->file, this->rootPageNum, rootPage);
-  nonLeafType* rootData = reinterpret_cast<nonLeafType*>(rootPage);
+  PageHandle rootPage = this->bufMgr->readPage(this->file, this->rootPageNum);
+  nonLeafType* rootData = reinterpret_cast<nonLeafType*>(rootPage.get());
   if (rootData->pageNoArray[0] == Page::INVALID_NUMBER) {
-    Page* lessKey, *greaterKey;
-    this->bufMgr->allocPage(this->file, rootData->pageNoArray[0], lessKey);
-    this->bufMgr->allocPage(this->file, rootData->pageNoArray[1], greaterKey);
+    rootPage.markDirty();
+    PageHandle lessKey = this->bufMgr->allocPage(this->file, rootData->pageNoArray[0]);
+    PageHandle greaterKey = this->bufMgr->allocPage(this->file, rootData->pageNoArray[1]);
 
     leafType dataPageLeft, dataPageRight;
     memset(&dataPageLeft, 0, sizeof(leafType));
@@ -1098,25 +1119,25 @@ const void BTreeIndex::insertKeyTemplate(const void* key, const RecordId rid) {
 
     dataPageLeft.rightSibPageNo = rootData->pageNoArray[1];
 
-    memcpy(lessKey, &dataPageLeft, sizeof(leafType));
-    this->bufMgr->unPinPage(this->file, rootData->pageNoArray[0], true);
+    memcpy(lessKey.write(), &dataPageLeft, sizeof(leafType));
+    lessKey.release();
 
     traits::assign(dataPageRight.keyArray[0],keyValue);
     dataPageRight.ridArray[0] = rid;
-    memcpy(greaterKey, &dataPageRight, sizeof(leafType));
-    this->bufMgr->unPinPage(this->file, rootData->pageNoArray[1], true);
+    memcpy(greaterKey.write(), &dataPageRight, sizeof(leafType));
+    greaterKey.release();
 
     rootData->level = 2;
     traits::assign(rootData->keyArray[0],keyValue);
-    this->bufMgr->unPinPage(this->file, this->rootPageNum, true);
+    rootPage.release();
   } else {
     PageId dataPageNum;
     PageId dataPageNumPrev;
-    Page* tempPage;
     int insertAt = -1, endOfRecordsOffset;
-    getPageNoAndOffsetOfKeyInsert<keyType>(key, rootPage, dataPageNum, insertAt, endOfRecordsOffset, dataPageNumPrev);
-    this->bufMgr->readPage(this->file, dataPageNum, tempPage);
-    leafType* dataPage = reinterpret_cast<leafType*>(tempPage);
+    rootPage.release();
+    getPageNoAndOffsetOfKeyInsert<keyType>(key, dataPageNum, insertAt, endOfRecordsOffset, dataPageNumPrev);
+    PageHandle tempPage = this->bufMgr->readPage(this->file, dataPageNum);
+    leafType* dataPage = reinterpret_cast<leafType*>(tempPage.write());
 
     for (int j = endOfRecordsOffset; j > insertAt; j--) {
       dataPage->ridArray[j] = dataPage->ridArray[j-1];
@@ -1124,7 +1145,7 @@ const void BTreeIndex::insertKeyTemplate(const void* key, const RecordId rid) {
     }
     dataPage->ridArray[insertAt] = rid;
     traits::assign(dataPage->keyArray[insertAt],keyValue);
-    this->bufMgr->unPinPage(this->file, dataPageNum, true);
+    tempPage.release();
 #ifdef DEBUG
     std::cout << "DBG: Key " << keyValue << " inserted on page " << dataPageNum << " at offset " << insertAt << ":" << endOfRecordsOffset << std::endl;
 #endif
@@ -1150,12 +1171,11 @@ PageId BTreeIndex::getSiblingPage (Page* currPage, std::vector<std::pair<int,Pag
 #endif
       PageId parentPageId = pathOfTraversal.back().second;
       int parentOffset = pathOfTraversal.back().first;
-      Page* parentPage;
+      PageHandle parentPage;
       if (parentOffset >= 1) {
-        this->bufMgr->readPage(this->file, parentPageId, parentPage);
-        nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage);
+        parentPage = this->bufMgr->readPage(this->file, parentPageId);
+        nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage.get());
         int retval =  parentData->pageNoArray[parentOffset-1];
-        this->bufMgr->unPinPage(this->file, parentPageId, true);
         return retval;
       } else if (parentPageId == this->rootPageNum) return Page::INVALID_NUMBER;
       else {
@@ -1167,10 +1187,9 @@ PageId BTreeIndex::getSiblingPage (Page* currPage, std::vector<std::pair<int,Pag
           parentOffset = pathOfTraversal[size-depth].first;
           depth++;
           if (parentOffset >= 1) {
-            this->bufMgr->readPage(this->file, parentPageId, parentPage);
-            nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage);
+            parentPage = this->bufMgr->readPage(this->file, parentPageId);
+            nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage.get());
             retval = parentData->pageNoArray[parentOffset-1];
-            this->bufMgr->unPinPage(this->file, parentPageId, true);
             offset = size-depth+1;
             break;
           }
@@ -1178,15 +1197,13 @@ PageId BTreeIndex::getSiblingPage (Page* currPage, std::vector<std::pair<int,Pag
         if (retval != Page::INVALID_NUMBER || pathOfTraversal[size-depth+1].first >= 1) {
           parentPageId = pathOfTraversal[offset].second;
           parentOffset = pathOfTraversal[offset].first;
-          this->bufMgr->readPage(this->file, parentPageId, parentPage);
-          nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage);
-          this->bufMgr->unPinPage(this->file, parentPageId, true);
+          parentPage = this->bufMgr->readPage(this->file, parentPageId);
+          nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage.get());
           parentPageId = parentData->pageNoArray[parentOffset-1];
           while (depth > 2) {
-            this->bufMgr->readPage(this->file, parentPageId, parentPage);
-            nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage);
-            retval = parentData->pageNoArray[this->getOccupancy<keyType, traits>(parentPage, false)-1];
-            this->bufMgr->unPinPage(this->file, parentPageId, true);
+            parentPage = this->bufMgr->readPage(this->file, parentPageId);
+            nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage.get());
+            retval = parentData->pageNoArray[this->getOccupancy<keyType, traits>(parentPage.get(), false)-1];
             parentPageId = retval;
             depth--;
           }
@@ -1201,12 +1218,11 @@ PageId BTreeIndex::getSiblingPage (Page* currPage, std::vector<std::pair<int,Pag
     if (right == false) {
       PageId parentPageId = pathOfTraversal[size-2].second;
       int parentOffset = pathOfTraversal[size-2].first;
-      Page* parentPage;
+      PageHandle parentPage;
       if (parentOffset >= 1) {
-        this->bufMgr->readPage(this->file, parentPageId, parentPage);
-        nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage);
+        parentPage = this->bufMgr->readPage(this->file, parentPageId);
+        nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage.get());
         int retval =  parentData->pageNoArray[parentOffset-1];
-        this->bufMgr->unPinPage(this->file, parentPageId, true);
         return retval;
       } else if (parentPageId == this->rootPageNum) return Page::INVALID_NUMBER;
       else {
@@ -1218,10 +1234,9 @@ PageId BTreeIndex::getSiblingPage (Page* currPage, std::vector<std::pair<int,Pag
           parentOffset = pathOfTraversal[size-depth].first;
           depth++;
           if (parentOffset >= 1) {
-            this->bufMgr->readPage(this->file, parentPageId, parentPage);
-            nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage);
+            parentPage = this->bufMgr->readPage(this->file, parentPageId);
+            nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage.get());
             retval = parentData->pageNoArray[parentOffset-1];
-            this->bufMgr->unPinPage(this->file, parentPageId, true);
             offset = size-depth+1;
             break;
           }
@@ -1230,15 +1245,13 @@ PageId BTreeIndex::getSiblingPage (Page* currPage, std::vector<std::pair<int,Pag
         if (retval != Page::INVALID_NUMBER || pathOfTraversal[size-depth].first >= 1) {
           parentPageId = pathOfTraversal[offset].second;
           parentOffset = pathOfTraversal[offset].first;
-          this->bufMgr->readPage(this->file, parentPageId, parentPage);
-          nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage);
-          this->bufMgr->unPinPage(this->file, parentPageId, true);
+          parentPage = this->bufMgr->readPage(this->file, parentPageId);
+          nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage.get());
           parentPageId = parentData->pageNoArray[parentOffset-1];
           while (depth > 2) {
-            this->bufMgr->readPage(this->file, parentPageId, parentPage);
-            nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage);
-            retval = parentData->pageNoArray[this->getOccupancy<keyType, traits>(parentPage, false)-1];
-            this->bufMgr->unPinPage(this->file, parentPageId, true);
+            parentPage = this->bufMgr->readPage(this->file, parentPageId);
+            nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage.get());
+            retval = parentData->pageNoArray[this->getOccupancy<keyType, traits>(parentPage.get(), false)-1];
             parentPageId = retval;
             depth--;
           }
@@ -1255,12 +1268,11 @@ PageId BTreeIndex::getSiblingPage (Page* currPage, std::vector<std::pair<int,Pag
 #endif
       PageId parentPageId = pathOfTraversal[size-2].second;
       int parentOffset = pathOfTraversal[size-2].first;
-      Page* parentPage;
+      PageHandle parentPage;
       if (parentOffset < traits::NONLEAFSIZE) {
-        this->bufMgr->readPage(this->file, parentPageId, parentPage);
-        nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage);
+        parentPage = this->bufMgr->readPage(this->file, parentPageId);
+        nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage.get());
         int retval =  parentData->pageNoArray[parentOffset+1];
-        this->bufMgr->unPinPage(this->file, parentPageId, true);
         return retval;
       } else if (parentPageId == this->rootPageNum) return Page::INVALID_NUMBER;
       else {
@@ -1272,10 +1284,9 @@ PageId BTreeIndex::getSiblingPage (Page* currPage, std::vector<std::pair<int,Pag
           parentOffset = pathOfTraversal[size-depth].first;
           depth++;
           if (parentOffset < traits::NONLEAFSIZE) {
-            this->bufMgr->readPage(this->file, parentPageId, parentPage);
-            nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage);
+            parentPage = this->bufMgr->readPage(this->file, parentPageId);
+            nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage.get());
             retval = parentData->pageNoArray[parentOffset+1];
-            this->bufMgr->unPinPage(this->file, parentPageId, true);
             offset = size-depth+1;
             break;
           }
@@ -1284,15 +1295,13 @@ PageId BTreeIndex::getSiblingPage (Page* currPage, std::vector<std::pair<int,Pag
         if (retval != Page::INVALID_NUMBER || pathOfTraversal[size-depth].first < traits::NONLEAFSIZE) {
           parentPageId = pathOfTraversal[offset].second;
           parentOffset = pathOfTraversal[offset].first;
-          this->bufMgr->readPage(this->file, parentPageId, parentPage);
-          nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage);
-          this->bufMgr->unPinPage(this->file, parentPageId, true);
+          parentPage = this->bufMgr->readPage(this->file, parentPageId);
+          nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage.get());
           parentPageId = parentData->pageNoArray[parentOffset+1];
           while (depth > 2) {
-            this->bufMgr->readPage(this->file, parentPageId, parentPage);
-            nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage);
+            parentPage = this->bufMgr->readPage(this->file, parentPageId);
+            nonLeafType* parentData = reinterpret_cast<nonLeafType*>(parentPage.get());
             retval = parentData->pageNoArray[0];
-            this->bufMgr->unPinPage(this->file, parentPageId, true);
             parentPageId = retval;
             depth--;
           }
@@ -1505,18 +1514,18 @@ void BTreeIndex::shiftLeftPage (Page* rightSib, Page* page, int startLoc, int en
   }
 }
 template<typename keyType, typename traits>
-void BTreeIndex::getLeftRightSiblingOccupancy (Page* currPage, PageId& leftSibling, Page*& leftSib, int& leftOccupancy, PageId& rightSibling, Page*& rightSib, int& rightOccupancy, std::vector<std::pair<int,PageId>>& pathOfTraversal, bool dataPage, PageId parentPageId) {
+void BTreeIndex::getLeftRightSiblingOccupancy (Page* currPage, PageId& leftSibling, PageHandle& leftSib, int& leftOccupancy, PageId& rightSibling, PageHandle& rightSib, int& rightOccupancy, std::vector<std::pair<int,PageId>>& pathOfTraversal, bool dataPage, PageId parentPageId) {
   leftSibling = this->getSiblingPage<keyType, traits>(currPage, pathOfTraversal, dataPage, false, parentPageId);
   leftOccupancy = -1;
   if (leftSibling != Page::INVALID_NUMBER) {
-    this->bufMgr->readPage(this->file, leftSibling, leftSib);
-    leftOccupancy = this->getOccupancy<keyType, traits>(leftSib, dataPage);
+    leftSib = this->bufMgr->readPage(this->file, leftSibling);
+    leftOccupancy = this->getOccupancy<keyType, traits>(leftSib.get(), dataPage);
   }
   rightSibling = this->getSiblingPage<keyType, traits>(currPage, pathOfTraversal, dataPage, true, parentPageId);
   rightOccupancy = -1;
   if (rightSibling != Page::INVALID_NUMBER) {
-    this->bufMgr->readPage(this->file, rightSibling, rightSib);
-    rightOccupancy = this->getOccupancy<keyType, traits>(rightSib, dataPage);
+    rightSib = this->bufMgr->readPage(this->file, rightSibling);
+    rightOccupancy = this->getOccupancy<keyType, traits>(rightSib.get(), dataPage);
   }
 }
 
@@ -1525,11 +1534,11 @@ bool BTreeIndex::isStructureValid() {
   typedef typename traits::nonLeafType nonLeafType;
   typedef typename traits::leafType leafType;
   std::vector< typename std::pair< typename std::pair<PageId,keyType>, bool> > queue[2];
-  Page* page;
+  PageHandle page;
   int depth = 1;
   nonLeafType* currData; 
-  this->bufMgr->readPage(this->file, this->rootPageNum, page);
-  currData = reinterpret_cast<nonLeafType*>(page);
+  page = this->bufMgr->readPage(this->file, this->rootPageNum);
+  currData = reinterpret_cast<nonLeafType*>(page.get());
   // for max = true
   std::pair<typename std::pair<PageId,keyType>, bool> minOrMaxConstraint;
   minOrMaxConstraint.first.first = this->rootPageNum;
@@ -1537,12 +1546,12 @@ bool BTreeIndex::isStructureValid() {
   minOrMaxConstraint.second = true;
   queue[depth%2].push_back(minOrMaxConstraint);
   int maxDepth = currData->level;
-  this->bufMgr->unPinPage(this->file, this->rootPageNum, true);
+  page.release();
   while (depth < maxDepth) {
     while (!queue[depth%2].empty())
     {
-      this->bufMgr->readPage(this->file, queue[depth%2].back().first.first, page);
-      currData = reinterpret_cast<nonLeafType*>(page);
+      page = this->bufMgr->readPage(this->file, queue[depth%2].back().first.first);
+      currData = reinterpret_cast<nonLeafType*>(page.get());
       minOrMaxConstraint.first.first = currData->pageNoArray[0];
       traits::assign(minOrMaxConstraint.first.second,currData->keyArray[0]);
       minOrMaxConstraint.second = true;
@@ -1590,14 +1599,14 @@ bool BTreeIndex::isStructureValid() {
           break;
         }
       }
-      this->bufMgr->unPinPage(this->file, queue[depth%2].back().first.first, true);
+      page.release();
       queue[depth%2].pop_back();
     }
     depth++;
   }
   while (!queue[depth%2].empty()) {
-    this->bufMgr->readPage(this->file, queue[depth%2].back().first.first, page);
-    leafType* data = reinterpret_cast<leafType*>(page);
+    page = this->bufMgr->readPage(this->file, queue[depth%2].back().first.first);
+    leafType* data = reinterpret_cast<leafType*>(page.get());
     for (int i = 1; i < traits::LEAFSIZE; i++) {
       if (data->ridArray[i].page_number == Page::INVALID_NUMBER) break;
 #ifdef DEBUG 
@@ -1613,7 +1622,7 @@ bool BTreeIndex::isStructureValid() {
       }
 #endif
     }
-    this->bufMgr->unPinPage(this->file, queue[depth%2].back().first.first, true);
+    page.release();
     queue[depth%2].pop_back();
   }
   return true;
@@ -1623,20 +1632,20 @@ template<typename keyType, typename traits>
 const bool BTreeIndex::deleteKeyTemplate(const void* key) {
   typedef typename traits::nonLeafType nonLeafType;
   typedef typename traits::leafType leafType;
-  Page* rootPage;
   keyType keyValue = traits::getKeyValue(key);
 #ifdef DEBUG
     std::cout << "DBG: Key " << keyValue << " deleted through ";
 #endif
-  this->bufMgr->readPage(this->file, this->rootPageNum, rootPage);
-  nonLeafType* rootData = reinterpret_cast<nonLeafType*>(rootPage);
+  PageHandle rootPage = this->bufMgr->readPage(this->file, this->rootPageNum);
+  nonLeafType* rootData = reinterpret_cast<nonLeafType*>(rootPage.get());
   nonLeafType* currPage = rootData;
   std::vector<std::pair<int,PageId>> pathOfTraversal;
   bool retval = true;
   PageId lastPage = this->rootPageNum;
-  Page* tempPage;
+  const int rootLevel = rootData->level;
+  PageHandle currHandle = std::move(rootPage);
   int depth = 1, i = 0;
-  while (depth < rootData->level) {
+  while (depth < rootLevel) {
     if (traits::less(keyValue,currPage->keyArray[0])) {
       // Case smaller than all keys
       i = 0;
@@ -1668,13 +1677,11 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
     if (i == traits::NONLEAFSIZE) {
       pathOfTraversal.push_back(std::pair<int,PageId>(i, lastPage));
     }
-    this->bufMgr->unPinPage(this->file, lastPage, false);
-    this->bufMgr->readPage(this->file, currPage->pageNoArray[i], tempPage);
     lastPage = currPage->pageNoArray[i];
-    currPage = reinterpret_cast<nonLeafType*>(tempPage);
+    currHandle = this->bufMgr->readPage(this->file, lastPage);
+    currPage = reinterpret_cast<nonLeafType*>(currHandle.get());
     depth++;
   }
-  PageId dataPageId = lastPage;
   i = 0;
   int startLoc = traits::LEAFSIZE, endLoc;
   leafType* dataPage = reinterpret_cast<leafType*>(currPage);
@@ -1697,72 +1704,65 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
   endLoc = i <= traits::LEAFSIZE ? i : traits::LEAFSIZE;
   if (!traits::equal(dataPage->keyArray[startLoc],keyValue)) retval = false;
   if (true == retval) {
+    currHandle.markDirty();
     if (endLoc > traits::LEAFSIZE/2) {
       this->deleteEntryInLeaf<keyType, traits>(reinterpret_cast<Page*>(dataPage), startLoc, endLoc);
-      this->bufMgr->unPinPage(this->file, dataPageId, true);
+      currHandle.release();
 #ifdef DEBUG 
       std::cout << "normal operation." << std::endl;
 #endif
     } else {
-      this->bufMgr->readPage(this->file, this->rootPageNum, rootPage);
-      rootData = reinterpret_cast<nonLeafType*>(rootPage);
-      int rootOccupancy = this->getOccupancy<keyType, traits>(rootPage, false);
+      rootPage = this->bufMgr->readPage(this->file, this->rootPageNum);
+      rootData = reinterpret_cast<nonLeafType*>(rootPage.get());
+      int rootOccupancy = this->getOccupancy<keyType, traits>(rootPage.get(), false);
       if (rootData->level > 2 || rootOccupancy > 2) {
-        this->bufMgr->unPinPage(this->file, this->rootPageNum, true);
+        rootPage.release();
         PageId rightSibling, leftSibling; 
-        Page* rightSib, *leftSib;
+        PageHandle rightSib, leftSib;
         int rightOccupancy = -1, leftOccupancy = -1;
         this->getLeftRightSiblingOccupancy<keyType, traits> (reinterpret_cast<Page*>(dataPage), leftSibling, leftSib, leftOccupancy,
             rightSibling, rightSib, rightOccupancy, pathOfTraversal, true, Page::INVALID_NUMBER);
         if (rightOccupancy > traits::LEAFSIZE/2) {
           // rotate leftwards from right page
-          this->shiftLeftPage<keyType, traits>(rightSib, reinterpret_cast<Page*>(dataPage), startLoc, endLoc, rightOccupancy, true);
+          this->shiftLeftPage<keyType, traits>(rightSib.write(), reinterpret_cast<Page*>(dataPage), startLoc, endLoc, rightOccupancy, true);
 
-          Page* parentPage;
-          this->bufMgr->readPage(this->file, parentPageId, parentPage);
-          nonLeafType* parentPageData = reinterpret_cast<nonLeafType*>(parentPage);
-          int parentOccupancy = this->getOccupancy<keyType, traits>(parentPage, false);
+          PageHandle parentPage = this->bufMgr->readPage(this->file, parentPageId);
+          nonLeafType* parentPageData = reinterpret_cast<nonLeafType*>(parentPage.write());
+          int parentOccupancy = this->getOccupancy<keyType, traits>(parentPage.get(), false);
 #ifdef DEBUG
           assert(parentPageOffset >= 0);
 #endif
-          if (parentPageOffset < parentOccupancy-1) traits::assign(parentPageData->keyArray[parentPageOffset], reinterpret_cast<leafType*>(rightSib)->keyArray[0]);
+          if (parentPageOffset < parentOccupancy-1) traits::assign(parentPageData->keyArray[parentPageOffset], reinterpret_cast<leafType*>(rightSib.get())->keyArray[0]);
           else {
             int size = pathOfTraversal.size();
             int k = 2;
             while (size - k >= 0) {
               PageId parentParentPageId = pathOfTraversal[size-k].second;
               int parentParentPageOffset = pathOfTraversal[size-k].first;
-              Page* tempPage;
-              this->bufMgr->readPage(this->file, parentParentPageId, tempPage);
-              nonLeafType* tempData = reinterpret_cast<nonLeafType*>(tempPage);
-              int tempOccupancy = this->getOccupancy<keyType, traits>(tempPage, false);
+              PageHandle tempPage = this->bufMgr->readPage(this->file, parentParentPageId);
+              nonLeafType* tempData = reinterpret_cast<nonLeafType*>(tempPage.write());
+              int tempOccupancy = this->getOccupancy<keyType, traits>(tempPage.get(), false);
               if (parentParentPageOffset < tempOccupancy -1) {
-                traits::assign(tempData->keyArray[parentParentPageOffset], reinterpret_cast<leafType*>(rightSib)->keyArray[0]);
-                this->bufMgr->unPinPage(this->file, parentParentPageId, true);
+                traits::assign(tempData->keyArray[parentParentPageOffset], reinterpret_cast<leafType*>(rightSib.get())->keyArray[0]);
                 break;
               }
               else {
                 k++;
-                this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                 continue;
               }
             }
           }
 
-          this->bufMgr->unPinPage(this->file, dataPageId, true);
-          if (-1 != leftOccupancy) this->bufMgr->unPinPage(this->file, leftSibling, false);
-          if (-1 != rightOccupancy) this->bufMgr->unPinPage(this->file, rightSibling, true);
-          this->bufMgr->unPinPage(this->file, parentPageId, true);
+          currHandle.release();
 #ifdef DEBUG 
           std::cout << "rotating leftwards from right page." << std::endl;
 #endif
         } else if (leftOccupancy > traits::LEAFSIZE/2) {
           // rotate rightwards from left page
-          this->shiftRightPage<keyType, traits>(leftSib, reinterpret_cast<Page*>(dataPage), startLoc, endLoc, leftOccupancy, true);
+          this->shiftRightPage<keyType, traits>(leftSib.write(), reinterpret_cast<Page*>(dataPage), startLoc, endLoc, leftOccupancy, true);
 
-          Page* parentPage;
-          this->bufMgr->readPage(this->file, parentPageId, parentPage);
-          nonLeafType* parentPageData = reinterpret_cast<nonLeafType*>(parentPage);
+          PageHandle parentPage = this->bufMgr->readPage(this->file, parentPageId);
+          nonLeafType* parentPageData = reinterpret_cast<nonLeafType*>(parentPage.write());
 #ifdef DEBUG
           assert(parentPageOffset-1 < traits::NONLEAFSIZE);
 #endif
@@ -1773,26 +1773,20 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
             while (size - k >= 0) {
               PageId parentParentPageId = pathOfTraversal[size-k].second;
               int parentParentPageOffset = pathOfTraversal[size-k].first;
-              Page* tempPage;
-              this->bufMgr->readPage(this->file, parentParentPageId, tempPage);
-              nonLeafType* tempData = reinterpret_cast<nonLeafType*>(tempPage);
+              PageHandle tempPage = this->bufMgr->readPage(this->file, parentParentPageId);
+              nonLeafType* tempData = reinterpret_cast<nonLeafType*>(tempPage.write());
               if (parentParentPageOffset >= 1) {
                 traits::assign(tempData->keyArray[parentParentPageOffset-1], dataPage->keyArray[0]);
-                this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                 break;
               }
               else {
                 k++;
-                this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                 continue;
               }
             }
           }
 
-          this->bufMgr->unPinPage(this->file, dataPageId, true);
-          if(-1 != leftOccupancy) this->bufMgr->unPinPage(this->file, leftSibling, true);
-          if (-1 != rightOccupancy) this->bufMgr->unPinPage(this->file, rightSibling, false);
-          this->bufMgr->unPinPage(this->file, parentPageId, true);
+          currHandle.release();
 #ifdef DEBUG 
           std::cout << "rotating rightwards from left page." << std::endl;
 #endif
@@ -1802,7 +1796,7 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
 #endif
           // merge with left page default, as copying in upper half array is easier
           this->deleteEntryInLeaf<keyType, traits>(reinterpret_cast<Page*>(dataPage), startLoc, endLoc);
-          leafType* leftPageData = reinterpret_cast<leafType*>(leftSib);
+          leafType* leftPageData = reinterpret_cast<leafType*>(leftSib.write());
           leftPageData->rightSibPageNo = rightSibling;
 #ifdef DEBUG
           assert(leftPageData->ridArray[leftOccupancy].page_number == Page::INVALID_NUMBER);
@@ -1811,38 +1805,34 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
             traits::assign(leftPageData->keyArray[i],dataPage->keyArray[j]);
             leftPageData->ridArray[i] = dataPage->ridArray[j];
           }
-          this->bufMgr->unPinPage(this->file, dataPageId, true);
+          currHandle.release();
           bool rotated = false;
           while (pathOfTraversal.size() >= 1) {
             parentPageOffset = pathOfTraversal.back().first;
             parentPageId = pathOfTraversal.back().second;
-            Page* parentPage;
-            this->bufMgr->readPage(this->file, parentPageId, parentPage);
-            int parentOccupancy = this->getOccupancy<keyType, traits>(parentPage, false);
-            nonLeafType* parentPageData = reinterpret_cast<nonLeafType*>(parentPage);
+            PageHandle parentPage = this->bufMgr->readPage(this->file, parentPageId);
+            int parentOccupancy = this->getOccupancy<keyType, traits>(parentPage.get(), false);
+            nonLeafType* parentPageData = reinterpret_cast<nonLeafType*>(parentPage.write());
             if (parentPageId == this->rootPageNum || parentOccupancy > traits::NONLEAFSIZE/2) {
               if (parentOccupancy > 2) {
-                if (parentPageOffset > 0) this->deleteEntryInNonLeaf<keyType, traits> (parentPage, parentPageOffset, parentOccupancy);
+                if (parentPageOffset > 0) this->deleteEntryInNonLeaf<keyType, traits> (parentPage.write(), parentPageOffset, parentOccupancy);
                 else {
                   keyType copyUpKey = keyType(0);
                   traits::assign(copyUpKey, parentPageData->keyArray[0]);
-                  this->deleteEntryInNonLeaf<keyType, traits> (parentPage, parentPageOffset, parentOccupancy);
+                  this->deleteEntryInNonLeaf<keyType, traits> (parentPage.write(), parentPageOffset, parentOccupancy);
                   int size = pathOfTraversal.size();
                   int k = 2;
                   while (size - k >= 0) {
                     PageId parentParentPageId = pathOfTraversal[size-k].second;
                     int parentParentPageOffset = pathOfTraversal[size-k].first;
-                    Page* tempPage;
-                    this->bufMgr->readPage(this->file, parentParentPageId, tempPage);
-                    nonLeafType* tempData = reinterpret_cast<nonLeafType*>(tempPage);
+                    PageHandle tempPage = this->bufMgr->readPage(this->file, parentParentPageId);
+                    nonLeafType* tempData = reinterpret_cast<nonLeafType*>(tempPage.write());
                     if (parentParentPageOffset >= 1) {
                       traits::assign(tempData->keyArray[parentParentPageOffset-1], copyUpKey);
-                      this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                       break;
                     }
                     else {
                       k++;
-                      this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                       continue;
                     }
                   }
@@ -1858,15 +1848,12 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
                 assert(0);
 #endif
               }
-              this->bufMgr->unPinPage(this->file, leftSibling, true);
-              if (rightOccupancy != -1) this->bufMgr->unPinPage(this->file, rightSibling, false);
-              this->bufMgr->unPinPage(this->file, parentPageId, true);
               break;
             } else {
               PageId pRightSibling, pLeftSibling; 
-              Page* pRightSib, *pLeftSib;
+              PageHandle pRightSib, pLeftSib;
               int pRightOccupancy = -1, pLeftOccupancy = -1;
-              this->getLeftRightSiblingOccupancy<keyType, traits> (parentPage, pLeftSibling, pLeftSib, pLeftOccupancy,
+              this->getLeftRightSiblingOccupancy<keyType, traits> (parentPage.get(), pLeftSibling, pLeftSib, pLeftOccupancy,
                   pRightSibling, pRightSib, pRightOccupancy, pathOfTraversal, false, parentPageId);
               if (pRightOccupancy > traits::NONLEAFSIZE/2) {
                 rotated = true;
@@ -1874,40 +1861,35 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
                 if (!pathOfTraversal.empty()) {
                   PageId parentParentPageOffset = pathOfTraversal.back().first;
                   int parentParentPageId = pathOfTraversal.back().second;
-                  Page* parentParentPage;
-                  this->bufMgr->readPage(this->file, parentParentPageId, parentParentPage);
-                  nonLeafType* parentParentPageData = reinterpret_cast<nonLeafType*>(parentParentPage);
-                  nonLeafType* rightPageData = reinterpret_cast<nonLeafType*>(pRightSib);
+                  PageHandle parentParentPage = this->bufMgr->readPage(this->file, parentParentPageId);
+                  nonLeafType* parentParentPageData = reinterpret_cast<nonLeafType*>(parentParentPage.write());
+                  nonLeafType* rightPageData = reinterpret_cast<nonLeafType*>(pRightSib.write());
                   keyType rightPageFirstKey = keyType(0);
                   traits::assign(rightPageFirstKey, rightPageData->keyArray[0]);
-                  if (parentPageOffset > 0) this->shiftLeftPage<keyType, traits>(pRightSib, parentPage, parentPageOffset, parentOccupancy, pRightOccupancy, false);
+                  if (parentPageOffset > 0) this->shiftLeftPage<keyType, traits>(pRightSib.write(), parentPage.write(), parentPageOffset, parentOccupancy, pRightOccupancy, false);
                   else {
                     keyType copyUpKey = keyType(0);
                     traits::assign(copyUpKey, parentPageData->keyArray[0]);
-                    this->shiftLeftPage<keyType, traits>(pRightSib, parentPage, parentPageOffset, parentOccupancy, pRightOccupancy, false);
+                    this->shiftLeftPage<keyType, traits>(pRightSib.write(), parentPage.write(), parentPageOffset, parentOccupancy, pRightOccupancy, false);
                     int size = pathOfTraversal.size();
                     int k = 1;
                     while (size - k >= 0) {
                       PageId parentParentPageId = pathOfTraversal[size-k].second;
                       int parentParentPageOffset = pathOfTraversal[size-k].first;
-                      Page* tempPage;
-                      this->bufMgr->readPage(this->file, parentParentPageId, tempPage);
-                      nonLeafType* tempData = reinterpret_cast<nonLeafType*>(tempPage);
+                      PageHandle tempPage = this->bufMgr->readPage(this->file, parentParentPageId);
+                      nonLeafType* tempData = reinterpret_cast<nonLeafType*>(tempPage.write());
                       if (parentParentPageOffset >= 1) {
                         traits::assign(tempData->keyArray[parentParentPageOffset-1], copyUpKey);
-                        this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                         break;
                       }
                       else {
                         k++;
-                        this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                         continue;
                       }
                     }
                   }
                   traits::assign(parentPageData->keyArray[parentOccupancy-2], parentParentPageData->keyArray[parentParentPageOffset]);
                   traits::assign(parentParentPageData->keyArray[parentParentPageOffset], rightPageFirstKey);
-                  this->bufMgr->unPinPage(this->file, parentParentPageId, true);
 #ifdef DEBUG 
                   std::cout << "Parent non-leaf node rotated left." << std::endl;
 #endif
@@ -1918,27 +1900,24 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
                 }
               } else if (pLeftOccupancy > traits::NONLEAFSIZE/2) {
                 rotated = true;
-                if(parentPageOffset>0) this->shiftRightPage<keyType, traits>(pLeftSib, parentPage, parentPageOffset, parentOccupancy, pLeftOccupancy, false);
+                if(parentPageOffset>0) this->shiftRightPage<keyType, traits>(pLeftSib.write(), parentPage.write(), parentPageOffset, parentOccupancy, pLeftOccupancy, false);
                 else {
                   keyType copyUpKey = keyType(0);
                   traits::assign(copyUpKey, parentPageData->keyArray[0]);
-                  this->shiftRightPage<keyType, traits>(pLeftSib, parentPage, parentPageOffset, parentOccupancy, pLeftOccupancy, false);
+                  this->shiftRightPage<keyType, traits>(pLeftSib.write(), parentPage.write(), parentPageOffset, parentOccupancy, pLeftOccupancy, false);
                   int size = pathOfTraversal.size();
                   int k = 1;
                   while (size - k >= 0) {
                     PageId parentParentPageId = pathOfTraversal[size-k].second;
                     int parentParentPageOffset = pathOfTraversal[size-k].first;
-                    Page* tempPage;
-                    this->bufMgr->readPage(this->file, parentParentPageId, tempPage);
-                    nonLeafType* tempData = reinterpret_cast<nonLeafType*>(tempPage);
+                    PageHandle tempPage = this->bufMgr->readPage(this->file, parentParentPageId);
+                    nonLeafType* tempData = reinterpret_cast<nonLeafType*>(tempPage.write());
                     if (parentParentPageOffset >= 1) {
                       traits::assign(tempData->keyArray[parentParentPageOffset-1], copyUpKey);
-                      this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                       break;
                     }
                     else {
                       k++;
-                      this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                       continue;
                     }
                   }
@@ -1947,10 +1926,9 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
                 if (!pathOfTraversal.empty()) {
                   PageId parentParentPageOffset = pathOfTraversal.back().first;
                   int parentParentPageId = pathOfTraversal.back().second;
-                  Page* parentParentPage;
-                  this->bufMgr->readPage(this->file, parentParentPageId, parentParentPage);
-                  nonLeafType* parentParentPageData = reinterpret_cast<nonLeafType*>(parentParentPage);
-                  nonLeafType* leftPageData = reinterpret_cast<nonLeafType*>(pLeftSib);
+                  PageHandle parentParentPage = this->bufMgr->readPage(this->file, parentParentPageId);
+                  nonLeafType* parentParentPageData = reinterpret_cast<nonLeafType*>(parentParentPage.write());
+                  nonLeafType* leftPageData = reinterpret_cast<nonLeafType*>(pLeftSib.write());
                   if (parentParentPageOffset >= 1) {
                     traits::assign(parentPageData->keyArray[0], parentParentPageData->keyArray[parentParentPageOffset-1]);
                     traits::assign(parentParentPageData->keyArray[parentParentPageOffset-1], leftPageData->keyArray[pLeftOccupancy-2]);
@@ -1961,23 +1939,19 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
                     while (size - k >= 0) {
                       PageId parentParentPageId = pathOfTraversal[size-k].second;
                       int parentParentPageOffset = pathOfTraversal[size-k].first;
-                      Page* tempPage;
-                      this->bufMgr->readPage(this->file, parentParentPageId, tempPage);
-                      nonLeafType* tempData = reinterpret_cast<nonLeafType*>(tempPage);
+                      PageHandle tempPage = this->bufMgr->readPage(this->file, parentParentPageId);
+                      nonLeafType* tempData = reinterpret_cast<nonLeafType*>(tempPage.write());
                       if (parentParentPageOffset >= 1) {
                         traits::assign(parentPageData->keyArray[0], tempData->keyArray[parentParentPageOffset-1]);
                         traits::assign(tempData->keyArray[parentParentPageOffset-1], leftPageData->keyArray[pLeftOccupancy-2]);
-                        this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                         break;
                       }
                       else {
                         k++;
-                        this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                         continue;
                       }
                     }
                   }
-                  this->bufMgr->unPinPage(this->file, parentParentPageId, true);
 #ifdef DEBUG 
                   std::cout << "Parent non-leaf node rotated right." << std::endl;
 #endif
@@ -1987,8 +1961,8 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
 #endif
                 }
               } else if (pLeftOccupancy != -1) {
-                this->deleteEntryInNonLeaf<keyType, traits>(parentPage, parentPageOffset, parentOccupancy);
-                nonLeafType* leftPageData = reinterpret_cast<nonLeafType*>(pLeftSib);
+                this->deleteEntryInNonLeaf<keyType, traits>(parentPage.write(), parentPageOffset, parentOccupancy);
+                nonLeafType* leftPageData = reinterpret_cast<nonLeafType*>(pLeftSib.write());
                 for (int i = pLeftOccupancy,j=1 ; i < traits::NONLEAFSIZE; i++, j++) {
                   traits::assign(leftPageData->keyArray[i],parentPageData->keyArray[j-1]);
                   leftPageData->pageNoArray[i] = parentPageData->pageNoArray[j-1];
@@ -1997,14 +1971,12 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
                 if (!pathOfTraversal.empty()) {
                   PageId parentParentPageOffset = pathOfTraversal.back().first;
                   int parentParentPageId = pathOfTraversal.back().second;
-                  Page* parentParentPage;
-                  this->bufMgr->readPage(this->file, parentParentPageId, parentParentPage);
-                  nonLeafType* parentParentPageData = reinterpret_cast<nonLeafType*>(parentParentPage);
+                  PageHandle parentParentPage = this->bufMgr->readPage(this->file, parentParentPageId);
+                  nonLeafType* parentParentPageData = reinterpret_cast<nonLeafType*>(parentParentPage.write());
 #ifdef DEBUG 
                   assert(parentParentPageOffset >= 1);
 #endif
                   traits::assign(leftPageData->keyArray[pLeftOccupancy-1], parentParentPageData->keyArray[parentParentPageOffset-1]);
-                  this->bufMgr->unPinPage(this->file, parentParentPageId, true);
 #ifdef DEBUG 
                   std::cout << "Parent non-leaf node merged with left." << std::endl;
 #endif
@@ -2014,9 +1986,9 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
 #endif
                 }
               } else if (pRightOccupancy != -1) {
-                this->deleteEntryInNonLeaf<keyType, traits>(parentPage, parentPageOffset, parentOccupancy);
+                this->deleteEntryInNonLeaf<keyType, traits>(parentPage.write(), parentPageOffset, parentOccupancy);
                 parentOccupancy-= 1;
-                nonLeafType* rightPageData = reinterpret_cast<nonLeafType*>(pRightSib);
+                nonLeafType* rightPageData = reinterpret_cast<nonLeafType*>(pRightSib.write());
                 for (int i = parentOccupancy,j = 0; i < traits::NONLEAFSIZE; j++,i++) {
                   traits::assign(parentPageData->keyArray[i],rightPageData->keyArray[j]);
                   parentPageData->pageNoArray[i] = rightPageData->pageNoArray[j];
@@ -2025,24 +1997,20 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
                 if (!pathOfTraversal.empty()) {
                   PageId parentParentPageOffset = pathOfTraversal.back().first;
                   int parentParentPageId = pathOfTraversal.back().second;
-                  Page* parentParentPage;
-                  this->bufMgr->readPage(this->file, parentParentPageId, parentParentPage);
-                  nonLeafType* parentParentPageData = reinterpret_cast<nonLeafType*>(parentParentPage);
+                  PageHandle parentParentPage = this->bufMgr->readPage(this->file, parentParentPageId);
+                  nonLeafType* parentParentPageData = reinterpret_cast<nonLeafType*>(parentParentPage.write());
                   int size = pathOfTraversal.size();
                   if (parentParentPageOffset == 0) {
-                    this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                     int k = 1;
                     while (size - k >= 0) {
                       PageId tempParentPageId = pathOfTraversal[size-k].second;
                       int tempParentPageOffset = pathOfTraversal[size-k].first;
-                      Page* tempPage;
-                      this->bufMgr->readPage(this->file, tempParentPageId, tempPage);
+                      PageHandle tempPage = this->bufMgr->readPage(this->file, tempParentPageId);
                       if (tempParentPageOffset >= 1) {
-                        parentParentPageData = reinterpret_cast<nonLeafType*>(tempPage);
+                        parentParentPageData = reinterpret_cast<nonLeafType*>(tempPage.write());
                         parentParentPageOffset = tempParentPageOffset-1;
                         parentParentPageId = tempParentPageId;
                         traits::assign(parentPageData->keyArray[parentOccupancy-1], parentParentPageData->keyArray[parentParentPageOffset]);
-                        this->bufMgr->unPinPage(this->file, tempParentPageId, true);
                         break;
                       }
                       else {
@@ -2050,16 +2018,13 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
                         if (size -k < 0) {
                           parentParentPageOffset = 0;
                           traits::assign(parentPageData->keyArray[parentOccupancy-1], parentParentPageData->keyArray[parentParentPageOffset]);
-                          this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                           break;
                         }
-                        this->bufMgr->unPinPage(this->file, tempParentPageId, true);
                       }
                     }
                   } else {
                     parentParentPageOffset = parentParentPageOffset-1;
                     traits::assign(parentPageData->keyArray[parentOccupancy-1], parentParentPageData->keyArray[parentParentPageOffset]);
-                    this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                   }
                   if (pathOfTraversal.back().first == 0) pathOfTraversal[size-1].first = 1;
 #ifdef DEBUG 
@@ -2074,41 +2039,32 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
 #ifdef DEBUG 
                 std::cout << "Non-leaf page made root." << std::endl;
 #endif
-                this->deleteEntryInNonLeaf<keyType, traits>(parentPage, parentPageOffset, parentOccupancy);
+                this->deleteEntryInNonLeaf<keyType, traits>(parentPage.write(), parentPageOffset, parentOccupancy);
                 this->rootPageNum = parentPageId;
-                if (leftOccupancy != -1) this->bufMgr->unPinPage(this->file, leftSibling, true);
-                if (rightOccupancy != -1) this->bufMgr->unPinPage(this->file, rightSibling, true);
-                this->bufMgr->unPinPage(this->file, parentPageId, true);
                 break;
               }
-              if(-1 != pLeftOccupancy) this->bufMgr->unPinPage(this->file, pLeftSibling, true);
-              if(-1 != pRightOccupancy) this->bufMgr->unPinPage(this->file, pRightSibling, true);
-              this->bufMgr->unPinPage(this->file, parentPageId, true);
             }
             if (true == rotated) {
-              if(-1 != leftOccupancy) this->bufMgr->unPinPage(this->file, leftSibling, true);
-              if(-1 != rightOccupancy) this->bufMgr->unPinPage(this->file, rightSibling, true);
               break;
             }
           }
         } else if (rightOccupancy != -1) {
           this->deleteEntryInLeaf<keyType, traits>(reinterpret_cast<Page*>(dataPage), startLoc, endLoc);
           endLoc -= 1;
-          leafType* rightPageData = reinterpret_cast<leafType*>(rightSib);
+          leafType* rightPageData = reinterpret_cast<leafType*>(rightSib.get());
           dataPage->rightSibPageNo = rightPageData->rightSibPageNo;
           for (int i = endLoc,j = 0; i < traits::LEAFSIZE; j++,i++) {
             traits::assign(dataPage->keyArray[i],rightPageData->keyArray[j]);
             dataPage->ridArray[i] = rightPageData->ridArray[j];
           }
-          this->bufMgr->unPinPage(this->file, dataPageId, true);
+          currHandle.release();
           bool rotated = false;
           while (pathOfTraversal.size() >= 1) {
             parentPageOffset = pathOfTraversal.back().first;
             parentPageId = pathOfTraversal.back().second;
-            Page* parentPage;
-            this->bufMgr->readPage(this->file, parentPageId, parentPage);
-            int parentOccupancy = this->getOccupancy<keyType, traits>(parentPage, false);
-            nonLeafType* parentPageData = reinterpret_cast<nonLeafType*>(parentPage);
+            PageHandle parentPage = this->bufMgr->readPage(this->file, parentPageId);
+            int parentOccupancy = this->getOccupancy<keyType, traits>(parentPage.get(), false);
+            nonLeafType* parentPageData = reinterpret_cast<nonLeafType*>(parentPage.write());
             if (parentPageId == this->rootPageNum || parentOccupancy > traits::NONLEAFSIZE/2) {
               if (parentPageOffset+1 <= traits::NONLEAFSIZE){
                 if (parentPageOffset == 0 && this->rootPageNum == parentPageId && parentOccupancy == 2) {
@@ -2116,22 +2072,19 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
                   parentPageData->pageNoArray[1] = Page::INVALID_NUMBER;
                   this->rootPageNum = parentPageData->pageNoArray[0];
                 } else {
-                  this->deleteEntryInNonLeaf<keyType, traits> (parentPage, parentPageOffset+1, parentOccupancy);
+                  this->deleteEntryInNonLeaf<keyType, traits> (parentPage.write(), parentPageOffset+1, parentOccupancy);
                 }
               } else {
 #ifdef DEBUG 
                 assert(0);
 #endif
               }
-              if (leftOccupancy != -1) this->bufMgr->unPinPage(this->file, leftSibling, false);
-              this->bufMgr->unPinPage(this->file, rightSibling, true);
-              this->bufMgr->unPinPage(this->file, parentPageId, true);
               break;
             } else {
               PageId pRightSibling, pLeftSibling;
-              Page* pRightSib, *pLeftSib;
+              PageHandle pRightSib, pLeftSib;
               int pRightOccupancy = -1, pLeftOccupancy = -1;
-              this->getLeftRightSiblingOccupancy<keyType, traits> (parentPage, pLeftSibling, pLeftSib, pLeftOccupancy,
+              this->getLeftRightSiblingOccupancy<keyType, traits> (parentPage.get(), pLeftSibling, pLeftSib, pLeftOccupancy,
                   pRightSibling, pRightSib, pRightOccupancy, pathOfTraversal, false, parentPageId);
               if (pRightOccupancy > traits::NONLEAFSIZE/2) {
                 rotated = true;
@@ -2139,34 +2092,30 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
                 if (!pathOfTraversal.empty()) {
                   PageId parentParentPageOffset = pathOfTraversal.back().first;
                   int parentParentPageId = pathOfTraversal.back().second;
-                  Page* parentParentPage;
-                  this->bufMgr->readPage(this->file, parentParentPageId, parentParentPage);
-                  nonLeafType* parentParentPageData = reinterpret_cast<nonLeafType*>(parentParentPage);
-                  nonLeafType* rightPageData = reinterpret_cast<nonLeafType*>(pRightSib);
+                  PageHandle parentParentPage = this->bufMgr->readPage(this->file, parentParentPageId);
+                  nonLeafType* parentParentPageData = reinterpret_cast<nonLeafType*>(parentParentPage.write());
+                  nonLeafType* rightPageData = reinterpret_cast<nonLeafType*>(pRightSib.write());
                   keyType rightPageFirstKey = keyType(0);
                   traits::assign(rightPageFirstKey, rightPageData->keyArray[0]);
-                  if (parentPageOffset+1 <= traits::NONLEAFSIZE) this->shiftLeftPage<keyType, traits>(pRightSib, parentPage, parentPageOffset+1, parentOccupancy, pRightOccupancy, false);
+                  if (parentPageOffset+1 <= traits::NONLEAFSIZE) this->shiftLeftPage<keyType, traits>(pRightSib.write(), parentPage.write(), parentPageOffset+1, parentOccupancy, pRightOccupancy, false);
                   else {
 #ifdef DEBUG 
                     assert(0);
 #endif
                   }
                   if (parentParentPageOffset == 0) {
-                    this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                     int k = 1;
                     int size = pathOfTraversal.size();
                     while (size - k >= 0) {
                       PageId tempParentPageId = pathOfTraversal[size-k].second;
                       int tempParentPageOffset = pathOfTraversal[size-k].first;
-                      Page* tempPage;
-                      this->bufMgr->readPage(this->file, tempParentPageId, tempPage);
+                      PageHandle tempPage = this->bufMgr->readPage(this->file, tempParentPageId);
                       if (tempParentPageOffset >= 1) {
-                        parentParentPageData = reinterpret_cast<nonLeafType*>(tempPage);
+                        parentParentPageData = reinterpret_cast<nonLeafType*>(tempPage.write());
                         parentParentPageOffset = tempParentPageOffset-1;
                         parentParentPageId = tempParentPageId;
                         traits::assign(parentPageData->keyArray[parentOccupancy-2], parentParentPageData->keyArray[parentParentPageOffset]);
                         traits::assign(parentParentPageData->keyArray[parentParentPageOffset], rightPageFirstKey);
-                        this->bufMgr->unPinPage(this->file, tempParentPageId, true);
                         break;
                       }
                       else {
@@ -2175,17 +2124,14 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
                           parentParentPageOffset = 0;
                           traits::assign(parentPageData->keyArray[parentOccupancy-2], parentParentPageData->keyArray[parentParentPageOffset]);
                           traits::assign(parentParentPageData->keyArray[parentParentPageOffset], rightPageFirstKey);
-                          this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                           break;
                         }
-                        this->bufMgr->unPinPage(this->file, tempParentPageId, true);
                       }
                     }
                   } else {
                     parentParentPageOffset = parentParentPageOffset-1;
                     traits::assign(parentPageData->keyArray[parentOccupancy-2], parentParentPageData->keyArray[parentParentPageOffset]);
                     traits::assign(parentParentPageData->keyArray[parentParentPageOffset], rightPageFirstKey);
-                    this->bufMgr->unPinPage(this->file, parentParentPageId, true);
                   }
 #ifdef DEBUG 
                   std::cout << "Parent non-leaf node rotated left." << std::endl;
@@ -2197,7 +2143,7 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
                 }
               } else if (pLeftOccupancy > traits::NONLEAFSIZE/2) {
                 rotated = true;
-                if (parentPageOffset+1 <= traits::NONLEAFSIZE) this->shiftRightPage<keyType, traits>(pLeftSib, parentPage, parentPageOffset+1, parentOccupancy, pLeftOccupancy, false);
+                if (parentPageOffset+1 <= traits::NONLEAFSIZE) this->shiftRightPage<keyType, traits>(pLeftSib.write(), parentPage.write(), parentPageOffset+1, parentOccupancy, pLeftOccupancy, false);
                 else {
 #ifdef DEBUG 
                   assert(0);
@@ -2207,17 +2153,15 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
                 if (!pathOfTraversal.empty()) {
                   PageId parentParentPageOffset = pathOfTraversal.back().first;
                   int parentParentPageId = pathOfTraversal.back().second;
-                  Page* parentParentPage;
-                  this->bufMgr->readPage(this->file, parentParentPageId, parentParentPage);
-                  nonLeafType* parentParentPageData = reinterpret_cast<nonLeafType*>(parentParentPage);
-                  nonLeafType* leftPageData = reinterpret_cast<nonLeafType*>(pLeftSib);
+                  PageHandle parentParentPage = this->bufMgr->readPage(this->file, parentParentPageId);
+                  nonLeafType* parentParentPageData = reinterpret_cast<nonLeafType*>(parentParentPage.write());
+                  nonLeafType* leftPageData = reinterpret_cast<nonLeafType*>(pLeftSib.write());
 #ifdef DEBUG 
                   assert(parentParentPageOffset >= 1);
 #endif
                   traits::assign(parentPageData->keyArray[0], parentParentPageData->keyArray[parentParentPageOffset-1]);
                   traits::assign(parentParentPageData->keyArray[parentParentPageOffset-1], leftPageData->keyArray[pLeftOccupancy-2]);
                   traits::assign(leftPageData->keyArray[pLeftOccupancy-2], 0);
-                  this->bufMgr->unPinPage(this->file, parentParentPageId, true);
 #ifdef DEBUG 
                   std::cout << "Parent non-leaf node rotated right." << std::endl;
 #endif
@@ -2227,13 +2171,13 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
 #endif
                 }
               } else if (pLeftOccupancy != -1) {
-                if (parentPageOffset+1 <= traits::NONLEAFSIZE)this->deleteEntryInNonLeaf<keyType, traits>(parentPage, parentPageOffset+1, parentOccupancy);
+                if (parentPageOffset+1 <= traits::NONLEAFSIZE)this->deleteEntryInNonLeaf<keyType, traits>(parentPage.write(), parentPageOffset+1, parentOccupancy);
                 else {
 #ifdef DEBUG 
                   assert(0);
 #endif
                 }
-                nonLeafType* leftPageData = reinterpret_cast<nonLeafType*>(pLeftSib);
+                nonLeafType* leftPageData = reinterpret_cast<nonLeafType*>(pLeftSib.write());
                 for (int i = pLeftOccupancy,j=1 ; i < traits::NONLEAFSIZE; i++, j++) {
                   traits::assign(leftPageData->keyArray[i],parentPageData->keyArray[j-1]);
                   leftPageData->pageNoArray[i] = parentPageData->pageNoArray[j-1];
@@ -2242,14 +2186,12 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
                 if (!pathOfTraversal.empty()) {
                   PageId parentParentPageOffset = pathOfTraversal.back().first;
                   int parentParentPageId = pathOfTraversal.back().second;
-                  Page* parentParentPage;
-                  this->bufMgr->readPage(this->file, parentParentPageId, parentParentPage);
-                  nonLeafType* parentParentPageData = reinterpret_cast<nonLeafType*>(parentParentPage);
+                  PageHandle parentParentPage = this->bufMgr->readPage(this->file, parentParentPageId);
+                  nonLeafType* parentParentPageData = reinterpret_cast<nonLeafType*>(parentParentPage.write());
 #ifdef DEBUG 
                   assert(parentParentPageOffset >= 1);
 #endif
                   traits::assign(leftPageData->keyArray[pLeftOccupancy-1], parentParentPageData->keyArray[parentParentPageOffset-1]);
-                  this->bufMgr->unPinPage(this->file, parentParentPageId, true);
 #ifdef DEBUG 
                   std::cout << "Parent non-leaf node merged with left." << std::endl;
 #endif
@@ -2259,14 +2201,14 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
 #endif
                 }
               } else if (pRightOccupancy != -1) {
-                if (parentPageOffset+1 <= traits::NONLEAFSIZE)this->deleteEntryInNonLeaf<keyType, traits>(parentPage, parentPageOffset+1, parentOccupancy);
+                if (parentPageOffset+1 <= traits::NONLEAFSIZE)this->deleteEntryInNonLeaf<keyType, traits>(parentPage.write(), parentPageOffset+1, parentOccupancy);
                 else {
 #ifdef DEBUG 
                   assert(0);
 #endif
                 }
                 parentOccupancy-= 1;
-                nonLeafType* rightPageData = reinterpret_cast<nonLeafType*>(pRightSib);
+                nonLeafType* rightPageData = reinterpret_cast<nonLeafType*>(pRightSib.write());
                 for (int i = parentOccupancy,j = 0; i < traits::NONLEAFSIZE; j++,i++) {
                   traits::assign(parentPageData->keyArray[i],rightPageData->keyArray[j]);
                   parentPageData->pageNoArray[i] = rightPageData->pageNoArray[j];
@@ -2275,14 +2217,12 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
                 if (!pathOfTraversal.empty()) {
                   PageId parentParentPageOffset = pathOfTraversal.back().first;
                   int parentParentPageId = pathOfTraversal.back().second;
-                  Page* parentParentPage;
-                  this->bufMgr->readPage(this->file, parentParentPageId, parentParentPage);
-                  nonLeafType* parentParentPageData = reinterpret_cast<nonLeafType*>(parentParentPage);
+                  PageHandle parentParentPage = this->bufMgr->readPage(this->file, parentParentPageId);
+                  nonLeafType* parentParentPageData = reinterpret_cast<nonLeafType*>(parentParentPage.write());
 #ifdef DEBUG
                   assert(parentParentPageOffset>=0);
 #endif
                   traits::assign(parentPageData->keyArray[parentOccupancy-1], parentParentPageData->keyArray[parentParentPageOffset]);
-                  this->bufMgr->unPinPage(this->file, parentParentPageId, true);
 #ifdef DEBUG 
                   std::cout << "Parent non-leaf node merged with right." << std::endl;
 #endif
@@ -2295,25 +2235,17 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
 #ifdef DEBUG 
                 std::cout << "Non-leaf page made root." << std::endl;
 #endif
-                if (parentPageOffset+1 <= traits::NONLEAFSIZE)this->deleteEntryInNonLeaf<keyType, traits>(parentPage, parentPageOffset+1, parentOccupancy);
+                if (parentPageOffset+1 <= traits::NONLEAFSIZE)this->deleteEntryInNonLeaf<keyType, traits>(parentPage.write(), parentPageOffset+1, parentOccupancy);
                 else {
 #ifdef DEBUG 
                   assert(0);
 #endif
                 }
                 this->rootPageNum = parentPageId;
-                if (leftOccupancy != -1) this->bufMgr->unPinPage(this->file, leftSibling, true);
-                if (rightOccupancy != -1) this->bufMgr->unPinPage(this->file, rightSibling, true);
-                this->bufMgr->unPinPage(this->file, parentPageId, true);
                 break;
               }
-              if(-1 != pLeftOccupancy) this->bufMgr->unPinPage(this->file, pLeftSibling, true);
-              if(-1 != pRightOccupancy) this->bufMgr->unPinPage(this->file, pRightSibling, true);
-              this->bufMgr->unPinPage(this->file, parentPageId, true);
             }
             if (true == rotated) {
-              if(-1 != leftOccupancy) this->bufMgr->unPinPage(this->file, leftSibling, true);
-              if(-1 != rightOccupancy) this->bufMgr->unPinPage(this->file, rightSibling, true);
               break;
             }
           }
@@ -2322,15 +2254,16 @@ const bool BTreeIndex::deleteKeyTemplate(const void* key) {
 #endif
         } else {
           this->deleteEntryInLeaf<keyType, traits>(reinterpret_cast<Page*>(dataPage), startLoc, endLoc);
-          this->bufMgr->unPinPage(this->file, dataPageId, true);
+          currHandle.release();
 #ifdef DEBUG 
           std::cout << "No left/right page, just deleted." << std::endl;
 #endif
         }
       } else {
         this->deleteEntryInLeaf<keyType, traits>(reinterpret_cast<Page*>(dataPage), startLoc, endLoc);
-        this->bufMgr->unPinPage(this->file, dataPageId, true);
-        this->bufMgr->unPinPage(this->file, this->rootPageNum, true);
+        currHandle.release();
+        rootPage.markDirty();
+        rootPage.release();
       }
     }
   }
@@ -5,110 +5,203 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
-#include <memory>
-#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
 #include "buffer.h"
 #include "bufHashTbl.h"
 #include "exceptions/hash_already_present_exception.h"
 #include "exceptions/hash_not_found_exception.h"
-#include "exceptions/hash_table_exception.h"
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File* file, const PageId pageNo)
+const std::uint32_t BufHashTbl::REHASH_STEP;
+
+namespace {
+
+/**
+ * Marks a slot of the old array whose entry has moved to the new one or been removed.  Unlike an empty slot, it
+ * doesn't end a probe sequence.
+ */
+const char movedMarker = 0;
+const File* const MOVED = reinterpret_cast<const File*>(&movedMarker);
+
+/**
+ * Returns the number of slots that keeps the given number of entries at most three quarters full.
+ */
+std::uint32_t slotsFor(const std::uint32_t entries)
 {
-  int tmp, value;
-  tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
-  return value;
+  std::uint32_t size = 4;
+  while (size * 3 < entries * 4)
+    size *= 2;
+  return size;
+}
+
+/**
+ * Allocates an array of empty slots aligned to a cache line.
+ */
+hashBucket* allocateSlots(const std::uint32_t count)
+{
+  void* memory = NULL;
+  if (posix_memalign(&memory, 64, count * sizeof(hashBucket)) != 0)
+    throw std::bad_alloc();
+  hashBucket* slots = static_cast<hashBucket*>(memory);
+  for (std::uint32_t i = 0; i < count; i++)
+    slots[i].file = NULL;
+  return slots;
+}
+
 }
 
 BufHashTbl::BufHashTbl(int htSize)
-	: HTSIZE(htSize)
+	: HTSIZE(slotsFor(htSize)), numEntries(0), oldSize(0), oldHt(NULL), nextToMove(0)
 {
-  // allocate an array of pointers to hashBuckets
-  ht = new hashBucket* [htSize];
-  for(int i=0; i < HTSIZE; i++)
-    ht[i] = NULL;
+  ht = allocateSlots(HTSIZE);
 }
 
 BufHashTbl::~BufHashTbl()
 {
-  for(int i = 0; i < HTSIZE; i++) {
-    hashBucket* tmpBuf = ht[i];
-    while (ht[i]) {
-      tmpBuf = ht[i];
-      ht[i] = ht[i]->next;
-      delete tmpBuf;
-    }
-  }
-  delete [] ht;
+  free(ht);
+  free(oldHt);
 }
 
-void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+std::uint32_t BufHashTbl::findSlot(const File* file, const PageId pageNo) const
 {
-  int index = hash(file, pageNo);
+  const std::uint32_t mask = HTSIZE - 1;
+  std::uint32_t index = hash(file, pageNo) & mask;
+  // the table is never full, so this always reaches an empty slot
+  while (ht[index].file != NULL && (ht[index].file != file || ht[index].pageNo != pageNo))
+    index = (index + 1) & mask;
+  return index;
+}
 
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-  		throw HashAlreadyPresentException(tmpBuc->file->filename(), tmpBuc->pageNo, tmpBuc->frameNo);
-    tmpBuc = tmpBuc->next;
+std::uint32_t BufHashTbl::findOldSlot(const File* file, const PageId pageNo) const
+{
+  if (oldHt == NULL)
+    return oldSize;
+  const std::uint32_t mask = oldSize - 1;
+  std::uint32_t index = hash(file, pageNo) & mask;
+  // nothing is ever added to the old slots, so there is still an empty one to stop at
+  while (oldHt[index].file != NULL)
+  {
+    if (oldHt[index].file == file && oldHt[index].pageNo == pageNo)
+      return index;
+    index = (index + 1) & mask;
   }
+  return oldSize;
+}
 
-  tmpBuc = new hashBucket;
-  if (!tmpBuc)
-  	throw HashTableException();
-
-  tmpBuc->file = (File*) file;
-  tmpBuc->pageNo = pageNo;
-  tmpBuc->frameNo = frameNo;
-  tmpBuc->next = ht[index];
-  ht[index] = tmpBuc;
+void BufHashTbl::startRehash(const std::uint32_t size)
+{
+  // only one resize is in progress at a time
+  while (oldHt != NULL)
+    rehashStep(oldSize);
+  oldHt = ht;
+  oldSize = HTSIZE;
+  nextToMove = 0;
+  HTSIZE = size;
+  ht = allocateSlots(HTSIZE);
 }
 
-void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
+void BufHashTbl::rehashStep(std::uint32_t slots)
 {
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
+  if (oldHt == NULL)
+    return;
+  for (; slots > 0 && nextToMove < oldSize; slots--, nextToMove++)
+  {
+    hashBucket& bucket = oldHt[nextToMove];
+    if (bucket.file != NULL && bucket.file != MOVED)
     {
-      frameNo = tmpBuc->frameNo; // return frameNo by reference
-      return;
+      ht[findSlot(bucket.file, bucket.pageNo)] = bucket;
+      bucket.file = MOVED;
     }
-    tmpBuc = tmpBuc->next;
+  }
+  if (nextToMove == oldSize)
+  {
+    free(oldHt);
+    oldHt = NULL;
+    oldSize = 0;
+  }
+}
+
+void BufHashTbl::reserve(const int htSize)
+{
+  const std::uint32_t size = slotsFor(std::max<std::uint32_t>(htSize, numEntries + 1));
+  if (size != HTSIZE)
+    startRehash(size);
+}
+
+void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+{
+  std::uint32_t index = findSlot(file, pageNo);
+  if (ht[index].file != NULL)
+  	throw HashAlreadyPresentException(file->filename(), pageNo, ht[index].frameNo);
+  const std::uint32_t oldIndex = findOldSlot(file, pageNo);
+  if (oldIndex != oldSize)
+  	throw HashAlreadyPresentException(file->filename(), pageNo, oldHt[oldIndex].frameNo);
+
+  if ((numEntries + 1) * 4 > HTSIZE * 3)
+  {
+    startRehash(HTSIZE * 2);
+    index = findSlot(file, pageNo);
   }
 
-  throw HashNotFoundException(file->filename(), pageNo);
+  ht[index].file = file;
+  ht[index].pageNo = pageNo;
+  ht[index].frameNo = frameNo;
+  numEntries++;
+  rehashStep(REHASH_STEP);
+}
+
+bool BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) const
+{
+  const std::uint32_t index = findSlot(file, pageNo);
+  if (ht[index].file == NULL)
+  {
+    const std::uint32_t oldIndex = findOldSlot(file, pageNo);
+    if (oldIndex == oldSize)
+      return false;
+    frameNo = oldHt[oldIndex].frameNo;
+    return true;
+  }
+
+  frameNo = ht[index].frameNo; // return frameNo by reference
+  return true;
 }
 
 void BufHashTbl::remove(const File* file, const PageId pageNo) {
 
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  hashBucket* prevBuc = NULL;
+  const std::uint32_t mask = HTSIZE - 1;
+  std::uint32_t hole = findSlot(file, pageNo);
+  if (ht[hole].file == NULL)
+  {
+    // not moved across yet; mark it moved so the entries after it stay reachable
+    const std::uint32_t oldIndex = findOldSlot(file, pageNo);
+    if (oldIndex == oldSize)
+      throw HashNotFoundException(file->filename(), pageNo);
+    oldHt[oldIndex].file = MOVED;
+    numEntries--;
+    rehashStep(REHASH_STEP);
+    return;
+  }
 
-  while (tmpBuc)
+  // shift back the entries after the hole that would otherwise become unreachable from their home slot
+  std::uint32_t index = hole;
+  while (true)
 	{
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
+    index = (index + 1) & mask;
+    if (ht[index].file == NULL)
+      break;
+    const std::uint32_t home = hash(ht[index].file, ht[index].pageNo) & mask;
+    if (((index - home) & mask) >= ((index - hole) & mask))
 		{
-      if(prevBuc) 
-				prevBuc->next = tmpBuc->next;
-      else
-				ht[index] = tmpBuc->next;
-
-      delete tmpBuc;
-      return;
-    }
-		else
-		{
-      prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
+      ht[hole] = ht[index];
+      hole = index;
     }
   }
-
-  throw HashNotFoundException(file->filename(), pageNo);
+  ht[hole].file = NULL;
+  numEntries--;
+  rehashStep(REHASH_STEP);
 }
 
 }
@@ -12,13 +12,13 @@
 namespace badgerdb {
 
 /**
-* @brief Declarations for buffer pool hash table
+* @brief One slot of the buffer pool hash table
 */
 struct hashBucket {
 	/**
-	 * pointer a file object (more on this below)
+	 * pointer a file object (more on this below).  NULL in empty slots
 	 */
-	File *file;
+	const File *file;
 
 	/**
 	 * page number within a file
@@ -29,43 +29,118 @@ struct hashBucket {
 	 * frame number of page in the buffer pool
 	 */
 	FrameId frameNo;
-
-	/**
-	 * Next node in the hash table
-	 */
-	hashBucket*   next;
 };
 
 
 /**
 * @brief Hash table class to keep track of pages in the buffer pool
 *
+* Entries live directly in one array of slots, four to a cache line, and collisions are resolved by linear probing,
+* so a lookup usually touches a single cache line and inserting does not allocate.  Removing an entry shifts the
+* entries after it back instead of leaving a tombstone.  The table doubles in size when it becomes three quarters full,
+* and can be resized to fit a different number of entries with reserve().
+*
+* Resizing rehashes incrementally, so no single call pays for moving every entry.  The old array is kept alongside
+* the new one, and each insert or remove moves a few more of its entries across until it is empty.  Entries that
+* have moved, or were removed, are marked as moved in the old array rather than cleared, so the probe sequences of
+* the entries still there stay intact.  Lookups look in both arrays meanwhile.
+*
 * @warning This class is not threadsafe.
 */
 class BufHashTbl
 {
  private:
 	/**
-	 *	Size of Hash Table
+	 *	Number of slots in the table; always a power of two
+	 */
+  std::uint32_t HTSIZE;
+
+	/**
+	 * Number of entries in the table
 	 */
-  int HTSIZE;
+  std::uint32_t numEntries;
+
 	/**
 	 * Actual Hash table object
 	 */
-  hashBucket**  ht;
+  hashBucket*  ht;
+
+	/**
+	 *	Number of slots in oldHt
+	 */
+  std::uint32_t oldSize;
 
 	/**
-	 * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+	 * Slots of the table before it was last resized, holding entries not yet moved to ht.  NULL once they all have.
+	 */
+  hashBucket*  oldHt;
+
+	/**
+	 * Next slot of oldHt whose entry is to be moved to ht
+	 */
+  std::uint32_t nextToMove;
+
+	/**
+	 * Number of slots of oldHt moved across by each insert or remove
+	 */
+  static const std::uint32_t REHASH_STEP = 8;
+
+	/**
+	 * Returns the slot holding (file, pageNo), or the empty slot where it would be inserted
 	 *
 	 * @param file   	File object
 	 * @param pageNo  Page number in the file
-	 * @return  			Hash value.
+	 * @return  			Index of the slot
+	 */
+  std::uint32_t findSlot(const File* file, const PageId pageNo) const;
+
+	/**
+	 * Returns the slot of oldHt holding (file, pageNo), or oldSize if it isn't there
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			Index of the slot
+	 */
+  std::uint32_t findOldSlot(const File* file, const PageId pageNo) const;
+
+	/**
+	 * Starts moving the entries to a new array of the given number of slots, first finishing any resize in progress
+	 *
+	 * @param size  	Number of slots; a power of two larger than the number of entries
+	 */
+  void startRehash(const std::uint32_t size);
+
+	/**
+	 * Moves the entries of up to the given number of slots of oldHt to ht, and frees oldHt once it is empty
+	 *
+	 * @param slots  	Number of slots of oldHt to go through
 	 */
-  int	 hash(const File* file, const PageId pageNo);
+  void rehashStep(std::uint32_t slots);
 
  public:
 	/**
+	 * returns a well mixed 64 bit hash of file and pageNo.  The buffer manager uses the high bits to pick a shard and
+	 * the table uses the low bits to pick a slot.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			Hash value.
+	 */
+  static std::uint64_t hash(const File* file, const PageId pageNo)
+  {
+		std::uint64_t key = reinterpret_cast<std::uintptr_t>(file) ^ (std::uint64_t(pageNo) * 0x9E3779B97F4A7C15ull);
+		key ^= key >> 30;
+		key *= 0xBF58476D1CE4E5B9ull;
+		key ^= key >> 27;
+		key *= 0x94D049BB133111EBull;
+		key ^= key >> 31;
+		return key;
+  }
+
+	/**
    * Constructor of BufHashTbl class
+   *
+   * @param htSize  Number of entries the table is expected to hold
 	 */
 	BufHashTbl(const int htSize);  // constructor
 
@@ -81,20 +156,28 @@ class BufHashTbl
 	 * @param pageNo 	Page number in the file
 	 * @param frameNo Frame number assigned to that page of the file
    * @throws  HashAlreadyPresentException	if the corresponding page already exists in the hash table
-   * @throws  HashTableException (optional) if could not create a new bucket as running of memory
 	 */
   void insert(const File* file, const PageId pageNo, const FrameId frameNo);
 
 	/**
    * Check if (file, pageNo) is currently in the buffer pool (ie. in
-   * the hash table).
+   * the hash table).  A miss is an ordinary outcome, so it is reported through the return value rather than an
+   * exception.
 	 *
 	 * @param file  	File object
 	 * @param pageNo	Page number in the file
-	 * @param frameNo Frame number reference
-   * @throws HashNotFoundException if the page entry is not found in the hash table 
+	 * @param frameNo Frame number reference, set only if the page is found
+   * @return  True if the page entry is found in the hash table
+	 */
+  bool lookup(const File* file, const PageId pageNo, FrameId &frameNo) const;
+
+	/**
+   * Resizes the table to fit the given number of entries, growing or shrinking it.  The entries are moved across
+   * incrementally by later inserts and removes.
+	 *
+	 * @param htSize  Number of entries the table is expected to hold
 	 */
-  void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
+  void reserve(const int htSize);
 
 	/**
    * Delete entry (file,pageNo) from hash table.
@@ -6,150 +6,557 @@
  */
 
 #include <memory>
+#include <new>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
-#include "exceptions/bad_buffer_exception.h"
 #include "exceptions/hash_not_found_exception.h"
 //#define DEBUG 
 namespace badgerdb { 
 
+const int BufMgr::WRITER_INTERVAL_MS;
+const std::size_t BufMgr::MAX_WRITE_RUN;
+const std::size_t BufMgr::WARM_BATCH;
+const int LatencyHistogram::NUM_BUCKETS;
+
+//----------------------------------------
+// Statistics
+//----------------------------------------
+
+LatencyHistogram& LatencyHistogram::operator=(const LatencyHistogram& other)
+{
+  for (int i = 0; i < NUM_BUCKETS; i++)
+    buckets[i] = other.buckets[i].load();
+  totalMicros = other.totalMicros.load();
+  return *this;
+}
+
+void LatencyHistogram::record(std::chrono::steady_clock::duration latency)
+{
+  std::uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+  int i = 0;
+  while (i < NUM_BUCKETS - 1 && micros >= bucketLimit(i))
+    i++;
+  buckets[i]++;
+  totalMicros += micros;
+}
+
+void LatencyHistogram::clear()
+{
+  for (int i = 0; i < NUM_BUCKETS; i++)
+    buckets[i] = 0;
+  totalMicros = 0;
+}
+
+std::uint64_t LatencyHistogram::count() const
+{
+  std::uint64_t n = 0;
+  for (int i = 0; i < NUM_BUCKETS; i++)
+    n += buckets[i];
+  return n;
+}
+
+double LatencyHistogram::meanMicros() const
+{
+  std::uint64_t n = count();
+  return n == 0 ? 0.0 : double(totalMicros) / n;
+}
+
+std::uint64_t LatencyHistogram::percentileMicros(double fraction) const
+{
+  std::uint64_t n = count();
+  if (n == 0)
+    return 0;
+  std::uint64_t rank = std::max<std::uint64_t>(1, std::ceil(fraction * n));
+  std::uint64_t seen = 0;
+  for (int i = 0; i < NUM_BUCKETS - 1; i++)
+  {
+    seen += buckets[i];
+    if (seen >= rank)
+      return bucketLimit(i);
+  }
+  return bucketLimit(NUM_BUCKETS - 1);
+}
+
+static void printJsonString(std::ostream& out, const std::string& str)
+{
+  out << '"';
+  for (std::size_t i = 0; i < str.size(); i++)
+  {
+    unsigned char c = str[i];
+    if (c == '"' || c == '\\')
+      out << '\\' << c;
+    else if (c < 0x20)
+    {
+      const char* hex = "0123456789abcdef";
+      out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+    }
+    else
+      out << c;
+  }
+  out << '"';
+}
+
+static void printJsonCounts(std::ostream& out, const BufPageCounts& counts)
+{
+  out << "{\"hits\":" << counts.hits << ",\"misses\":" << counts.misses << ",\"evictions\":" << counts.evictions
+      << ",\"victimwrites\":" << counts.victimwrites << ",\"pinwaits\":" << counts.pinwaits
+      << ",\"prefetchhits\":" << counts.prefetchhits << ",\"cachehits\":" << counts.cachehits << "}";
+}
+
+static void printJsonHistogram(std::ostream& out, const LatencyHistogram& histogram)
+{
+  out << "{\"count\":" << histogram.count() << ",\"mean_us\":" << histogram.meanMicros()
+      << ",\"p50_us\":" << histogram.percentileMicros(0.5) << ",\"p99_us\":" << histogram.percentileMicros(0.99)
+      << ",\"p999_us\":" << histogram.percentileMicros(0.999) << ",\"buckets\":[";
+  for (int i = 0; i < LatencyHistogram::NUM_BUCKETS; i++)
+    out << (i > 0 ? "," : "") << histogram.bucket(i);
+  out << "]}";
+}
+
+void BufStatsSnapshot::printJson(std::ostream& out) const
+{
+  out << "{\"accesses\":" << accesses << ",\"diskreads\":" << diskreads << ",\"diskwrites\":" << diskwrites
+      << ",\"prefetches\":" << prefetches << ",\"optimisticretries\":" << optimisticretries
+      << ",\"hit_ratio\":" << hitRatio() << ",\"total\":";
+  printJsonCounts(out, total);
+  out << ",\"files\":{";
+  for (std::map<std::string, BufPageCounts>::const_iterator it = files.begin(); it != files.end(); ++it)
+  {
+    if (it != files.begin())
+      out << ",";
+    printJsonString(out, it->first);
+    out << ":";
+    printJsonCounts(out, it->second);
+  }
+  out << "},\"read_miss_latency\":";
+  printJsonHistogram(out, readMissLatency);
+  out << ",\"write_latency\":";
+  printJsonHistogram(out, writeLatency);
+  out << "}" << std::endl;
+}
+
 //----------------------------------------
 // Constructor of the class BufMgr
 //----------------------------------------
 
-BufMgr::BufMgr(std::uint32_t bufs)
-	: numBufs(bufs) {
-	bufDescTable = new BufDesc[bufs];
+BufMgr::BufMgr(std::uint32_t bufs, LogManager* log, ReplacementPolicy::Kind policy, const BufPoolOptions& options)
+	: numBufs(bufs), maxBufs(std::max(bufs, options.maxBufs)),
+	  policy(ReplacementPolicy::create(policy, bufs, options.maxBufs)),
+	  victimCache(options.victimCacheBytes > 0 ? new VictimCache(options.victimCacheBytes) : NULL), prefetchFile(NULL),
+	  prefetchStop(false),
+	  writerStop(false), cleanTarget(std::max<std::uint32_t>(1, bufs / 8)), log(log) {
+  // Bring the files up to date with any updates logged before a crash.
+  if (log != NULL)
+    log->recover();
 
-  for (FrameId i = 0; i < bufs; i++) 
+  numPartitions = 1;
+  if (options.numaPartitioned)
+    numPartitions = std::max<std::uint32_t>(1, std::min<std::uint32_t>(bufs, PoolMemory::numNodes()));
+  partitionChunk = std::max<std::uint32_t>(1, PoolMemory::HUGE_PAGE_SIZE / sizeof(Page));
+
+  // Room is reserved for the largest the pool may grow to, so frames never move.  Descriptors are much smaller than
+  // frames, so with partitions they are kept on small pages, or a chunk's descriptors would rarely fill a huge page of
+  // their own to place on its node.
+  frameMemory = new PoolMemory(sizeof(Page) * maxBufs, options.pages);
+  descMemory = new PoolMemory(sizeof(BufDesc) * maxBufs, numPartitions > 1 ? PoolMemory::SMALL_PAGES : options.pages);
+  if (numPartitions > 1)
   {
+    // the memory has to be placed before it is first touched below
+    for (FrameId first = 0; first < maxBufs; first += partitionChunk)
+    {
+      std::uint32_t count = std::min(partitionChunk, maxBufs - first);
+      frameMemory->bindToNode(sizeof(Page) * first, sizeof(Page) * count, partitionOf(first));
+      descMemory->bindToNode(sizeof(BufDesc) * first, sizeof(BufDesc) * count, partitionOf(first));
+    }
+  }
+
+	bufDescTable = static_cast<BufDesc*>(descMemory->base());
+  bufPool = static_cast<Page*>(frameMemory->base());
+
+  // descriptors are kept for every frame the pool may grow to, but pages only for the frames in use
+  for (FrameId i = 0; i < maxBufs; i++) 
+  {
+    new (&bufDescTable[i]) BufDesc();
   	bufDescTable[i].frameNo = i;
   	bufDescTable[i].valid = false;
   }
+  for (FrameId i = 0; i < bufs; i++) 
+    new (&bufPool[i]) Page();
 
-  bufPool = new Page[bufs];
+  // every frame starts out free; hand out the lowest numbered ones of each partition first
+  freeFrames.resize(numPartitions);
+  for (FrameId i = bufs; i > 0; i--)
+  {
+    bufDescTable[i - 1].free = true;
+    freeFrames[partitionOf(i - 1)].push_back(i - 1);
+  }
+  numFreeFrames = bufs;
 
-  int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
-  hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
+  // each shard expects its share of the frames; its table grows if the hash gives it more
+  shards = new BufHashShard[NUM_SHARDS];
+  for (std::uint32_t i = 0; i < NUM_SHARDS; i++)
+  {
+    shards[i].table = new BufHashTbl (bufs / NUM_SHARDS + 1);  // allocate the buffer hash table
+    shards[i].writebacks = 0;
+  }
 
-  clockHand = bufs - 1;
+  hotPagesPath = options.hotPagesFile;
+  loadHotPages();
+  pageWriter = std::thread(&BufMgr::writerLoop, this);
 }
 
 
 BufMgr::~BufMgr() {
+  // stop the prefetcher before the frames go away
+  {
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+    prefetchStop = true;
+  }
+  prefetchCond.notify_all();
+  if (prefetcher.joinable())
+    prefetcher.join();
+  {
+    std::lock_guard<std::mutex> lock(writerMutex);
+    writerStop = true;
+  }
+  writerCond.notify_all();
+  pageWriter.join();
+
   //Flush out all unwritten pages
-  for (std::uint32_t i = 0; i < numBufs; i++) 
+  if (log != NULL)
+    checkpoint();
+  else
   {
-  	BufDesc* tmpbuf = &bufDescTable[i];
-  	if (tmpbuf->valid == true && tmpbuf->dirty == true)
-		{
-			tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
-  	}
+    writeDirtyPages();
+    saveHotPages();
   }
 
-  delete [] bufDescTable;
-  delete [] bufPool;
+  for (std::uint32_t i = 0; i < NUM_SHARDS; i++)
+    delete shards[i].table;
+  delete [] shards;
+  delete policy;
+  delete victimCache;
+  for (FrameId i = 0; i < numBufs; i++)
+    bufPool[i].~Page();
+  for (FrameId i = 0; i < maxBufs; i++)
+    bufDescTable[i].~BufDesc();
+  delete descMemory;
+  delete frameMemory;
 }
 
-void BufMgr::allocBuf(FrameId & frame) 
+std::uint32_t BufMgr::allocBuf(FrameId & frame) 
 {
-  // perform first part of clock algorithm to search for 
-  // open buffer frame
-  // Assumes non-concurrent access to buffer manager
-  std::uint32_t numScanned = 0;
-  bool found = 0;
+  // Frames that another thread holds a lock on are skipped rather than waited for.  Everywhere else the shard lock is
+  // taken before the frame's latch; eviction has to latch the frame before it knows the page's shard, so it only
+  // try-locks the shard, and waiting here could deadlock
+  const ReplacementPolicy::PinnedPredicate isPinned = [this](FrameId f) { return bufDescTable[f].pinCnt > 0; };
+  std::vector<FrameId> candidates;
+  std::uint32_t pinWaits = 0;
 
-  while (numScanned < 2*numBufs)	//Need to scn twice
+  while (true)
   {
-    // advance the clock
-    advanceClock();
-    numScanned++;
+    if (takeFreeFrame(frame))
+      return pinWaits;
 
-    // if invalid, use frame
-    if (! bufDescTable[clockHand].valid)
+    candidates.clear();
+    policy->victimCandidates(candidates, VICTIM_BATCH, isPinned);
+    if (candidates.empty())
     {
-      break;
+      // every page is pinned, unless a frame was freed meanwhile
+      if (takeFreeFrame(frame))
+        return pinWaits;
+      throw BufferExceededException();
     }
 
-    // is valid, check referenced bit
-    if (! bufDescTable[clockHand].refbit)
+    for (std::size_t i = 0; i < candidates.size(); i++)
     {
-      // check to see if someone has it pinned
-      if (bufDescTable[clockHand].pinCnt == 0)
+      if (evictFrame(candidates[i]))
       {
-        // hasn't been referenced and is not pinned, use it
-        // remove previous entry from hash table
-        hashTable->remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
-        found = true;
-        break;
+        frame = candidates[i];
+        return pinWaits;
       }
     }
-    else
-    {
-      // has been referenced, clear the bit
-      bufStats.accesses++;
-      bufDescTable[clockHand].refbit = false;
-    }
+
+    // every candidate was busy; let the threads holding them finish
+    pinWaits++;
+    bufStats.pinwaits++;
+    std::this_thread::yield();
   }
-  
-  // check for full buffer pool
-  if (!found && numScanned >= 2*numBufs)
+} // end allocBuf
+
+bool BufMgr::evictFrame(FrameId frame, const File* file, PageId pageNo)
+{
+  BufDesc* tmpbuf = &bufDescTable[frame];
+
+  if (tmpbuf->pinCnt > 0)
+    return false;
+
+  std::unique_lock<std::mutex> latch(tmpbuf->latch, std::try_to_lock);
+  if (!latch.owns_lock())
+    return false;
+
+  // the page left the frame since the caller picked it; the frame is free or being loaded by another thread
+  if (!tmpbuf->valid)
+    return false;
+  if (file != NULL && (tmpbuf->file != file || tmpbuf->pageNo != pageNo))
+    return false;
+
+  // compress the copy for the victim cache under the latch alone, so threads of the shard aren't held up by it.  A
+  // page changed or pinned meanwhile is not evicted, or its copy is dropped below
+  std::uint64_t version = tmpbuf->version;
+  std::string copy;
+  bool keepCopy = victimCache != NULL && VictimCache::compress(bufPool[frame], copy);
+
+  BufHashShard& shard = shardFor(tmpbuf->file, tmpbuf->pageNo);
+  std::unique_lock<std::mutex> shardLock(shard.mutex, std::try_to_lock);
+  if (!shardLock.owns_lock())
+    return false;
+
+  // check to see if someone has it pinned; pins are only taken under the shard lock, which we now hold
+  if (tmpbuf->pinCnt != 0 || tmpbuf->writing)
+    return false;
+
+  // a scan recycling its ring keeps the pages read ahead for it until it gets to them
+  if (file != NULL && tmpbuf->prefetched)
+    return false;
+
+  // flush any existing changes to disk if necessary.  This is done before the page leaves the hash table, so a
+  // thread missing on the page can't read it from disk before it has been written.  The locks are dropped during the
+  // write, and a page pinned or changed meanwhile stays where it is
+  if (tmpbuf->dirty)
   {
-    throw BufferExceededException();
+    const bool clean = writeFrame(frame, shardLock, latch);
+
+    // the page writer should have got to it first; have it look further ahead
+    fileCounts(shard, tmpbuf->file).victimwrites++;
+    bufStats.victimwrites++;
+    writerCond.notify_one();
+
+    if (!clean || tmpbuf->pinCnt != 0)
+      return false;
   }
-  
-  // flush any existing changes to disk if necessary
-  if (bufDescTable[clockHand].dirty)
+
+  fileCounts(shard, tmpbuf->file).evictions++;
+  bufStats.evictions++;
+
+  // the page is clean now; keep the compressed copy in case it is needed again soon, unless the page changed since it
+  // was made.  This too is done before the page leaves the hash table, so a thread missing on it finds either the page
+  // or the copy
+  if (keepCopy && tmpbuf->version == version)
+    victimCache->put(tmpbuf->file, tmpbuf->pageNo, copy);
+  else if (victimCache != NULL)
+    victimCache->erase(tmpbuf->file, tmpbuf->pageNo);
+
+  // remove previous entry from hash table
+  shard.table->remove(tmpbuf->file, tmpbuf->pageNo);
+  untrackPage(tmpbuf->file, tmpbuf->pageNo);
+  policy->pageRemoved(frame, tmpbuf->file, tmpbuf->pageNo, true);
+
+	//Reset all the BufDesc entry for the frame before returning the frame
+  tmpbuf->Clear();
+  tmpbuf->pinCnt = 1;
+  return true;
+}
+
+BufferRing::Slot& BufMgr::allocRingBuf(BufferRing& ring, FrameId & frame, std::uint32_t& pinWaits)
+{
+  // keep the ring to an eighth of the pool, as a ring nearly as large as the pool protects nothing
+  std::uint32_t ringSize = std::max<std::uint32_t>(1, std::min<std::uint32_t>(ring.slots.size(), numBufs / 8));
+  if (ring.next >= ringSize)
+    ring.next = 0;
+  BufferRing::Slot& slot = ring.slots[ring.next];
+  ring.next = (ring.next + 1) % ringSize;
+
+  // reuse the frame of the page read one lap ago, unless it has been evicted or someone is still using it
+  pinWaits = 0;
+  if (slot.file != NULL && evictFrame(slot.frame, slot.file, slot.pageNo))
+    frame = slot.frame;
+  else
+    pinWaits = allocBuf(frame);
+  slot.file = NULL;
+  return slot;
+}
+
+void BufMgr::releaseBuf(FrameId frame)
+{
   {
-    bufStats.diskwrites++;
-    //status = bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo,
-    bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo, bufPool[clockHand]);
+    std::lock_guard<std::mutex> latch(bufDescTable[frame].latch);
+    bufDescTable[frame].Clear();
   }
+  freeFrame(frame);
+}
 
-	//Reset all the BufDesc entry for the frame before returning the frame
-  bufDescTable[clockHand].Clear();
+void BufMgr::freeFrame(FrameId frame)
+{
+  std::lock_guard<std::mutex> lock(freeMutex);
+  // a frame being dropped by resize(), or one it already put back
+  if (frame >= numBufs || bufDescTable[frame].free)
+    return;
+  bufDescTable[frame].free = true;
+  freeFrames[partitionOf(frame)].push_back(frame);
+  numFreeFrames++;
+}
 
-  // return new frame number
-  frame = clockHand;
-} // end allocBuf
+bool BufMgr::takeFreeFrame(FrameId & frame)
+{
+  // start with the partition local to this thread, if there is more than one
+  std::uint32_t local = numPartitions > 1 ? PoolMemory::currentNode() % numPartitions : 0;
+  {
+    std::lock_guard<std::mutex> lock(freeMutex);
+    if (numFreeFrames == 0)
+      return false;
+    std::uint32_t p = local;
+    while (freeFrames[p].empty())
+      p = (p + 1) % numPartitions;
+    frame = freeFrames[p].back();
+    freeFrames[p].pop_back();
+    numFreeFrames--;
+    // pinned before the lock is dropped, so a shrinking resize() never sees the frame unpinned and off the lists
+    bufDescTable[frame].free = false;
+    bufDescTable[frame].pinCnt = 1;
+  }
+  return true;
+}
 
 	
-void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
+void BufMgr::readPage(File* file, const PageId pageNo, Page*& page, AccessHint hint, BufferRing* ring)
 {
-  // check to see if it is already in the buffer pool
   #ifdef DEBUG
   std::cout << "readPage called on page " << pageNo << "\n";
   #endif
+  bufStats.accesses++;
+  trace.record(TraceEvent::READ, file, pageNo, hint);
+  fetchPage(file, pageNo, page, hint, ring);
+}
+
+bool BufMgr::fetchPage(File* file, const PageId pageNo, Page*& page, AccessHint hint, BufferRing* ring,
+                       bool prefetching, const FrameId* reserved)
+{
+  // check to see if it is already in the buffer pool
+  BufHashShard& shard = shardFor(file, pageNo);
   FrameId frameNo = 0;
-	try
-	{
-  	hashTable->lookup(file, pageNo, frameNo);
+  std::uint64_t writebacks;
+  {
+    std::unique_lock<std::mutex> shardLock(shard.mutex);
+  	if (shard.table->lookup(file, pageNo, frameNo))
+	  {
+      bufDescTable[frameNo].pinCnt++;
+      if (hint == ACCESS_RANDOM)
+        policy->pageAccessed(frameNo);
+      if (!prefetching)
+        countHit(shard, file, frameNo);
+      page = &bufPool[frameNo];
+      shardLock.unlock();
+      if (reserved != NULL)
+        releaseBuf(*reserved);
+      return false;
+    }
+    writebacks = shard.writebacks;
+  }
 
-    // set the referenced bit
-    bufDescTable[frameNo].refbit = true;
-    bufDescTable[frameNo].pinCnt++;
-    page = &bufPool[frameNo];
+  //not in the buffer pool, must allocate a new page
+  const std::chrono::steady_clock::time_point missStart = std::chrono::steady_clock::now();
+
+  // alloc a new frame, out of the scan's ring if it has one
+  BufferRing::Slot* slot = NULL;
+  std::uint32_t pinWaits = 0;
+  if (reserved != NULL)
+    frameNo = *reserved;
+  else if (hint == ACCESS_SEQUENTIAL && ring != NULL)
+  {
+    std::lock_guard<std::mutex> ringLock(ring->mutex);
+    slot = &allocRingBuf(*ring, frameNo, pinWaits);
   }
-  catch(HashNotFoundException e) //not in the buffer pool, must allocate a new page
+  else
+    pinWaits = allocBuf(frameNo);
+
+  std::unique_lock<std::mutex> shardLock(shard.mutex, std::defer_lock);
+  bool cached;
+  while (true)
   {
-    // alloc a new frame
-    allocBuf(frameNo);
+    // read the page into the new frame, from the victim cache if it kept a copy.  The frame is pinned and not in the
+    // hash table, so no other thread touches it
+    cached = victimCache != NULL && victimCache->take(file, pageNo, bufPool[frameNo]);
+    if (!cached)
+    {
+      try
+      {
+        bufStats.diskreads++;
+        bufPool[frameNo] = file->readPage(pageNo);
+      }
+      catch(...)
+      {
+        releaseBuf(frameNo);
+        throw;
+      }
+    }
 
-    // read the page into the new frame
-    bufStats.diskreads++;
-    //status = file->readPage(pageNo, &bufPool[frameNo]);
-    bufPool[frameNo] = file->readPage(pageNo);
+    shardLock.lock();
+    FrameId otherFrameNo = 0;
+    if (shard.table->lookup(file, pageNo, otherFrameNo))
+    {
+      // another thread read the same page in the meantime; use its frame.  This still took a read, so counts as a miss
+      bufDescTable[otherFrameNo].pinCnt++;
+      if (hint == ACCESS_RANDOM)
+        policy->pageAccessed(otherFrameNo);
+      countMiss(shard, file, pinWaits, prefetching, cached, missStart);
+      page = &bufPool[otherFrameNo];
+      releaseBuf(frameNo);
+      return false;
+    }
+
+    // another thread may have read the page, changed it and written it back while we read it, leaving us an old image.
+    // The same goes for a copy from the victim cache, which is only put there as the page is evicted
+    if (shard.writebacks == writebacks)
+      break;
+    writebacks = shard.writebacks;
+    shardLock.unlock();
+  }
 
-    // set up the entry properly
+  // set up the entry properly
+  {
+    std::lock_guard<std::mutex> latch(bufDescTable[frameNo].latch);
     bufDescTable[frameNo].Set(file, pageNo);
-    page = &bufPool[frameNo];
+  }
+  page = &bufPool[frameNo];
+
+  // insert in the hash table
+  shard.table->insert(file, pageNo, frameNo);
+  trackPage(file, pageNo, frameNo);
+  policy->pageLoaded(frameNo, file, pageNo, hint);
+  bufDescTable[frameNo].prefetched = prefetching;
+  countMiss(shard, file, pinWaits, prefetching, cached, missStart);
+  shardLock.unlock();
 
-    // insert in the hash table
-    hashTable->insert(file, pageNo, frameNo);
+  if (slot != NULL)
+  {
+    std::lock_guard<std::mutex> ringLock(ring->mutex);
+    slot->frame = frameNo;
+    slot->file = file;
+    slot->pageNo = pageNo;
   }
+  return true;
+}
+
+
+PageHandle BufMgr::readPage(File* file, const PageId pageNo, AccessHint hint, BufferRing* ring)
+{
+  Page* page;
+  readPage(file, pageNo, page, hint, ring);
+  return PageHandle(this, file, pageNo, static_cast<FrameId>(page - bufPool), page);
 }
 
 
@@ -157,81 +564,1091 @@ void BufMgr::unPinPage(File* file, const PageId pageNo,
 			     const bool dirty) 
 {
   // lookup in hashtable
+  BufHashShard& shard = shardFor(file, pageNo);
+  std::lock_guard<std::mutex> shardLock(shard.mutex);
   FrameId frameNo = 0;
-  hashTable->lookup(file, pageNo, frameNo);
+  if (!shard.table->lookup(file, pageNo, frameNo))
+    throw HashNotFoundException(file->filename(), pageNo);
 
-  if (dirty == true) bufDescTable[frameNo].dirty = dirty;
+  dropPin(frameNo, dirty);
+  trace.record(TraceEvent::UNPIN, file, pageNo, ACCESS_RANDOM, dirty);
+#ifdef DEBUG
+  std::cout << "unpin called on page " << pageNo << "\n";
+#endif
+}
+
+void BufMgr::unPinFrame(FrameId frame, File* file, const PageId pageNo, const bool dirty)
+{
+  // the frame can only have lost the page if the handle outlived a flush of the file
+  BufHashShard& shard = shardFor(file, pageNo);
+  std::lock_guard<std::mutex> shardLock(shard.mutex);
+  if (!bufDescTable[frame].valid || bufDescTable[frame].file != file || bufDescTable[frame].pageNo != pageNo)
+    throw HashNotFoundException(file->filename(), pageNo);
+
+  dropPin(frame, dirty);
+  trace.record(TraceEvent::UNPIN, file, pageNo, ACCESS_RANDOM, dirty);
+}
+
+void BufMgr::dropPin(FrameId frame, const bool dirty)
+{
+  BufDesc* tmpbuf = &bufDescTable[frame];
 
   // make sure the page is actually pinned
-  if (bufDescTable[frameNo].pinCnt == 0)
+  if (tmpbuf->pinCnt == 0)
   {
-  	throw PageNotPinnedException(file->filename(), pageNo, frameNo);
+  	throw PageNotPinnedException(tmpbuf->file->filename(), tmpbuf->pageNo, frame);
   }
-  else bufDescTable[frameNo].pinCnt--;
-#ifdef DEBUG
-  std::cout << "unpin called on page " << pageNo << "\n";
-#endif
+
+  if (dirty == true)
+  {
+    std::lock_guard<std::mutex> latch(tmpbuf->latch);
+    tmpbuf->dirty = true;
+    tmpbuf->logged = false;
+    trackDirty(tmpbuf->file, tmpbuf->pageNo, true);
+    // before the pin goes, so an optimistic reader that finds the page unpinned also sees it changed
+    tmpbuf->version++;
+  }
+  tmpbuf->pinCnt--;
+}
+
+PageHandle::PageHandle(PageHandle&& other)
+	: bufMgr(other.bufMgr), file(other.file), pageNo(other.pageNo), frame(other.frame), page(other.page),
+	  dirty(other.dirty)
+{
+  other.bufMgr = NULL;
+  other.page = NULL;
+  other.dirty = false;
+}
+
+PageHandle& PageHandle::operator=(PageHandle&& other)
+{
+  if (this != &other)
+  {
+    release();
+    bufMgr = other.bufMgr;
+    file = other.file;
+    pageNo = other.pageNo;
+    frame = other.frame;
+    page = other.page;
+    dirty = other.dirty;
+    other.bufMgr = NULL;
+    other.page = NULL;
+    other.dirty = false;
+  }
+  return *this;
+}
+
+PageHandle::~PageHandle()
+{
+  try
+  {
+    release();
+  }
+  catch (...)
+  {
+  }
+}
+
+void PageHandle::release()
+{
+  if (page == NULL)
+    return;
+
+  // empty the handle first, so it holds no pin even if unpinning throws
+  BufMgr* mgr = bufMgr;
+  const bool wasDirty = dirty;
+  bufMgr = NULL;
+  page = NULL;
+  dirty = false;
+  mgr->unPinFrame(frame, file, pageNo, wasDirty);
+}
+
+void BufMgr::readOptimistic(File* file, const PageId pageNo, const std::function<void(const Page&)>& reader,
+                            PageLocation* location)
+{
+  PageLocation found;
+  if (location != NULL && location->bufMgr == this && location->file == file && location->pageNo == pageNo)
+    found = *location;
+
+  bool lookedUp = false;
+  for (int attempt = 0; attempt < OPTIMISTIC_ATTEMPTS; attempt++)
+  {
+    // a frame that still has the version it had when the page was found in it still holds the page, unchanged
+    if (found.version == 0 || bufDescTable[found.frame].version != found.version)
+    {
+      if (!locatePage(file, pageNo, found))
+        break;
+      lookedUp = true;
+    }
+    // a writer holds a pin for as long as it changes the page, and may hold it for long
+    if (bufDescTable[found.frame].pinCnt != 0)
+    {
+      bufStats.optimisticretries++;
+      break;
+    }
+
+    if (readFrameOptimistic(found.frame, found.version, reader))
+    {
+      // a read that looked the page up has written shared memory anyway; of those that went straight to the frame,
+      // only some are reported, counted by the location so each page of each buffer manager gets its share
+      if (lookedUp || ++found.numReads % OPTIMISTIC_ACCESS_INTERVAL == 0)
+        policy->pageAccessed(found.frame);
+      if (location != NULL)
+        *location = found;
+      if (trace.isOpen())
+      {
+        trace.record(TraceEvent::READ, file, pageNo, ACCESS_RANDOM);
+        trace.record(TraceEvent::UNPIN, file, pageNo);
+      }
+      return;
+    }
+    bufStats.optimisticretries++;
+    found.version = 0;
+  }
+
+  // the page isn't in the pool, is pinned or keeps changing; read it pinned
+  PageHandle handle = readPage(file, pageNo);
+  reader(*handle.get());
+  if (location != NULL)
+  {
+    location->bufMgr = this;
+    location->file = file;
+    location->pageNo = pageNo;
+    location->frame = handle.frame;
+    location->version = bufDescTable[handle.frame].version;
+  }
+}
+
+bool BufMgr::locatePage(File* file, const PageId pageNo, PageLocation& location)
+{
+  BufHashShard& shard = shardFor(file, pageNo);
+  std::lock_guard<std::mutex> shardLock(shard.mutex);
+  FrameId frameNo = 0;
+  if (!shard.table->lookup(file, pageNo, frameNo))
+    return false;
+  location.bufMgr = this;
+  location.file = file;
+  location.pageNo = pageNo;
+  location.frame = frameNo;
+  location.version = bufDescTable[frameNo].version;
+  return true;
+}
+
+bool BufMgr::readFrameOptimistic(FrameId frame, std::uint64_t version, const std::function<void(const Page&)>& reader)
+{
+  BufDesc* tmpbuf = &bufDescTable[frame];
+  std::exception_ptr error;
+  try
+  {
+    reader(bufPool[frame]);
+  }
+  catch (...)
+  {
+    // what the reader saw may have been half changed; only pass the error on if it wasn't
+    error = std::current_exception();
+  }
+
+  // the page's bytes were read before the pin count and version are read again
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const bool unchanged = tmpbuf->pinCnt.load(std::memory_order_relaxed) == 0 &&
+                         tmpbuf->version.load(std::memory_order_relaxed) == version;
+  if (error && unchanged)
+    std::rethrow_exception(error);
+  return unchanged;
+}
+
+void BufMgr::prefetch(File* file, const std::vector<PageId>& pageNos, BufferRing* ring)
+{
+  if (pageNos.empty())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+    for (std::size_t i = 0; i < pageNos.size() && prefetchQueue.size() < MAX_PREFETCH_QUEUE; i++)
+    {
+      PrefetchRequest request = { file, pageNos[i], ring };
+      prefetchQueue.push_back(request);
+    }
+    if (!prefetcher.joinable())
+      prefetcher = std::thread(&BufMgr::prefetchLoop, this);
+  }
+  prefetchCond.notify_all();
+}
+
+void BufMgr::waitForPrefetch()
+{
+  std::unique_lock<std::mutex> lock(prefetchMutex);
+  prefetchCond.wait(lock, [this]() { return prefetchQueue.empty() && warmQueue.empty() && prefetchFile == NULL; });
+}
+
+void BufMgr::warmUp(File* file)
+{
+  std::vector<PageId> pageNos;
+  {
+    std::lock_guard<std::mutex> lock(prefetchMutex);
+    std::vector<std::pair<std::string, PageId> > others;
+    for (std::size_t i = 0; i < savedHotPages.size(); i++)
+    {
+      if (savedHotPages[i].first == file->filename())
+        pageNos.push_back(savedHotPages[i].second);
+      else
+        others.push_back(savedHotPages[i]);
+    }
+    if (pageNos.empty())
+      return;
+    savedHotPages.swap(others);
+
+    // hottest batch first, each in page number order so the disk reads it front to back
+    for (std::size_t first = 0; first < pageNos.size(); first += WARM_BATCH)
+    {
+      std::vector<PageId>::iterator last = pageNos.begin() + std::min(first + WARM_BATCH, pageNos.size());
+      std::sort(pageNos.begin() + first, last);
+      for (std::vector<PageId>::iterator it = pageNos.begin() + first; it != last; ++it)
+        warmQueue.push_back(std::make_pair(file, *it));
+    }
+    if (!prefetcher.joinable())
+      prefetcher = std::thread(&BufMgr::prefetchLoop, this);
+  }
+  prefetchCond.notify_all();
+}
+
+void BufMgr::collectHotPages(const File* file, std::vector<std::pair<std::string, PageId> >& pages)
+{
+  // the policy ranks every page it would evict, coldest first, when none is taken to be pinned
+  std::vector<FrameId> frames;
+  policy->upcomingVictims(frames, numBufs, [](FrameId) { return false; });
+  for (std::size_t i = frames.size(); i > 0; i--)
+  {
+    BufDesc* tmpbuf = &bufDescTable[frames[i - 1]];
+    std::lock_guard<std::mutex> latch(tmpbuf->latch);
+    if (tmpbuf->valid && (file == NULL || tmpbuf->file == file))
+      pages.push_back(std::make_pair(tmpbuf->file->filename(), tmpbuf->pageNo));
+  }
+}
+
+void BufMgr::loadHotPages()
+{
+  if (hotPagesPath.empty())
+    return;
+  // one page per line: the page number, a space and the file name, which may itself contain spaces
+  std::ifstream in(hotPagesPath.c_str());
+  PageId pageNo;
+  std::string name;
+  while (in >> pageNo && in.get() == ' ' && std::getline(in, name))
+    savedHotPages.push_back(std::make_pair(name, pageNo));
+}
+
+void BufMgr::saveHotPages()
+{
+  if (hotPagesPath.empty())
+    return;
+  std::vector<std::pair<std::string, PageId> > pages;
+  collectHotPages(NULL, pages);
+  {
+    std::lock_guard<std::mutex> lock(hotPagesMutex);
+    pages.insert(pages.end(), flushedHotPages.begin(), flushedHotPages.end());
+  }
+
+  // a page flushed and read again is listed twice; keep its hotter place.  No more pages than fit are worth warming.
+  std::set<std::pair<std::string, PageId> > seen;
+  std::vector<std::pair<std::string, PageId> > hotPages;
+  for (std::size_t i = 0; i < pages.size() && hotPages.size() < numBufs; i++)
+  {
+    if (seen.insert(pages[i]).second)
+      hotPages.push_back(pages[i]);
+  }
+
+  // written aside and renamed over the old list, so a crash meanwhile leaves the old one whole
+  const std::string tmpPath = hotPagesPath + ".tmp";
+  {
+    std::ofstream out(tmpPath.c_str(), std::ios::trunc);
+    for (std::size_t i = 0; i < hotPages.size(); i++)
+      out << hotPages[i].second << ' ' << hotPages[i].first << '\n';
+    if (!out.flush())
+      return;
+  }
+  std::rename(tmpPath.c_str(), hotPagesPath.c_str());
+}
+
+void BufMgr::prefetchLoop()
+{
+  std::unique_lock<std::mutex> lock(prefetchMutex);
+  while (true)
+  {
+    prefetchCond.wait(lock, [this]() { return prefetchStop || !prefetchQueue.empty() || !warmQueue.empty(); });
+    if (prefetchStop)
+      return;
+
+    // scans waiting for their pages go before warming
+    const bool warming = prefetchQueue.empty();
+    PrefetchRequest request;
+    FrameId frame = 0;
+    if (warming)
+    {
+      // the frame is taken now rather than when the page is read, so a reader filling the pool meanwhile can't leave
+      // the page to be read over one in use
+      if (!takeFreeFrame(frame))
+      {
+        // the pool has filled up; warming any further would evict pages in use
+        warmQueue.clear();
+        prefetchCond.notify_all();
+        continue;
+      }
+      request.file = warmQueue.front().first;
+      request.pageNo = warmQueue.front().second;
+      request.ring = NULL;
+      warmQueue.pop_front();
+    }
+    else
+    {
+      request = prefetchQueue.front();
+      prefetchQueue.pop_front();
+    }
+    prefetchFile = request.file;
+    lock.unlock();
+
+    // read the page like any other and leave it unpinned for the reader to find.  Read ahead pages are used once,
+    // into the scan's ring if it has one, while warmed pages were hot before the restart.
+    try
+    {
+      Page* page;
+      AccessHint hint = warming ? ACCESS_RANDOM : (request.ring != NULL ? ACCESS_SEQUENTIAL : ACCESS_ONCE);
+      if (fetchPage(request.file, request.pageNo, page, hint, request.ring, true, warming ? &frame : NULL))
+        bufStats.prefetches++;
+      // unpinned directly rather than through unPinPage(), which would record it in the trace
+      std::lock_guard<std::mutex> shardLock(shardFor(request.file, request.pageNo).mutex);
+      dropPin(static_cast<FrameId>(page - bufPool), false);
+    }
+    catch (...)
+    {
+      // read-ahead is only a hint; the reader will see any error for itself
+    }
+
+    lock.lock();
+    prefetchFile = NULL;
+    prefetchCond.notify_all();
+  }
+}
+
+std::uint32_t BufMgr::cleanVictims()
+{
+  // free frames need no cleaning
+  std::size_t target = cleanTarget;
+  {
+    std::lock_guard<std::mutex> lock(freeMutex);
+    if (numFreeFrames >= target)
+      return 0;
+    target -= numFreeFrames;
+  }
+
+  const ReplacementPolicy::PinnedPredicate isPinned = [this](FrameId f) { return bufDescTable[f].pinCnt > 0; };
+  std::vector<FrameId> victims;
+  policy->upcomingVictims(victims, target, isPinned);
+
+  std::uint32_t numWritten = 0;
+  for (std::size_t i = 0; i < victims.size(); i++)
+  {
+    BufDesc* tmpbuf = &bufDescTable[victims[i]];
+    const File* file;
+    PageId pageNo;
+    {
+      std::lock_guard<std::mutex> latch(tmpbuf->latch);
+      if (!tmpbuf->valid || !tmpbuf->dirty)
+        continue;
+      file = tmpbuf->file;
+      pageNo = tmpbuf->pageNo;
+    }
+
+    // take the shard lock before the latch, as everywhere but eviction, so waiting for them is safe.  Holding the
+    // shard lock keeps anyone from pinning the page and changing it while it is copied for the write
+    BufHashShard& shard = shardFor(file, pageNo);
+    std::unique_lock<std::mutex> shardLock(shard.mutex);
+    std::unique_lock<std::mutex> latch(tmpbuf->latch);
+    if (!tmpbuf->valid || tmpbuf->file != file || tmpbuf->pageNo != pageNo || !tmpbuf->dirty || tmpbuf->pinCnt != 0 ||
+        tmpbuf->writing)
+      continue;
+
+    writeFrame(victims[i], shardLock, latch);
+    numWritten++;
+  }
+  return numWritten;
+}
+
+void BufMgr::writerLoop()
+{
+  std::unique_lock<std::mutex> lock(writerMutex);
+  while (!writerStop)
+  {
+    writerCond.wait_for(lock, std::chrono::milliseconds(WRITER_INTERVAL_MS));
+    if (writerStop)
+      return;
+    lock.unlock();
+    try
+    {
+      cleanVictims();
+    }
+    catch (...)
+    {
+      // the page stays dirty, and whoever evicts it will see the error
+    }
+    lock.lock();
+  }
+}
+
+void BufMgr::cancelPrefetch(const File* file)
+{
+  std::unique_lock<std::mutex> lock(prefetchMutex);
+  for (std::deque<PrefetchRequest>::iterator it = prefetchQueue.begin(); it != prefetchQueue.end(); )
+  {
+    if (it->file == file)
+      it = prefetchQueue.erase(it);
+    else
+      ++it;
+  }
+  for (std::deque<std::pair<File*, PageId> >::iterator it = warmQueue.begin(); it != warmQueue.end(); )
+  {
+    if (it->first == file)
+      it = warmQueue.erase(it);
+    else
+      ++it;
+  }
+  prefetchCond.wait(lock, [this, file]() { return prefetchFile != file; });
 }
 
 void BufMgr::flushFile(const File* file) 
 {
-  for (std::uint32_t i = 0; i < numBufs; i++)
+  trace.record(TraceEvent::FLUSH, file, Page::INVALID_NUMBER);
+
+  // the prefetcher must not touch the file once it has been flushed, as it may be closed next
+  cancelPrefetch(file);
+
+  // the file may be closed next, so remember its hot pages now for the hot page list.  A file with no pages left in
+  // the pool hasn't been used since it was last flushed, and keeps the pages remembered then.
+  std::vector<std::pair<std::string, PageId> > hotPages;
+  if (!hotPagesPath.empty())
+    collectHotPages(file, hotPages);
+  if (!hotPages.empty())
+  {
+    std::lock_guard<std::mutex> lock(hotPagesMutex);
+    std::vector<std::pair<std::string, PageId> > others;
+    for (std::size_t i = 0; i < flushedHotPages.size() && hotPages.size() + others.size() < numBufs; i++)
+    {
+      if (flushedHotPages[i].first != file->filename())
+        others.push_back(flushedHotPages[i]);
+    }
+    hotPages.insert(hotPages.end(), others.begin(), others.end());
+    flushedHotPages.swap(hotPages);
+  }
+
+  std::vector<std::pair<PageId, FrameId> > pages;
+  std::vector<PageId> dirtyPages;
+  {
+    std::lock_guard<std::mutex> lock(filePagesMutex);
+    std::map<const File*, BufFilePages>::const_iterator it = filePages.find(file);
+    if (it != filePages.end())
+    {
+      pages.assign(it->second.frames.begin(), it->second.frames.end());
+      dirtyPages.assign(it->second.dirty.begin(), it->second.dirty.end());
+    }
+  }
+
+  // refuse before anything is written if the file is still in use
+  for (std::size_t i = 0; i < pages.size(); i++)
+  {
+    if (bufDescTable[pages[i].second].pinCnt > 0)
+      throw PagePinnedException(file->filename(), pages[i].first, pages[i].second);
+  }
+
+  writeRuns(file, dirtyPages);
+
+  for (std::size_t i = 0; i < pages.size(); i++)
 	{
-  	BufDesc* tmpbuf = &(bufDescTable[i]);
-  	if(tmpbuf->valid == true && tmpbuf->file == file)
-		{
-	    if (tmpbuf->pinCnt > 0)
-  			throw PagePinnedException(file->filename(), tmpbuf->pageNo, tmpbuf->frameNo);
+    const PageId pageNo = pages[i].first;
+    BufHashShard& shard = shardFor(file, pageNo);
+    std::unique_lock<std::mutex> shardLock(shard.mutex);
+    FrameId frameNo = 0;
+    if (!lookupIdle(shard, shardLock, file, pageNo, frameNo))
+      continue;  // evicted meanwhile
+
+    BufDesc* tmpbuf = &(bufDescTable[frameNo]);
+    std::unique_lock<std::mutex> latch(tmpbuf->latch);
+    if (tmpbuf->pinCnt > 0)
+      throw PagePinnedException(file->filename(), pageNo, frameNo);
 
-	    if (tmpbuf->dirty == true)
-			{
-				//if ((status = tmpbuf->file->writePage(tmpbuf->pageNo, &(bufPool[i]))) != OK)
-				tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
-				tmpbuf->dirty = false;
-    	}
+    // the page may be pinned while it is written
+    if (tmpbuf->dirty == true && (!writeFrame(frameNo, shardLock, latch) || tmpbuf->pinCnt > 0))
+      throw PagePinnedException(file->filename(), pageNo, frameNo);
 
-    	hashTable->remove(file,tmpbuf->pageNo);
-    	tmpbuf->Clear();
-  	}
-		else if (tmpbuf->valid == false && tmpbuf->file == file)
-  		throw BadBufferException(tmpbuf->frameNo, tmpbuf->dirty, tmpbuf->valid, tmpbuf->refbit);
+    shard.table->remove(file, pageNo);
+    untrackPage(file, pageNo);
+    policy->pageRemoved(frameNo, file, pageNo, false);
+    tmpbuf->Clear();
+    freeFrame(frameNo);
   }
+
+  // the File object may be deleted next and another made at its address; drop the copies of its pages, including
+  // those of pages evicted while they were being removed above
+  if (victimCache != NULL)
+    victimCache->eraseFile(file);
 }
 
 void BufMgr::disposePage(File* file, const PageId pageNo) 
 {
+  trace.record(TraceEvent::DISPOSE, file, pageNo);
+
 	//Deallocate from file altogether
   //See if it is in the buffer pool
-  FrameId frameNo = 0;
-  hashTable->lookup(file, pageNo, frameNo);
+  BufHashShard& shard = shardFor(file, pageNo);
+  {
+    std::unique_lock<std::mutex> shardLock(shard.mutex);
+    FrameId frameNo = 0;
+    if (lookupIdle(shard, shardLock, file, pageNo, frameNo))
+    {
+	    // clear the page
+	    {
+	      std::lock_guard<std::mutex> latch(bufDescTable[frameNo].latch);
+	      bufDescTable[frameNo].Clear();
+	    }
 
-	// clear the page
-	bufDescTable[frameNo].Clear();
+	    shard.table->remove(file, pageNo);
+	    untrackPage(file, pageNo);
+	    policy->pageRemoved(frameNo, file, pageNo, false);
+	    freeFrame(frameNo);
+    }
+  }
 
-	hashTable->remove(file, pageNo);
+  // a copy of the old page must not turn up if the page number is reused
+  if (victimCache != NULL)
+    victimCache->erase(file, pageNo);
 
   // deallocate it in the file	
   file->deletePage(pageNo);
+
+  // keep older images of the page in the log from being copied over it if the page is reused
+  if (log != NULL)
+    log->logPageFreed(file, pageNo);
 }
 
 
 void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
 {
   FrameId frameNo;
+  bufStats.accesses++;
 
   // alloc a new frame
-  allocBuf(frameNo);
+  std::uint32_t pinWaits = allocBuf(frameNo);
 
   // allocate a new page in the file
 	//std::cerr << "buffer data size:" << bufPool[frameNo].data_.length() << "\n";
-  bufPool[frameNo] = file->allocatePage(pageNo);
+  try
+  {
+    bufPool[frameNo] = file->allocatePage(pageNo);
+  }
+  catch(...)
+  {
+    releaseBuf(frameNo);
+    throw;
+  }
   page = &bufPool[frameNo];
 
   // set up the entry properly
-  bufDescTable[frameNo].Set(file, pageNo);
+  BufHashShard& shard = shardFor(file, pageNo);
+  std::lock_guard<std::mutex> shardLock(shard.mutex);
+  {
+    std::lock_guard<std::mutex> latch(bufDescTable[frameNo].latch);
+    bufDescTable[frameNo].Set(file, pageNo);
+  }
 
   // insert in the hash table
-  hashTable->insert(file, pageNo, frameNo);
+  shard.table->insert(file, pageNo, frameNo);
+  trackPage(file, pageNo, frameNo);
+  policy->pageLoaded(frameNo, file, pageNo, ACCESS_RANDOM);
+  fileCounts(shard, file).pinwaits += pinWaits;
+  trace.record(TraceEvent::ALLOC, file, pageNo);
+}
+
+PageHandle BufMgr::allocPage(File* file, PageId &pageNo)
+{
+  Page* page;
+  allocPage(file, pageNo, page);
+  return PageHandle(this, file, pageNo, static_cast<FrameId>(page - bufPool), page);
+}
+
+bool BufMgr::writeFrame(FrameId frame, std::unique_lock<std::mutex>& shardLock, std::unique_lock<std::mutex>& latch)
+{
+  BufDesc* tmpbuf = &bufDescTable[frame];
+  File* file = tmpbuf->file;
+  const PageId pageNo = tmpbuf->pageNo;
+  BufHashShard& shard = shardFor(file, pageNo);
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  // write-ahead rule: the log must hold the page's newest image before the page itself is written.  Appending it only
+  // copies it into the log's buffer; forcing the log is left for after the locks are dropped
+  if (log != NULL && !tmpbuf->logged)
+  {
+    tmpbuf->pageLsn = log->logPage(file, pageNo, bufPool[frame]);
+    tmpbuf->logged = true;
+  }
+  const Lsn pageLsn = tmpbuf->pageLsn;
+  const std::uint64_t version = tmpbuf->version;
+  const Page image = bufPool[frame];
+  tmpbuf->writing = true;
+  latch.unlock();
+  shardLock.unlock();
+
+  try
+  {
+    if (log != NULL)
+      log->flush(pageLsn);
+    bufStats.diskwrites++;
+    file->writePage(pageNo, image);
+  }
+  catch (...)
+  {
+    // the page stays dirty
+    shardLock.lock();
+    latch.lock();
+    tmpbuf->writing = false;
+    shard.writeDone.notify_all();
+    throw;
+  }
+  bufStats.writeLatency.record(std::chrono::steady_clock::now() - start);
+  {
+    std::lock_guard<std::mutex> lock(unsyncedMutex);
+    unsyncedFiles.insert(file->filename());
+  }
+
+  shardLock.lock();
+  latch.lock();
+  tmpbuf->writing = false;
+  shard.writeDone.notify_all();
+  // a miss on the page after it is evicted must not install an image it read before this write
+  shard.writebacks++;
+
+  // a page unpinned dirty during the write has changed since the copy was made, and is still dirty
+  if (tmpbuf->version != version)
+    return false;
+  tmpbuf->dirty = false;
+  trackDirty(file, pageNo, false);
+  return true;
+}
+
+bool BufMgr::lookupIdle(BufHashShard& shard, std::unique_lock<std::mutex>& shardLock, const File* file, PageId pageNo,
+                        FrameId& frame)
+{
+  while (shard.table->lookup(file, pageNo, frame))
+  {
+    if (!bufDescTable[frame].writing)
+      return true;
+    shard.writeDone.wait(shardLock);
+  }
+  return false;
+}
+
+void BufMgr::writeRuns(const File* file, const std::vector<PageId>& pageNos)
+{
+  std::vector<FrameId> run;
+  PageId first = Page::INVALID_NUMBER;
+  for (std::size_t i = 0; i < pageNos.size(); i++)
+  {
+    // a page that doesn't follow the run, including one after a page that was skipped, starts a new run
+    if (!run.empty() && (pageNos[i] != first + run.size() || run.size() == MAX_WRITE_RUN))
+    {
+      writeRun(first, run);
+      run.clear();
+    }
+
+    BufHashShard& shard = shardFor(file, pageNos[i]);
+    std::unique_lock<std::mutex> shardLock(shard.mutex);
+    FrameId frameNo = 0;
+    if (!lookupIdle(shard, shardLock, file, pageNos[i], frameNo))
+      continue;  // evicted, and so written back, meanwhile
+    {
+      std::lock_guard<std::mutex> latch(bufDescTable[frameNo].latch);
+      if (!bufDescTable[frameNo].dirty)
+        continue;
+    }
+    bufDescTable[frameNo].pinCnt++;
+
+    if (run.empty())
+      first = pageNos[i];
+    run.push_back(frameNo);
+  }
+  if (!run.empty())
+    writeRun(first, run);
+}
+
+void BufMgr::writeRun(PageId first, const std::vector<FrameId>& run)
+{
+  File* file = bufDescTable[run[0]].file;
+  // other threads may pin the pages and change them during the write, so copies are written, and a page only counts
+  // as clean afterwards if it wasn't unpinned dirty since its copy was taken
+  std::vector<Page> images(run.size());
+  std::vector<std::uint64_t> versions(run.size());
+  try
+  {
+    std::vector<const Page*> pages;
+    Lsn runLsn = 0;
+    for (std::size_t i = 0; i < run.size(); i++)
+    {
+      BufDesc* tmpbuf = &bufDescTable[run[i]];
+      std::lock_guard<std::mutex> latch(tmpbuf->latch);
+      versions[i] = tmpbuf->version;
+      images[i] = bufPool[run[i]];
+      if (log != NULL)
+      {
+        // write-ahead rule, as in writeFrame(), for the whole run at once
+        if (!tmpbuf->logged)
+        {
+          tmpbuf->pageLsn = log->logPage(tmpbuf->file, tmpbuf->pageNo, images[i]);
+          tmpbuf->logged = true;
+        }
+        runLsn = std::max(runLsn, tmpbuf->pageLsn);
+      }
+      pages.push_back(&images[i]);
+    }
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (log != NULL)
+      log->flush(runLsn);
+    file->writePages(first, pages);
+    bufStats.writeLatency.record(std::chrono::steady_clock::now() - start);
+    bufStats.diskwrites += run.size();
+    std::lock_guard<std::mutex> lock(unsyncedMutex);
+    unsyncedFiles.insert(file->filename());
+  }
+  catch (...)
+  {
+    // the pages stay dirty
+    for (std::size_t i = 0; i < run.size(); i++)
+    {
+      std::lock_guard<std::mutex> shardLock(shardFor(file, first + i).mutex);
+      bufDescTable[run[i]].pinCnt--;
+    }
+    throw;
+  }
+
+  for (std::size_t i = 0; i < run.size(); i++)
+  {
+    // a miss on the page after it is evicted must not install an image it read before this write
+    BufHashShard& shard = shardFor(file, first + i);
+    std::lock_guard<std::mutex> shardLock(shard.mutex);
+    {
+      std::lock_guard<std::mutex> latch(bufDescTable[run[i]].latch);
+      if (bufDescTable[run[i]].version == versions[i])
+      {
+        bufDescTable[run[i]].dirty = false;
+        trackDirty(file, first + i, false);
+      }
+    }
+    shard.writebacks++;
+    bufDescTable[run[i]].pinCnt--;
+  }
+}
+
+void BufMgr::writeDirtyPages()
+{
+  std::vector<std::pair<const File*, std::vector<PageId> > > dirtyPages;
+  {
+    std::lock_guard<std::mutex> lock(filePagesMutex);
+    for (std::map<const File*, BufFilePages>::const_iterator it = filePages.begin(); it != filePages.end(); ++it)
+    {
+      if (!it->second.dirty.empty())
+        dirtyPages.push_back(std::make_pair(it->first,
+                                            std::vector<PageId>(it->second.dirty.begin(), it->second.dirty.end())));
+    }
+  }
+
+  for (std::size_t i = 0; i < dirtyPages.size(); i++)
+    writeRuns(dirtyPages[i].first, dirtyPages[i].second);
+}
+
+void BufMgr::trackPage(const File* file, PageId pageNo, FrameId frame)
+{
+  std::lock_guard<std::mutex> lock(filePagesMutex);
+  filePages[file].frames[pageNo] = frame;
+}
+
+void BufMgr::untrackPage(const File* file, PageId pageNo)
+{
+  std::lock_guard<std::mutex> lock(filePagesMutex);
+  std::map<const File*, BufFilePages>::iterator it = filePages.find(file);
+  if (it == filePages.end())
+    return;
+  it->second.frames.erase(pageNo);
+  it->second.dirty.erase(pageNo);
+  if (it->second.frames.empty())
+    filePages.erase(it);
+}
+
+void BufMgr::trackDirty(const File* file, PageId pageNo, bool dirty)
+{
+  std::lock_guard<std::mutex> lock(filePagesMutex);
+  std::map<const File*, BufFilePages>::iterator it = filePages.find(file);
+  if (it == filePages.end())
+    return;
+  if (dirty)
+    it->second.dirty.insert(pageNo);
+  else
+    it->second.dirty.erase(pageNo);
+}
+
+Lsn BufMgr::commit()
+{
+  if (log == NULL)
+    return 0;
+
+  // only the dirty pages can be missing from the log
+  std::vector<std::pair<const File*, PageId> > dirtyPages;
+  {
+    std::lock_guard<std::mutex> lock(filePagesMutex);
+    for (std::map<const File*, BufFilePages>::const_iterator it = filePages.begin(); it != filePages.end(); ++it)
+    {
+      for (std::set<PageId>::const_iterator page = it->second.dirty.begin(); page != it->second.dirty.end(); ++page)
+        dirtyPages.push_back(std::make_pair(it->first, *page));
+    }
+  }
+
+  for (std::size_t i = 0; i < dirtyPages.size(); i++)
+  {
+    BufHashShard& shard = shardFor(dirtyPages[i].first, dirtyPages[i].second);
+    std::lock_guard<std::mutex> shardLock(shard.mutex);
+    FrameId frameNo = 0;
+    if (!shard.table->lookup(dirtyPages[i].first, dirtyPages[i].second, frameNo))
+      continue;
+    BufDesc* tmpbuf = &bufDescTable[frameNo];
+    std::lock_guard<std::mutex> latch(tmpbuf->latch);
+    if (tmpbuf->dirty == true && !tmpbuf->logged)
+    {
+      tmpbuf->pageLsn = log->logPage(tmpbuf->file, tmpbuf->pageNo, bufPool[frameNo]);
+      tmpbuf->logged = true;
+    }
+  }
+  // the log has a lock of its own, and other threads' I/O must not wait for the commit's group to fill up
+  return log->commit();
+}
+
+void BufMgr::checkpoint()
+{
+  // write the dirty pages in file and page order, so each file is written front to back
+  writeDirtyPages();
+
+  // the pages must be on disk before the log that covers them is emptied
+  std::set<std::string> files;
+  {
+    std::lock_guard<std::mutex> lock(unsyncedMutex);
+    files.swap(unsyncedFiles);
+  }
+  for (std::set<std::string>::const_iterator it = files.begin(); it != files.end(); ++it)
+    File::sync(*it);
+
+  if (log != NULL)
+    log->truncate();
+
+  saveHotPages();
+}
+
+std::uint32_t BufMgr::resize(std::uint32_t bufs)
+{
+  std::lock_guard<std::mutex> resizing(resizeMutex);
+  bufs = std::max<std::uint32_t>(1, std::min(bufs, maxBufs));
+  const std::uint32_t oldBufs = numBufs;
+
+  if (bufs > oldBufs)
+  {
+    for (FrameId i = oldBufs; i < bufs; i++)
+      new (&bufPool[i]) Page();
+    policy->resize(bufs);
+
+    std::lock_guard<std::mutex> lock(freeMutex);
+    numBufs = bufs;
+    for (FrameId i = bufs; i > oldBufs; i--)
+    {
+      bufDescTable[i - 1].free = true;
+      freeFrames[partitionOf(i - 1)].push_back(i - 1);
+    }
+    numFreeFrames += bufs - oldBufs;
+  }
+  else if (bufs < oldBufs)
+  {
+    // Lowering numBufs keeps frames beyond it off the free lists from now on; take off those already there.
+    {
+      std::lock_guard<std::mutex> lock(freeMutex);
+      numBufs = bufs;
+      for (std::uint32_t p = 0; p < numPartitions; p++)
+      {
+        std::vector<FrameId>& list = freeFrames[p];
+        for (std::size_t i = 0; i < list.size(); )
+        {
+          if (list[i] >= bufs)
+          {
+            bufDescTable[list[i]].free = false;
+            list[i] = list.back();
+            list.pop_back();
+            numFreeFrames--;
+          }
+          else
+            i++;
+        }
+      }
+    }
+
+    // drop frames from the end down, stopping at the first pinned one
+    std::uint32_t kept = bufs;
+    for (FrameId frame = oldBufs; frame > bufs; frame--)
+    {
+      if (!retireFrame(frame - 1))
+      {
+        kept = frame;
+        break;
+      }
+    }
+
+    if (kept > bufs)
+    {
+      // Keep the frames below the pinned one after all.  Those left empty by the eviction go back on the free lists;
+      // the latch keeps a thread that evicted one for itself from being passed over.
+      {
+        std::lock_guard<std::mutex> lock(freeMutex);
+        numBufs = kept;
+      }
+      for (FrameId frame = bufs; frame < kept; frame++)
+      {
+        BufDesc* tmpbuf = &bufDescTable[frame];
+        std::lock_guard<std::mutex> latch(tmpbuf->latch);
+        std::lock_guard<std::mutex> lock(freeMutex);
+        if (!tmpbuf->valid && tmpbuf->pinCnt == 0 && !tmpbuf->free)
+        {
+          tmpbuf->free = true;
+          freeFrames[partitionOf(frame)].push_back(frame);
+          numFreeFrames++;
+        }
+      }
+      bufs = kept;
+    }
+
+    for (FrameId i = bufs; i < oldBufs; i++)
+      bufPool[i].~Page();
+    frameMemory->release(sizeof(Page) * bufs, sizeof(Page) * (oldBufs - bufs));
+    policy->resize(bufs);
+  }
+
+  for (std::uint32_t i = 0; i < NUM_SHARDS; i++)
+  {
+    std::lock_guard<std::mutex> lock(shards[i].mutex);
+    shards[i].table->reserve(bufs / NUM_SHARDS + 1);
+  }
+  return bufs;
+}
+
+bool BufMgr::retireFrame(FrameId frame)
+{
+  BufDesc* tmpbuf = &bufDescTable[frame];
+  while (true)
+  {
+    if (tmpbuf->pinCnt > 0)
+      return false;
+    {
+      // empty, and no other thread is loading a page into it
+      std::lock_guard<std::mutex> latch(tmpbuf->latch);
+      if (!tmpbuf->valid && tmpbuf->pinCnt == 0)
+        return true;
+    }
+    if (evictFrame(frame))
+    {
+      // the eviction left the frame pinned for us; nothing can claim it once it is beyond numBufs
+      tmpbuf->pinCnt = 0;
+      return true;
+    }
+    // another thread holds the latch or the shard lock for a moment
+    std::this_thread::yield();
+  }
+}
+
+BufPageCounts& BufMgr::fileCounts(BufHashShard& shard, const File* file)
+{
+  std::pair<std::string, BufPageCounts>& entry = shard.fileCounts[file];
+  if (entry.first != file->filename())
+  {
+    // a File object has been deleted and another made at its address; keep the old file's counts under its name
+    if (!entry.first.empty())
+      shard.closedFileCounts[entry.first].add(entry.second);
+    entry.first = file->filename();
+    entry.second = BufPageCounts();
+  }
+  return entry.second;
+}
+
+void BufMgr::countHit(BufHashShard& shard, const File* file, FrameId frame)
+{
+  BufPageCounts& counts = fileCounts(shard, file);
+  counts.hits++;
+  bufStats.hits++;
+  if (bufDescTable[frame].prefetched)
+  {
+    bufDescTable[frame].prefetched = false;
+    counts.prefetchhits++;
+    bufStats.prefetchhits++;
+  }
+}
+
+void BufMgr::countMiss(BufHashShard& shard, const File* file, std::uint32_t pinWaits, bool prefetching, bool cached,
+                       std::chrono::steady_clock::time_point start)
+{
+  BufPageCounts& counts = fileCounts(shard, file);
+  counts.pinwaits += pinWaits;
+  if (prefetching)
+    return;
+  counts.misses++;
+  bufStats.misses++;
+  if (cached)
+  {
+    counts.cachehits++;
+    bufStats.cachehits++;
+  }
+  bufStats.readMissLatency.record(std::chrono::steady_clock::now() - start);
+}
+
+BufStatsSnapshot BufMgr::getStatsSnapshot()
+{
+  BufStatsSnapshot snapshot;
+  snapshot.accesses = bufStats.accesses;
+  snapshot.diskreads = bufStats.diskreads;
+  snapshot.diskwrites = bufStats.diskwrites;
+  snapshot.prefetches = bufStats.prefetches;
+  snapshot.optimisticretries = bufStats.optimisticretries;
+  snapshot.total.hits = bufStats.hits;
+  snapshot.total.misses = bufStats.misses;
+  snapshot.total.evictions = bufStats.evictions;
+  snapshot.total.victimwrites = bufStats.victimwrites;
+  snapshot.total.pinwaits = bufStats.pinwaits;
+  snapshot.total.prefetchhits = bufStats.prefetchhits;
+  snapshot.total.cachehits = bufStats.cachehits;
+  snapshot.readMissLatency = bufStats.readMissLatency;
+  snapshot.writeLatency = bufStats.writeLatency;
+
+  // a file's pages are spread over the shards
+  for (std::uint32_t i = 0; i < NUM_SHARDS; i++)
+  {
+    std::lock_guard<std::mutex> lock(shards[i].mutex);
+    std::map<const File*, std::pair<std::string, BufPageCounts> >::const_iterator it;
+    for (it = shards[i].fileCounts.begin(); it != shards[i].fileCounts.end(); ++it)
+      snapshot.files[it->second.first].add(it->second.second);
+    std::map<std::string, BufPageCounts>::const_iterator closed;
+    for (closed = shards[i].closedFileCounts.begin(); closed != shards[i].closedFileCounts.end(); ++closed)
+      snapshot.files[closed->first].add(closed->second);
+  }
+  return snapshot;
+}
+
+void BufMgr::clearBufStats()
+{
+  bufStats.clear();
+  for (std::uint32_t i = 0; i < NUM_SHARDS; i++)
+  {
+    std::lock_guard<std::mutex> lock(shards[i].mutex);
+    shards[i].fileCounts.clear();
+    shards[i].closedFileCounts.clear();
+  }
 }
 
 void BufMgr::printSelf(void) 
@@ -8,8 +8,25 @@
 #pragma once
 
 #include "file.h"
+#include "accesstrace.h"
 #include "bufHashTbl.h"
+#include "logmanager.h"
+#include "poolmemory.h"
+#include "replacementpolicy.h"
+#include "victimcache.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace badgerdb {
 
@@ -20,6 +37,11 @@ class BufMgr;
 
 /**
 * @brief Class for maintaining information about buffer pool frames
+*
+* The frame's identity (file, pageNo, valid) and its dirty state are changed while holding the frame's latch.  Pins
+* are taken and dropped while holding the lock of the hash table shard the page belongs to, so a page found unpinned
+* under that lock can be evicted without anyone pinning it in the meantime.  The version changes along with the
+* frame's identity, and when the page is unpinned dirty.
 */
 class BufDesc {
 
@@ -44,7 +66,7 @@ class BufDesc {
 	/**
    * Number of times this page has been pinned
 	 */
-  int pinCnt;
+  std::atomic<int> pinCnt;
 
 	/**
    * True if page is dirty;  false otherwise
@@ -54,24 +76,61 @@ class BufDesc {
 	/**
    * True if page is valid
 	 */
-  bool valid;
+  std::atomic<bool> valid;
 
 	/**
-   * Has this buffer frame been reference recently
+   * True if the page's current contents have been appended to the log.  Only meaningful while the page is dirty
 	 */
-  bool refbit;
+  bool logged;
+
+	/**
+   * Log sequence number of the last image of the page appended to the log
+	 */
+  Lsn pageLsn;
+
+	/**
+   * Latch protecting the frame's identity and dirty state
+	 */
+  std::mutex latch;
+
+	/**
+   * True while a copy of the page is being written back with no lock held.  The frame keeps its page meanwhile:
+   * eviction and the page writer pass it over, and anything that would drop the page waits for the write.  Guarded by
+   * the lock of the page's shard.
+	 */
+  bool writing;
+
+	/**
+   * True while the frame is on a free list.  Guarded by the buffer manager's free list lock rather than the latch
+	 */
+  bool free;
+
+	/**
+   * True if prefetch() read the page and no readPage() has found it since.  Guarded by the lock of the page's shard.
+	 */
+  bool prefetched;
+
+	/**
+   * Changes whenever the frame is given another page or its page is unpinned dirty, so a reader that looked at the
+   * page without pinning it can tell whether the page changed under it
+	 */
+  std::atomic<std::uint64_t> version;
 
 	/**
    * Initialize buffer frame for a new user
 	 */
   void Clear()
 	{
+    version++;
     pinCnt = 0;
 		file = NULL;
 		pageNo = Page::INVALID_NUMBER;
     dirty = false;
-    refbit = false;
 		valid = false;
+    logged = false;
+    pageLsn = 0;
+    prefetched = false;
+    writing = false;
   };
 
 	/**
@@ -83,12 +142,14 @@ class BufDesc {
 	 */
   void Set(File* filePtr, PageId pageNum)
 	{ 
+    version++;
 		file = filePtr;
     pageNo = pageNum;
     pinCnt = 1;
     dirty = false;
     valid = true;
-    refbit = true;
+    logged = false;
+    pageLsn = 0;
   }
 
   void Print()
@@ -103,17 +164,177 @@ class BufDesc {
 
 		std::cout << "valid:" << valid << " ";
 		std::cout << "pinCnt:" << pinCnt << " ";
-		std::cout << "dirty:" << dirty << " ";
-		std::cout << "refbit:" << refbit << "\n";
+		std::cout << "dirty:" << dirty << "\n";
   }
 
 	/**
    * Constructor of BufDesc class 
 	 */
   BufDesc()
+	  : version(0)
 	{
   	Clear();
+    free = false;
+  }
+};
+
+
+/**
+* @brief Counts of how the pages of one file, or of all files, fared in the buffer pool
+*/
+struct BufPageCounts
+{
+	/**
+   * Number of readPage() calls that found the page in the buffer pool
+	 */
+  std::uint64_t hits;
+
+	/**
+   * Number of readPage() calls that had to read the page from disk or the victim cache
+	 */
+  std::uint64_t misses;
+
+	/**
+   * Number of pages evicted to make room for others
+	 */
+  std::uint64_t evictions;
+
+	/**
+   * Number of the evicted pages that were dirty, so the thread evicting them had to write them back, which the page
+   * writer is there to avoid
+	 */
+  std::uint64_t victimwrites;
+
+	/**
+   * Number of times a thread reading or allocating a page found every victim frame pinned or busy and had to wait
+	 */
+  std::uint64_t pinwaits;
+
+	/**
+   * Number of pages read by prefetch() that a readPage() then found in the buffer pool
+	 */
+  std::uint64_t prefetchhits;
+
+	/**
+   * Number of the misses that found the page in the victim cache instead of reading it from disk
+	 */
+  std::uint64_t cachehits;
+
+	/**
+   * Constructor of BufPageCounts class.  All counts zero.
+	 */
+  BufPageCounts()
+    : hits(0), misses(0), evictions(0), victimwrites(0), pinwaits(0), prefetchhits(0), cachehits(0)
+  {
+  }
+
+	/**
+   * Adds another set of counts to these
+	 */
+  void add(const BufPageCounts& other)
+  {
+		hits += other.hits;
+		misses += other.misses;
+		evictions += other.evictions;
+		victimwrites += other.victimwrites;
+		pinwaits += other.pinwaits;
+		prefetchhits += other.prefetchhits;
+		cachehits += other.cachehits;
+  }
+};
+
+
+/**
+* @brief Histogram of operation latencies, in buckets that double in width.  Bucket 0 counts latencies under one
+* microsecond, bucket i those from 2^(i-1) up to 2^i microseconds, and the last bucket everything longer.
+*
+* Recording is threadsafe and lock free.  A copy is a snapshot of the counts at the time.
+*/
+class LatencyHistogram
+{
+ public:
+	/**
+   * Number of buckets.  The last one starts at about 18 minutes.
+	 */
+  static const int NUM_BUCKETS = 32;
+
+	/**
+   * Constructor of LatencyHistogram class.  All buckets empty.
+	 */
+  LatencyHistogram()
+  {
+		clear();
+  }
+
+	/**
+   * Copy constructor, taking a snapshot of the counts
+	 */
+  LatencyHistogram(const LatencyHistogram& other)
+  {
+		*this = other;
+  }
+
+	/**
+   * Assignment, taking a snapshot of the counts
+	 */
+  LatencyHistogram& operator=(const LatencyHistogram& other);
+
+	/**
+   * Counts one operation.
+   *
+   * @param latency	How long the operation took
+	 */
+  void record(std::chrono::steady_clock::duration latency);
+
+	/**
+   * Empties all buckets
+	 */
+  void clear();
+
+	/**
+   * Number of operations counted in a bucket
+	 */
+  std::uint64_t bucket(int i) const
+  {
+		return buckets[i];
   }
+
+	/**
+   * Upper bound of a bucket, in microseconds
+	 */
+  static std::uint64_t bucketLimit(int i)
+  {
+		return std::uint64_t(1) << i;
+  }
+
+	/**
+   * Number of operations counted
+	 */
+  std::uint64_t count() const;
+
+	/**
+   * Mean latency in microseconds, or 0 if nothing was counted
+	 */
+  double meanMicros() const;
+
+	/**
+   * Latency that the given fraction of the operations took at most, as the upper bound of the bucket it falls in.
+   *
+   * @param fraction	Fraction of the operations, such as 0.99
+   * @return  Microseconds, or 0 if nothing was counted
+	 */
+  std::uint64_t percentileMicros(double fraction) const;
+
+ private:
+	/**
+   * Number of operations in each bucket
+	 */
+  std::atomic<std::uint64_t> buckets[NUM_BUCKETS];
+
+	/**
+   * Sum of the latencies counted, in microseconds
+	 */
+  std::atomic<std::uint64_t> totalMicros;
 };
 
 
@@ -125,24 +346,88 @@ struct BufStats
 	/**
    * Total number of accesses to buffer pool
 	 */
-  int accesses;
+  std::atomic<std::uint64_t> accesses;
 
 	/**
    * Number of pages read from disk (including allocs)
 	 */
-  int diskreads;
+  std::atomic<std::uint64_t> diskreads;
 
 	/**
    * Number of pages written back to disk
 	 */
-  int diskwrites;
+  std::atomic<std::uint64_t> diskwrites;
+
+	/**
+   * Number of pages read from disk ahead of time by prefetch().  These are also counted in diskreads.
+	 */
+  std::atomic<std::uint64_t> prefetches;
+
+	/**
+   * Number of readPage() calls that found the page in the buffer pool
+	 */
+  std::atomic<std::uint64_t> hits;
+
+	/**
+   * Number of readPage() calls that had to read the page from disk or the victim cache
+	 */
+  std::atomic<std::uint64_t> misses;
+
+	/**
+   * Number of pages evicted to make room for others
+	 */
+  std::atomic<std::uint64_t> evictions;
+
+	/**
+   * Number of dirty victims the thread evicting them had to write back, which the page writer is there to avoid.
+   * These are also counted in diskwrites.
+	 */
+  std::atomic<std::uint64_t> victimwrites;
+
+	/**
+   * Number of times a thread needing a frame found every victim frame pinned or busy and had to wait
+	 */
+  std::atomic<std::uint64_t> pinwaits;
+
+	/**
+   * Number of pages read by prefetch() that a readPage() then found in the buffer pool
+	 */
+  std::atomic<std::uint64_t> prefetchhits;
+
+	/**
+   * Number of readPage() calls that found the page in the victim cache instead of reading it from disk.  These are
+   * also counted in misses.
+	 */
+  std::atomic<std::uint64_t> cachehits;
+
+	/**
+   * Number of readOptimistic() tries that found the page pinned or changed under them, and were repeated or had
+   * to pin the page instead
+	 */
+  std::atomic<std::uint64_t> optimisticretries;
+
+	/**
+   * Latencies of readPage() calls that had to read the page from disk or the victim cache, including finding a frame
+   * for it
+	 */
+  LatencyHistogram readMissLatency;
+
+	/**
+   * Latencies of writes of pages to disk, including forcing the log ahead of them.  A run of pages written at once
+   * counts as one write.
+	 */
+  LatencyHistogram writeLatency;
 
 	/**
    * Clear all values 
 	 */
   void clear()
   {
-		accesses = diskreads = diskwrites = 0;
+		accesses = diskreads = diskwrites = prefetches = 0;
+		hits = misses = evictions = victimwrites = pinwaits = prefetchhits = cachehits = 0;
+		optimisticretries = 0;
+		readMissLatency.clear();
+		writeLatency.clear();
   }
       
 	/**
@@ -156,139 +441,1276 @@ struct BufStats
 
 
 /**
-* @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+* @brief Buffer pool statistics at one point in time, as returned by BufMgr::getStatsSnapshot()
 */
-class BufMgr 
+struct BufStatsSnapshot
 {
- private:
 	/**
-   * Current position of clockhand in our buffer pool
+   * Total number of accesses to buffer pool
 	 */
-  FrameId clockHand;
+  std::uint64_t accesses;
 
 	/**
-   * Number of frames in the buffer pool
+   * Number of pages read from disk (including allocs)
 	 */
-  std::uint32_t numBufs;
-	
+  std::uint64_t diskreads;
+
 	/**
-   * Hash table mapping (File, page) to frame
+   * Number of pages written back to disk
 	 */
-  BufHashTbl *hashTable;
+  std::uint64_t diskwrites;
 
 	/**
-   * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
+   * Number of pages read from disk ahead of time by prefetch()
 	 */
-  BufDesc *bufDescTable;
+  std::uint64_t prefetches;
 
 	/**
-   * Maintains Buffer pool usage statistics 
+   * Number of readOptimistic() tries that found the page pinned or changed under them, and were repeated or had
+   * to pin the page instead
 	 */
-  BufStats bufStats;
+  std::uint64_t optimisticretries;
 
 	/**
-	 * Allocate a free frame.  
-	 *
-	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
-	 * @throws BufferExceededException If no such buffer is found which can be allocated
+   * Counts over all files
+	 */
+  BufPageCounts total;
+
+	/**
+   * Counts of each file, by file name.  Pin waits are counted for the file whose page needed the frame.
+	 */
+  std::map<std::string, BufPageCounts> files;
+
+	/**
+   * Latencies of readPage() calls that had to read the page from disk or the victim cache
 	 */
-  void allocBuf(FrameId & frame);
+  LatencyHistogram readMissLatency;
 
 	/**
-   * Advance clock to next frame in the buffer pool
+   * Latencies of writes of pages to disk
 	 */
-  void advanceClock()
+  LatencyHistogram writeLatency;
+
+	/**
+   * Fraction of readPage() calls that found the page in the buffer pool, or 0 if there were none
+	 */
+  double hitRatio() const
   {
-		clockHand = (clockHand + 1) % numBufs;
+		std::uint64_t reads = total.hits + total.misses;
+		return reads == 0 ? 0.0 : double(total.hits) / reads;
   }
 
+	/**
+   * Writes the statistics as a JSON object.
+   *
+   * @param out	Stream to write to
+	 */
+  void printJson(std::ostream& out) const;
+};
+
+
+/**
+* @brief A small ring of frames that a sequential scan recycles, so a scan of a large file only ever occupies a few
+* frames of the buffer pool instead of evicting everything else.
+*
+* The scan passes its ring to BufMgr::readPage() with ACCESS_SEQUENTIAL.  Each page the scan has to read from disk is
+* read into the frame of the page it read one lap of the ring earlier, if that page is still there and unpinned;
+* otherwise a frame is allocated as usual and becomes part of the ring.  Pages the scan finds already in the buffer
+* pool are used where they are and don't join the ring.  A ring belongs to one scan; the pages the scan reads ahead
+* with BufMgr::prefetch() go into the ring too, so the prefetcher shares it, and a page read ahead keeps its frame until
+* the scan has reached it.
+*/
+class BufferRing
+{
+	friend class BufMgr;
 
  public:
 	/**
-   * Actual buffer pool from which frames are allocated
+   * Number of frames in a ring unless asked otherwise
 	 */
-  Page* bufPool;
+  static const std::uint32_t DEFAULT_SIZE = 16;
 
 	/**
-   * Constructor of BufMgr class
+   * Constructor of BufferRing class.  The buffer manager never lets a ring take more than an eighth of the pool.
+   *
+   * @param size  Number of frames in the ring
 	 */
-  BufMgr(std::uint32_t bufs);
-	
+  explicit BufferRing(std::uint32_t size = DEFAULT_SIZE)
+		: slots(size == 0 ? 1 : size), next(0)
+  {
+  }
+
+ private:
 	/**
-   * Destructor of BufMgr class
+	 * A frame of the ring and the page the scan last read into it
 	 */
-  ~BufMgr();
+  struct Slot
+  {
+    FrameId frame;
+    const File* file;
+    PageId pageNo;
+
+    Slot() : frame(0), file(NULL), pageNo(Page::INVALID_NUMBER) {}
+  };
 
 	/**
-	 * Reads the given page from the file into a frame and returns the pointer to page.
-	 * If the requested page is already present in the buffer pool pointer to that frame is returned
-	 * otherwise a new frame is allocated from the buffer pool for reading the page.
-	 *
-	 * @param file   	File object
-	 * @param PageNo  Page number in the file to be read
-	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+   * Frames of the ring.  A slot whose file is NULL has no frame yet.
 	 */
-  void readPage(File* file, const PageId PageNo, Page*& page);
+  std::vector<Slot> slots;
 
 	/**
-	 * Unpin a page from memory since it is no longer required for it to remain in memory.
-	 *
-	 * @param file   	File object
-	 * @param PageNo  Page number
-	 * @param dirty		True if the page to be unpinned needs to be marked dirty	
-   * @throws  PageNotPinnedException If the page is not already pinned
+   * Slot to use for the next page read from disk
 	 */
-  void unPinPage(File* file, const PageId PageNo, const bool dirty);
+  std::uint32_t next;
 
 	/**
-	 * Allocates a new, empty page in the file and returns the Page object.
-	 * The newly allocated page is also assigned a frame in the buffer pool.
-	 *
-	 * @param file   	File object
-	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
-	 * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+   * Lock guarding slots and next, as the scan and the prefetcher both read pages into the ring.  Only the locks
+   * evictFrame() and allocBuf() take are taken while it is held.
 	 */
-  void allocPage(File* file, PageId &PageNo, Page*& page); 
+  std::mutex mutex;
+};
+
+
+/**
+* @brief A pin on a page in the buffer pool, returned by BufMgr::readPage() and BufMgr::allocPage(), that unpins the
+* page when it goes out of scope.
+*
+* The handle remembers the frame holding the page, so unpinning it needs no hash table lookup.  Taking the page with
+* write() marks it dirty, so it is written back once it is unpinned.  Handles can be moved but not copied; a handle
+* that is default constructed, moved from or released holds no pin.  A handle must be released before the page's
+* file is flushed.
+*/
+class PageHandle
+{
+	friend class BufMgr;
 
+ public:
 	/**
-	 * Writes out all dirty pages of the file to disk.
-	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
-	 * Otherwise Error returned.
-	 *
-	 * @param file   	File object
-   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool 
-   * @throws BadBufferException If any frame allocated to the file is found to be invalid
+   * Constructor of an empty PageHandle class
 	 */
-  void flushFile(const File* file);
+  PageHandle()
+		: bufMgr(NULL), file(NULL), pageNo(Page::INVALID_NUMBER), frame(0), page(NULL), dirty(false)
+  {
+  }
 
 	/**
-	 * Delete page from file and also from buffer pool if present.
-	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
-	 *
-	 * @param file   	File object
-	 * @param PageNo  Page number
+   * Takes over the pin of another handle, leaving it empty
 	 */
-  void disposePage(File* file, const PageId PageNo);
+  PageHandle(PageHandle&& other);
 
 	/**
-   * Print member variable values. 
+   * Unpins the page this handle holds, if any, and takes over the pin of another handle, leaving it empty
 	 */
-  void  printSelf();
+  PageHandle& operator=(PageHandle&& other);
 
 	/**
-   * Get buffer pool usage statistics
+   * Destructor of PageHandle class.  Unpins the page; errors are ignored, since a destructor must not throw.
 	 */
-  BufStats & getBufStats()
+  ~PageHandle();
+
+	/**
+   * Returns the page for reading.  Changes made through the pointer are only written back if the page is marked dirty.
+	 */
+  Page* get() const
   {
-		return bufStats;
+		return page;
   }
 
 	/**
-   * Clear buffer pool usage statistics
+   * Returns the page for changing it, and marks it dirty.
+	 */
+  Page* write()
+  {
+		dirty = true;
+		return page;
+  }
+
+	/**
+   * Marks the page dirty, so it is written back once unpinned.
+	 */
+  void markDirty()
+  {
+		dirty = true;
+  }
+
+	/**
+   * Returns the number of the page in its file
+	 */
+  PageId pageNumber() const
+  {
+		return pageNo;
+  }
+
+	/**
+   * True if the handle holds a pin
+	 */
+  explicit operator bool() const
+  {
+		return page != NULL;
+  }
+
+	/**
+	 * Unpins the page now, dirty if it was written or marked dirty, and leaves the handle empty.  Does nothing if the
+	 * handle is empty.
+	 *
+   * @throws  PageNotPinnedException If the page is no longer pinned
+   * @throws  HashNotFoundException If the page is no longer in the frame the handle remembers
+	 */
+  void release();
+
+ private:
+  PageHandle(BufMgr* bufMgr, File* file, PageId pageNo, FrameId frame, Page* page)
+		: bufMgr(bufMgr), file(file), pageNo(pageNo), frame(frame), page(page), dirty(false)
+  {
+  }
+
+  PageHandle(const PageHandle&);
+  PageHandle& operator=(const PageHandle&);
+
+	/**
+   * Buffer manager holding the page, or NULL if the handle is empty
+	 */
+  BufMgr* bufMgr;
+
+	/**
+   * File the page belongs to
+	 */
+  File* file;
+
+	/**
+   * Page number in the file
+	 */
+  PageId pageNo;
+
+	/**
+   * Frame holding the page
+	 */
+  FrameId frame;
+
+	/**
+   * The page in the buffer pool
+	 */
+  Page* page;
+
+	/**
+   * True if the page is to be unpinned dirty
+	 */
+  bool dirty;
+};
+
+
+/**
+* @brief Where BufMgr::readOptimistic() last found a page, so reading the page again can go straight to its frame
+* instead of looking it up in the hash table.
+*
+* A location starts out empty and is filled in by readOptimistic().  It stays good for as long as the page stays in
+* its frame unchanged; after that the page is looked up again.  A location remembers which page of which buffer
+* manager it is for, so passing it along with another page only makes that page be looked up.
+*/
+struct PageLocation
+{
+	/**
+   * Buffer manager the page was found in
+	 */
+  const BufMgr* bufMgr;
+
+	/**
+   * File of the page
+	 */
+  const File* file;
+
+	/**
+   * Page number in the file
+	 */
+  PageId pageNo;
+
+	/**
+   * Frame the page was found in
+	 */
+  FrameId frame;
+
+	/**
+   * Version of the frame when the page was read, or 0 if the location is empty
+	 */
+  std::uint64_t version;
+
+	/**
+   * Number of reads that went straight to the frame through this location, so one in
+   * BufMgr::OPTIMISTIC_ACCESS_INTERVAL of them is reported to the replacement policy
+	 */
+  std::uint32_t numReads;
+
+	/**
+   * Constructor of an empty PageLocation class
+	 */
+  PageLocation()
+		: bufMgr(NULL), file(NULL), pageNo(Page::INVALID_NUMBER), frame(0), version(0), numReads(0)
+  {
+  }
+};
+
+
+/**
+* @brief One partition of the buffer pool hash table, with the lock that guards it
+*/
+struct BufHashShard
+{
+	/**
+   * Lock held while looking up, inserting or removing pages in this shard, and while pinning or unpinning them
+	 */
+  std::mutex mutex;
+
+	/**
+   * Hash table mapping (File, page) to frame for the pages that fall in this shard
+	 */
+  BufHashTbl *table;
+
+	/**
+   * Number of dirty pages of this shard written back and dropped from the pool.  A thread that read a page from disk
+   * while this changed may have read an image older than the one written back, and must read it again.
+	 */
+  std::uint64_t writebacks;
+
+	/**
+   * Notified, with the shard lock, when a write back of a page of this shard finishes
+	 */
+  std::condition_variable writeDone;
+
+	/**
+   * Counts of the pages of each file that fall in this shard, with the file's name as it was when they were counted
+	 */
+  std::map<const File*, std::pair<std::string, BufPageCounts> > fileCounts;
+
+	/**
+   * Counts of files whose File object has been replaced by another at the same address, by file name
+	 */
+  std::map<std::string, BufPageCounts> closedFileCounts;
+};
+
+
+/**
+* @brief The pages of one file in the buffer pool, so flushing the file looks at its own pages instead of every frame
+*/
+struct BufFilePages
+{
+	/**
+   * Frame holding each page of the file, by page number
+	 */
+  std::map<PageId, FrameId> frames;
+
+	/**
+   * Numbers of the file's dirty pages, in order
+	 */
+  std::set<PageId> dirty;
+};
+
+
+/**
+* @brief How the memory of the buffer pool is laid out
+*/
+struct BufPoolOptions
+{
+	/**
+   * Kind of pages backing the frames.  Huge pages let the TLB cover far more of a large pool.
+	 */
+  PoolMemory::PageKind pages;
+
+	/**
+   * Split the pool into one partition per NUMA node, each with its frames and descriptors in the node's memory.  A
+   * thread needing a free frame takes one from the partition of the node it runs on, falling back to the others.
+	 */
+  bool numaPartitioned;
+
+	/**
+   * Largest number of frames the pool can be grown to with BufMgr::resize(), or 0 to only allow shrinking.  Address
+   * space for this many frames is reserved up front, so pages never move, but memory is only used as frames are added.
+	 */
+  std::uint32_t maxBufs;
+
+	/**
+   * File to keep the list of hot pages in for a warm restart, or empty for none.  The pages in the buffer pool are
+   * saved to it, hottest first, by checkpoint() and when the buffer manager is destroyed; the list is read back when
+   * the next buffer manager is created, and warmUp() then reads a file's pages in the background.
+	 */
+  std::string hotPagesFile;
+
+	/**
+   * Bytes of memory for a VictimCache of pages evicted from the pool, or 0 for none.  A page missing from the pool
+   * is looked for there before it is read from disk.
+	 */
+  std::size_t victimCacheBytes;
+
+	/**
+   * Constructor of BufPoolOptions class.  Transparent huge pages, one partition, no growing, no hot page list, no
+   * victim cache.
+	 */
+  BufPoolOptions()
+    : pages(PoolMemory::TRANSPARENT_HUGE_PAGES), numaPartitioned(false), maxBufs(0), victimCacheBytes(0)
+  {
+  }
+};
+
+
+/**
+* @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+*
+* readPage(), unPinPage(), allocPage() and disposePage() may be called from several threads at once.  The hash table
+* is split into shards with a lock each, so threads touching different pages rarely wait for each other, and pins
+* are atomic.  Frames that hold no page are kept on free lists, one per partition of the pool.  Once it is empty, a ReplacementPolicy proposes
+* victim frames, which are claimed with try-locks; frames that are busy are skipped instead of waited for.  Files and
+* the log are threadsafe, and no shard lock is held while reading or writing them: a page is read into a frame that
+* is not yet in the hash table, and written back from a copy while its frame is marked as being written.
+*
+* flushFile(), commit(), checkpoint() and printSelf() must not run while other threads are updating pages of the
+* files involved.
+*
+* A page writer thread writes back dirty pages shortly before they are evicted, so a file with dirty pages in the
+* buffer pool may be written at any time and must only be accessed through the buffer manager until it is flushed.
+*/
+class BufMgr 
+{
+	friend class PageHandle;
+
+ private:
+	/**
+   * Number of shards the hash table is split into
+	 */
+  static const std::uint32_t NUM_SHARDS = 16;
+
+	/**
+   * Number of victim frames asked of the replacement policy at a time
+	 */
+  static const std::size_t VICTIM_BATCH = 8;
+
+	/**
+   * Largest number of pages waiting to be prefetched.  Further requests are dropped.
+	 */
+  static const std::size_t MAX_PREFETCH_QUEUE = 64;
+
+	/**
+   * Number of hot pages warmUp() sorts into page number order at a time.  The hottest batch is read first.
+	 */
+  static const std::size_t WARM_BATCH = 64;
+
+	/**
+   * Time the page writer sleeps between rounds unless woken earlier
+	 */
+  static const int WRITER_INTERVAL_MS = 20;
+
+	/**
+   * Number of times readOptimistic() tries to read a page that changes under it before pinning it instead
+	 */
+  static const int OPTIMISTIC_ATTEMPTS = 4;
+
+	/**
+   * Optimistic reads that go straight to the frame through a PageLocation tell the replacement policy about one in
+   * this many of the reads made through that location, so pages read only that way still look hot without every
+   * read writing to the policy's shared state.  Reads that look the page up are all reported.
+	 */
+  static const std::uint32_t OPTIMISTIC_ACCESS_INTERVAL = 16;
+
+	/**
+   * Largest number of consecutive pages written back with one write
+	 */
+  static const std::size_t MAX_WRITE_RUN = 32;
+
+	/**
+   * Number of frames in the buffer pool.  Frames from here on hold no page and aren't on the free lists.
+	 */
+  std::atomic<std::uint32_t> numBufs;
+
+	/**
+   * Number of frames the buffer pool has room to grow to
+	 */
+  std::uint32_t maxBufs;
+
+	/**
+   * Serializes resize()
+	 */
+  std::mutex resizeMutex;
+	
+	/**
+   * Hash table mapping (File, page) to frame, split into NUM_SHARDS shards
+	 */
+  BufHashShard *shards;
+
+	/**
+   * Decides which page to evict when no frame is free.  Told about every page loaded, accessed and removed.
+	 */
+  ReplacementPolicy* policy;
+
+	/**
+   * Compressed copies of recently evicted pages, consulted on a miss before the disk, or NULL if there is none
+	 */
+  VictimCache* victimCache;
+
+	/**
+   * Memory the frames are placed in
+	 */
+  PoolMemory* frameMemory;
+
+	/**
+   * Memory the frame descriptors are placed in
+	 */
+  PoolMemory* descMemory;
+
+	/**
+   * Number of partitions the pool is split into; one unless it is NUMA partitioned
+	 */
+  std::uint32_t numPartitions;
+
+	/**
+   * Number of consecutive frames that go to the same partition, one huge page's worth.  The chunks are dealt out to
+   * the partitions in turn, so the partitions stay even however far the pool is grown or shrunk.  Partition p's chunks
+   * are in the memory of NUMA node p.
+	 */
+  std::uint32_t partitionChunk;
+
+	/**
+   * Frames that hold no page, for each partition, taken before the policy is asked for a victim
+	 */
+  std::vector<std::vector<FrameId> > freeFrames;
+
+	/**
+   * Number of frames on all the free lists
+	 */
+  std::size_t numFreeFrames;
+
+	/**
+   * Lock guarding freeFrames, numFreeFrames and the free flags of the frames.  No other lock is taken while it is held.
+	 */
+  std::mutex freeMutex;
+
+	/**
+   * Background thread reading the pages in prefetchQueue.  Started by the first call to prefetch().
+	 */
+  std::thread prefetcher;
+
+	/**
+   * Lock guarding prefetchQueue, warmQueue, savedHotPages, prefetchFile and prefetchStop.  Only freeMutex is taken
+   * while it is held.
+	 */
+  std::mutex prefetchMutex;
+
+	/**
+   * Signalled when pages are queued for prefetching, when the prefetcher finishes a page and when it must stop
+	 */
+  std::condition_variable prefetchCond;
+
+	/**
+   * A page waiting to be read by the prefetcher
+	 */
+  struct PrefetchRequest
+  {
+    File* file;
+    PageId pageNo;
+
+    /**
+     * Ring of the scan the page is read ahead for, or NULL to read it into the pool at large
+     */
+    BufferRing* ring;
+  };
+
+	/**
+   * Pages waiting to be read by the prefetcher, oldest request first
+	 */
+  std::deque<PrefetchRequest> prefetchQueue;
+
+	/**
+   * Hot pages queued by warmUp(), read by the prefetcher while prefetchQueue is empty and there are free frames
+	 */
+  std::deque<std::pair<File*, PageId> > warmQueue;
+
+	/**
+   * Hot pages read from the hot page list that no warmUp() has asked for yet, hottest first, by file name
+	 */
+  std::vector<std::pair<std::string, PageId> > savedHotPages;
+
+	/**
+   * File the hot page list is kept in, or empty for none
+	 */
+  std::string hotPagesPath;
+
+	/**
+   * Pages that were in the buffer pool when their file was flushed, most recently flushed file first, so a file
+   * closed before shutdown still has its hot pages saved
+	 */
+  std::vector<std::pair<std::string, PageId> > flushedHotPages;
+
+	/**
+   * Lock guarding flushedHotPages.  No other lock is taken while it is held.
+	 */
+  std::mutex hotPagesMutex;
+
+	/**
+   * File of the page the prefetcher is reading, or NULL if it is idle
+	 */
+  const File* prefetchFile;
+
+	/**
+   * Set to make the prefetcher exit
+	 */
+  bool prefetchStop;
+
+	/**
+   * Background thread writing back dirty pages that are about to be evicted, so misses find clean victims
+	 */
+  std::thread pageWriter;
+
+	/**
+   * Lock guarding writerStop.  No other lock is taken while it is held.
+	 */
+  std::mutex writerMutex;
+
+	/**
+   * Signalled to wake the page writer early, or to make it exit
+	 */
+  std::condition_variable writerCond;
+
+	/**
+   * Set to make the page writer exit
+	 */
+  bool writerStop;
+
+	/**
+   * Number of frames, free or holding the next pages to be evicted, the page writer tries to keep clean
+	 */
+  std::atomic<std::uint32_t> cleanTarget;
+
+	/**
+   * Pages of each file in the buffer pool, and which of them are dirty
+	 */
+  std::map<const File*, BufFilePages> filePages;
+
+	/**
+   * Lock guarding filePages.  No other lock is taken while it is held.
+	 */
+  std::mutex filePagesMutex;
+
+
+	/**
+   * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
+	 */
+  BufDesc *bufDescTable;
+
+	/**
+   * Maintains Buffer pool usage statistics 
+	 */
+  BufStats bufStats;
+
+	/**
+   * Write-ahead log that page updates are appended to, or NULL if pages are only made durable by writing them back
+	 */
+  LogManager* log;
+
+	/**
+   * Records the calls made into the buffer manager while a trace is started
+	 */
+  AccessTraceWriter trace;
+
+	/**
+   * Names of files pages have been written to since the last checkpoint, which need syncing before the log is emptied
+	 */
+  std::set<std::string> unsyncedFiles;
+
+	/**
+   * Lock guarding unsyncedFiles.  No other lock is taken while it is held.
+	 */
+  std::mutex unsyncedMutex;
+
+	/**
+	 * Writes a dirty frame back to its file.  With a log, the page's image is appended to the log first if it isn't
+	 * already there, and the log is forced up to that image before the page is written.
+	 *
+	 * The caller holds the lock of the page's shard and the frame's latch, and the page must be unpinned and not
+	 * already being written.  A copy of the page is written with both locks dropped, the frame marked as being written
+	 * meanwhile, so other threads can use the shard while the write waits for the disk.  Both locks are held again when
+	 * this returns, even if it throws.  The frame still holds the page then, but it may have been pinned, and changed,
+	 * during the write.
+	 *
+	 * @param frame   	Frame to write back
+	 * @param shardLock	Lock of the page's shard, held by the caller
+	 * @param latch		Latch of the frame, held by the caller
+	 * @return  True if the page didn't change during the write, and so is clean now
+	 */
+  bool writeFrame(FrameId frame, std::unique_lock<std::mutex>& shardLock, std::unique_lock<std::mutex>& latch);
+
+	/**
+	 * Looks up a page in a shard, first waiting for any write back of it to finish.
+	 *
+	 * @param shard   	Shard of the page
+	 * @param shardLock	Lock of the shard, held by the caller and dropped while waiting
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frame   	Set to the frame holding the page, if it is in the pool
+	 * @return  True if the page is in the pool
+	 */
+  bool lookupIdle(BufHashShard& shard, std::unique_lock<std::mutex>& shardLock, const File* file, PageId pageNo,
+                  FrameId& frame);
+
+	/**
+	 * Writes back the pages of a file that are still dirty, in page number order, with one write for each run of
+	 * consecutive pages.  The pages of a run are pinned while it is written, so they can neither be evicted nor
+	 * written by the page writer meanwhile.  Other threads may still pin and change them; a page unpinned dirty during
+	 * the write stays dirty.
+	 *
+	 * @param file   	File object
+	 * @param pageNos Numbers of the pages to write back, in order
+	 */
+  void writeRuns(const File* file, const std::vector<PageId>& pageNos);
+
+	/**
+	 * Writes back copies of a run of consecutive pages of a file with one write, then marks the pages that didn't
+	 * change meanwhile clean and unpins them all.  With a log, the images of the pages not yet in it are appended
+	 * first, and the log is forced once for the run.
+	 *
+	 * @param first  	Page number of the first page of the run
+	 * @param run   	Frames holding the pages of the run, pinned by the caller
+	 */
+  void writeRun(PageId first, const std::vector<FrameId>& run);
+
+	/**
+	 * Writes back every dirty page in the buffer pool, file by file.
+	 */
+  void writeDirtyPages();
+
+	/**
+	 * Records that a frame now holds a page of a file.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frame   	Frame holding the page
+	 */
+  void trackPage(const File* file, PageId pageNo, FrameId frame);
+
+	/**
+	 * Records that a page of a file has left the buffer pool.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 */
+  void untrackPage(const File* file, PageId pageNo);
+
+	/**
+	 * Records that a page of a file in the buffer pool became dirty or was written back.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param dirty		True if the page became dirty
+	 */
+  void trackDirty(const File* file, PageId pageNo, bool dirty);
+
+	/**
+	 * Allocate a free frame.  The frame is returned invalid and with a pin count of one, so no other thread claims it.
+	 *
+	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @return  Number of times every victim frame was pinned or busy and the thread had to wait
+	 * @throws BufferExceededException If no such buffer is found which can be allocated
+	 */
+  std::uint32_t allocBuf(FrameId & frame);
+
+	/**
+	 * Evicts the page in a frame, writing it back first if it is dirty, and leaves the frame invalid and pinned once.
+	 * Gives up rather than waits if another thread holds a lock the eviction needs, and if the page is pinned during
+	 * the write back.  No lock is held while the page is written.
+	 *
+	 * @param frame   	Frame to evict
+	 * @param file   	If not NULL, only evict the frame if it still holds this file's page, and the page isn't one
+	 *									read ahead that no one has read yet
+	 * @param pageNo  Page the frame must hold if file is given
+	 * @return  False if the frame is pinned, busy, being written, holds no page or holds another page
+	 */
+  bool evictFrame(FrameId frame, const File* file = NULL, PageId pageNo = Page::INVALID_NUMBER);
+
+	/**
+	 * Allocates a frame for a page a sequential scan is reading from disk, reusing the ring's frame if it can.
+	 *
+	 * @param ring   	Ring of the scan, locked by the caller
+	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param pinWaits	Set to the number of times the thread had to wait for a frame, as returned by allocBuf()
+	 * @return  Slot of the ring to record the page in once it is loaded
+	 * @throws BufferExceededException If no such buffer is found which can be allocated
+	 */
+  BufferRing::Slot& allocRingBuf(BufferRing& ring, FrameId & frame, std::uint32_t& pinWaits);
+
+	/**
+	 * Gives back a frame claimed by allocBuf() that ended up not being used.
+	 *
+	 * @param frame   	Frame to give back
+	 */
+  void releaseBuf(FrameId frame);
+
+	/**
+	 * Does the work of readPage(): pins the page, reading it from disk first if it isn't in the buffer pool.
+	 *
+	 * @param prefetching	True if called by the prefetcher, whose reads aren't counted as hits or misses
+	 * @param reserved	If not NULL, a frame taken by takeFreeFrame() to read the page into instead of allocating one.
+	 *									It is given back if the page is in the buffer pool already.
+	 * @return  True if the page was read from disk
+	 */
+  bool fetchPage(File* file, const PageId pageNo, Page*& page, AccessHint hint, BufferRing* ring,
+                 bool prefetching = false, const FrameId* reserved = NULL);
+
+	/**
+	 * Returns the counts of a file in a shard, starting them if the file has none.  The caller holds the shard lock.
+	 *
+	 * @param shard   	Shard of the page being counted
+	 * @param file   	File object
+	 */
+  BufPageCounts& fileCounts(BufHashShard& shard, const File* file);
+
+	/**
+	 * Counts a readPage() that found its page in the buffer pool.  The caller holds the shard lock.
+	 *
+	 * @param shard   	Shard of the page
+	 * @param file   	File object
+	 * @param frame   	Frame holding the page
+	 */
+  void countHit(BufHashShard& shard, const File* file, FrameId frame);
+
+	/**
+	 * Counts a page read from disk or the victim cache.  The caller holds the shard lock.
+	 *
+	 * @param shard   	Shard of the page
+	 * @param file   	File object
+	 * @param pinWaits	Number of times the thread had to wait for a frame
+	 * @param prefetching	True if the prefetcher read the page, which isn't counted as a miss
+	 * @param cached   	True if the page came from the victim cache
+	 * @param start   	When the read was found to miss
+	 */
+  void countMiss(BufHashShard& shard, const File* file, std::uint32_t pinWaits, bool prefetching, bool cached,
+                 std::chrono::steady_clock::time_point start);
+
+	/**
+	 * Unpins a page held by a PageHandle, going straight to the frame instead of looking the page up.
+	 *
+	 * @param frame   	Frame the page is in
+	 * @param file   	File object
+	 * @param pageNo  Page number
+	 * @param dirty		True if the page needs to be marked dirty
+   * @throws  PageNotPinnedException If the page is not pinned
+   * @throws  HashNotFoundException If the frame no longer holds the page
+	 */
+  void unPinFrame(FrameId frame, File* file, const PageId pageNo, const bool dirty);
+
+	/**
+	 * Drops one pin on a frame, marking it dirty first if asked to.  The caller must hold the lock of the page's shard.
+	 *
+	 * @param frame   	Frame the page is in
+	 * @param dirty		True if the page needs to be marked dirty
+   * @throws  PageNotPinnedException If the page is not pinned
+	 */
+  void dropPin(FrameId frame, const bool dirty);
+
+	/**
+	 * Looks a page up in the hash table for readOptimistic().
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param location	Set to the frame holding the page and its version
+	 * @return  False if the page is not in the buffer pool
+	 */
+  bool locatePage(File* file, const PageId pageNo, PageLocation& location);
+
+	/**
+	 * Passes the page in a frame to a reader without pinning it, and checks afterwards that the frame kept its version
+	 * and no one pinned the page meanwhile.  An exception the reader throws is passed on only if the check succeeds.
+	 *
+	 * @param frame   	Frame holding the page
+	 * @param version		Version the frame had when the page was found in it
+	 * @param reader		Called with the page
+	 * @return  True if the page didn't change while it was read
+	 */
+  bool readFrameOptimistic(FrameId frame, std::uint64_t version, const std::function<void(const Page&)>& reader);
+
+	/**
+	 * Body of the prefetcher thread.
+	 */
+  void prefetchLoop();
+
+	/**
+	 * Body of the page writer thread.
+	 */
+  void writerLoop();
+
+	/**
+	 * Appends the pages in the buffer pool to a vector, hottest first, as the replacement policy ranks them.
+	 *
+	 * @param file   	Only append this file's pages, or all pages if NULL
+	 * @param pages  	Vector to append the file names and page numbers to
+	 */
+  void collectHotPages(const File* file, std::vector<std::pair<std::string, PageId> >& pages);
+
+	/**
+	 * Reads the hot page list left by an earlier buffer manager into savedHotPages.  A missing list is no error.
+	 */
+  void loadHotPages();
+
+	/**
+	 * Drops the pages of a file waiting to be prefetched and waits for the prefetcher to finish with the file.
+	 *
+	 * @param file   	File object
+	 */
+  void cancelPrefetch(const File* file);
+
+	/**
+	 * Puts a frame that no longer holds a page on the free list.  The frame must already be cleared.  A frame a
+	 * shrinking resize() is dropping is left off.
+	 *
+	 * @param frame   	Frame to free
+	 */
+  void freeFrame(FrameId frame);
+
+	/**
+	 * Takes a frame off a free list and pins it, preferring the partition of the NUMA node the calling thread runs on.
+	 *
+	 * @param frame   	Frame reference, frame ID of the free frame returned via this variable
+	 * @return  False if the free list is empty
+	 */
+  bool takeFreeFrame(FrameId & frame);
+
+	/**
+	 * Drops a frame from a pool being shrunk, evicting its page if it holds one.  The frame must already be beyond
+	 * numBufs.
+	 *
+	 * @param frame   	Frame to drop
+	 * @return  False if the frame is pinned, so neither it nor the frames below it can be dropped
+	 */
+  bool retireFrame(FrameId frame);
+
+	/**
+	 * Returns the partition a frame belongs to.
+	 *
+	 * @param frame   	Frame number
+	 */
+  std::uint32_t partitionOf(const FrameId frame) const
+  {
+		return (frame / partitionChunk) % numPartitions;
+  }
+
+	/**
+	 * Returns the hash table shard a page belongs to.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 */
+  BufHashShard& shardFor(const File* file, const PageId pageNo)
+  {
+		// the tables index slots with the low bits of the hash, so pick the shard with the high bits
+		return shards[(BufHashTbl::hash(file, pageNo) >> 32) % NUM_SHARDS];
+  }
+
+
+ public:
+	/**
+   * Actual buffer pool from which frames are allocated
+	 */
+  Page* bufPool;
+
+	/**
+   * Constructor of BufMgr class.  If a log is given, any page images left in it by a crash are first copied back
+   * into their files.
+   *
+   * @param bufs    Number of frames in the buffer pool
+   * @param log     Write-ahead log to append page updates to, or NULL.  Must outlive the buffer manager.
+   * @param policy  Replacement policy choosing which page to evict.  LRU_K, TWO_Q and ARC keep frequently used pages,
+   *                such as index pages, resident while large scans pass through the pool; CLOCK is cheapest.
+   * @param options How the memory of the pool is laid out
+	 */
+  BufMgr(std::uint32_t bufs, LogManager* log = NULL, ReplacementPolicy::Kind policy = ReplacementPolicy::CLOCK,
+         const BufPoolOptions& options = BufPoolOptions());
+	
+	/**
+   * Destructor of BufMgr class
+	 */
+  ~BufMgr();
+
+	/**
+	 * Reads the given page from the file into a frame and returns the pointer to page.
+	 * If the requested page is already present in the buffer pool pointer to that frame is returned
+	 * otherwise a new frame is allocated from the buffer pool for reading the page.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+	 * @param hint  	How the page is going to be used.  Pages read with any hint but ACCESS_RANDOM are the first to be
+	 *              	evicted, and finding them in the pool doesn't make them look any hotter.
+	 * @param ring  	Ring of frames to read the page into if it isn't in the pool.  Only used with ACCESS_SEQUENTIAL.
+	 */
+  void readPage(File* file, const PageId PageNo, Page*& page, AccessHint hint = ACCESS_RANDOM, BufferRing* ring = NULL);
+
+	/**
+	 * Reads the given page like readPage() above, and returns a handle that unpins it once it goes out of scope.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param hint  	How the page is going to be used
+	 * @param ring  	Ring of frames to read the page into if it isn't in the pool.  Only used with ACCESS_SEQUENTIAL.
+	 * @return  Handle holding the pinned page
+	 */
+  PageHandle readPage(File* file, const PageId PageNo, AccessHint hint = ACCESS_RANDOM, BufferRing* ring = NULL);
+
+	/**
+	 * Reads a page without pinning it, for pages read far more often than they change, such as the inner nodes of an
+	 * index.  The reader looks at the page in its frame, and is called again if the page changed or was pinned, and
+	 * so may have been changed, while it looked.  After a few tries, or if the page isn't in the pool, the page is
+	 * read pinned as readPage() does.  With a location, a page found in the same frame as last time, unchanged, isn't
+	 * looked up in the hash table at all, so reading it writes no memory other threads use.
+	 *
+	 * The reader may be called with a page changing under it and must not act on what it sees until this returns:
+	 * it should only work out results that the next call overwrites, and not follow offsets or lengths it reads off
+	 * the page out of it.  Only the last call's results count.  Writers must change a page only while they have it
+	 * pinned, and unpin it dirty.
+	 *
+	 * Reads that don't pin the page aren't counted in the statistics.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param reader	Called with the page, possibly more than once
+	 * @param location	Where the page was last found, or NULL.  Updated to where it was found this time.
+	 */
+  void readOptimistic(File* file, const PageId pageNo, const std::function<void(const Page&)>& reader,
+                      PageLocation* location = NULL);
+
+	/**
+	 * Asks for pages to be read into the buffer pool in the background, so a scan that will reach them shortly finds
+	 * them there instead of waiting for the disk.  Pages already in the pool are skipped, prefetched pages are left
+	 * unpinned and are among the first to be evicted, and requests beyond what the prefetcher can keep up with are
+	 * dropped.  Errors, such as a page that doesn't exist, are ignored.
+	 *
+	 * A sequential scan passes its ring, and the pages are read into the ring rather than taking frames of the pool at
+	 * large.
+	 *
+	 * The prefetcher keeps a pointer to the file and the ring, so the file must be flushed with flushFile() before
+	 * either goes.
+	 *
+	 * @param file   	File object
+	 * @param pageNos Numbers of the pages to read, in the order they will be needed
+	 * @param ring  	Ring of the scan the pages are read for, or NULL
+	 */
+  void prefetch(File* file, const std::vector<PageId>& pageNos, BufferRing* ring = NULL);
+
+	/**
+	 * Waits until every page asked for by prefetch() or warmUp() so far has been read or dropped.
+	 */
+  void waitForPrefetch();
+
+	/**
+	 * Starts reading the pages of a file that were hot when the hot page list was saved, so the file doesn't start
+	 * cold after a restart.  The prefetcher reads them in the background, hottest first in batches sorted by page
+	 * number, but only while the scans' own prefetches leave it idle and only into free frames, so warming never
+	 * evicts a page.  Call after opening the file; does nothing without a hot page list or if the file had no hot
+	 * pages, and the pages are only handed out once.
+	 *
+	 * As with prefetch(), the file must be flushed with flushFile() before it is closed.
+	 *
+	 * @param file   	File object
+	 */
+  void warmUp(File* file);
+
+	/**
+	 * Saves the pages in the buffer pool, hottest first, to the hot page list set in BufPoolOptions, together with the
+	 * pages of files flushed since the buffer manager was created.  Called by checkpoint() and when the buffer manager
+	 * is destroyed.  Does nothing without a hot page list.
+	 */
+  void saveHotPages();
+
+	/**
+	 * Writes back the dirty pages among the next victims, so that the free frames and the clean frames next in line for
+	 * eviction add up to the clean target.  Pages stay in the buffer pool, and pinned pages are skipped.  The page writer calls this every WRITER_INTERVAL_MS milliseconds, and sooner when a miss
+	 * had to write back its victim itself.
+	 *
+	 * @return  Number of pages written back
+	 */
+  std::uint32_t cleanVictims();
+
+	/**
+	 * Sets the number of frames the page writer tries to keep clean.  Defaults to an eighth of the pool; 0 stops
+	 * the page writer from writing anything.
+	 *
+	 * @param frames  Number of frames to keep clean
+	 */
+  void setCleanTarget(std::uint32_t frames)
+  {
+		cleanTarget = frames;
+  }
+
+	/**
+	 * Unpin a page from memory since it is no longer required for it to remain in memory.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number
+	 * @param dirty		True if the page to be unpinned needs to be marked dirty	
+   * @throws  PageNotPinnedException If the page is not already pinned
+   * @throws  HashNotFoundException If the page is not in the buffer pool
+	 */
+  void unPinPage(File* file, const PageId PageNo, const bool dirty);
+
+	/**
+	 * Allocates a new, empty page in the file and returns the Page object.
+	 * The newly allocated page is also assigned a frame in the buffer pool.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
+	 * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+	 */
+  void allocPage(File* file, PageId &PageNo, Page*& page); 
+
+	/**
+	 * Allocates a new, empty page in the file like allocPage() above, and returns a handle that unpins it once it goes
+	 * out of scope.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
+	 * @return  Handle holding the pinned page
+	 */
+  PageHandle allocPage(File* file, PageId &PageNo);
+
+	/**
+	 * Writes out all dirty pages of the file to disk and drops the file's pages from the buffer pool.
+	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
+	 * Otherwise Error returned.  Pages of the file waiting to be prefetched are dropped.
+	 * Only the file's own pages are looked at, and its dirty pages are written in page number order, each run of
+	 * consecutive pages with one write.
+	 *
+	 * @param file   	File object
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool, in which case nothing is written
+	 */
+  void flushFile(const File* file);
+
+	/**
+	 * Delete page from file and also from buffer pool if present.  A page that is not in the buffer pool is simply
+	 * deleted from the file.
+	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number
+	 */
+  void disposePage(File* file, const PageId PageNo);
+
+	/**
+	 * Makes every page update unpinned so far durable.  The images of dirty pages not yet in the log are appended to it
+	 * along with a commit record, and the call returns once the record is on disk.  Commits of several threads made
+	 * around the same time share one force of the log; see LogManager::commit().  Does nothing without a log.
+	 *
+	 * @return  Log sequence number of the commit record, or 0 without a log
+	 */
+  Lsn commit();
+
+	/**
+	 * Writes every dirty page in the buffer pool back to its file, sorted by file and page number with each run of
+	 * consecutive pages written at once, and syncs the files.
+	 * With a log, the log is then emptied.  Pages stay in the buffer pool.
+	 */
+  void checkpoint();
+
+	/**
+	 * Grows or shrinks the buffer pool while other threads go on using it.  Frames are added to or dropped from the
+	 * end of the pool: new frames go on the free lists, and the pages in dropped frames are evicted, dirty ones written
+	 * back first.  Pinned pages are never evicted, so shrinking stops short at the highest frame holding a pinned page.
+	 * The memory of dropped frames is given back to the system, and the hash table shards are resized to match,
+	 * rehashing incrementally.
+	 *
+	 * @param bufs  	Number of frames wanted.  At least one, and at most the maxBufs the pool was created with.
+	 * @return  Number of frames the pool has now
+	 */
+  std::uint32_t resize(std::uint32_t bufs);
+
+	/**
+   * Print member variable values.  Not threadsafe.
+	 */
+  void  printSelf();
+
+	/**
+	 * Starts recording the calls to readPage(), allocPage(), unPinPage(), disposePage() and flushFile(), and pages let
+	 * go of by PageHandles, to a trace file, for replaying against other pool sizes and policies with TraceSimulator.
+	 * Pages read ahead by the prefetcher are not recorded.  A trace already started is stopped first.
+	 *
+	 * @param name  	Name of the trace file, which is replaced if it exists
+	 * @throws TraceIOException If the file can't be created
+	 */
+  void startTrace(const std::string& name)
+  {
+		trace.open(name);
+  }
+
+	/**
+	 * Stops recording and closes the trace file.  Does nothing if no trace was started.
+	 *
+	 * @throws TraceIOException If any of the trace could not be written
+	 */
+  void stopTrace()
+  {
+		trace.close();
+  }
+
+	/**
+   * Writes the buffer pool statistics as a JSON object, for monitoring tools.  Threadsafe.
+   *
+   * @param out	Stream to write to
+	 */
+  void printStatsJson(std::ostream& out = std::cout)
+  {
+		getStatsSnapshot().printJson(out);
+  }
+
+	/**
+   * Get buffer pool usage statistics
+	 */
+  BufStats & getBufStats()
+  {
+		return bufStats;
+  }
+
+	/**
+   * Copies the buffer pool usage statistics, including the counts of each file.  Threadsafe, though counts taken
+   * while other threads use the pool may be a few operations apart.
+	 */
+  BufStatsSnapshot getStatsSnapshot();
+
+	/**
+   * Clear buffer pool usage statistics
+	 */
+  void clearBufStats();
+
+	/**
+   * Kind of pages the frames actually got, which may be smaller than asked for if the system has no huge pages free
+	 */
+  PoolMemory::PageKind getPoolPageKind() const
+  {
+		return frameMemory->pageKind();
+  }
+
+	/**
+   * Number of frames in the buffer pool
+	 */
+  std::uint32_t getNumBufs() const
+  {
+		return numBufs;
+  }
+
+	/**
+   * Number of frames the buffer pool can be grown to
+	 */
+  std::uint32_t getMaxBufs() const
+  {
+		return maxBufs;
+  }
+
+	/**
+   * Victim cache behind the buffer pool, or NULL if it has none
+	 */
+  const VictimCache* getVictimCache() const
+  {
+		return victimCache;
+  }
+
+	/**
+   * Number of partitions the buffer pool is split into
 	 */
-  void clearBufStats() 
+  std::uint32_t getNumPartitions() const
   {
-		bufStats.clear();
+		return numPartitions;
   }
 };
 
@@ -0,0 +1,49 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a page is not laid out in the format
+ *        the caller expects, or cannot be given the requested layout.
+ */
+class BadPageFormatException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a bad page format exception for the given page.
+   *
+   * @param page_num  Number of the page.
+   * @param reason    What is wrong with the page or the requested layout.
+   */
+  BadPageFormatException(const PageId page_num, const std::string& reason);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~BadPageFormatException() throw() {}
+
+  /**
+   * Returns the number of the page that caused this exception.
+   */
+  virtual PageId page_number() const { return page_number_; }
+
+ protected:
+  /**
+   * Number of the page which caused this exception.
+   */
+  const PageId page_number_;
+};
+
+}
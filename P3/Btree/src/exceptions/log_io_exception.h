@@ -0,0 +1,48 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when the write-ahead log can't be read
+ *        or written.
+ */
+class LogIOException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a log I/O exception for the given log file.
+   *
+   * @param name       Name of the log file.
+   * @param operation  What was being done when the error occurred.
+   */
+  LogIOException(const std::string& name, const std::string& operation);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~LogIOException() throw() {}
+
+  /**
+   * Returns the name of the log file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+ protected:
+  /**
+   * Name of log file that caused this exception.
+   */
+  const std::string filename_;
+};
+
+}
@@ -0,0 +1,25 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "page_size_mismatch_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+PageSizeMismatchException::PageSizeMismatchException(
+    const std::string& name, const std::uint32_t file_page_size,
+    const std::uint32_t page_size)
+    : BadgerDbException(""), filename_(name) {
+  std::stringstream ss;
+  ss << "File '" << filename_ << "' has " << file_page_size
+     << " byte pages but this build uses " << page_size << " byte pages";
+  message_.assign(ss.str());
+}
+
+}
@@ -0,0 +1,52 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a file is opened by a binary built
+ *        with a different page size than the one the file was created with.
+ */
+class PageSizeMismatchException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a page size mismatch exception for the given file.
+   *
+   * @param name            Name of the file.
+   * @param file_page_size  Page size recorded in the file.
+   * @param page_size       Page size of the running binary.
+   */
+  PageSizeMismatchException(const std::string& name,
+                            const std::uint32_t file_page_size,
+                            const std::uint32_t page_size);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~PageSizeMismatchException() throw() {}
+
+  /**
+   * Returns the name of the file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+ protected:
+  /**
+   * Name of file that caused this exception.
+   */
+  const std::string filename_;
+};
+
+}
@@ -0,0 +1,48 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when the access trace can't be read
+ *        or written.
+ */
+class TraceIOException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a trace I/O exception for the given trace file.
+   *
+   * @param name       Name of the trace file.
+   * @param operation  What was being done when the error occurred.
+   */
+  TraceIOException(const std::string& name, const std::string& operation);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~TraceIOException() throw() {}
+
+  /**
+   * Returns the name of the trace file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+ protected:
+  /**
+   * Name of trace file that caused this exception.
+   */
+  const std::string filename_;
+};
+
+}
@@ -12,19 +12,35 @@
 #include <memory>
 #include <string>
 #include <cstdio>
+#include <cstring>
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include "exceptions/bad_page_format_exception.h"
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/page_size_mismatch_exception.h"
 #include "file_iterator.h"
 #include "page.h"
+#include "pagecodec.h"
+#include "pagedirectory.h"
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
+File::OpenFileMap File::open_files_;
 File::CountMap File::open_counts_;
+PageId File::extent_pages_ = 64;
+PageFile::DirectoryMap PageFile::directories_;
+BlobFile::PageTableMap BlobFile::page_tables_;
+const std::uint32_t FileHeader::COMPRESSED;
+const std::size_t BlobFile::ENTRIES_PER_CHUNK;
 
 void File::remove(const std::string& filename) {
   if (!exists(filename)) {
@@ -60,44 +76,95 @@ File::~File() {
 
 
 PageId File::getFirstPageNo() {
-  const FileHeader& header = readHeader();
+  const FileHeader& header = lockAndReadHeader();
   return header.first_used_page;
 }
 
+PageId File::getNumPages() {
+  const FileHeader& header = lockAndReadHeader();
+  return header.num_pages;
+}
+
+void File::writePages(const PageId first_page_number,
+                      const std::vector<const Page*>& pages) {
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    writePage(first_page_number + i, *pages[i]);
+  }
+}
+
+void File::sync(const std::string& filename) {
+  OpenFileMap::iterator iter = open_files_.find(filename);
+  if (iter != open_files_.end()) {
+    ::fsync(iter->second->fd);
+    return;
+  }
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    ::fsync(fd);
+    ::close(fd);
+  }
+}
+
 File::File(const std::string& name, const bool create_new) : filename_(name) {
   openIfNeeded(create_new);
 
   if (create_new) {
     // File starts with 1 page (the header).
     FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+                         0 /* num_free_pages */, 0 /* first_free_page */,
+                         Page::SIZE /* page_size */, 0 /* flags */,
+                         1 /* reserved_pages */};
     writeHeader(header);
+  } else {
+    const FileHeader header = readHeader();
+    if (header.page_size != Page::SIZE) {
+      const std::uint32_t file_page_size = header.page_size;
+      close();
+      throw PageSizeMismatchException(filename_, file_page_size, Page::SIZE);
+    }
+  }
+}
+
+void File::reservePages(FileHeader& header, const PageId count) {
+  if (header.num_pages + count <= header.reserved_pages) {
+    return;
+  }
+  const PageId extent = std::max(extent_pages_, count);
+  if (::posix_fallocate(open_file_->fd, pagePosition(header.reserved_pages),
+                        static_cast<off_t>(extent) * Page::SIZE) == 0) {
+    header.reserved_pages += extent;
+  }
+}
+
+File::OpenFile::OpenFile(const std::string& filename, const bool create_new)
+    : fd(::open(filename.c_str(),
+                O_RDWR | (create_new ? O_CREAT | O_TRUNC : 0), 0644)) {}
+
+File::OpenFile::~OpenFile() {
+  if (fd >= 0) {
+    ::close(fd);
   }
 }
 
 void File::openIfNeeded(const bool create_new) {
   if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
     ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+    open_file_ = open_files_[filename_];
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
     const bool already_exists = exists(filename_);
     if (create_new) {
       // Error if we try to overwrite an existing file.
       if (already_exists) {
         throw FileExistsException(filename_);
       }
-      // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
     } else {
       // Error if we try to open a file that doesn't exist.
       if (!already_exists) {
         throw FileNotFoundException(filename_);
       }
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
+    open_file_.reset(new OpenFile(filename_, create_new));
+    open_files_[filename_] = open_file_;
     open_counts_[filename_] = 1;
   }
 }
@@ -106,26 +173,72 @@ void File::close() {
 	if(open_counts_[filename_] > 0)
   	--open_counts_[filename_];
 
-  stream_.reset();
+  open_file_.reset();
 	assert(open_counts_[filename_] >= 0);
 
   if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
+    open_files_.erase(filename_);
     open_counts_.erase(filename_);
   }
 }
 
 FileHeader File::readHeader() const {
   FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
+  readAt(0 /* position */, reinterpret_cast<char*>(&header),
+         sizeof(FileHeader));
   return header;
 }
 
+FileHeader File::lockAndReadHeader() const {
+  std::lock_guard<std::mutex> lock(open_file_->mutex);
+  return readHeader();
+}
+
 void File::writeHeader(const FileHeader& header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
-  stream_->flush();
+  writeAt(0 /* position */, reinterpret_cast<const char*>(&header),
+          sizeof(FileHeader));
+}
+
+void File::readAt(const std::uint64_t position, char* data,
+                  const std::size_t length) const {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n = ::pread(open_file_->fd, data + done, length - done,
+                              static_cast<off_t>(position + done));
+    if (n <= 0) {
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      // Past the end of the file; the rest reads as zeroes.
+      memset(data + done, 0, length - done);
+      return;
+    }
+    done += n;
+  }
+}
+
+void File::writeAt(const std::uint64_t position, const char* data,
+                   const std::size_t length) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n = ::pwrite(open_file_->fd, data + done, length - done,
+                               static_cast<off_t>(position + done));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return;
+    }
+    done += n;
+  }
+}
+
+std::uint64_t File::fileSize() const {
+  struct stat st;
+  if (::fstat(open_file_->fd, &st) != 0) {
+    return 0;
+  }
+  return st.st_size;
 }
 
 
@@ -143,13 +256,15 @@ PageFile PageFile::open(const std::string& filename) {
 PageFile::PageFile(const std::string& name, const bool create_new)
 : File(name, create_new)
 {
+  openDirectory(create_new);
 }
 
 PageFile::~PageFile() {
 }
 
 PageFile::PageFile(const PageFile& other)
-: File(other.filename_, false /* create_new */)
+: File(other.filename_, false /* create_new */),
+  directory_(other.directory_)
 {
 }
 
@@ -159,86 +274,66 @@ PageFile& PageFile::operator=(const PageFile& rhs) {
   close();	//close my file and associate me with the new one
   filename_ = rhs.filename_;
   openIfNeeded(false /* create_new */);
+  directory_ = rhs.directory_;
   return *this;
 }
 
 Page PageFile::allocatePage(PageId &new_page_number) {
+  std::lock_guard<std::mutex> lock(open_file_->mutex);
   FileHeader header = readHeader();
   Page new_page;
-  Page existing_page;
   if (header.num_free_pages > 0) {
     new_page = readPage(header.first_free_page, true /* allow_free */);
     new_page.set_page_number(header.first_free_page);
-		new_page_number = new_page.page_number();
     header.first_free_page = new_page.next_page_number();
     --header.num_free_pages;
 
-    if (header.first_used_page == Page::INVALID_NUMBER ||
-        header.first_used_page > new_page.page_number()) {
-      // Either have no pages used or the head of the used list is a page later
-      // than the one we just allocated, so add the new page to the head.
-      if (header.first_used_page > new_page.page_number()) {
-        new_page.set_next_page_number(header.first_used_page);
-      }
-      header.first_used_page = new_page.page_number();
-    } else {
-      // New page is reused from somewhere after the beginning, so we need to
-      // find where in the used list to insert it.
-      PageId next_page_number = Page::INVALID_NUMBER;
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
-            next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      existing_page.set_next_page_number(new_page.page_number());
-      new_page.set_next_page_number(next_page_number);
-    }
-
     assert((header.num_free_pages == 0) ==
            (header.first_free_page == Page::INVALID_NUMBER));
   }
 	else
 	{
-    new_page.set_page_number(header.num_pages);
-		new_page_number = new_page.page_number();
-
-    if (header.first_used_page == Page::INVALID_NUMBER)
-		{
-      header.first_used_page = new_page.page_number();
-    }
-		else
-		{
-      // If we have pages allocated, we need to add the new page to the tail
-      // of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      assert(existing_page.isUsed());
-      existing_page.set_next_page_number(new_page.page_number());
+    reservePages(header,
+                 PageDirectory::isDirectoryPage(header.num_pages) ? 2 : 1);
+    if (PageDirectory::isDirectoryPage(header.num_pages)) {
+      // The file has grown into the next run of pages; its first page holds
+      // the directory for the run.
+      const std::vector<char> empty_directory(Page::SIZE, 0);
+      writeAt(pagePosition(header.num_pages), &empty_directory[0], Page::SIZE);
+      ++header.num_pages;
     }
+    new_page.set_page_number(header.num_pages);
     ++header.num_pages;
   }
-  writePage(new_page_number, new_page.header_, new_page);
-  if (existing_page.page_number() != Page::INVALID_NUMBER) {
-    // If we updated an existing page by inserting the new page into the
-    // used list, we need to write it out.
-    writePage(existing_page.page_number(), existing_page.header_, existing_page);
+	new_page_number = new_page.page_number();
+
+  // Link the page into the used list after the closest used page before it,
+  // or at the head of the list if there is none.
+  const PageId previous_page_number =
+      directory_->previousUsed(new_page_number);
+  if (previous_page_number == Page::INVALID_NUMBER) {
+    new_page.set_next_page_number(header.first_used_page);
+    header.first_used_page = new_page_number;
+  } else {
+    PageHeader previous_header = readPageHeader(previous_page_number);
+    new_page.set_next_page_number(previous_header.next_page_number);
+    previous_header.next_page_number = new_page_number;
+    writePageHeader(previous_page_number, previous_header);
   }
+  writePage(new_page_number, new_page.header_, new_page);
   writeHeader(header);
+  setPageUsed(new_page_number, true);
 
   return new_page;
 }
 
 Page PageFile::readPage(const PageId page_number) const {
-  FileHeader header = readHeader();
+  // The page itself is read without the lock; the buffer manager never reads
+  // a page while it writes it.
+  FileHeader header = lockAndReadHeader();
 
-	if (page_number >= header.num_pages)
+	if (page_number >= header.num_pages ||
+			PageDirectory::isDirectoryPage(page_number))
 	{
 		throw InvalidPageException(page_number, filename_);
 	}
@@ -247,9 +342,10 @@ Page PageFile::readPage(const PageId page_number) const {
 
 Page PageFile::readPage(const PageId page_number, const bool allow_free) const {
   Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(PageHeader));
-  stream_->read(reinterpret_cast<char*>(&page.data_[0]), Page::DATA_SIZE);
+  readAt(pagePosition(page_number), reinterpret_cast<char*>(&page.header_),
+         sizeof(PageHeader));
+  readAt(pagePosition(page_number) + sizeof(PageHeader),
+         reinterpret_cast<char*>(&page.data_[0]), Page::DATA_SIZE);
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
@@ -258,6 +354,11 @@ Page PageFile::readPage(const PageId page_number, const bool allow_free) const {
 }
 
 void PageFile::writePage(const PageId new_page_number, const Page& new_page) {
+	if (PageDirectory::isDirectoryPage(new_page_number))
+	{
+		throw InvalidPageException(new_page_number, filename_);
+	}
+	std::lock_guard<std::mutex> lock(open_file_->mutex);
 	PageHeader header = readPageHeader(new_page_number);
 	if (header.current_page_number == Page::INVALID_NUMBER)
 	{
@@ -273,40 +374,70 @@ void PageFile::writePage(const PageId new_page_number, const Page& new_page) {
 	writePage(new_page_number, header, new_page);
 }
 
+void PageFile::writePages(const PageId first_page_number,
+                          const std::vector<const Page*>& pages) {
+  // Build the whole run, header and data of each page back to back as they
+  // are laid out on disk, keeping the next page pointers as writePage() does.
+  std::lock_guard<std::mutex> lock(open_file_->mutex);
+  std::string run;
+  run.reserve(pages.size() * Page::SIZE);
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    const PageId page_number = first_page_number + i;
+    if (PageDirectory::isDirectoryPage(page_number)) {
+      throw InvalidPageException(page_number, filename_);
+    }
+    PageHeader header = readPageHeader(page_number);
+    if (header.current_page_number == Page::INVALID_NUMBER) {
+      throw InvalidPageException(page_number, filename_);
+    }
+    const PageId next_page_number = header.next_page_number;
+    header = pages[i]->header_;
+    header.next_page_number = next_page_number;
+    run.append(reinterpret_cast<const char*>(&header), sizeof(PageHeader));
+    run.append(reinterpret_cast<const char*>(&pages[i]->data_[0]),
+               Page::DATA_SIZE);
+  }
+  if (run.empty()) {
+    return;
+  }
+  writeAt(pagePosition(first_page_number), run.data(), run.size());
+}
+
 void PageFile::deletePage(const PageId page_number) {
+  std::lock_guard<std::mutex> lock(open_file_->mutex);
   FileHeader header = readHeader();
 
-  Page existing_page = readPage(page_number);
-  Page previous_page;
-  // If this page is the head of the used list, update the header to point to
-  // the next page in line.
-  if (page_number == header.first_used_page) {
+  if (page_number >= header.num_pages ||
+      PageDirectory::isDirectoryPage(page_number)) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  Page existing_page = readPage(page_number, false /* allow_free */);
+  // Unlink the page from the used list, updating whichever of the header or
+  // the closest used page before it points at the page.
+  const PageId previous_page_number = directory_->previousUsed(page_number);
+  if (previous_page_number == Page::INVALID_NUMBER) {
     header.first_used_page = existing_page.next_page_number();
   } else {
-    // Walk the used list so we can update the page that points to this one.
-    for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
-        break;
-      }
-    }
+    PageHeader previous_header = readPageHeader(previous_page_number);
+    previous_header.next_page_number = existing_page.next_page_number();
+    writePageHeader(previous_page_number, previous_header);
   }
   // Clear the page and add it to the head of the free list.
   existing_page.initialize();
   existing_page.set_next_page_number(header.first_free_page);
   header.first_free_page = page_number;
   ++header.num_free_pages;
-  if (previous_page.isUsed()) {
-    writePage(previous_page.page_number(), previous_page.header_, previous_page);
-  }
   writePage(page_number, existing_page.header_, existing_page);
   writeHeader(header);
+  setPageUsed(page_number, false);
 }
 
 FileIterator PageFile::begin() {
-  const FileHeader& header = readHeader();
-  return FileIterator(this, header.first_used_page);
+  return FileIterator(this);
+}
+
+FileIterator PageFile::begin(const PageId start_page) {
+  return FileIterator(this, start_page);
 }
 
 FileIterator PageFile::end() {
@@ -315,40 +446,93 @@ FileIterator PageFile::end() {
 
 void PageFile::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(PageHeader));
-  stream_->write(reinterpret_cast<const char*>(&new_page.data_[0]),
-                 Page::DATA_SIZE);
-  stream_->flush();
+  // One write for the whole page, so a concurrent read of it sees either
+  // the old page or the new one.
+  char bytes[Page::SIZE];
+  memcpy(bytes, &header, sizeof(PageHeader));
+  memcpy(bytes + sizeof(PageHeader), &new_page.data_[0], Page::DATA_SIZE);
+  writeAt(pagePosition(page_number), bytes, Page::SIZE);
 }
 
 PageHeader PageFile::readPageHeader(PageId page_number) const {
   PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(PageHeader));
+  readAt(pagePosition(page_number), reinterpret_cast<char*>(&header),
+         sizeof(PageHeader));
   return header;
 }
 
+void PageFile::writePageHeader(const PageId page_number,
+                               const PageHeader& header) {
+  writeAt(pagePosition(page_number), reinterpret_cast<const char*>(&header),
+          sizeof(PageHeader));
+}
+
+void PageFile::openDirectory(const bool create_new) {
+  if (!create_new) {
+    DirectoryMap::iterator iter = directories_.find(filename_);
+    if (iter != directories_.end()) {
+      directory_ = iter->second.lock();
+      if (directory_) {
+        return;
+      }
+    }
+  }
 
+  directory_.reset(new PageDirectory());
+  directories_[filename_] = directory_;
+  if (!create_new) {
+    // Read every directory page of the file.
+    const PageId num_pages = readHeader().num_pages;
+    for (PageId directory_page = 1; directory_page < num_pages;
+         directory_page += PageDirectory::SPAN) {
+      readAt(pagePosition(directory_page),
+             directory_->directoryPageData(directory_page), Page::SIZE);
+    }
+  }
+}
 
+void PageFile::setPageUsed(const PageId page_number, const bool used) {
+  directory_->setUsed(page_number, used);
+  const std::uint64_t word = directory_->wordFor(page_number);
+  writeAt(pagePosition(PageDirectory::directoryPageFor(page_number)) +
+              PageDirectory::wordOffsetFor(page_number),
+          reinterpret_cast<const char*>(&word), sizeof(word));
+}
 
-BlobFile BlobFile::create(const std::string& filename) {
-  return BlobFile(filename, true /* create_new */);
+
+
+
+BlobFile BlobFile::create(const std::string& filename, const bool compressed) {
+  return BlobFile(filename, true /* create_new */, compressed);
 }
 
 BlobFile BlobFile::open(const std::string& filename) {
   return BlobFile(filename, false /* create_new */);
 }
 
-BlobFile::BlobFile(const std::string& name, const bool create_new)
+BlobFile::BlobFile(const std::string& name, const bool create_new,
+                   const bool compressed)
 : File(name, create_new) {
+  if (create_new) {
+    if (compressed) {
+      FileHeader header = readHeader();
+      header.flags |= FileHeader::COMPRESSED;
+      writeHeader(header);
+      page_table_.reset(new PageTable());
+      page_tables_[filename_] = page_table_;
+      appendPageTableChunk();
+    }
+  } else if (readHeader().flags & FileHeader::COMPRESSED) {
+    openPageTable();
+  }
 }
 
 BlobFile::~BlobFile() {
 }
 
 BlobFile::BlobFile(const BlobFile& other)
-: File(other.filename_, false /* create_new */)
+: File(other.filename_, false /* create_new */),
+  page_table_(other.page_table_)
 {
 }
 
@@ -358,23 +542,37 @@ BlobFile& BlobFile::operator=(const BlobFile& rhs) {
   close();	//close my file and associate me with the new one
   filename_ = rhs.filename_;
   openIfNeeded(false /* create_new */);
+  page_table_ = rhs.page_table_;
   return *this;
 }
 
 Page BlobFile::allocatePage(PageId &new_page_number) {
+  std::lock_guard<std::mutex> lock(open_file_->mutex);
   FileHeader header = readHeader();
 	Page new_page;
 
 	new_page_number = header.num_pages;
+	if (!page_table_) {
+		// Compressed pages are appended at the end of the file instead.
+		reservePages(header, 1);
+	}
 
 	if (header.first_used_page == Page::INVALID_NUMBER) {
 		header.first_used_page = header.num_pages;
 	}
 
 	++header.num_pages;
+	if (page_table_) {
+		// Make room in the page table before the page is written.
+		const std::size_t index = new_page_number - 1;
+		if (index / ENTRIES_PER_CHUNK >= page_table_->chunk_offsets.size()) {
+			appendPageTableChunk();
+		}
+		page_table_->entries.resize(index + 1);
+	}
 	//Fix set the 'new_page's page number to new_page_number before writing it to the disk
 	new_page.set_page_number(new_page_number);
-	writePage(new_page_number, new_page);
+	storePage(new_page_number, new_page);
 	writeHeader(header);
 
 	return new_page;
@@ -382,15 +580,80 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
 
 Page BlobFile::readPage(const PageId page_number) const {
 	Page page;
-	stream_->seekg(pagePosition(page_number), std::ios::beg);
-	stream_->read(reinterpret_cast<char*>(&page), Page::SIZE);
+	if (!page_table_) {
+		readAt(pagePosition(page_number), reinterpret_cast<char*>(&page),
+		       Page::SIZE);
+		return page;
+	}
+
+	std::vector<char> bytes;
+	{
+		// The page table, and where a page lives, change as pages are written.
+		std::lock_guard<std::mutex> lock(open_file_->mutex);
+		if (page_number == Page::INVALID_NUMBER ||
+				page_number > page_table_->entries.size()) {
+			throw InvalidPageException(page_number, filename_);
+		}
+		const PageTableEntry& entry = page_table_->entries[page_number - 1];
+		bytes.resize(entry.length);
+		readAt(entry.offset, &bytes[0], entry.length);
+	}
+	if (bytes.size() == Page::SIZE) {
+		memcpy(reinterpret_cast<char*>(&page), &bytes[0], Page::SIZE);
+	} else if (!PageCodec::decompress(&bytes[0], bytes.size(),
+	                                  reinterpret_cast<char*>(&page),
+	                                  Page::SIZE)) {
+		throw BadPageFormatException(page_number, "corrupt compressed page");
+	}
 	return page;
 }
 
 void BlobFile::writePage(const PageId new_page_number, const Page& new_page) {
-	stream_->seekp(pagePosition(new_page_number), std::ios::beg);
-	stream_->write(reinterpret_cast<const char*>(&new_page), Page::SIZE);
-	stream_->flush();
+	if (!page_table_) {
+		storePage(new_page_number, new_page);
+		return;
+	}
+	std::lock_guard<std::mutex> lock(open_file_->mutex);
+	storePage(new_page_number, new_page);
+}
+
+void BlobFile::storePage(const PageId new_page_number, const Page& new_page) {
+	if (!page_table_) {
+		writeAt(pagePosition(new_page_number),
+		        reinterpret_cast<const char*>(&new_page), Page::SIZE);
+		return;
+	}
+
+	if (new_page_number == Page::INVALID_NUMBER ||
+			new_page_number > page_table_->entries.size()) {
+		throw InvalidPageException(new_page_number, filename_);
+	}
+	std::string compressed;
+	PageCodec::compress(reinterpret_cast<const char*>(&new_page), Page::SIZE,
+	                    compressed);
+	const char* bytes = compressed.data();
+	std::size_t length = compressed.size();
+	if (length >= Page::SIZE) {
+		// Not worth it; store the page as is.
+		bytes = reinterpret_cast<const char*>(&new_page);
+		length = Page::SIZE;
+	}
+
+	PageTableEntry& entry = page_table_->entries[new_page_number - 1];
+	entry.length = length;
+	if (length <= entry.capacity) {
+		writeAt(entry.offset, bytes, length);
+	} else {
+		// Doesn't fit where the page was; move it to the end of the file and
+		// leave some slack so small changes can be written in place.  The old
+		// space is not reused.
+		entry.offset = fileSize();
+		entry.capacity = (length + 63) / 64 * 64;
+		std::vector<char> padded(entry.capacity, 0);
+		memcpy(&padded[0], bytes, length);
+		writeAt(entry.offset, &padded[0], padded.size());
+	}
+	writePageTableEntry(new_page_number);
 }
 
 //delePage should not be called for a blob_file, not supported
@@ -398,4 +661,59 @@ void BlobFile::deletePage(const PageId page_number) {
 	throw InvalidPageException(page_number, filename_);
 }
 
+void BlobFile::openPageTable() {
+	PageTableMap::iterator iter = page_tables_.find(filename_);
+	if (iter != page_tables_.end()) {
+		page_table_ = iter->second.lock();
+		if (page_table_) {
+			return;
+		}
+	}
+
+	page_table_.reset(new PageTable());
+	page_tables_[filename_] = page_table_;
+	const std::size_t num_entries = readHeader().num_pages - 1;
+	std::uint64_t chunk_offset = sizeof(FileHeader);
+	while (true) {
+		page_table_->chunk_offsets.push_back(chunk_offset);
+		const std::size_t first = page_table_->entries.size();
+		const std::size_t count =
+				std::min(ENTRIES_PER_CHUNK, num_entries - first);
+		page_table_->entries.resize(first + count);
+		readAt(chunk_offset + sizeof(chunk_offset),
+		       reinterpret_cast<char*>(page_table_->entries.data() + first),
+		       count * sizeof(PageTableEntry));
+		readAt(chunk_offset, reinterpret_cast<char*>(&chunk_offset),
+		       sizeof(chunk_offset));
+		if (page_table_->entries.size() == num_entries) {
+			break;
+		}
+	}
+}
+
+void BlobFile::appendPageTableChunk() {
+	const std::vector<char> chunk(
+			sizeof(std::uint64_t) + ENTRIES_PER_CHUNK * sizeof(PageTableEntry), 0);
+	const std::uint64_t chunk_offset = fileSize();
+	writeAt(chunk_offset, &chunk[0], chunk.size());
+	if (!page_table_->chunk_offsets.empty()) {
+		// Link the new chunk from the previous one.
+		writeAt(page_table_->chunk_offsets.back(),
+		        reinterpret_cast<const char*>(&chunk_offset),
+		        sizeof(chunk_offset));
+	}
+	page_table_->chunk_offsets.push_back(chunk_offset);
+}
+
+void BlobFile::writePageTableEntry(const PageId page_number) {
+	const std::size_t index = page_number - 1;
+	const std::uint64_t position =
+			page_table_->chunk_offsets[index / ENTRIES_PER_CHUNK] +
+			sizeof(std::uint64_t) +
+			(index % ENTRIES_PER_CHUNK) * sizeof(PageTableEntry);
+	writeAt(position,
+	        reinterpret_cast<const char*>(&page_table_->entries[index]),
+	        sizeof(PageTableEntry));
+}
+
 }
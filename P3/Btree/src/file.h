@@ -7,23 +7,27 @@
 
 #pragma once
 
-#include <fstream>
+#include <cstdint>
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "page.h"
 
 namespace badgerdb {
 
 class FileIterator;
+class PageDirectory;
 
 /**
  * @brief Header metadata for files on disk which contain pages.
  */
 struct FileHeader {
   /**
-   * Number of pages allocated in the file.
+   * Number of pages allocated in the file.  This is the high-water mark of
+   * the file: pages at and beyond it have never been handed out.
    */
   PageId num_pages;
 
@@ -42,6 +46,29 @@ struct FileHeader {
    */
   PageId first_free_page;
 
+  /**
+   * Size in bytes of the pages in the file, i.e. the Page::SIZE of the binary
+   * that created it.
+   */
+  std::uint32_t page_size;
+
+  /**
+   * Bit set of FileHeader flags, such as COMPRESSED.
+   */
+  std::uint32_t flags;
+
+  /**
+   * Number of pages the file has space reserved for on disk, counting the
+   * header page.  Pages from num_pages up to this are preallocated but not
+   * yet in use.
+   */
+  PageId reserved_pages;
+
+  /**
+   * Flag set on BlobFiles whose pages are stored compressed.
+   */
+  static const std::uint32_t COMPRESSED = 0x1;
+
   /**
    * Returns true if this file header is equal to the other.
    *
@@ -52,23 +79,58 @@ struct FileHeader {
     return num_pages == rhs.num_pages &&
         num_free_pages == rhs.num_free_pages &&
         first_used_page == rhs.first_used_page &&
-        first_free_page == rhs.first_free_page;
+        first_free_page == rhs.first_free_page &&
+        page_size == rhs.page_size &&
+        flags == rhs.flags &&
+        reserved_pages == rhs.reserved_pages;
   }
 };
 
+/**
+ * @brief Location of one page of a compressed BlobFile.
+ */
+struct PageTableEntry {
+  /**
+   * Position of the page's bytes in the file.
+   */
+  std::uint64_t offset;
+
+  /**
+   * Number of bytes the page currently takes up.  A length of Page::SIZE
+   * means the page did not compress and is stored as is.
+   */
+  std::uint32_t length;
+
+  /**
+   * Number of bytes reserved at <offset>.  A page that grows beyond this is
+   * moved to the end of the file.
+   */
+  std::uint32_t capacity;
+};
+
 /**
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
  *
- * The File class wraps a stream to an underlying file on disk.  Files contain
- * fixed-sized pages, and they never deallocate space (though they do reuse
- * deleted pages if possible).  If multiple File objects refer to the same
- * underlying file, they will share the stream in memory.
+ * The File class wraps a descriptor of an underlying file on disk.  Files
+ * contain fixed-sized pages, and they never deallocate space (though they do
+ * reuse deleted pages if possible).  If multiple File objects refer to the
+ * same underlying file, they will share the descriptor.
  * If a file that has already been opened (possibly by another query), then the File class
- * detects this (by looking in the open_streams_ map) and just returns a file object with
- * the already created stream for the file without actually opening the UNIX file again. 
+ * detects this (by looking in the open_files_ map) and just returns a file object with
+ * the already opened descriptor for the file without actually opening the UNIX file again. 
+ *
+ * Files grow in extents rather than a page at a time: when the pages handed
+ * out reach the end of the reserved space, a whole extent of pages is
+ * reserved with fallocate, so files built up page by page stay contiguous on
+ * disk.
  *
- * @warning This class is not threadsafe.
+ * Pages are read and written with pread() and pwrite() at their position, so
+ * several threads may read and write pages of a file at once.  Changes to the
+ * structure of a file, such as allocating or deleting a page, are serialized
+ * by a lock per file, which writing a page also takes as it keeps the page's
+ * link in the used list; reading a page takes it only to check the page
+ * number against the header.  Opening and closing files is not threadsafe.
  */
 
 
@@ -84,6 +146,8 @@ class File {
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  PageSizeMismatchException  If the existing file was created with
+   *                                     a different page size.
    */
   File(const std::string& name, const bool create_new);
 
@@ -143,6 +207,17 @@ class File {
    */
   virtual void writePage(const PageId page_number, const Page& new_page) = 0;
 
+  /**
+   * Writes consecutive pages into the file, starting at the given page number.
+   * By default the pages are written one at a time; files that can replace a
+   * run of pages with a single write override this.
+   *
+   * @param first_page_number Number of the first page whose contents to replace.
+   * @param pages             Pages to write, in page number order.
+   */
+  virtual void writePages(const PageId first_page_number,
+                          const std::vector<const Page*>& pages);
+
   /**
    * Deletes a page from the file.
    *
@@ -164,6 +239,37 @@ class File {
    */
 	PageId getFirstPageNo();
 
+ 	/**
+   * Returns the number of pages in the file, counting the header page.
+   * Page numbers handed out by the file are always less than this value.
+   *
+   * @return  Number of pages in the file.
+   */
+	PageId getNumPages();
+
+  /**
+   * Returns the number of pages files reserve space for at a time when they
+   * grow.
+   */
+  static PageId getExtentPages() { return extent_pages_; }
+
+  /**
+   * Sets the number of pages files reserve space for at a time when they
+   * grow.
+   *
+   * @param extent_pages  Number of pages per extent; at least 1.
+   */
+  static void setExtentPages(const PageId extent_pages) {
+    extent_pages_ = extent_pages > 0 ? extent_pages : 1;
+  }
+
+  /**
+   * Asks the operating system to write the file's data to stable storage.
+   *
+   * @param filename  Name of the file.
+   */
+  static void sync(const std::string& filename);
+
  protected:
   /**
    * Returns the position of the page with the given number in the file (as an
@@ -172,14 +278,15 @@ class File {
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+  static std::uint64_t pagePosition(const PageId page_number) {
+    return sizeof(FileHeader) +
+           (static_cast<std::uint64_t>(page_number - 1) * Page::SIZE);
   }
 
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * the same filesystem file; otherwise, it reuses the existing descriptor.
    *
    * @param create_new  Whether to create a new file.
    * @throws  FileExistsException     If the underlying file exists and
@@ -190,52 +297,140 @@ class File {
   void openIfNeeded(const bool create_new);
 
   /**
-   * Closes the underlying file stream in <stream_>.
+   * Closes the underlying file in <open_file_>.
    * This method only closes the file if no other File objects exist that access
    * the same file.
    */
   void close();
 
   /**
-   * Reads the header for this file from disk.
+   * Reads the header for this file from disk.  The caller holds the file's
+   * lock.
    *
    * @return  The file header.
    */
   FileHeader readHeader() const;
 
   /**
-   * Writes the given header to the disk as the header for this file.
+   * Reads the header for this file from disk, taking the file's lock.
+   *
+   * @return  The file header.
+   */
+  FileHeader lockAndReadHeader() const;
+
+  /**
+   * Writes the given header to the disk as the header for this file.  The
+   * caller holds the file's lock.
    *
    * @param header  File header to write.
    */
   void writeHeader(const FileHeader& header);
 
-  typedef std::map<std::string, std::shared_ptr<std::fstream> > StreamMap;
+  /**
+   * Reads bytes from the file at the given position.  Bytes beyond the end
+   * of the file read as zero.
+   *
+   * @param position  Offset from the beginning of the file.
+   * @param data      Buffer to read into.
+   * @param length    Number of bytes to read.
+   */
+  void readAt(const std::uint64_t position, char* data,
+              const std::size_t length) const;
+
+  /**
+   * Writes bytes to the file at the given position.
+   *
+   * @param position  Offset from the beginning of the file.
+   * @param data      Bytes to write.
+   * @param length    Number of bytes to write.
+   */
+  void writeAt(const std::uint64_t position, const char* data,
+               const std::size_t length);
+
+  /**
+   * Returns the size of the file in bytes.
+   */
+  std::uint64_t fileSize() const;
+
+  /**
+   * Makes sure space is reserved on disk for the next <count> pages after
+   * the high-water mark, reserving another extent if it is not.  Updates
+   * <header>, which the caller writes back.  If the filesystem can't reserve
+   * the space, the file simply grows as pages are written.
+   *
+   * @param header  Header of the file.
+   * @param count   Number of pages about to be handed out.
+   */
+  void reservePages(FileHeader& header, const PageId count);
+
+  /**
+   * @brief An open file on disk, shared by the File objects for it.
+   */
+  struct OpenFile {
+    /**
+     * Opens the file.
+     *
+     * @param filename  Name of the file.
+     * @param create_new  Whether to truncate the file.
+     */
+    OpenFile(const std::string& filename, const bool create_new);
+
+    /**
+     * Closes the file.
+     */
+    ~OpenFile();
+
+    /**
+     * Descriptor of the file.
+     */
+    int fd;
+
+    /**
+     * Lock serializing changes to the structure of the file: its header, the
+     * links between pages and, in subclasses, the page directory or table.
+     */
+    std::mutex mutex;
+  };
+
+  typedef std::map<std::string, std::shared_ptr<OpenFile> > OpenFileMap;
   typedef std::map<std::string, int> CountMap;
 
   /**
-   * Streams for opened files.
+   * Descriptors of opened files.
    */
-  static StreamMap open_streams_;
+  static OpenFileMap open_files_;
 
   /**
    * Counts for opened files.
    */
   static CountMap open_counts_;
 
+  /**
+   * Number of pages reserved at a time when a file grows.
+   */
+  static PageId extent_pages_;
+
   /**
    * Name of the file this object represents.
    */
   std::string filename_;
 
   /**
-   * Stream for underlying filesystem object.
+   * Descriptor of the underlying filesystem object.
    */
-  std::shared_ptr<std::fstream> stream_;
+  std::shared_ptr<OpenFile> open_file_;
 
   friend class FileIterator;
 };
 
+/**
+ * @brief File of slotted pages, chained together in a list of used pages and a
+ *        list of free pages.
+ *
+ * Which pages are in use is also recorded in a PageDirectory stored inside the
+ * file, so the used pages can be found in bulk and a page's neighbours in the
+ * used list can be found without walking the list.
+ */
 class PageFile : public File {
  public:
 
@@ -249,10 +444,10 @@ class PageFile : public File {
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
-	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
+	 * It first checks if the file is already open. If so, then the new File object created uses the same descriptor to read from or write to
 	 * that already open file. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
-	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
-	 * open_streams_ map.
+	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the descriptor associated with this File object are inserted into the
+	 * open_files_ map.
    *
    * @param filename  Name of the file.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
@@ -319,6 +514,18 @@ class PageFile : public File {
    */
   void writePage(const PageId page_number, const Page& new_page);
 
+  /**
+   * Writes consecutive pages into the file with a single write, starting at
+   * the given page number.  Every page is checked before any is written.
+   *
+   * @param first_page_number Number of the first page whose contents to replace.
+   * @param pages             Pages to write, in page number order.
+   * @throws  InvalidPageException  If any of the pages is a directory page or
+   *                                is not currently used.
+   */
+  void writePages(const PageId first_page_number,
+                  const std::vector<const Page*>& pages);
+
   /**
    * Deletes a page from the file.
    *
@@ -333,6 +540,16 @@ class PageFile : public File {
    */
   FileIterator begin();
 
+  /**
+   * Returns an iterator at the first used page numbered <start_page> or
+   * higher.  Iterators started at different pages can be used to split a
+   * scan of the file into ranges of page numbers.
+   *
+   * @param start_page  Number of page to start at.
+   * @return  Iterator at the first used page at or after <start_page>.
+   */
+  FileIterator begin(const PageId start_page);
+
   /**
    * Returns an iterator representing the page after the last page in the file.
    * This iterator should not be dereferenced.
@@ -347,8 +564,8 @@ class PageFile : public File {
    * Reads a page from the file.  If <allow_free> is not set, an exception
    * will be thrown if the page read from disk is not currently in use.
    *
-   * No bounds checking is performed; the underlying file stream will throw
-   * an exception if the page is past the end of the file.
+   * No bounds checking is performed; a page past the end of the file reads
+   * as zeroes.
    *
    * @param page_number   Number of page to read.
    * @param allow_free    Whether to allow reading a free (unused) page.
@@ -379,6 +596,43 @@ class PageFile : public File {
    */
   PageHeader readPageHeader(const PageId page_number) const;
 
+  /**
+   * Writes only the header of the given page to disk.  No bounds checking is
+   * performed.
+   *
+   * @param page_number   Number of page whose header is to be written.
+   * @param header        Header to write.
+   */
+  void writePageHeader(const PageId page_number, const PageHeader& header);
+
+  /**
+   * Shares the page directory with other open PageFile objects for the same
+   * file, reading it from disk if there are none.
+   *
+   * @param create_new  Whether the file was just created.
+   */
+  void openDirectory(const bool create_new);
+
+  /**
+   * Marks a page as used or unused in the page directory and on disk.
+   *
+   * @param page_number   Number of page.
+   * @param used          Whether the page is in use.
+   */
+  void setPageUsed(const PageId page_number, const bool used);
+
+  /**
+   * Directory of the pages in use in this file.
+   */
+  std::shared_ptr<PageDirectory> directory_;
+
+  typedef std::map<std::string, std::weak_ptr<PageDirectory> > DirectoryMap;
+
+  /**
+   * Page directories of open files.
+   */
+  static DirectoryMap directories_;
+
   friend class FileIterator;
 };
 
@@ -388,17 +642,19 @@ class BlobFile : public File {
   /**
    * Creates a new BlobFile.
    *
-   * @param filename  Name of the file.
+   * @param filename    Name of the file.
+   * @param compressed  Whether to store the pages of the file compressed.
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static BlobFile create(const std::string& filename);
+  static BlobFile create(const std::string& filename,
+                         const bool compressed = false);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
-	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
+	 * It first checks if the file is already open. If so, then the new File object created uses the same descriptor to read from or write to
 	 * that already open file. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
-	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
-	 * open_streams_ map.
+	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the descriptor associated with this File object are inserted into the
+	 * open_files_ map.
    *
    * @param filename  Name of the file.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
@@ -408,16 +664,24 @@ class BlobFile : public File {
   /**
    * Constructs a file object representing a file on the filesystem.
    *
+   * A compressed file stores every page compressed with PageCodec, wherever
+   * there is room for it, and keeps a page table mapping page numbers to
+   * their location.  Callers still read and write whole uncompressed pages.
+   * Whether an existing file is compressed is recorded in its header, so
+   * <compressed> only matters when creating a file.
+   *
    * @see File::create()
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param compressed  Whether a newly created file stores pages compressed.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  BlobFile(const std::string& name, const bool create_new);
+  BlobFile(const std::string& name, const bool create_new,
+           const bool compressed = false);
 
   /**
    * Copy constructor.
@@ -455,15 +719,18 @@ class BlobFile : public File {
    * @return  The page.
    * @throws  InvalidPageException  If the page doesn't exist in the file or is
    *                                not currently used.
+   * @throws  BadPageFormatException  If a compressed page is corrupt.
    */
   Page readPage(const PageId page_number) const;
 
   /**
    * Writes a page into the file at the given page number.
-   * No bounds checking is performed.
+   * No bounds checking is performed on uncompressed files.
    *
    * @param page_number Number of page whose contents to replace.
    * @param new_page    Page to write.
+   * @throws  InvalidPageException  If the file is compressed and the page
+   *                                doesn't exist in it.
    */
   void writePage(const PageId page_number, const Page& new_page);
 
@@ -473,6 +740,74 @@ class BlobFile : public File {
    * @param page_number   Number of page to delete.
    */
   void deletePage(const PageId page_number);
+
+  /**
+   * Returns true if the pages of this file are stored compressed.
+   */
+  bool isCompressed() const { return page_table_ != nullptr; }
+
+ private:
+  /**
+   * Number of page table entries kept in each chunk of the table.
+   */
+  static const std::size_t ENTRIES_PER_CHUNK = 512;
+
+  /**
+   * @brief Page table of a compressed file, kept in memory while it is open.
+   *
+   * On disk the table is a linked list of chunks, each holding the position
+   * of the next chunk followed by ENTRIES_PER_CHUNK entries.  The first chunk
+   * comes straight after the file header; the others are appended to the file
+   * as it grows.
+   */
+  struct PageTable {
+    /**
+     * Location of every page, indexed by page number - 1.
+     */
+    std::vector<PageTableEntry> entries;
+
+    /**
+     * Position of every chunk of the table in the file.
+     */
+    std::vector<std::uint64_t> chunk_offsets;
+  };
+
+  /**
+   * Shares the page table with other open BlobFile objects for the same file,
+   * reading it from disk if there are none.
+   */
+  void openPageTable();
+
+  /**
+   * Appends an empty chunk to the page table.
+   */
+  void appendPageTableChunk();
+
+  /**
+   * Writes a page into the file, as writePage() does.  The caller holds the
+   * file's lock if the file is compressed.
+   *
+   * @param page_number Number of page whose contents to replace.
+   * @param new_page    Page to write.
+   */
+  void storePage(const PageId page_number, const Page& new_page);
+
+  /**
+   * Writes the page table entry of the given page to disk.
+   */
+  void writePageTableEntry(const PageId page_number);
+
+  /**
+   * Page table of the file if it is compressed; null otherwise.
+   */
+  std::shared_ptr<PageTable> page_table_;
+
+  typedef std::map<std::string, std::weak_ptr<PageTable> > PageTableMap;
+
+  /**
+   * Page tables of open compressed files.
+   */
+  static PageTableMap page_tables_;
 };
 
 }
@@ -8,8 +8,11 @@
 #pragma once
 
 #include <cassert>
+#include <memory>
+#include <vector>
 #include "file.h"
 #include "page.h"
+#include "pagedirectory.h"
 #include "types.h"
 
 namespace badgerdb {
@@ -18,16 +21,25 @@ namespace badgerdb {
  * @brief Iterator for iterating over the pages in a file.
  *
  * This class provides a forward-only iterator for iterating over all of the
- * pages in a file.
+ * pages in a file, in order of page number.  The numbers of the used pages
+ * are taken from the file's page directory a batch at a time, so advancing
+ * the iterator does not touch the disk.  Copies of an iterator share the
+ * batch they were made from.
  */
 class FileIterator {
  public:
+  /**
+   * Number of page numbers fetched from the page directory at a time.
+   */
+  static const std::size_t BATCH_SIZE = 256;
+
   /**
    * Constructs an empty iterator.
    */
   FileIterator()
       : file_(NULL),
-        current_page_number_(Page::INVALID_NUMBER) {
+        current_page_number_(Page::INVALID_NUMBER),
+        batch_index_(0) {
   }
 
   /**
@@ -37,22 +49,27 @@ class FileIterator {
    * @param file  File to iterate over.
    */
   FileIterator(PageFile* file)
-      : file_(file) {
+      : file_(file),
+        batch_index_(0) {
     assert(file_ != NULL);
-    const FileHeader& header = file_->readHeader();
-    current_page_number_ = header.first_used_page;
+    fetchBatch(1 /* page_number */);
   }
 
   /**
-   * Constructs an iterator over the pages in a file, starting at the given
-   * page number.
+   * Constructs an iterator over the pages in a file, starting at the first
+   * used page numbered <page_number> or higher.  An invalid page number gives
+   * an iterator at the end of the file.
    *
    * @param file        File to iterate over.
    * @param page_number Number of page to start iterator at.
    */
   FileIterator(PageFile* file, PageId page_number)
       : file_(file),
-        current_page_number_(page_number) {
+        current_page_number_(Page::INVALID_NUMBER),
+        batch_index_(0) {
+    if (page_number != Page::INVALID_NUMBER) {
+      fetchBatch(page_number);
+    }
   }
 
   /**
@@ -60,8 +77,7 @@ class FileIterator {
    */
 	inline FileIterator& operator++() {
     assert(file_ != NULL);
-    const PageHeader& header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
+    advance();
 
 		return *this;
 	}
@@ -72,8 +88,7 @@ class FileIterator {
 		FileIterator tmp = *this;   // copy ourselves
 
     assert(file_ != NULL);
-    const PageHeader& header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
+    advance();
 
 		return tmp;
 	}
@@ -85,25 +100,67 @@ class FileIterator {
    * @return    True if other iterator is equal to this one.
    */
 	inline bool operator==(const FileIterator& rhs) const {
-    return file_->filename() == rhs.file_->filename() &&
-        current_page_number_ == rhs.current_page_number_;
+    return current_page_number_ == rhs.current_page_number_ &&
+        (file_ == rhs.file_ ||
+         (file_ != NULL && rhs.file_ != NULL &&
+          file_->filename() == rhs.file_->filename()));
   }
 
 	inline bool operator!=(const FileIterator& rhs) const {
-    return (file_->filename() != rhs.file_->filename()) ||
-        (current_page_number_ != rhs.current_page_number_);
+    return !(*this == rhs);
   }
 
   /**
    * Dereferences the iterator, returning a copy of the current page in the
-   * file.
+   * file.  Scans that go through the buffer manager should read the page
+   * numbered page_number() from it instead.
    *
    * @return  Page in file.
    */
 	inline Page operator*() const
-  { return file_->readPage(current_page_number_); }
+  { return file_->readPage(current_page_number_, false /* allow_free */); }
+
+  /**
+   * Returns the number of the page the iterator is at.
+   *
+   * @return  Page number, or Page::INVALID_NUMBER at the end of the file.
+   */
+  PageId page_number() const { return current_page_number_; }
 
  private:
+  /**
+   * Replaces the current batch with the used pages starting at the given page
+   * and moves to the first of them.
+   *
+   * @param page_number   Number of first page to consider.
+   */
+  void fetchBatch(const PageId page_number) {
+    std::shared_ptr<std::vector<PageId> > batch(new std::vector<PageId>());
+    batch->reserve(BATCH_SIZE);
+    file_->directory_->usedPages(page_number, BATCH_SIZE, *batch);
+    batch_ = batch;
+    batch_index_ = 0;
+    current_page_number_ =
+        batch_->empty() ? Page::INVALID_NUMBER : (*batch_)[0];
+  }
+
+  /**
+   * Moves to the next used page, skipping pages of the current batch that
+   * have been deleted since it was fetched.
+   */
+  void advance() {
+    if (!batch_) {
+      return;
+    }
+    while (++batch_index_ < batch_->size()) {
+      current_page_number_ = (*batch_)[batch_index_];
+      if (file_->directory_->isUsed(current_page_number_)) {
+        return;
+      }
+    }
+    fetchBatch(batch_->empty() ? Page::INVALID_NUMBER : batch_->back() + 1);
+  }
+
   /**
    * File we're iterating over.
    */
@@ -113,6 +170,16 @@ class FileIterator {
    * Number of page in file iterator is currently pointing to.
    */
   PageId current_page_number_;
+
+  /**
+   * Numbers of the used pages fetched most recently from the page directory.
+   */
+  std::shared_ptr<const std::vector<PageId> > batch_;
+
+  /**
+   * Position of the current page in <batch_>.
+   */
+  std::size_t batch_index_;
 };
 
 }
@@ -14,58 +14,61 @@ FileScan::FileScan(const std::string &name, BufMgr *bufferMgr)
 {
   file = new PageFile(name, false);	//dont create new file
 	bufMgr = bufferMgr;
-	curDirtyFlag = false;
-  curPage = NULL;
 	filePageIter = file->begin();
+  readAheadPages = 0;
 }
 
 FileScan::~FileScan()
 {
   // generally must unpin last page of the scan
-  if (curPage != NULL)
-  {
-    bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
-    curPage = NULL;
-		curDirtyFlag = false;
-    filePageIter = file->begin();
-  }
+  curPage.release();
   bufMgr->flushFile(file);
   delete file;
 }
 
 void FileScan::scanNext(RecordId& outRid)
+{
+  if (!tryScanNext(outRid))
+  {
+    throw EndOfFileException();
+  }
+}
+
+bool FileScan::tryScanNext(RecordId& outRid)
 {
   std::string rec;
 
   if (filePageIter == file->end())
 	{
-		throw EndOfFileException();
+		return false;
 	}
 
   // special case of the first record of the first page of the file
-  if (curPage == NULL)
+  if (!curPage)
   {
     // need to get the first page of the file
 		filePageIter = file->begin();
     if(filePageIter == file->end())
 		{
-			throw EndOfFileException();
+			return false;
 		}
 	 
 		// read the first page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage); 
-		curDirtyFlag = false;
+    readAheadIter = filePageIter;
+    readAheadPages = 0;
+    readAhead();
+    curPage = bufMgr->readPage(file, filePageIter.page_number(), ACCESS_SEQUENTIAL, &ring);
 
 		// get the first record off the page
-    pageRecordIter = curPage->begin(); 
+    pageRecordIter = curPage.get()->begin(); 
 
-		if(pageRecordIter != curPage->end()) 
+		if(pageRecordIter != curPage.get()->end()) 
 		{
 		  // get pointer to record
 		  rec = *pageRecordIter;
 
 			outRid = pageRecordIter.getCurrentRecord();
-			return;
+			return true;
 		}
   }
 
@@ -73,25 +76,25 @@ void FileScan::scanNext(RecordId& outRid)
 	// First try and get the next record off the current page
 	pageRecordIter++;
 
-  while (pageRecordIter == curPage->end())
+  while (pageRecordIter == curPage.get()->end())
   {
     // unpin the current page
-    bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
-    curPage = NULL;
-    curDirtyFlag = false;
+    curPage.release();
 
     filePageIter++;
     if (filePageIter == file->end())
     {
-      curPage = NULL;
-			throw EndOfFileException();
+			return false;
     }
 
     // read the next page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage);
+    if (readAheadPages > 0)
+      readAheadPages--;
+    readAhead();
+    curPage = bufMgr->readPage(file, filePageIter.page_number(), ACCESS_SEQUENTIAL, &ring);
 
     // get the first record off the page
-    pageRecordIter = curPage->begin(); 
+    pageRecordIter = curPage.get()->begin(); 
   }
 
   // curRec points at a valid record
@@ -101,7 +104,7 @@ void FileScan::scanNext(RecordId& outRid)
 
 	// return rid of the record
 	outRid = pageRecordIter.getCurrentRecord();
-	return;
+	return true;
 }
 
 // returns pointer to the current record.  page is left pinned
@@ -111,10 +114,24 @@ std::string FileScan::getRecord()
   return *pageRecordIter;
 }
 
+void FileScan::readAhead()
+{
+  std::vector<PageId> pageNos;
+  while (readAheadPages < READ_AHEAD && readAheadIter != file->end())
+  {
+    readAheadIter++;
+    if (readAheadIter == file->end())
+      break;
+    pageNos.push_back(readAheadIter.page_number());
+    readAheadPages++;
+  }
+  bufMgr->prefetch(file, pageNos, &ring);
+}
+
 // mark current page of scan dirty
 void FileScan::markDirty()
 {
-  curDirtyFlag = true;
+  curPage.markDirty();
 }
 
 }
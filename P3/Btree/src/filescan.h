@@ -29,15 +29,29 @@ class FileScan
   ~FileScan();
 
   //return RecordId of next record that satisfies the scan 
+  //throws EndOfFileException when there are no more records
   void scanNext(RecordId& outRid);
 
+  //return RecordId of next record that satisfies the scan, or false when there are no more records
+  bool tryScanNext(RecordId& outRid);
+
   //read current record, returning pointer and length
   std::string getRecord();
 
   //marks current page of scan dirty
   void markDirty();
 
+  /**
+   * Number of pages the scan asks the buffer manager to read ahead of the page it is on.
+   */
+  static const std::uint32_t READ_AHEAD = 8;
+
  private:
+  /**
+   * Asks the buffer manager to read the pages following the current one, up to READ_AHEAD of them.
+   */
+  void readAhead();
+
   /**
    * File which is being scanned.
    */
@@ -49,17 +63,27 @@ class FileScan
 	BufMgr				*bufMgr;
 
   /**
-   * Current page being scanned.
+   * Current page being scanned, pinned until the scan moves off it.  Marked dirty if the page has been updated.
    */
-  Page*         curPage;
+  PageHandle    curPage;
 
   FileIterator  filePageIter;
+
+  /**
+   * Last page asked to be read ahead, at most READ_AHEAD pages in front of filePageIter.
+   */
+  FileIterator  readAheadIter;
+
+  /**
+   * Number of pages between filePageIter and readAheadIter.
+   */
+  std::uint32_t readAheadPages;
   PageIterator  pageRecordIter;
 
   /**
-   * True if page has been updated
+   * Frames the scan reads pages into, so scanning a large file leaves the rest of the buffer pool alone.
    */
-  bool  	      curDirtyFlag;
+  BufferRing    ring;
 };
 
 }
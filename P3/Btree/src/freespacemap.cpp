@@ -0,0 +1,176 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "freespacemap.h"
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_set>
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Opens the map file, discarding any previous map if create_new is set.
+ */
+BlobFile openMapFile(const std::string& filename, const bool create_new) {
+  if (create_new && File::exists(filename)) {
+    File::remove(filename);
+  }
+  return BlobFile(filename, create_new);
+}
+
+}
+
+const std::uint8_t FreeSpaceMap::NUM_CATEGORIES;
+const std::size_t FreeSpaceMap::CATEGORY_BYTES;
+
+FreeSpaceMap::FreeSpaceMap(const std::string& relation_name,
+                           const bool create_new)
+    : file_(openMapFile(mapFileName(relation_name), create_new)),
+      dirty_(false) {
+  std::fill(num_pages_, num_pages_ + NUM_CATEGORIES, 0);
+  const PageId num_pages = file_.getNumPages();
+  entries_.resize((num_pages - 1) * Page::SIZE, 0);
+  for (PageId page_number = 1; page_number < num_pages; ++page_number) {
+    const Page page = file_.readPage(page_number);
+    std::memcpy(&entries_[(page_number - 1) * Page::SIZE],
+                reinterpret_cast<const char*>(&page), Page::SIZE);
+  }
+
+  // Seed the candidate stacks with every page that has any room.
+  for (PageId page_number = 1; page_number < entries_.size() * 2;
+       ++page_number) {
+    const std::uint8_t category = getCategory(page_number);
+    if (category > 0) {
+      candidates_[category].push_back(page_number);
+      ++num_pages_[category];
+    }
+  }
+}
+
+FreeSpaceMap::~FreeSpaceMap() {
+  flush();
+}
+
+std::uint8_t FreeSpaceMap::categoryFor(const std::size_t free_bytes) {
+  if (free_bytes >= Page::DATA_SIZE) {
+    return NUM_CATEGORIES - 1;
+  }
+  const std::size_t category = free_bytes / CATEGORY_BYTES;
+  return category < NUM_CATEGORIES - 1 ? category : NUM_CATEGORIES - 2;
+}
+
+std::uint8_t FreeSpaceMap::getCategory(const PageId page_number) const {
+  const std::size_t index = page_number / 2;
+  if (index >= entries_.size()) {
+    return 0;
+  }
+  return (page_number % 2 == 0) ? (entries_[index] & 0x0F)
+                                : (entries_[index] >> 4);
+}
+
+void FreeSpaceMap::setCategory(const PageId page_number,
+                               const std::uint8_t category) {
+  const std::size_t index = page_number / 2;
+  if (index >= entries_.size()) {
+    entries_.resize(index + 1, 0);
+  }
+  const std::uint8_t old_category = getCategory(page_number);
+  if (old_category > 0) {
+    --num_pages_[old_category];
+  }
+  if (category > 0) {
+    ++num_pages_[category];
+  }
+  if (page_number % 2 == 0) {
+    entries_[index] = (entries_[index] & 0xF0) | category;
+  } else {
+    entries_[index] = (entries_[index] & 0x0F) | (category << 4);
+  }
+  dirty_ = true;
+}
+
+void FreeSpaceMap::update(const PageId page_number,
+                          const std::size_t free_bytes) {
+  const std::uint8_t category = categoryFor(free_bytes);
+  if (category == getCategory(page_number)) {
+    return;
+  }
+  setCategory(page_number, category);
+  if (category > 0) {
+    std::vector<PageId>& stack = candidates_[category];
+    stack.push_back(page_number);
+    // findPage() only drops the stale entries it comes across, which it may
+    // never do for a category that is rarely asked for.
+    if (stack.size() > 2 * num_pages_[category]) {
+      compact(category);
+    }
+  }
+}
+
+PageId FreeSpaceMap::findPage(const std::size_t bytes) {
+  // Round up so that any page in the chosen category is guaranteed to have
+  // the requested room, and prefer the fullest page that fits.
+  std::size_t category = (bytes + CATEGORY_BYTES - 1) / CATEGORY_BYTES;
+  if (category == 0) {
+    category = 1;
+  } else if (category > NUM_CATEGORIES - 2) {
+    // Only an empty page is sure to have room for more.
+    category = NUM_CATEGORIES - 1;
+  }
+  for (; category < NUM_CATEGORIES; ++category) {
+    std::vector<PageId>& stack = candidates_[category];
+    while (!stack.empty()) {
+      if (getCategory(stack.back()) == category) {
+        return stack.back();
+      }
+      stack.pop_back();
+    }
+  }
+  return Page::INVALID_NUMBER;
+}
+
+void FreeSpaceMap::compact(const std::uint8_t category) {
+  // Walk the stack from the top, so the most recent entry of a page is the
+  // one kept.
+  std::vector<PageId>& stack = candidates_[category];
+  std::unordered_set<PageId> seen;
+  std::vector<PageId> live;
+  live.reserve(num_pages_[category]);
+  for (std::vector<PageId>::reverse_iterator iter = stack.rbegin();
+       iter != stack.rend(); ++iter) {
+    if (getCategory(*iter) == category && seen.insert(*iter).second) {
+      live.push_back(*iter);
+    }
+  }
+  std::reverse(live.begin(), live.end());
+  stack.swap(live);
+}
+
+void FreeSpaceMap::flush() {
+  if (!dirty_) {
+    return;
+  }
+  const std::size_t num_map_pages =
+      (entries_.size() + Page::SIZE - 1) / Page::SIZE;
+  entries_.resize(num_map_pages * Page::SIZE, 0);
+  while (file_.getNumPages() - 1 < num_map_pages) {
+    PageId new_page_number;
+    file_.allocatePage(new_page_number);
+  }
+  for (PageId page_number = 1; page_number <= num_map_pages; ++page_number) {
+    Page page;
+    std::memcpy(reinterpret_cast<char*>(&page),
+                &entries_[(page_number - 1) * Page::SIZE], Page::SIZE);
+    file_.writePage(page_number, page);
+  }
+  dirty_ = false;
+}
+
+}
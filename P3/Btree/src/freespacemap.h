@@ -0,0 +1,154 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Tracks approximately how much free space each page of a relation has.
+ *
+ * Every page of the relation is summarised by a 4-bit category: category c
+ * means the page has at least c * CATEGORY_BYTES bytes free, except for the
+ * top category, which holds the empty pages, so a record too large for the
+ * other categories still finds one.  The categories
+ * are packed two to a byte and persisted in a BlobFile next to the relation
+ * (the relation name with ".fsm" appended), so a map for a 16000 page relation
+ * fits in a single page.
+ *
+ * The map is only a hint.  Callers must check that the page they are handed
+ * really has room and call update() with the true amount of free space if it
+ * does not, which corrects the map for the next lookup.
+ *
+ * To find a page quickly, each category keeps a stack of the pages that were
+ * last placed into it.  Entries are not removed when a page changes category;
+ * they are discarded lazily when found to be stale, and a stack is compacted
+ * once its stale entries outnumber the live ones, so both update() and
+ * findPage() run in amortised constant time and the stacks stay in proportion
+ * to the relation.
+ *
+ * @warning This class is not threadsafe.
+ */
+class FreeSpaceMap {
+ public:
+  /**
+   * Number of distinct free space categories a page can be in.
+   */
+  static const std::uint8_t NUM_CATEGORIES = 16;
+
+  /**
+   * Number of free bytes covered by one category step.
+   */
+  static const std::size_t CATEGORY_BYTES = Page::DATA_SIZE / NUM_CATEGORIES;
+
+  /**
+   * Returns the name of the file the map for the given relation lives in.
+   *
+   * @param relation_name  Name of the relation file.
+   * @return  Name of the free space map file.
+   */
+  static std::string mapFileName(const std::string& relation_name) {
+    return relation_name + ".fsm";
+  }
+
+  /**
+   * Opens the free space map of a relation, creating an empty one if
+   * create_new is set.  Any existing map file is replaced in that case.
+   *
+   * @param relation_name  Name of the relation file the map describes.
+   * @param create_new     Whether to start with an empty map.
+   * @throws  FileNotFoundException  If the map file doesn't exist and
+   *                                 create_new is false.
+   */
+  FreeSpaceMap(const std::string& relation_name, const bool create_new);
+
+  /**
+   * Writes the map back to disk and closes its file.
+   */
+  ~FreeSpaceMap();
+
+  /**
+   * Records the amount of free space currently available on a page.
+   *
+   * @param page_number  Number of the page in the relation.
+   * @param free_bytes   Bytes free on the page.
+   */
+  void update(const PageId page_number, const std::size_t free_bytes);
+
+  /**
+   * Returns a page believed to have at least the given number of bytes free,
+   * or Page::INVALID_NUMBER if no page is known to have that much room.
+   *
+   * @param bytes  Number of free bytes needed.
+   * @return  Candidate page number.
+   */
+  PageId findPage(const std::size_t bytes);
+
+  /**
+   * Writes the map to its file on disk.
+   */
+  void flush();
+
+ private:
+  /**
+   * Returns the category a page with the given free space belongs in.
+   * Rounds down, so a page is never reported as having more room than it has.
+   * Only an empty page goes into the top category.
+   */
+  static std::uint8_t categoryFor(const std::size_t free_bytes);
+
+  /**
+   * Returns the category of the given page, zero for pages never recorded.
+   */
+  std::uint8_t getCategory(const PageId page_number) const;
+
+  /**
+   * Sets the category of the given page, growing the map if needed.
+   */
+  void setCategory(const PageId page_number, const std::uint8_t category);
+
+  /**
+   * Drops the stale and duplicate entries from the candidate stack of a
+   * category, keeping the live ones in their order.
+   */
+  void compact(const std::uint8_t category);
+
+  /**
+   * Categories of all pages, two 4-bit entries per byte.
+   */
+  std::vector<std::uint8_t> entries_;
+
+  /**
+   * Candidate pages for every category; may contain stale entries.
+   */
+  std::vector<PageId> candidates_[NUM_CATEGORIES];
+
+  /**
+   * Number of pages in every category.  Not kept for category zero, which
+   * also holds the pages beyond the end of the map.
+   */
+  std::size_t num_pages_[NUM_CATEGORIES];
+
+  /**
+   * File the map is persisted in.
+   */
+  BlobFile file_;
+
+  /**
+   * True if the map has changed since it was last written out.
+   */
+  bool dirty_;
+};
+
+}
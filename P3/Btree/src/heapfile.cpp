@@ -0,0 +1,160 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "heapfile.h"
+#include "file_iterator.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/invalid_page_exception.h"
+
+namespace badgerdb {
+
+HeapFile::HeapFile(const std::string &name, BufMgr *bufferMgr)
+{
+	bufMgr = bufferMgr;
+	if (File::exists(name))
+	{
+		file = new PageFile(name, false);	//dont create new file
+		bufMgr->warmUp(file);
+		if (File::exists(FreeSpaceMap::mapFileName(name)))
+		{
+			freeSpaceMap = new FreeSpaceMap(name, false);
+		}
+		else
+		{
+			freeSpaceMap = new FreeSpaceMap(name, true);
+			rebuildFreeSpaceMap();
+		}
+	}
+	else
+	{
+		file = new PageFile(name, true);
+		// a map left behind by an earlier relation of the same name is stale
+		freeSpaceMap = new FreeSpaceMap(name, true);
+	}
+}
+
+HeapFile::~HeapFile()
+{
+	bufMgr->flushFile(file);
+	delete freeSpaceMap;
+	delete file;
+}
+
+void HeapFile::remove(const std::string &name)
+{
+	File::remove(name);
+	if (File::exists(FreeSpaceMap::mapFileName(name)))
+	{
+		File::remove(FreeSpaceMap::mapFileName(name));
+	}
+}
+
+void HeapFile::rebuildFreeSpaceMap()
+{
+	for (FileIterator iter = file->begin(); iter != file->end(); ++iter)
+	{
+		const Page page = *iter;
+		freeSpaceMap->update(page.page_number(), page.getFreeSpace());
+	}
+}
+
+namespace {
+
+/**
+ * Returns the space a record needs on a page.  Asking for room for a new slot
+ * as well keeps the request conservative; the page may be able to reuse a free
+ * slot instead.
+ */
+std::size_t spaceNeeded(const std::string &record_data)
+{
+	const std::size_t needed = record_data.length() + sizeof(PageSlot);
+	if (needed > Page::DATA_SIZE)
+	{
+		throw InsufficientSpaceException(Page::INVALID_NUMBER, record_data.length(),
+				Page::DATA_SIZE - sizeof(PageSlot));
+	}
+	return needed;
+}
+
+}
+
+PageHandle HeapFile::pinPageWithSpace(const std::size_t bytes)
+{
+	PageId pageNo = freeSpaceMap->findPage(bytes);
+	while (pageNo != Page::INVALID_NUMBER)
+	{
+		PageHandle page;
+		try
+		{
+			page = bufMgr->readPage(file, pageNo);
+		}
+		catch (const InvalidPageException&)
+		{
+			// the map outlived the page; forget about it
+			freeSpaceMap->update(pageNo, 0);
+			pageNo = freeSpaceMap->findPage(bytes);
+			continue;
+		}
+
+		if (page.get()->getFreeSpace() >= bytes)
+		{
+			return page;
+		}
+
+		// the map was out of date for this page; correct it and look again
+		freeSpaceMap->update(pageNo, page.get()->getFreeSpace());
+		pageNo = freeSpaceMap->findPage(bytes);
+	}
+
+	// no existing page has room, so the caller gets a fresh page
+	return bufMgr->allocPage(file, pageNo);
+}
+
+RecordId HeapFile::insertRecord(const std::string &record_data)
+{
+	PageHandle page = pinPageWithSpace(spaceNeeded(record_data));
+	RecordId rid = page.write()->insertRecord(record_data);
+	freeSpaceMap->update(page.pageNumber(), page.get()->getFreeSpace());
+	return rid;
+}
+
+std::vector<RecordId> HeapFile::insertRecords(const std::vector<std::string> &records)
+{
+	// check every record up front so that a bad one can't leave the batch half done
+	for (std::size_t i = 0; i < records.size(); i++)
+	{
+		spaceNeeded(records[i]);
+	}
+
+	std::vector<RecordId> rids;
+	rids.reserve(records.size());
+	std::size_t next = 0;
+	while (next < records.size())
+	{
+		// the page has room for at least the next record, so every pass makes progress
+		PageHandle page = pinPageWithSpace(spaceNeeded(records[next]));
+		next += page.write()->insertRecords(records, next, rids);
+		freeSpaceMap->update(page.pageNumber(), page.get()->getFreeSpace());
+	}
+	return rids;
+}
+
+void HeapFile::deleteRecord(const RecordId &rid)
+{
+	PageHandle page = bufMgr->readPage(file, rid.page_number);
+	page.get()->deleteRecord(rid);
+	page.markDirty();
+	freeSpaceMap->update(rid.page_number, page.get()->getFreeSpace());
+}
+
+std::string HeapFile::getRecord(const RecordId &rid)
+{
+	PageHandle page = bufMgr->readPage(file, rid.page_number);
+	return page.get()->getRecord(rid);
+}
+
+}
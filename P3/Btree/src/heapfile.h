@@ -0,0 +1,125 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "types.h"
+#include "page.h"
+#include "buffer.h"
+#include "freespacemap.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An unordered relation of records stored in a PageFile.
+ *
+ * Pages are read and written through the buffer manager.  A FreeSpaceMap kept
+ * alongside the relation is used to pick a page with enough room for each
+ * inserted record, so space freed by deletes is reused without scanning the
+ * file and new pages are only allocated when no existing page fits.
+ */
+class HeapFile
+{
+ public:
+
+  /**
+   * Opens the relation with the given name, creating it if it doesn't exist.
+   * If the relation exists but its free space map doesn't, the map is rebuilt
+   * from the pages of the relation.
+   *
+   * @param name    Name of the relation file.
+   * @param bufMgr  Buffer manager used to read and write pages.
+   */
+  HeapFile(const std::string &name, BufMgr *bufMgr);
+
+  /**
+   * Flushes the relation's pages and free space map to disk.
+   */
+  ~HeapFile();
+
+  /**
+   * Deletes a relation along with its free space map.
+   *
+   * @param name  Name of the relation file.
+   * @throws  FileNotFoundException   If the relation doesn't exist.
+   * @throws  FileOpenException       If the relation is currently open.
+   */
+  static void remove(const std::string &name);
+
+  /**
+   * Inserts a record into the relation.
+   *
+   * @param record_data  Bytes of the record.
+   * @return  ID of the record.
+   * @throws  InsufficientSpaceException  If the record doesn't fit on an empty
+   *                                      page.
+   */
+  RecordId insertRecord(const std::string &record_data);
+
+  /**
+   * Inserts a batch of records into the relation.  Each page the records go
+   * to is pinned once and filled with Page::insertRecords.
+   *
+   * @param records  Records to insert.
+   * @return  IDs of the records, in the same order as <records>.
+   * @throws  InsufficientSpaceException  If any record doesn't fit on an empty
+   *                                      page.  Nothing is inserted then.
+   */
+  std::vector<RecordId> insertRecords(const std::vector<std::string> &records);
+
+  /**
+   * Deletes a record from the relation.  The space it used becomes available
+   * to later inserts.
+   *
+   * @param rid  ID of the record to delete.
+   * @throws  InvalidRecordException  If the record doesn't exist.
+   */
+  void deleteRecord(const RecordId &rid);
+
+  /**
+   * Returns a copy of a record in the relation.
+   *
+   * @param rid  ID of the record.
+   * @return  Bytes of the record.
+   * @throws  InvalidRecordException  If the record doesn't exist.
+   */
+  std::string getRecord(const RecordId &rid);
+
+ private:
+  /**
+   * Rebuilds the free space map by reading every page of the relation.
+   */
+  void rebuildFreeSpaceMap();
+
+  /**
+   * Pins a page that has at least the given number of bytes free.  A new page
+   * is allocated if the free space map doesn't know of one.
+   *
+   * @param bytes   Number of free bytes needed.
+   * @return  Handle holding the pin on the page.
+   */
+  PageHandle pinPageWithSpace(const std::size_t bytes);
+
+  /**
+   * File holding the records.
+   */
+  PageFile      *file;
+
+  /**
+   * Buffer Manager instance used to read/write pages into/from buffer pool.
+   */
+	BufMgr				*bufMgr;
+
+  /**
+   * Free space available on each page of the file.
+   */
+  FreeSpaceMap  *freeSpaceMap;
+};
+
+}
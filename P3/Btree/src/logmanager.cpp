@@ -0,0 +1,320 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "logmanager.h"
+
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <utility>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/log_io_exception.h"
+
+namespace badgerdb {
+
+const std::uint8_t LogManager::PAGE_IMAGE;
+const std::uint8_t LogManager::PAGE_FREED;
+const std::uint8_t LogManager::COMMIT;
+const std::uint8_t LogManager::PAGE_FILE;
+const std::uint8_t LogManager::BLOB_FILE;
+
+namespace {
+
+/**
+ * Reads the whole log file into <contents>.
+ */
+bool readLog(const int fd, std::string& contents) {
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    return false;
+  }
+  contents.resize(st.st_size);
+  std::size_t done = 0;
+  while (done < contents.size()) {
+    const ssize_t n = ::pread(fd, &contents[done], contents.size() - done, done);
+    if (n <= 0) {
+      return false;
+    }
+    done += n;
+  }
+  return true;
+}
+
+}
+
+LogManager::LogManager(const std::string& name, const std::uint32_t group_size,
+                       const std::uint32_t group_wait_us)
+    : name_(name),
+      group_size_(group_size == 0 ? 1 : group_size),
+      group_wait_us_(group_wait_us),
+      pending_commits_(0),
+      next_lsn_(1),
+      flushed_lsn_(1),
+      num_flushes_(0),
+      flushing_(false) {
+  fd_ = ::open(name_.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (fd_ < 0) {
+    throw LogIOException(name_, "open");
+  }
+  // Find the end of the intact records so new ones follow them, and drop any
+  // torn record left by a crash.
+  std::string contents;
+  if (!readLog(fd_, contents)) {
+    ::close(fd_);
+    throw LogIOException(name_, "read");
+  }
+  std::size_t offset = 0;
+  while (offset + sizeof(LogRecordHeader) <= contents.size()) {
+    LogRecordHeader header;
+    memcpy(&header, &contents[offset], sizeof(header));
+    if (header.length < sizeof(header) ||
+        header.length > contents.size() - offset) {
+      break;
+    }
+    const std::uint32_t stored = header.checksum;
+    header.checksum = 0;
+    memcpy(&contents[offset], &header, sizeof(header));
+    if (checksum(&contents[offset], header.length) != stored) {
+      break;
+    }
+    next_lsn_ = header.lsn + header.length;
+    offset += header.length;
+  }
+  if (offset != contents.size() && ::ftruncate(fd_, offset) != 0) {
+    ::close(fd_);
+    throw LogIOException(name_, "truncate");
+  }
+  flushed_lsn_ = next_lsn_;
+}
+
+LogManager::~LogManager() {
+  try {
+    flush();
+  } catch (const LogIOException&) {
+  }
+  ::close(fd_);
+}
+
+Lsn LogManager::logPage(const File* file, const PageId page_number,
+                        const Page& page) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return append(PAGE_IMAGE, file, page_number, &page);
+}
+
+Lsn LogManager::logPageFreed(const File* file, const PageId page_number) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const Lsn lsn = append(PAGE_FREED, file, page_number, NULL);
+  force(lsn, lock);
+  return lsn;
+}
+
+Lsn LogManager::commit() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const Lsn lsn = append(COMMIT, NULL, Page::INVALID_NUMBER, NULL);
+  if (++pending_commits_ < group_size_) {
+    // Give the rest of the group the chance to join before forcing the log
+    // for a partial group.
+    flushed_cond_.wait_for(lock, std::chrono::microseconds(group_wait_us_),
+                           [this, lsn]() { return flushed_lsn_ > lsn; });
+  }
+  force(lsn, lock);
+  return lsn;
+}
+
+void LogManager::flush(const Lsn lsn) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  force(lsn, lock);
+}
+
+void LogManager::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  force(next_lsn_, lock);
+}
+
+Lsn LogManager::getFlushedLsn() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return flushed_lsn_;
+}
+
+std::uint64_t LogManager::getNumFlushes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_flushes_;
+}
+
+void LogManager::force(const Lsn lsn, std::unique_lock<std::mutex>& lock) {
+  while (lsn >= flushed_lsn_) {
+    if (flushing_) {
+      // The force under way may cover the record; if not, the next one will.
+      flushed_cond_.wait(lock);
+      continue;
+    }
+    if (buffer_.empty()) {
+      return;
+    }
+
+    // One sequential write and one sync cover every collected record.  The
+    // records are taken out of the buffer so others can be appended meanwhile.
+    std::string records;
+    records.swap(buffer_);
+    const Lsn end = next_lsn_;
+    flushing_ = true;
+    pending_commits_ = 0;
+    lock.unlock();
+    const char* error = NULL;
+    std::size_t done = 0;
+    while (error == NULL && done < records.size()) {
+      const ssize_t n =
+          ::write(fd_, records.data() + done, records.size() - done);
+      if (n <= 0) {
+        error = "write";
+      } else {
+        done += n;
+      }
+    }
+    if (error == NULL && ::fdatasync(fd_) != 0) {
+      error = "sync";
+    }
+    lock.lock();
+
+    flushing_ = false;
+    if (error != NULL) {
+      // Keep the records for the next attempt.
+      buffer_.insert(0, records);
+      flushed_cond_.notify_all();
+      throw LogIOException(name_, error);
+    }
+    flushed_lsn_ = end;
+    ++num_flushes_;
+    flushed_cond_.notify_all();
+  }
+}
+
+void LogManager::truncate() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  force(next_lsn_, lock);
+  if (::ftruncate(fd_, 0) != 0 || ::fdatasync(fd_) != 0) {
+    throw LogIOException(name_, "truncate");
+  }
+}
+
+std::uint32_t LogManager::recover() {
+  flush();
+  std::string contents;
+  if (!readLog(fd_, contents)) {
+    throw LogIOException(name_, "read");
+  }
+
+  // Find the newest record for every page.  The constructor already dropped
+  // any torn tail, so every record is intact.
+  typedef std::map<std::pair<std::string, PageId>, std::size_t> NewestMap;
+  NewestMap newest;
+  std::size_t offset = 0;
+  while (offset + sizeof(LogRecordHeader) <= contents.size()) {
+    LogRecordHeader header;
+    memcpy(&header, &contents[offset], sizeof(header));
+    if (header.type != COMMIT) {
+      const std::string name(&contents[offset + sizeof(header)],
+                             header.name_length);
+      newest[std::make_pair(name, header.page_number)] = offset;
+    }
+    offset += header.length;
+  }
+
+  // Write the pages back a file at a time, in page order.
+  std::uint32_t num_written = 0;
+  std::unique_ptr<File> file;
+  std::string file_name;
+  bool file_missing = false;
+  for (NewestMap::const_iterator iter = newest.begin(); iter != newest.end();
+       ++iter) {
+    LogRecordHeader header;
+    memcpy(&header, &contents[iter->second], sizeof(header));
+    if (iter->first.first != file_name) {
+      if (file) {
+        File::sync(file_name);
+      }
+      file.reset();
+      file_name = iter->first.first;
+      file_missing = false;
+      try {
+        if (header.file_kind == BLOB_FILE) {
+          file.reset(new BlobFile(file_name, false /* create_new */));
+        } else {
+          file.reset(new PageFile(file_name, false /* create_new */));
+        }
+      } catch (const FileNotFoundException&) {
+        file_missing = true;
+      }
+    }
+    if (file_missing || header.type != PAGE_IMAGE) {
+      continue;
+    }
+    Page page;
+    memcpy(reinterpret_cast<char*>(&page),
+           &contents[iter->second + sizeof(header) + header.name_length],
+           Page::SIZE);
+    try {
+      file->writePage(header.page_number, page);
+      ++num_written;
+    } catch (const InvalidPageException&) {
+      // The page was deleted after the image was logged.
+    }
+  }
+  if (file) {
+    File::sync(file_name);
+  }
+  truncate();
+  return num_written;
+}
+
+Lsn LogManager::append(const std::uint8_t type, const File* file,
+                       const PageId page_number, const Page* page) {
+  LogRecordHeader header;
+  memset(&header, 0, sizeof(header));
+  header.lsn = next_lsn_;
+  header.page_number = page_number;
+  header.type = type;
+  if (file != NULL) {
+    header.name_length = file->filename().size();
+    header.file_kind =
+        dynamic_cast<const BlobFile*>(file) != NULL ? BLOB_FILE : PAGE_FILE;
+  }
+  header.length = sizeof(header) + header.name_length +
+                  (page != NULL ? Page::SIZE : 0);
+
+  const std::size_t start = buffer_.size();
+  buffer_.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (file != NULL) {
+    buffer_.append(file->filename());
+  }
+  if (page != NULL) {
+    buffer_.append(reinterpret_cast<const char*>(page), Page::SIZE);
+  }
+  header.checksum = checksum(&buffer_[start], header.length);
+  memcpy(&buffer_[start], &header, sizeof(header));
+
+  next_lsn_ += header.length;
+  return header.lsn;
+}
+
+std::uint32_t LogManager::checksum(const char* record,
+                                   const std::size_t length) {
+  // FNV-1a.
+  std::uint32_t hash = 2166136261u;
+  for (std::size_t i = 0; i < length; ++i) {
+    hash = (hash ^ static_cast<unsigned char>(record[i])) * 16777619u;
+  }
+  return hash;
+}
+
+}
@@ -0,0 +1,303 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Header of every record in the write-ahead log.
+ *
+ * Page image records are followed by the name of the file and the page.  Page
+ * freed records are followed by the name of the file.  Commit records have no
+ * body.
+ */
+struct LogRecordHeader {
+  /**
+   * Log sequence number of the record.
+   */
+  Lsn lsn;
+
+  /**
+   * Length of the whole record, including this header.
+   */
+  std::uint32_t length;
+
+  /**
+   * Checksum of the record, computed with this field set to zero.
+   */
+  std::uint32_t checksum;
+
+  /**
+   * Page the record describes.  Unused by commit records.
+   */
+  PageId page_number;
+
+  /**
+   * Length of the file name following the header.
+   */
+  std::uint16_t name_length;
+
+  /**
+   * One of the LogManager record types.
+   */
+  std::uint8_t type;
+
+  /**
+   * One of the LogManager file kinds.
+   */
+  std::uint8_t file_kind;
+};
+
+/**
+ * @brief Write-ahead log of page updates made through the buffer manager.
+ *
+ * Instead of writing every dirty page back to its place in its file to make
+ * it durable, the buffer manager appends an image of the page to the log, and
+ * the log is written sequentially.  Records are collected in memory, and a
+ * commit waits for a group of commits to build up before the log is forced,
+ * so several commits share one write and one sync of the log.  The commit
+ * that completes a group forces the log for all of them; a group still short
+ * once the first of its commits has waited long enough is forced by that
+ * commit.  Either way a commit returns only once its record is on disk.
+ *
+ * The log holds the newest image of every page that has been changed since
+ * the last checkpoint, and a page is never written to its file before its
+ * image is on disk in the log.  After a crash, recover() copies the newest
+ * image of each page back into its file, in file and page order, and empties
+ * the log.  A checkpoint does the same from the buffer pool.
+ *
+ * Images of a file's pages are kept until the next checkpoint, so a file
+ * whose pages have been logged must not be removed and created again before
+ * a checkpoint.
+ *
+ * The log is threadsafe, and no lock is held while it is written or synced,
+ * so records can be appended meanwhile.  recover() must not run while other
+ * threads use the log.
+ */
+class LogManager {
+ public:
+  /**
+   * Type of a record holding an image of a page.
+   */
+  static const std::uint8_t PAGE_IMAGE = 1;
+
+  /**
+   * Type of a record noting that a page was deleted from its file.
+   */
+  static const std::uint8_t PAGE_FREED = 2;
+
+  /**
+   * Type of a record marking a commit.
+   */
+  static const std::uint8_t COMMIT = 3;
+
+  /**
+   * Kind of a record's file: a PageFile.
+   */
+  static const std::uint8_t PAGE_FILE = 1;
+
+  /**
+   * Kind of a record's file: a BlobFile.
+   */
+  static const std::uint8_t BLOB_FILE = 2;
+
+  /**
+   * Opens the log, creating it if it doesn't exist.  Any records in the log
+   * are kept for recover().
+   *
+   * @param name           Name of the log file.
+   * @param group_size     Number of commits collected before the log is forced
+   *                       to disk.
+   * @param group_wait_us  Microseconds a commit waits for the rest of its
+   *                       group before forcing the log itself.
+   * @throws  LogIOException  If the log can't be opened.
+   */
+  LogManager(const std::string& name, const std::uint32_t group_size = 8,
+             const std::uint32_t group_wait_us = 1000);
+
+  /**
+   * Forces any collected records to disk and closes the log.
+   */
+  ~LogManager();
+
+  /**
+   * Appends an image of a page to the log.
+   *
+   * @param file         File the page belongs to.
+   * @param page_number  Number of the page.
+   * @param page         Contents of the page.
+   * @return  Log sequence number of the record.
+   */
+  Lsn logPage(const File* file, const PageId page_number, const Page& page);
+
+  /**
+   * Appends a record noting that a page was deleted and forces it to disk, so
+   * older images of the page are not copied over it if the page is reused.
+   *
+   * @param file         File the page belonged to.
+   * @param page_number  Number of the page.
+   * @return  Log sequence number of the record.
+   */
+  Lsn logPageFreed(const File* file, const PageId page_number);
+
+  /**
+   * Appends a commit record and waits until it is on disk.  The log is
+   * forced once group_size commits have been collected, or by this commit if
+   * its group is still short after group_wait_us.
+   *
+   * @return  Log sequence number of the commit record.
+   * @throws  LogIOException  If the log can't be written.
+   */
+  Lsn commit();
+
+  /**
+   * Forces the log to disk up to and including the record with the given
+   * log sequence number, along with every other collected record.  Waits
+   * for a force already under way instead, if that covers the record.
+   *
+   * @param lsn  Log sequence number that must be durable.
+   * @throws  LogIOException  If the log can't be written.
+   */
+  void flush(const Lsn lsn);
+
+  /**
+   * Forces every collected record to disk.
+   */
+  void flush();
+
+  /**
+   * Returns the log sequence number up to which (exclusive) the log is on
+   * disk.
+   */
+  Lsn getFlushedLsn() const;
+
+  /**
+   * Returns the number of times the log has been forced to disk.
+   */
+  std::uint64_t getNumFlushes() const;
+
+  /**
+   * Empties the log.  Called once every page image in it has been written to
+   * its file and the files have been synced.
+   *
+   * @throws  LogIOException  If the log can't be truncated.
+   */
+  void truncate();
+
+  /**
+   * Copies the newest image of every page in the log back into its file and
+   * empties the log.  Images of pages that were later deleted, and of files
+   * that no longer exist, are skipped.  Records after a torn or corrupt
+   * record are ignored.
+   *
+   * @return  Number of pages written.
+   * @throws  LogIOException  If the log can't be read.
+   */
+  std::uint32_t recover();
+
+ private:
+  /**
+   * Appends a record to the records waiting to be written.
+   *
+   * @param type         Type of record.
+   * @param file         File the record describes, or NULL.
+   * @param page_number  Page the record describes.
+   * @param page         Page image to include, or NULL.
+   * @return  Log sequence number of the record.
+   */
+  Lsn append(const std::uint8_t type, const File* file,
+             const PageId page_number, const Page* page);
+
+  /**
+   * Does the work of flush().  Requires mutex_, which is dropped while the
+   * log is written and synced.
+   *
+   * @param lsn   Log sequence number that must be durable.
+   * @param lock  Lock holding mutex_.
+   */
+  void force(const Lsn lsn, std::unique_lock<std::mutex>& lock);
+
+  /**
+   * Returns the checksum of a record, whose checksum field must be zero.
+   *
+   * @param record  Start of the record.
+   * @param length  Length of the record.
+   */
+  static std::uint32_t checksum(const char* record, const std::size_t length);
+
+  /**
+   * Name of the log file.
+   */
+  std::string name_;
+
+  /**
+   * Descriptor of the log file.
+   */
+  int fd_;
+
+  /**
+   * Number of commits after which the log is forced to disk.
+   */
+  std::uint32_t group_size_;
+
+  /**
+   * Microseconds a commit waits for its group to fill up.
+   */
+  std::uint32_t group_wait_us_;
+
+  /**
+   * Number of commits collected since the log was last forced.
+   */
+  std::uint32_t pending_commits_;
+
+  /**
+   * Records appended but not yet written to the log file.
+   */
+  std::string buffer_;
+
+  /**
+   * Log sequence number the next record will get.
+   */
+  Lsn next_lsn_;
+
+  /**
+   * Every record before this log sequence number is on disk.
+   */
+  Lsn flushed_lsn_;
+
+  /**
+   * Number of times the log has been forced.
+   */
+  std::uint64_t num_flushes_;
+
+  /**
+   * True while a thread is writing and syncing records taken out of buffer_.
+   */
+  bool flushing_;
+
+  /**
+   * Lock guarding every member but name_ and fd_.
+   */
+  mutable std::mutex mutex_;
+
+  /**
+   * Signalled whenever the log has been forced, or a force has failed.
+   */
+  std::condition_variable flushed_cond_;
+};
+
+}
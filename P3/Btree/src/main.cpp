@@ -6,9 +6,25 @@
  */
 
 #include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <cstdio>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "btree.h"
 #include "page.h"
 #include "filescan.h"
+#include "heapfile.h"
+#include "logmanager.h"
+#include "paxpage.h"
+#include "accesstrace.h"
+#include "tracesim.h"
+#include "victimcache.h"
 #include "page_iterator.h"
 #include "file_iterator.h"
 #include "exceptions/insufficient_space_exception.h"
@@ -19,6 +35,10 @@
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/page_size_mismatch_exception.h"
+#include "exceptions/page_pinned_exception.h"
+#include "exceptions/invalid_record_exception.h"
 
 #define checkPassFail(a, b) 																				\
 {																																		\
@@ -52,10 +72,34 @@ std::string dbRecord1;
 
 BufMgr * bufMgr = new BufMgr(100);
 
+// Whether indexTests builds its indexes in compressed files.
+bool compressIndexes = false;
+
 // -----------------------------------------------------------------------------
 // Forward declarations
 // -----------------------------------------------------------------------------
 
+void pageTests();
+void bufHashTblTests();
+void heapFileTests();
+void paxPageTests();
+void fileIteratorTests();
+void walTests();
+void concurrentBufferTests();
+void concurrentIOTests();
+void replacementPolicyTests();
+void bufferRingTests();
+void prefetchTests();
+void pageWriterTests();
+void flushFileTests();
+void pageHandleTests();
+void poolMemoryTests();
+void resizeTests();
+void statsTests();
+void warmRestartTests();
+void traceTests();
+void victimCacheTests();
+void optimisticReadTests();
 void createRelationForward();
 void createRelationBackward();
 void createRelationRandom();
@@ -72,102 +116,1905 @@ int stringScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Opera
 void test1();
 void test2();
 void test3();
+void compressedIndexTests();
+void tryScanNextTests();
 void errorTests();
 void test4();
 void deleteRelation();
 
 int main(int argc, char **argv)
 {
-	if( argc != 2 )
+	if( argc != 2 )
+	{
+		std::cout << "Expects one argument as a number between 1 to 3 to choose datatype of key.\n";
+		std::cout << "For INTEGER keys run as: ./badgerdb_main 1\n";
+		std::cout << "For DOUBLE keys run as: ./badgerdb_main 2\n";
+		std::cout << "For STRING keys run as: ./badgerdb_main 3\n";
+		delete bufMgr;
+		return 1;
+	}
+
+	sscanf(argv[1],"%d",&testNum);
+
+	switch(testNum)
+	{
+		case 1:
+			std::cout << "leaf size:" << INTARRAYLEAFSIZE << " non-leaf size:" << INTARRAYNONLEAFSIZE << std::endl;
+			break;
+		case 2:
+			std::cout << "leaf size:" << DOUBLEARRAYLEAFSIZE << " non-leaf size:" << DOUBLEARRAYNONLEAFSIZE << std::endl;
+			break;
+		case 3:
+			std::cout << "leaf size:" << STRINGARRAYLEAFSIZE << " non-leaf size:" << STRINGARRAYNONLEAFSIZE << std::endl;
+			break;
+	}
+
+
+  // Clean up from any previous runs that crashed.
+  try
+	{
+    File::remove(relationName);
+  }
+	catch(const FileNotFoundException&)
+	{
+  }
+
+	{
+		// Create a new database file.
+		PageFile new_file = PageFile::create(relationName);
+
+		// Allocate some pages and put data on them.
+		for (int i = 0; i < 20; ++i)
+		{
+			PageId new_page_number;
+			Page new_page = new_file.allocatePage(new_page_number);
+
+    	sprintf(record1.s, "%05d string record", i);
+    	record1.i = i;
+    	record1.d = (double)i;
+    	std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+
+			new_page.insertRecord(new_data);
+			new_file.writePage(new_page_number, new_page);
+		}
+
+	}
+	// new_file goes out of scope here, so file is automatically closed.
+
+	{
+		FileScan fscan(relationName, bufMgr);
+
+		try
+		{
+			RecordId scanRid;
+			while(1)
+			{
+				fscan.scanNext(scanRid);
+				//Assuming RECORD.i is our key, lets extract the key, which we know is INTEGER and whose byte offset is also know inside the record. 
+				std::string recordStr = fscan.getRecord();
+				const char *record = recordStr.c_str();
+				int key = *((int *)(record + offsetof (RECORD, i)));
+				std::cout << "Extracted : " << key << std::endl;
+			}
+		}
+		catch(const EndOfFileException& e)
+		{
+			std::cout << "Read all records" << std::endl;
+		}
+	}
+	// filescan goes out of scope here, so relation file gets closed.
+
+	File::remove(relationName);
+
+	pageTests();
+	bufHashTblTests();
+	heapFileTests();
+	paxPageTests();
+	fileIteratorTests();
+	walTests();
+	concurrentBufferTests();
+	concurrentIOTests();
+	replacementPolicyTests();
+	bufferRingTests();
+	prefetchTests();
+	pageWriterTests();
+	flushFileTests();
+	pageHandleTests();
+	poolMemoryTests();
+	resizeTests();
+	statsTests();
+	warmRestartTests();
+	traceTests();
+	victimCacheTests();
+	optimisticReadTests();
+	test1();
+	test2();
+	test3();
+	compressedIndexTests();
+	tryScanNextTests();
+	errorTests();
+	//test4();
+
+	delete bufMgr;
+	return 0;
+}
+
+// -----------------------------------------------------------------------------
+// pageTests
+// -----------------------------------------------------------------------------
+
+void pageTests()
+{
+	// Fill a page, delete every other record and then insert a record that only
+	// fits once the holes left by the deletes have been compacted.
+	std::cout << "---------" << std::endl;
+	std::cout << "pageTests" << std::endl;
+	Page page;
+	std::vector<RecordId> rids;
+	for(int i = 0; page.hasSpaceForRecord(std::string(100, 'a' + i % 26)); i++)
+	{
+		rids.push_back(page.insertRecord(std::string(100, 'a' + i % 26)));
+	}
+
+	int numDeleted = 0;
+	for(std::size_t i = 0; i < rids.size(); i += 2)
+	{
+		page.deleteRecord(rids[i]);
+		numDeleted++;
+	}
+
+	std::string bigRecord(100 * (numDeleted - 1), 'z');
+	RecordId bigRid = page.insertRecord(bigRecord);
+	bool bigRecordIntact = (page.getRecord(bigRid) == bigRecord);
+	checkPassFail(bigRecordIntact, true)
+
+	int numIntact = 0;
+	for(std::size_t i = 1; i < rids.size(); i += 2)
+	{
+		if(page.getRecord(rids[i]) == std::string(100, 'a' + i % 26))
+			numIntact++;
+	}
+	checkPassFail(numIntact, (int)(rids.size() / 2))
+
+	// A batch insert should pack exactly as many records onto a page as
+	// inserting them one at a time does.
+	Page batchPage;
+	std::vector<std::string> batch(rids.size() + 10, std::string(100, 'b'));
+	std::vector<RecordId> batchRids;
+	int numInserted = batchPage.insertRecords(batch, 0, batchRids);
+	checkPassFail(numInserted, (int)rids.size())
+	bool batchIntact = (batchPage.getRecord(batchRids.back()) == batch.back());
+	checkPassFail(batchIntact, true)
+}
+
+// -----------------------------------------------------------------------------
+// bufHashTblTests
+// -----------------------------------------------------------------------------
+
+void bufHashTblTests()
+{
+	// Fill a table well past its initial size, remove every other entry and
+	// check the rest can still be found after being shifted into the holes.
+	std::cout << "---------------" << std::endl;
+	std::cout << "bufHashTblTests" << std::endl;
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+	PageFile* file = new PageFile(relationName, true);
+	BufHashTbl table(8);
+	for(PageId pageNo = 1; pageNo <= 1000; pageNo++)
+		table.insert(file, pageNo, pageNo * 3);
+	for(PageId pageNo = 1; pageNo <= 1000; pageNo += 2)
+		table.remove(file, pageNo);
+
+	int numFound = 0;
+	int numMissing = 0;
+	for(PageId pageNo = 1; pageNo <= 1000; pageNo++)
+	{
+		FrameId frameNo;
+		if(!table.lookup(file, pageNo, frameNo))
+			numMissing++;
+		else if(frameNo == pageNo * 3)
+			numFound++;
+	}
+	checkPassFail(numFound, 500)
+	checkPassFail(numMissing, 500)
+
+	// shrinking moves the entries over a few at a time; they stay findable meanwhile
+	table.reserve(4);
+	int numFoundAfterReserve = 0;
+	for(PageId pageNo = 2; pageNo <= 1000; pageNo += 2)
+	{
+		FrameId frameNo;
+		if(table.lookup(file, pageNo, frameNo) && frameNo == pageNo * 3)
+			numFoundAfterReserve++;
+	}
+	checkPassFail(numFoundAfterReserve, 500)
+
+	delete file;
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// heapFileTests
+// -----------------------------------------------------------------------------
+
+void heapFileTests()
+{
+	// Deleting records and inserting the same amount again should reuse the
+	// freed space instead of growing the file, whether the free space map is
+	// read back from disk or rebuilt from the relation.
+	std::cout << "-------------" << std::endl;
+	std::cout << "heapFileTests" << std::endl;
+	try
+	{
+		HeapFile::remove(relationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+
+	std::vector<RecordId> rids;
+	memset(record1.s, ' ', sizeof(record1.s));
+	std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+	{
+		HeapFile relation(relationName, bufMgr);
+		for(int i = 0; i < 1000; i++)
+		{
+			rids.push_back(relation.insertRecord(new_data));
+		}
+	}
+	PageId numPages = PageFile(relationName, false).getNumPages();
+
+	for(int pass = 0; pass < 2; pass++)
+	{
+		if(pass == 1)
+		{
+			File::remove(FreeSpaceMap::mapFileName(relationName));
+		}
+		{
+			HeapFile relation(relationName, bufMgr);
+			for(std::size_t i = pass; i < rids.size(); i += 2)
+			{
+				relation.deleteRecord(rids[i]);
+			}
+		}
+		{
+			HeapFile relation(relationName, bufMgr);
+			for(std::size_t i = pass; i < rids.size(); i += 2)
+			{
+				rids[i] = relation.insertRecord(new_data);
+			}
+		}
+		checkPassFail(PageFile(relationName, false).getNumPages(), numPages)
+	}
+
+	int numIntact = 0;
+	{
+		HeapFile relation(relationName, bufMgr);
+		for(std::size_t i = 0; i < rids.size(); i++)
+		{
+			if(relation.getRecord(rids[i]) == new_data)
+				numIntact++;
+		}
+	}
+	checkPassFail(numIntact, (int)rids.size())
+
+	// a record too large for any category of partly filled pages still goes
+	// into a page emptied of its records
+	std::string bigRecord(Page::DATA_SIZE - sizeof(PageSlot), 'b');
+	bool reused;
+	{
+		HeapFile relation(relationName, bufMgr);
+		RecordId bigRid = relation.insertRecord(bigRecord);
+		relation.deleteRecord(bigRid);
+		reused = relation.insertRecord(bigRecord).page_number == bigRid.page_number;
+	}
+	checkPassFail(reused, true)
+
+	HeapFile::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// paxPageTests
+// -----------------------------------------------------------------------------
+
+void paxPageTests()
+{
+	// Load records onto PAX pages through the buffer manager, then scan only
+	// the integer column of each page and check every key comes back.
+	std::cout << "------------" << std::endl;
+	std::cout << "paxPageTests" << std::endl;
+	const std::string paxRelationName = relationName + ".pax";
+	try
+	{
+		File::remove(paxRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+
+	std::vector<PaxColumn> columns;
+	columns.push_back({offsetof(RECORD, i), sizeof(record1.i)});
+	columns.push_back({offsetof(RECORD, d), sizeof(record1.d)});
+	columns.push_back({offsetof(RECORD, s), sizeof(record1.s)});
+
+	PageFile* paxFile = new PageFile(paxRelationName, true);
+	memset(&record1, 0, sizeof(record1));
+	bool recordIntact = true;
+	PageHandle page;
+	for(int i = 0; i < relationSize; i++)
+	{
+		if(!page || PaxPage(page.get()).isFull())
+		{
+			PageId pageNo;
+			page = bufMgr->allocPage(paxFile, pageNo);
+			PaxPage::format(page.write(), columns, sizeof(RECORD));
+		}
+		sprintf(record1.s, "%05d string record", i);
+		record1.i = i;
+		record1.d = (double)i;
+		std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+		PaxPage paxPage(page.write());
+		std::uint16_t row = paxPage.insertRecord(new_data);
+		recordIntact = recordIntact && (paxPage.getRecord(row) == new_data);
+	}
+	page.release();
+	bufMgr->flushFile(paxFile);
+	checkPassFail(recordIntact, true)
+
+	long long keySum = 0;
+	std::vector<int> keys;
+	for(FileIterator iter = paxFile->begin(); iter != paxFile->end(); ++iter)
+	{
+		PageHandle scanPage = bufMgr->readPage(paxFile, iter.page_number());
+		keys.clear();
+		PaxPage(scanPage.get()).getColumn(0, keys);
+		for(std::size_t i = 0; i < keys.size(); i++)
+			keySum += keys[i];
+	}
+	checkPassFail(keySum, (long long)relationSize * (relationSize - 1) / 2)
+
+	// a column the page doesn't have must be refused, not read past the header
+	int numRefused = 0;
+	{
+		PageHandle firstPage = bufMgr->readPage(paxFile, paxFile->getFirstPageNo());
+		PaxPage paxPage(firstPage.get());
+		try
+		{
+			paxPage.getColumnData(paxPage.getNumColumns());
+		}
+		catch(const BadPageFormatException& e)
+		{
+			numRefused++;
+		}
+		try
+		{
+			paxPage.getColumn(paxPage.getNumColumns(), keys);
+		}
+		catch(const BadPageFormatException& e)
+		{
+			numRefused++;
+		}
+	}
+	checkPassFail(numRefused, 2)
+
+	bufMgr->flushFile(paxFile);
+	delete paxFile;
+	File::remove(paxRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// fileIteratorTests
+// -----------------------------------------------------------------------------
+
+void fileIteratorTests()
+{
+	// Delete and reuse pages, then check that iterating over the file, walking
+	// the used list and starting part way through all agree.
+	std::cout << "-----------------" << std::endl;
+	std::cout << "fileIteratorTests" << std::endl;
+	try
+	{
+		File::remove(relationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+
+	int numUsed = 0;
+	{
+		PageFile file = PageFile::create(relationName);
+		PageId pageNo;
+		for(int i = 0; i < 1000; i++)
+		{
+			file.allocatePage(pageNo);
+			numUsed++;
+		}
+		for(PageId i = 2; i <= pageNo; i += 3)
+		{
+			file.deletePage(i);
+			numUsed--;
+		}
+		for(int i = 0; i < 100; i++)
+		{
+			file.allocatePage(pageNo);
+			numUsed++;
+		}
+	}
+
+	{
+		// The file grows a whole extent at a time, so its length on disk is a
+		// whole number of extents no matter how many pages are in use.
+		PageFile file = PageFile::open(relationName);
+		const PageId extentPages = File::getExtentPages();
+		const PageId numExtents = (file.getNumPages() - 1 + extentPages - 1) / extentPages;
+		std::ifstream fileStream(relationName, std::ios::binary | std::ios::ate);
+		long long fileLength = fileStream.tellg();
+		checkPassFail(fileLength, (long long)(sizeof(FileHeader) + (std::size_t)numExtents * extentPages * Page::SIZE))
+
+		int numIterated = 0;
+		bool ascending = true;
+		PageId lastPageNo = Page::INVALID_NUMBER;
+		for(FileIterator iter = file.begin(); iter != file.end(); ++iter)
+		{
+			ascending = ascending && iter.page_number() > lastPageNo;
+			lastPageNo = iter.page_number();
+			numIterated++;
+		}
+		checkPassFail(numIterated, numUsed)
+		checkPassFail(ascending, true)
+
+		int numLinked = 0;
+		for(PageId pageNo = file.getFirstPageNo(); pageNo != Page::INVALID_NUMBER; pageNo = file.readPage(pageNo).next_page_number())
+		{
+			numLinked++;
+		}
+		checkPassFail(numLinked, numUsed)
+
+		int numFromMiddle = 0;
+		for(FileIterator iter = file.begin(500); iter != file.end(); ++iter)
+		{
+			numFromMiddle += iter.page_number() >= 500 ? 1 : -numUsed;
+		}
+		int numExpectedFromMiddle = 0;
+		for(FileIterator iter = file.begin(); iter != file.end(); ++iter)
+		{
+			if(iter.page_number() >= 500)
+				numExpectedFromMiddle++;
+		}
+		checkPassFail(numFromMiddle, numExpectedFromMiddle)
+	}
+
+	File::remove(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// walTests
+// -----------------------------------------------------------------------------
+
+void walTests()
+{
+	// Commits should reach the log a group at a time, each on disk by the time
+	// it returns.  Then update a page through a buffer manager with a log,
+	// commit and crash before the page is written back, and check the next
+	// buffer manager redoes the update.
+	std::cout << "--------" << std::endl;
+	std::cout << "walTests" << std::endl;
+	const std::string walRelationName = relationName + ".wal";
+	const std::string logName = relationName + ".log";
+	try
+	{
+		File::remove(walRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+	std::remove(logName.c_str());
+
+	{
+		// a commit left alone waits out its group and then forces the log itself
+		LogManager log(logName, 4, 50000);
+		Lsn lsn = log.commit();
+		bool forcedAlone = (log.getNumFlushes() == 1 && log.getFlushedLsn() > lsn);
+		checkPassFail(forcedAlone, true)
+
+		// commits made together share a force, and each is on disk when it returns
+		std::vector<std::thread> threads;
+		std::atomic<int> numDurable(0);
+		for(int t = 0; t < 8; t++)
+		{
+			threads.push_back(std::thread([&]()
+			{
+				Lsn commitLsn = log.commit();
+				if(log.getFlushedLsn() > commitLsn)
+					numDurable++;
+			}));
+		}
+		for(int t = 0; t < 8; t++)
+			threads[t].join();
+		checkPassFail(numDurable.load(), 8)
+		bool grouped = (log.getNumFlushes() - 1 < 8);
+		checkPassFail(grouped, true)
+		log.truncate();
+	}
+
+	memset(&record1, 0, sizeof(record1));
+	sprintf(record1.s, "logged string record");
+	std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+	pid_t pid = fork();
+	if(pid == 0)
+	{
+		LogManager log(logName);
+		BufMgr* walMgr = new BufMgr(10, &log);
+		PageFile* walFile = new PageFile(walRelationName, true);
+		PageId pageNo;
+		walMgr->allocPage(walFile, pageNo).write()->insertRecord(new_data);
+		walMgr->commit();
+		// Crash without running any destructors, and without forcing the log
+		// any further than the commit did.
+		_exit(0);
+	}
+	int status;
+	waitpid(pid, &status, 0);
+
+	PageFile* walFile = new PageFile(walRelationName, false);
+	PageId pageNo = walFile->getFirstPageNo();
+	bool lostOnDisk = (walFile->readPage(pageNo).getFreeSpace() == Page().getFreeSpace());
+	checkPassFail(lostOnDisk, true)
+	{
+		LogManager log(logName);
+		BufMgr walMgr(10, &log);
+		PageHandle page = walMgr.readPage(walFile, pageNo);
+		RecordId walRid = {pageNo, 1};
+		bool redone = (page.get()->getRecord(walRid) == new_data);
+		checkPassFail(redone, true)
+	}
+
+	delete walFile;
+	File::remove(walRelationName);
+	std::remove(logName.c_str());
+}
+
+// -----------------------------------------------------------------------------
+// concurrentBufferTests
+// -----------------------------------------------------------------------------
+
+void concurrentBufferTests()
+{
+	// Several threads read pages through a buffer pool much smaller than the
+	// file, so frames are evicted and reused all the time.  Each thread also
+	// bumps a counter on the pages it owns; every read must find the page it
+	// asked for and no update may be lost, whichever replacement policy runs.
+	std::cout << "---------------------" << std::endl;
+	std::cout << "concurrentBufferTests" << std::endl;
+	const std::string mtRelationName = relationName + ".mt";
+	try
+	{
+		File::remove(mtRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+
+	const int numPages = 200;
+	const int numThreads = 4;
+	std::vector<PageId> pageNos;
+	PageFile* mtFile = new PageFile(mtRelationName, true);
+	for(int i = 0; i < numPages; i++)
+	{
+		PageId pageNo;
+		Page page = mtFile->allocatePage(pageNo);
+		page.insertRecord(std::string(sizeof(int), '\0'));
+		mtFile->writePage(pageNo, page);
+		pageNos.push_back(pageNo);
+	}
+
+	const ReplacementPolicy::Kind policies[] = {ReplacementPolicy::CLOCK, ReplacementPolicy::LRU_K,
+		ReplacementPolicy::TWO_Q, ReplacementPolicy::ARC};
+	std::atomic<int> numWrongPages(0);
+	std::atomic<int> numUpdates(0);
+	for(int p = 0; p < 4; p++)
+	{
+		BufMgr* mtMgr = new BufMgr(20, NULL, policies[p]);
+		std::vector<std::thread> threads;
+		for(int t = 0; t < numThreads; t++)
+		{
+			threads.push_back(std::thread([&, t]()
+			{
+				for(int i = 0; i < 2000; i++)
+				{
+					int index = (i * 31 + t * 17) % numPages;
+					PageId pageNo = pageNos[index];
+					PageHandle page = mtMgr->readPage(mtFile, pageNo);
+					if(page.get()->page_number() != pageNo)
+						numWrongPages++;
+					if(index % numThreads == t)
+					{
+						RecordId counterRid = {pageNo, 1};
+						std::string counter = page.get()->getRecord(counterRid);
+						(*reinterpret_cast<int*>(&counter[0]))++;
+						page.write()->updateRecord(counterRid, counter);
+						numUpdates++;
+					}
+				}
+			}));
+		}
+		for(int t = 0; t < numThreads; t++)
+			threads[t].join();
+		mtMgr->flushFile(mtFile);
+		delete mtMgr;
+	}
+	checkPassFail(numWrongPages, 0)
+
+	int counterSum = 0;
+	for(int i = 0; i < numPages; i++)
+	{
+		RecordId counterRid = {pageNos[i], 1};
+		std::string counter = mtFile->readPage(pageNos[i]).getRecord(counterRid);
+		counterSum += *reinterpret_cast<int*>(&counter[0]);
+	}
+	checkPassFail(counterSum, numUpdates)
+
+	delete mtFile;
+	File::remove(mtRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// concurrentIOTests
+// -----------------------------------------------------------------------------
+
+// A page file on a slow disk: every page read and write takes a while, and
+// writes can be held up until the test lets them go, a run of pages once it
+// has been written.  It counts how many of them are in progress at once.
+class SlowPageFile : public PageFile
+{
+ public:
+	SlowPageFile(const std::string& name, const int delayMicros)
+		: PageFile(name, true), delayMicros(delayMicros), inFlight(0), maxInFlight(0), holdWrites(false),
+		  heldWrites(0)
+	{
+	}
+
+	Page readPage(const PageId pageNo) const
+	{
+		InFlight io(*this);
+		return PageFile::readPage(pageNo);
+	}
+
+	void writePage(const PageId pageNo, const Page& page)
+	{
+		InFlight io(*this);
+		waitForRelease();
+		PageFile::writePage(pageNo, page);
+	}
+
+	void writePages(const PageId firstPageNo, const std::vector<const Page*>& pages)
+	{
+		InFlight io(*this);
+		PageFile::writePages(firstPageNo, pages);
+		waitForRelease();
+	}
+
+	const int delayMicros;
+	mutable std::atomic<int> inFlight;
+	mutable std::atomic<int> maxInFlight;
+	std::atomic<bool> holdWrites;
+	std::atomic<int> heldWrites;
+
+ private:
+	void waitForRelease()
+	{
+		if(holdWrites)
+		{
+			heldWrites++;
+			while(holdWrites)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	struct InFlight
+	{
+		InFlight(const SlowPageFile& file) : file(file)
+		{
+			int now = ++file.inFlight;
+			int max = file.maxInFlight;
+			while(now > max && !file.maxInFlight.compare_exchange_weak(max, now))
+			{
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(file.delayMicros));
+		}
+
+		~InFlight()
+		{
+			file.inFlight--;
+		}
+
+		const SlowPageFile& file;
+	};
+};
+
+void concurrentIOTests()
+{
+	// Threads missing on pages of the same file must read and write them at
+	// the same time rather than queue for the disk one after another, and a
+	// page being written back must not keep other threads from its shard.
+	std::cout << "---------------------" << std::endl;
+	std::cout << "concurrentIOTests" << std::endl;
+	const std::string ioRelationName = relationName + ".io";
+	try
+	{
+		File::remove(ioRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+
+	const int numPages = 128;
+	const int numThreads = 4;
+	const int numFrames = 16;
+	const int delayMicros = 500;
+	SlowPageFile* ioFile = new SlowPageFile(ioRelationName, delayMicros);
+	std::vector<PageId> pageNos;
+	for(int i = 0; i < numPages; i++)
+	{
+		PageId pageNo;
+		Page page = ioFile->allocatePage(pageNo);
+		page.insertRecord(std::string(sizeof(int), '\0'));
+		ioFile->PageFile::writePage(pageNo, page);
+		pageNos.push_back(pageNo);
+	}
+
+	// every access dirties its page, so most misses evict a dirty page.  The
+	// disk time of the reads and writes adds up to more than the time taken,
+	// as they overlap
+	BufMgr* ioMgr = new BufMgr(numFrames);
+	// only the threads of the test write pages back, so the writes held up
+	// below are the ones the test means to hold up
+	ioMgr->setCleanTarget(0);
+	std::atomic<int> numUpdates(0);
+	std::vector<std::thread> threads;
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for(int t = 0; t < numThreads; t++)
+	{
+		threads.push_back(std::thread([&, t]()
+		{
+			for(int i = 0; i < 150; i++)
+			{
+				// each thread counts on its own pages, so updates can't be lost to a race between threads
+				int index = ((i * 37) % (numPages / numThreads)) * numThreads + t;
+				RecordId counterRid = {pageNos[index], 1};
+				PageHandle page = ioMgr->readPage(ioFile, pageNos[index]);
+				std::string counter = page.get()->getRecord(counterRid);
+				(*reinterpret_cast<int*>(&counter[0]))++;
+				page.write()->updateRecord(counterRid, counter);
+				numUpdates++;
+			}
+		}));
+	}
+	for(int t = 0; t < numThreads; t++)
+		threads[t].join();
+	const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+	const int numIOs = ioMgr->getBufStats().diskreads + ioMgr->getBufStats().diskwrites;
+	bool overlapped = ioFile->maxInFlight > 1;
+	checkPassFail(overlapped, true)
+	bool fasterThanDisk = elapsed < std::chrono::microseconds(delayMicros) * numIOs;
+	checkPassFail(fasterThanDisk, true)
+
+	ioMgr->flushFile(ioFile);
+	int counterSum = 0;
+	for(int i = 0; i < numPages; i++)
+	{
+		RecordId counterRid = {pageNos[i], 1};
+		std::string counter = ioFile->PageFile::readPage(pageNos[i]).getRecord(counterRid);
+		counterSum += *reinterpret_cast<int*>(&counter[0]);
+	}
+	checkPassFail(counterSum, numUpdates)
+
+	// hold up the write back of a dirty victim; meanwhile another thread must
+	// still get at the page, which stays in its frame until it is written
+	for(int i = 0; i < numFrames; i++)
+		ioMgr->readPage(ioFile, pageNos[i]).markDirty();
+	ioFile->holdWrites = true;
+	std::thread evicter([&]()
+	{
+		ioMgr->readPage(ioFile, pageNos[numFrames]);
+	});
+	while(ioFile->heldWrites == 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	std::atomic<int> numRead(0);
+	std::thread reader([&]()
+	{
+		for(int i = 0; i < numFrames; i++)
+			ioMgr->readPage(ioFile, pageNos[i]);
+		numRead = numFrames;
+	});
+	for(int i = 0; i < 2000 && numRead == 0; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	int readWhileWriting = numRead;
+	ioFile->holdWrites = false;
+	reader.join();
+	evicter.join();
+	checkPassFail(readWhileWriting, numFrames)
+	ioMgr->flushFile(ioFile);
+
+	// change a page while a checkpoint writes it back; the change must not be
+	// taken for written
+	RecordId counterRid = {pageNos[0], 1};
+	int value = 12345;
+	ioMgr->readPage(ioFile, pageNos[0]).markDirty();
+	ioFile->heldWrites = 0;
+	ioFile->holdWrites = true;
+	std::thread checkpointer([&]()
+	{
+		ioMgr->checkpoint();
+	});
+	while(ioFile->heldWrites == 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	{
+		PageHandle page = ioMgr->readPage(ioFile, pageNos[0]);
+		page.write()->updateRecord(counterRid, std::string(reinterpret_cast<char*>(&value), sizeof(value)));
+	}
+	ioFile->holdWrites = false;
+	checkpointer.join();
+	ioMgr->flushFile(ioFile);
+	std::string counter = ioFile->PageFile::readPage(pageNos[0]).getRecord(counterRid);
+	int written = *reinterpret_cast<const int*>(counter.data());
+	checkPassFail(written, value)
+
+	delete ioMgr;
+	delete ioFile;
+	File::remove(ioRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// replacementPolicyTests
+// -----------------------------------------------------------------------------
+
+void replacementPolicyTests()
+{
+	// A few hot pages, standing in for the upper levels of an index, are read
+	// between the pages of a scan of a much larger file.  The scan-resistant
+	// policies must keep the hot pages resident through the scan, and through a
+	// second scan with no hot reads at all.
+	std::cout << "---------------------" << std::endl;
+	std::cout << "replacementPolicyTests" << std::endl;
+	const std::string policyRelationName = relationName + ".policy";
+	try
+	{
+		File::remove(policyRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+
+	const int numHot = 10;
+	const int numPages = 300;
+	PageFile* policyFile = new PageFile(policyRelationName, true);
+	std::vector<PageId> pageNos;
+	for(int i = 0; i < numPages; i++)
+	{
+		PageId pageNo;
+		policyFile->allocatePage(pageNo);
+		pageNos.push_back(pageNo);
+	}
+
+	const ReplacementPolicy::Kind policies[] = {ReplacementPolicy::LRU_K, ReplacementPolicy::TWO_Q,
+		ReplacementPolicy::ARC};
+	for(int p = 0; p < 3; p++)
+	{
+		BufMgr* policyMgr = new BufMgr(30, NULL, policies[p]);
+		for(int i = numHot; i < numPages; i++)
+		{
+			policyMgr->readPage(policyFile, pageNos[i]);
+			for(int h = (2 * i) % numHot; h <= (2 * i + 1) % numHot; h++)
+			{
+				policyMgr->readPage(policyFile, pageNos[h]);
+			}
+		}
+		for(int i = numHot; i < numPages; i++)
+		{
+			policyMgr->readPage(policyFile, pageNos[i]);
+		}
+
+		int readsBefore = policyMgr->getBufStats().diskreads;
+		for(int h = 0; h < numHot; h++)
+		{
+			policyMgr->readPage(policyFile, pageNos[h]);
+		}
+		int hotMisses = policyMgr->getBufStats().diskreads - readsBefore;
+		checkPassFail(hotMisses, 0)
+		delete policyMgr;
+	}
+
+	delete policyFile;
+	File::remove(policyRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// bufferRingTests
+// -----------------------------------------------------------------------------
+
+void bufferRingTests()
+{
+	// A sequential scan through a ring must leave pages read for random access
+	// in the pool, even under the clock policy, which a plain scan would flush.
+	std::cout << "---------------------" << std::endl;
+	std::cout << "bufferRingTests" << std::endl;
+	const std::string ringRelationName = relationName + ".ring";
+	try
+	{
+		File::remove(ringRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+
+	const int numHot = 10;
+	const int numPages = 300;
+	PageFile* ringFile = new PageFile(ringRelationName, true);
+	std::vector<PageId> pageNos;
+	for(int i = 0; i < numPages; i++)
+	{
+		PageId pageNo;
+		ringFile->allocatePage(pageNo);
+		pageNos.push_back(pageNo);
+	}
+
+	BufMgr* ringMgr = new BufMgr(32);
+	for(int h = 0; h < numHot; h++)
+	{
+		ringMgr->readPage(ringFile, pageNos[h]);
+	}
+
+	BufferRing ring;
+	int numWrongPages = 0;
+	for(int i = numHot; i < numPages; i++)
+	{
+		PageHandle page = ringMgr->readPage(ringFile, pageNos[i], ACCESS_SEQUENTIAL, &ring);
+		if(page.get()->page_number() != pageNos[i])
+			numWrongPages++;
+	}
+	checkPassFail(numWrongPages, 0)
+
+	int readsBefore = ringMgr->getBufStats().diskreads;
+	for(int h = 0; h < numHot; h++)
+	{
+		ringMgr->readPage(ringFile, pageNos[h]);
+	}
+	int hotMisses = ringMgr->getBufStats().diskreads - readsBefore;
+	checkPassFail(hotMisses, 0)
+
+	// pages read ahead for a scan go into its ring as well, and none is recycled before the scan gets to it
+	BufferRing aheadRing;
+	readsBefore = ringMgr->getBufStats().diskreads;
+	for(int i = numHot; i < numPages; i++)
+	{
+		if(i + 2 < numPages)
+			ringMgr->prefetch(ringFile, std::vector<PageId>(1, pageNos[i + 2]), &aheadRing);
+		ringMgr->waitForPrefetch();
+		ringMgr->readPage(ringFile, pageNos[i], ACCESS_SEQUENTIAL, &aheadRing);
+	}
+	bool readOnce = ringMgr->getBufStats().diskreads - readsBefore <= numPages - numHot;
+	checkPassFail(readOnce, true)
+
+	readsBefore = ringMgr->getBufStats().diskreads;
+	for(int h = 0; h < numHot; h++)
+	{
+		ringMgr->readPage(ringFile, pageNos[h]);
+	}
+	hotMisses = ringMgr->getBufStats().diskreads - readsBefore;
+	checkPassFail(hotMisses, 0)
+
+	ringMgr->flushFile(ringFile);
+	delete ringMgr;
+	delete ringFile;
+	File::remove(ringRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// prefetchTests
+// -----------------------------------------------------------------------------
+
+void prefetchTests()
+{
+	// Pages asked for with prefetch() must be in the pool by the time the
+	// prefetcher is idle, so reading them afterwards never touches the disk.
+	std::cout << "---------------------" << std::endl;
+	std::cout << "prefetchTests" << std::endl;
+	const std::string prefetchRelationName = relationName + ".prefetch";
+	try
+	{
+		File::remove(prefetchRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+
+	const int numPages = 40;
+	PageFile* prefetchFile = new PageFile(prefetchRelationName, true);
+	std::vector<PageId> pageNos;
+	for(int i = 0; i < numPages; i++)
+	{
+		PageId pageNo;
+		prefetchFile->allocatePage(pageNo);
+		pageNos.push_back(pageNo);
+	}
+
+	BufMgr* prefetchMgr = new BufMgr(64);
+	prefetchMgr->prefetch(prefetchFile, pageNos);
+	prefetchMgr->waitForPrefetch();
+	int numPrefetched = prefetchMgr->getBufStats().prefetches;
+	checkPassFail(numPrefetched, numPages)
+
+	int readsBefore = prefetchMgr->getBufStats().diskreads;
+	int numWrongPages = 0;
+	for(int i = 0; i < numPages; i++)
+	{
+		PageHandle page = prefetchMgr->readPage(prefetchFile, pageNos[i]);
+		if(page.get()->page_number() != pageNos[i])
+			numWrongPages++;
+	}
+	int numMisses = prefetchMgr->getBufStats().diskreads - readsBefore;
+	checkPassFail(numMisses, 0)
+	checkPassFail(numWrongPages, 0)
+
+	prefetchMgr->flushFile(prefetchFile);
+	delete prefetchMgr;
+	delete prefetchFile;
+	File::remove(prefetchRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// pageWriterTests
+// -----------------------------------------------------------------------------
+
+void pageWriterTests()
+{
+	// Fill a pool with dirty pages and clean the next victims; the misses that
+	// follow must then evict clean pages instead of writing them back first,
+	// and the updates must still reach the file.
+	std::cout << "---------------------" << std::endl;
+	std::cout << "pageWriterTests" << std::endl;
+	const std::string writerRelationName = relationName + ".writer";
+	try
+	{
+		File::remove(writerRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+
+	const int numFrames = 16;
+	PageFile* writerFile = new PageFile(writerRelationName, true);
+	BufMgr* writerMgr = new BufMgr(numFrames);
+	writerMgr->setCleanTarget(numFrames);
+	std::vector<PageId> pageNos;
+	for(int i = 0; i < 2 * numFrames; i++)
+	{
+		PageId pageNo;
+		writerMgr->allocPage(writerFile, pageNo).markDirty();
+		pageNos.push_back(pageNo);
+	}
+
+	// record the page number in the first half's pages; they are still in the pool
+	memset(&record1, 0, sizeof(record1));
+	for(int i = numFrames; i < 2 * numFrames; i++)
+	{
+		PageHandle page = writerMgr->readPage(writerFile, pageNos[i]);
+		record1.i = pageNos[i];
+		page.write()->insertRecord(std::string(reinterpret_cast<char*>(&record1), sizeof(record1)));
+	}
+
+	writerMgr->cleanVictims();
+	writerMgr->clearBufStats();
+	for(int i = 0; i < numFrames; i++)
+	{
+		writerMgr->readPage(writerFile, pageNos[i]);
+	}
+	int victimWrites = writerMgr->getBufStats().victimwrites;
+	checkPassFail(victimWrites, 0)
+
+	writerMgr->flushFile(writerFile);
+	delete writerMgr;
+	int numLost = 0;
+	for(int i = numFrames; i < 2 * numFrames; i++)
+	{
+		RecordId rid = {pageNos[i], 1};
+		std::string rec = writerFile->readPage(pageNos[i]).getRecord(rid);
+		if(reinterpret_cast<const RECORD*>(rec.data())->i != (int)pageNos[i])
+			numLost++;
+	}
+	checkPassFail(numLost, 0)
+
+	delete writerFile;
+	File::remove(writerRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// flushFileTests
+// -----------------------------------------------------------------------------
+void flushFileTests()
+{
+	// Flush one file out of a pool shared with another; only its own dirty
+	// pages are written, nothing at all while one of them is pinned, and the
+	// other file's pages stay in the pool.
+	std::cout << "---------------------" << std::endl;
+	std::cout << "flushFileTests" << std::endl;
+	const std::string flushRelationName = relationName + ".flush";
+	const std::string otherRelationName = relationName + ".other";
+	try
+	{
+		File::remove(flushRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+	try
+	{
+		File::remove(otherRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+
+	const int numPages = 40;
+	const int numOtherPages = 8;
+	PageFile* flushFile = new PageFile(flushRelationName, true);
+	PageFile* otherFile = new PageFile(otherRelationName, true);
+	BufMgr* flushMgr = new BufMgr(256);
+	std::vector<PageId> pageNos;
+	std::vector<PageId> otherPageNos;
+	memset(&record1, 0, sizeof(record1));
+	for(int i = 0; i < numPages + numOtherPages; i++)
+	{
+		PageFile* file = i < numPages ? flushFile : otherFile;
+		PageId pageNo;
+		PageHandle page = flushMgr->allocPage(file, pageNo);
+		record1.i = pageNo;
+		page.write()->insertRecord(std::string(reinterpret_cast<char*>(&record1), sizeof(record1)));
+		(i < numPages ? pageNos : otherPageNos).push_back(pageNo);
+	}
+
+	flushMgr->clearBufStats();
+	PageHandle pinned = flushMgr->readPage(flushFile, pageNos[numPages / 2]);
+	bool threwPinned = false;
+	try
+	{
+		flushMgr->flushFile(flushFile);
+	}
+	catch(const PagePinnedException& e)
+	{
+		threwPinned = true;
+	}
+	checkPassFail(threwPinned, true)
+	int pinnedWrites = flushMgr->getBufStats().diskwrites;
+	checkPassFail(pinnedWrites, 0)
+	pinned.release();
+
+	flushMgr->flushFile(flushFile);
+	int flushWrites = flushMgr->getBufStats().diskwrites;
+	checkPassFail(flushWrites, numPages)
+
+	int numLost = 0;
+	for(int i = 0; i < numPages; i++)
+	{
+		RecordId rid = {pageNos[i], 1};
+		std::string rec = flushFile->readPage(pageNos[i]).getRecord(rid);
+		if(reinterpret_cast<const RECORD*>(rec.data())->i != (int)pageNos[i])
+			numLost++;
+	}
+	checkPassFail(numLost, 0)
+
+	flushMgr->clearBufStats();
+	for(int i = 0; i < numOtherPages; i++)
+	{
+		flushMgr->readPage(otherFile, otherPageNos[i]);
+	}
+	int otherReads = flushMgr->getBufStats().diskreads;
+	checkPassFail(otherReads, 0)
+
+	flushMgr->flushFile(otherFile);
+	delete flushMgr;
+	delete flushFile;
+	delete otherFile;
+	File::remove(flushRelationName);
+	File::remove(otherRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// pageHandleTests
+// -----------------------------------------------------------------------------
+void pageHandleTests()
+{
+	// A handle unpins its page when it goes out of scope or is moved over, and
+	// only writes through it make the page dirty.
+	std::cout << "---------------------" << std::endl;
+	std::cout << "pageHandleTests" << std::endl;
+	const std::string handleRelationName = relationName + ".handle";
+	try
+	{
+		File::remove(handleRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+
+	PageFile* handleFile = new PageFile(handleRelationName, true);
+	BufMgr* handleMgr = new BufMgr(8);
+	PageId firstPageNo, secondPageNo;
+	{
+		PageHandle first = handleMgr->allocPage(handleFile, firstPageNo);
+		PageHandle second = handleMgr->allocPage(handleFile, secondPageNo);
+		memset(&record1, 0, sizeof(record1));
+		record1.i = firstPageNo;
+		first.write()->insertRecord(std::string(reinterpret_cast<char*>(&record1), sizeof(record1)));
+		// moving over a handle unpins the page it held, once
+		second = std::move(first);
+		bool movedFromEmpty = !first;
+		checkPassFail(movedFromEmpty, true)
+		second.release();
+		second.release();
+	}
+	handleMgr->clearBufStats();
+	handleMgr->flushFile(handleFile);
+	// only the page written through a handle goes back to disk
+	int flushWrites = handleMgr->getBufStats().diskwrites;
+	checkPassFail(flushWrites, 1)
+
+	RecordId rid = {firstPageNo, 1};
+	std::string rec = handleFile->readPage(firstPageNo).getRecord(rid);
+	int storedPageNo = reinterpret_cast<const RECORD*>(rec.data())->i;
+	checkPassFail(storedPageNo, (int)firstPageNo)
+
+	{
+		PageHandle page = handleMgr->readPage(handleFile, firstPageNo);
+		bool pageMatches = page.pageNumber() == firstPageNo && page.get()->page_number() == firstPageNo;
+		checkPassFail(pageMatches, true)
+	}
+	handleMgr->clearBufStats();
+	handleMgr->flushFile(handleFile);
+	int readOnlyWrites = handleMgr->getBufStats().diskwrites;
+	checkPassFail(readOnlyWrites, 0)
+
+	delete handleMgr;
+	delete handleFile;
+	File::remove(handleRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// poolMemoryTests
+// -----------------------------------------------------------------------------
+void poolMemoryTests()
+{
+	// Pool memory comes zero filled and page aligned, and a pool asking for huge
+	// pages and NUMA partitions works the same whatever the system gives it.
+	std::cout << "---------------------" << std::endl;
+	std::cout << "poolMemoryTests" << std::endl;
+	{
+		PoolMemory memory(100, PoolMemory::SMALL_PAGES);
+		const char* bytes = static_cast<const char*>(memory.base());
+		bool zeroed = memory.size() >= 100 && std::count(bytes, bytes + memory.size(), 0) == (long)memory.size();
+		checkPassFail(zeroed, true)
+		bool aligned = reinterpret_cast<std::uintptr_t>(memory.base()) % sysconf(_SC_PAGESIZE) == 0;
+		checkPassFail(aligned, true)
+	}
+
+	const std::string poolRelationName = relationName + ".pool";
+	try
+	{
+		File::remove(poolRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+
+	const int numFrames = 16;
+	const int numPages = 3 * numFrames;
+	BufPoolOptions options;
+	options.pages = PoolMemory::HUGE_PAGES;
+	options.numaPartitioned = true;
+	PageFile* poolFile = new PageFile(poolRelationName, true);
+	BufMgr* poolMgr = new BufMgr(numFrames, NULL, ReplacementPolicy::CLOCK, options);
+	int numPartitions = poolMgr->getNumPartitions();
+	checkPassFail(numPartitions, std::min(numFrames, PoolMemory::numNodes()))
+	bool hugeKind = poolMgr->getPoolPageKind() != PoolMemory::SMALL_PAGES;
+	checkPassFail(hugeKind, true)
+
+	std::vector<PageId> pageNos;
+	memset(&record1, 0, sizeof(record1));
+	for(int i = 0; i < numPages; i++)
+	{
+		PageId pageNo;
+		PageHandle page = poolMgr->allocPage(poolFile, pageNo);
+		record1.i = pageNo;
+		page.write()->insertRecord(std::string(reinterpret_cast<char*>(&record1), sizeof(record1)));
+		pageNos.push_back(pageNo);
+	}
+	int numLost = 0;
+	for(int i = 0; i < numPages; i++)
+	{
+		PageHandle page = poolMgr->readPage(poolFile, pageNos[i]);
+		RecordId rid = {pageNos[i], 1};
+		std::string rec = page.get()->getRecord(rid);
+		if(reinterpret_cast<const RECORD*>(rec.data())->i != (int)pageNos[i])
+			numLost++;
+	}
+	checkPassFail(numLost, 0)
+
+	poolMgr->flushFile(poolFile);
+	delete poolMgr;
+	delete poolFile;
+	File::remove(poolRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// resizeTests
+// -----------------------------------------------------------------------------
+void resizeTests()
+{
+	// A grown pool can hold more pages pinned at once, and shrinking it evicts
+	// pages without losing them but stops at a frame that is still pinned.
+	std::cout << "-----------" << std::endl;
+	std::cout << "resizeTests" << std::endl;
+	const std::string resizeRelationName = relationName + ".resize";
+	try
+	{
+		File::remove(resizeRelationName);
+	}
+	catch(const FileNotFoundException& e)
 	{
-		std::cout << "Expects one argument as a number between 1 to 3 to choose datatype of key.\n";
-		std::cout << "For INTEGER keys run as: ./badgerdb_main 1\n";
-		std::cout << "For DOUBLE keys run as: ./badgerdb_main 2\n";
-		std::cout << "For STRING keys run as: ./badgerdb_main 3\n";
-		delete bufMgr;
-		return 1;
 	}
 
-	sscanf(argv[1],"%d",&testNum);
+	const int numPages = 24;
+	BufPoolOptions options;
+	options.maxBufs = 32;
+	PageFile* resizeFile = new PageFile(resizeRelationName, true);
+	BufMgr* resizeMgr = new BufMgr(8, NULL, ReplacementPolicy::CLOCK, options);
+	int grown = resizeMgr->resize(numPages);
+	checkPassFail(grown, numPages)
+
+	// the frames added by growing are handed out first, lowest first, so page i
+	// is in frame 8 + i
+	std::vector<PageId> pageNos;
+	std::vector<PageHandle> handles;
+	memset(&record1, 0, sizeof(record1));
+	for(int i = 0; i < numPages; i++)
+	{
+		PageId pageNo;
+		handles.push_back(resizeMgr->allocPage(resizeFile, pageNo));
+		record1.i = pageNo;
+		handles.back().write()->insertRecord(std::string(reinterpret_cast<char*>(&record1), sizeof(record1)));
+		pageNos.push_back(pageNo);
+	}
+	PageHandle pinned = std::move(handles[3]);
+	handles.clear();
 
-	switch(testNum)
+	int shrunk = resizeMgr->resize(4);
+	checkPassFail(shrunk, 12)
+	pinned.release();
+	shrunk = resizeMgr->resize(4);
+	checkPassFail(shrunk, 4)
+
+	int numLost = 0;
+	for(int i = 0; i < numPages; i++)
 	{
-		case 1:
-			std::cout << "leaf size:" << INTARRAYLEAFSIZE << " non-leaf size:" << INTARRAYNONLEAFSIZE << std::endl;
-			break;
-		case 2:
-			std::cout << "leaf size:" << DOUBLEARRAYLEAFSIZE << " non-leaf size:" << DOUBLEARRAYNONLEAFSIZE << std::endl;
-			break;
-		case 3:
-			std::cout << "leaf size:" << STRINGARRAYLEAFSIZE << " non-leaf size:" << STRINGARRAYNONLEAFSIZE << std::endl;
-			break;
+		PageHandle page = resizeMgr->readPage(resizeFile, pageNos[i]);
+		RecordId rid = {pageNos[i], 1};
+		std::string rec = page.get()->getRecord(rid);
+		if(reinterpret_cast<const RECORD*>(rec.data())->i != (int)pageNos[i])
+			numLost++;
 	}
+	checkPassFail(numLost, 0)
 
+	// readers go on while the pool is grown and shrunk under them
+	std::atomic<int> numWrongPages(0);
+	std::atomic<bool> stop(false);
+	std::vector<std::thread> readers;
+	for(int t = 0; t < 4; t++)
+	{
+		readers.push_back(std::thread([&, t]()
+		{
+			for(int i = 0; !stop; i++)
+			{
+				PageId pageNo = pageNos[(i * 7 + t * 5) % numPages];
+				PageHandle page = resizeMgr->readPage(resizeFile, pageNo);
+				if(page.get()->page_number() != pageNo)
+					numWrongPages++;
+			}
+		}));
+	}
+	for(int i = 0; i < 200; i++)
+		resizeMgr->resize(i % 2 == 0 ? 32 : 6);
+	stop = true;
+	for(int t = 0; t < 4; t++)
+		readers[t].join();
+	checkPassFail(numWrongPages, 0)
+
+	int clamped = resizeMgr->resize(1000);
+	checkPassFail(clamped, 32)
+
+	resizeMgr->flushFile(resizeFile);
+	delete resizeMgr;
+	delete resizeFile;
+	File::remove(resizeRelationName);
+}
 
-  // Clean up from any previous runs that crashed.
-  try
+// -----------------------------------------------------------------------------
+// statsTests
+// -----------------------------------------------------------------------------
+void statsTests()
+{
+	// Hits, misses, evictions and prefetch hits are counted for the file and in
+	// total, and the latencies of misses go into the histogram.
+	std::cout << "----------" << std::endl;
+	std::cout << "statsTests" << std::endl;
 	{
-    File::remove(relationName);
-  }
-	catch(FileNotFoundException)
+		LatencyHistogram histogram;
+		histogram.record(std::chrono::microseconds(0));
+		histogram.record(std::chrono::microseconds(3));
+		bool bucketed = histogram.bucket(0) == 1 && histogram.bucket(2) == 1;
+		checkPassFail(bucketed, true)
+		int median = histogram.percentileMicros(0.5);
+		int highest = histogram.percentileMicros(1.0);
+		checkPassFail(median, 1)
+		checkPassFail(highest, 4)
+	}
+
+	const std::string statsRelationName = relationName + ".stats";
+	try
 	{
-  }
+		File::remove(statsRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
 
+	PageFile* statsFile = new PageFile(statsRelationName, true);
+	BufMgr* statsMgr = new BufMgr(4);
+	std::vector<PageId> pageNos;
+	for(int i = 0; i < 8; i++)
 	{
-		// Create a new database file.
-		PageFile new_file = PageFile::create(relationName);
+		PageId pageNo;
+		statsMgr->allocPage(statsFile, pageNo);
+		pageNos.push_back(pageNo);
+	}
+	statsMgr->flushFile(statsFile);
+	statsMgr->clearBufStats();
+
+	// four misses filling the pool, four hits, then a miss evicting a page
+	for(int pass = 0; pass < 2; pass++)
+		for(int i = 0; i < 4; i++)
+			statsMgr->readPage(statsFile, pageNos[i]);
+	statsMgr->readPage(statsFile, pageNos[4]);
+	// a prefetched page is a hit, and the prefetcher's own read isn't a miss
+	statsMgr->prefetch(statsFile, std::vector<PageId>(1, pageNos[5]));
+	statsMgr->waitForPrefetch();
+	statsMgr->readPage(statsFile, pageNos[5]);
+
+	BufStatsSnapshot snapshot = statsMgr->getStatsSnapshot();
+	bool totals = snapshot.total.hits == 5 && snapshot.total.misses == 5 && snapshot.total.evictions == 2 &&
+		snapshot.total.prefetchhits == 1 && snapshot.readMissLatency.count() == 5;
+	checkPassFail(totals, true)
+	bool perFile = snapshot.files.size() == 1 && snapshot.files[statsRelationName].hits == 5 &&
+		snapshot.files[statsRelationName].evictions == 2;
+	checkPassFail(perFile, true)
+	int hitPercent = snapshot.hitRatio() * 100;
+	checkPassFail(hitPercent, 50)
+
+	std::ostringstream json;
+	statsMgr->printStatsJson(json);
+	bool dumped = json.str()[0] == '{' && json.str().find("\"" + statsRelationName + "\":{\"hits\":5,") != std::string::npos;
+	checkPassFail(dumped, true)
+
+	statsMgr->flushFile(statsFile);
+	delete statsMgr;
+	delete statsFile;
+	File::remove(statsRelationName);
+}
 
-		// Allocate some pages and put data on them.
-		for (int i = 0; i < 20; ++i)
+// -----------------------------------------------------------------------------
+// warmRestartTests
+// -----------------------------------------------------------------------------
+void warmRestartTests()
+{
+	// The pages in use when one buffer manager shuts down are read back in the
+	// background by the next, but only into free frames.
+	std::cout << "----------------" << std::endl;
+	std::cout << "warmRestartTests" << std::endl;
+	const std::string warmRelationName = relationName + ".warm";
+	BufPoolOptions options;
+	options.hotPagesFile = relationName + ".hot";
+	std::remove(options.hotPagesFile.c_str());
+	try
+	{
+		File::remove(warmRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+
+	PageFile* warmFile = new PageFile(warmRelationName, true);
+	std::vector<PageId> pageNos;
+	{
+		BufMgr warmMgr(8, NULL, ReplacementPolicy::CLOCK, options);
+		for(int i = 0; i < 16; i++)
 		{
-			PageId new_page_number;
-			Page new_page = new_file.allocatePage(new_page_number);
+			PageId pageNo;
+			warmMgr.allocPage(warmFile, pageNo);
+			pageNos.push_back(pageNo);
+		}
+		warmMgr.flushFile(warmFile);
+		for(int i = 3; i < 6; i++)
+			warmMgr.readPage(warmFile, pageNos[i]);
+		// the file is flushed before the buffer manager goes, as it would be when closed
+		warmMgr.flushFile(warmFile);
+	}
 
-    	sprintf(record1.s, "%05d string record", i);
-    	record1.i = i;
-    	record1.d = (double)i;
-    	std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
+	{
+		BufMgr warmMgr(8, NULL, ReplacementPolicy::CLOCK, options);
+		warmMgr.warmUp(warmFile);
+		warmMgr.waitForPrefetch();
+		for(int i = 3; i < 6; i++)
+			warmMgr.readPage(warmFile, pageNos[i]);
+		BufStatsSnapshot snapshot = warmMgr.getStatsSnapshot();
+		bool warmed = snapshot.total.misses == 0 && snapshot.total.prefetchhits == 3;
+		checkPassFail(warmed, true)
+		warmMgr.flushFile(warmFile);
+	}
 
-			new_page.insertRecord(new_data);
-			new_file.writePage(new_page_number, new_page);
+	{
+		// the frames taken for hot pages that are in the pool already are given back, so a reader still finds one
+		BufMgr warmMgr(4, NULL, ReplacementPolicy::CLOCK, options);
+		std::vector<PageHandle> pinned;
+		for(int i = 3; i < 6; i++)
+			pinned.push_back(warmMgr.readPage(warmFile, pageNos[i]));
+		warmMgr.warmUp(warmFile);
+		warmMgr.waitForPrefetch();
+		bool readOther = true;
+		try
+		{
+			warmMgr.readPage(warmFile, pageNos[0]);
+		}
+		catch(const BufferExceededException&)
+		{
+			readOther = false;
 		}
+		checkPassFail(readOther, true)
+		pinned.clear();
+		warmMgr.flushFile(warmFile);
+	}
 
+	{
+		// with two frames only two of the three pages are read, and nothing else is evicted for them
+		BufMgr warmMgr(2, NULL, ReplacementPolicy::CLOCK, options);
+		warmMgr.warmUp(warmFile);
+		warmMgr.waitForPrefetch();
+		int numWarmed = warmMgr.getBufStats().prefetches;
+		checkPassFail(numWarmed, 2)
+		warmMgr.flushFile(warmFile);
 	}
-	// new_file goes out of scope here, so file is automatically closed.
 
+	delete warmFile;
+	File::remove(warmRelationName);
+	std::remove(options.hotPagesFile.c_str());
+}
+
+// -----------------------------------------------------------------------------
+// traceTests
+// -----------------------------------------------------------------------------
+void traceTests()
+{
+	// A recorded trace reads back event by event, and replaying it against the
+	// same pool size and policy gives the hits and misses of the real run.
+	std::cout << "----------" << std::endl;
+	std::cout << "traceTests" << std::endl;
+	const std::string traceRelationName = relationName + ".traced";
+	const std::string traceName = relationName + ".trace";
+	try
 	{
-		FileScan fscan(relationName, bufMgr);
+		File::remove(traceRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
 
-		try
+	PageFile* traceFile = new PageFile(traceRelationName, true);
+	BufMgr* traceMgr = new BufMgr(8);
+	traceMgr->startTrace(traceName);
+	std::vector<PageId> pageNos;
+	for(int i = 0; i < 12; i++)
+	{
+		PageId pageNo;
+		traceMgr->allocPage(traceFile, pageNo);
+		pageNos.push_back(pageNo);
+	}
+	for(int pass = 0; pass < 3; pass++)
+		for(int i = 0; i < 6; i++)
+			traceMgr->readPage(traceFile, pageNos[i]);
+	BufStatsSnapshot live = traceMgr->getStatsSnapshot();
+	traceMgr->flushFile(traceFile);
+	traceMgr->stopTrace();
+	delete traceMgr;
+
+	int numEvents = 0;
+	int numReads = 0;
+	{
+		AccessTraceReader reader(traceName);
+		TraceEvent event;
+		while(reader.next(event))
 		{
-			RecordId scanRid;
-			while(1)
-			{
-				fscan.scanNext(scanRid);
-				//Assuming RECORD.i is our key, lets extract the key, which we know is INTEGER and whose byte offset is also know inside the record. 
-				std::string recordStr = fscan.getRecord();
-				const char *record = recordStr.c_str();
-				int key = *((int *)(record + offsetof (RECORD, i)));
-				std::cout << "Extracted : " << key << std::endl;
-			}
+			numEvents++;
+			if(event.kind == TraceEvent::READ && event.page_number == pageNos[numReads % 6])
+				numReads++;
 		}
-		catch(EndOfFileException e)
+		checkPassFail(reader.fileNames()[0], traceRelationName)
+	}
+	// 12 allocations and 18 reads, each unpinned, and the flush
+	checkPassFail(numEvents, 61)
+	checkPassFail(numReads, 18)
+
+	BufStatsSnapshot simulated = TraceSimulator::replay(traceName, ReplacementPolicy::CLOCK, 8);
+	bool matches = simulated.total.hits == live.total.hits && simulated.total.misses == live.total.misses &&
+		simulated.files[traceRelationName].hits == live.total.hits;
+	checkPassFail(matches, true)
+	BufStatsSnapshot large = TraceSimulator::replay(traceName, ReplacementPolicy::ARC, 16);
+	int largeMisses = large.total.misses;
+	checkPassFail(largeMisses, 0)
+	int numPages = TraceSimulator::countPages(traceName);
+	checkPassFail(numPages, 12)
+
+	delete traceFile;
+	File::remove(traceRelationName);
+	std::remove(traceName.c_str());
+}
+
+// -----------------------------------------------------------------------------
+// victimCacheTests
+// -----------------------------------------------------------------------------
+void victimCacheTests()
+{
+	// Pages evicted from the pool are read back from the victim cache instead of
+	// the disk, and copies of disposed pages and flushed files are dropped.
+	std::cout << "----------" << std::endl;
+	std::cout << "victimCacheTests" << std::endl;
+	{
+		VictimCache cache(3 * 1024);
+		Page page;
+		RecordId rid = page.insertRecord("victim");
+		bool kept = cache.put(NULL, 1, page);
+		checkPassFail(kept, true)
+		Page copy;
+		bool taken = cache.take(NULL, 1, copy);
+		checkPassFail(taken, true)
+		std::string record = copy.getRecord(rid);
+		checkPassFail(record, "victim")
+		bool takenTwice = cache.take(NULL, 1, copy);
+		checkPassFail(takenTwice, false)
+
+		// the pages put least recently make room for new ones
+		for(PageId i = 1; i <= 64; i++)
+			cache.put(NULL, i, page);
+		bool bounded = cache.size() <= cache.capacity() && cache.numPages() < 64;
+		checkPassFail(bounded, true)
+		bool newestKept = cache.take(NULL, 64, copy) && !cache.take(NULL, 1, copy);
+		checkPassFail(newestKept, true)
+
+		// a page that doesn't compress isn't worth keeping
+		Page noise;
+		std::string bytes(Page::DATA_SIZE - 64, ' ');
+		std::uint32_t seed = 1;
+		for(std::size_t i = 0; i < bytes.size(); i++)
 		{
-			std::cout << "Read all records" << std::endl;
+			seed = seed * 1103515245 + 12345;
+			bytes[i] = seed >> 24;
 		}
+		noise.insertRecord(bytes);
+		VictimCache large(64 * 1024);
+		bool noiseKept = large.put(NULL, 1, noise);
+		checkPassFail(noiseKept, false)
 	}
-	// filescan goes out of scope here, so relation file gets closed.
 
-	File::remove(relationName);
+	const std::string cacheRelationName = relationName + ".cached";
+	try
+	{
+		File::remove(cacheRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
 
-	test1();
-	test2();
-	test3();
-	errorTests();
-	//test4();
+	PageFile* cacheFile = new PageFile(cacheRelationName, true);
+	BufPoolOptions options;
+	options.victimCacheBytes = 64 * 1024;
+	BufMgr* cacheMgr = new BufMgr(4, NULL, ReplacementPolicy::CLOCK, options);
+	std::vector<PageId> pageNos;
+	std::vector<RecordId> rids;
+	for(int i = 0; i < 8; i++)
+	{
+		PageId pageNo;
+		PageHandle page = cacheMgr->allocPage(cacheFile, pageNo);
+		std::ostringstream record;
+		record << "page " << i;
+		rids.push_back(page.write()->insertRecord(record.str()));
+		pageNos.push_back(pageNo);
+	}
+	cacheMgr->flushFile(cacheFile);
+	cacheMgr->clearBufStats();
+
+	// a second pass finds each page it doesn't find in the pool in the cache
+	for(int pass = 0; pass < 2; pass++)
+		for(int i = 0; i < 8; i++)
+			cacheMgr->readPage(cacheFile, pageNos[i]);
+	BufStatsSnapshot snapshot = cacheMgr->getStatsSnapshot();
+	bool cacheHits = snapshot.total.cachehits >= 4 && snapshot.total.cachehits + snapshot.total.hits == 8;
+	int diskReads = snapshot.diskreads;
+	checkPassFail(cacheHits, true)
+	checkPassFail(diskReads, 8)
+	{
+		PageHandle page = cacheMgr->readPage(cacheFile, pageNos[2]);
+		std::string record = page.get()->getRecord(rids[2]);
+		checkPassFail(record, "page 2")
+	}
 
-	delete bufMgr;
-	return 0;
+	// the pages not in the pool are in the cache, until the file is flushed or
+	// they are disposed of
+	const VictimCache* cache = cacheMgr->getVictimCache();
+	int cachedPages = cache->numPages();
+	checkPassFail(cachedPages, 4)
+	cacheMgr->flushFile(cacheFile);
+	cachedPages = cache->numPages();
+	checkPassFail(cachedPages, 0)
+	for(int i = 0; i < 8; i++)
+		cacheMgr->readPage(cacheFile, pageNos[i]);
+	for(int i = 0; i < 8; i++)
+		cacheMgr->disposePage(cacheFile, pageNos[i]);
+	cachedPages = cache->numPages();
+	checkPassFail(cachedPages, 0)
+
+	delete cacheMgr;
+	delete cacheFile;
+	File::remove(cacheRelationName);
+}
+
+// -----------------------------------------------------------------------------
+// optimisticReadTests
+// -----------------------------------------------------------------------------
+void optimisticReadTests()
+{
+	// An optimistic read of a page no one changes takes no pin; one that sees the
+	// page change under it is repeated, and one of a pinned page pins it.
+	std::cout << "----------" << std::endl;
+	std::cout << "optimisticReadTests" << std::endl;
+	const std::string optimisticRelationName = relationName + ".optimistic";
+	try
+	{
+		File::remove(optimisticRelationName);
+	}
+	catch(const FileNotFoundException& e)
+	{
+	}
+
+	PageFile* optimisticFile = new PageFile(optimisticRelationName, true);
+	BufMgr* optimisticMgr = new BufMgr(4);
+	PageId pageNo;
+	RecordId rid;
+	{
+		PageHandle page = optimisticMgr->allocPage(optimisticFile, pageNo);
+		rid = page.write()->insertRecord("first");
+	}
+	optimisticMgr->clearBufStats();
+
+	PageLocation location;
+	std::string record;
+	int numCalls = 0;
+	optimisticMgr->readOptimistic(optimisticFile, pageNo, [&](const Page& page) {
+		numCalls++;
+		record = page.getRecord(rid);
+	}, &location);
+	checkPassFail(record, "first")
+	bool located = location.pageNo == pageNo && location.version != 0;
+	checkPassFail(located, true)
+	// the page was neither pinned nor counted
+	int accesses = optimisticMgr->getStatsSnapshot().accesses;
+	checkPassFail(accesses, 0)
+
+	// a change made while the reader looks is seen, and the read repeated
+	numCalls = 0;
+	optimisticMgr->readOptimistic(optimisticFile, pageNo, [&](const Page& page) {
+		if(numCalls++ == 0)
+		{
+			PageHandle writer = optimisticMgr->readPage(optimisticFile, pageNo);
+			writer.write()->updateRecord(rid, "second");
+		}
+		record = page.getRecord(rid);
+	}, &location);
+	checkPassFail(numCalls, 2)
+	checkPassFail(record, "second")
+	int retries = optimisticMgr->getStatsSnapshot().optimisticretries;
+	checkPassFail(retries, 1)
+
+	// a pinned page may be being changed, so it is read pinned
+	{
+		PageHandle pinned = optimisticMgr->readPage(optimisticFile, pageNo);
+		numCalls = 0;
+		optimisticMgr->readOptimistic(optimisticFile, pageNo, [&](const Page& page) {
+			numCalls++;
+			record = page.getRecord(rid);
+		}, &location);
+		checkPassFail(numCalls, 1)
+		BufStatsSnapshot snapshot = optimisticMgr->getStatsSnapshot();
+		bool pinnedRead = snapshot.accesses == 3 && snapshot.optimisticretries == 2;
+		checkPassFail(pinnedRead, true)
+	}
+
+	// a location left behind by the page is looked up again, and the page read back in
+	optimisticMgr->flushFile(optimisticFile);
+	std::uint64_t oldVersion = location.version;
+	optimisticMgr->readOptimistic(optimisticFile, pageNo, [&](const Page& page) {
+		record = page.getRecord(rid);
+	}, &location);
+	bool reread = record == "second" && location.version != oldVersion;
+	checkPassFail(reread, true)
+
+	// a location only counts for the buffer manager that filled it in
+	{
+		BufMgr otherMgr(4);
+		PageLocation otherLocation = location;
+		otherMgr.readOptimistic(optimisticFile, pageNo, [&](const Page& page) {
+			record = page.getRecord(rid);
+		}, &otherLocation);
+		bool relocated = record == "second" && otherLocation.bufMgr == &otherMgr;
+		checkPassFail(relocated, true)
+		otherMgr.flushFile(optimisticFile);
+	}
+
+	// errors of a read that saw the page unchanged are passed on
+	bool thrown = false;
+	try
+	{
+		optimisticMgr->readOptimistic(optimisticFile, pageNo, [&](const Page& page) {
+			page.getRecord(RecordId{pageNo, 100});
+		}, &location);
+	}
+	catch(const InvalidRecordException& e)
+	{
+		thrown = true;
+	}
+	checkPassFail(thrown, true)
+
+	// readers on several threads share the page without pinning it
+	std::atomic<int> numWrong(0);
+	std::vector<std::thread> readers;
+	for(int t = 0; t < 4; t++)
+	{
+		readers.push_back(std::thread([&]() {
+			PageLocation threadLocation;
+			for(int i = 0; i < 1000; i++)
+			{
+				std::string seen;
+				optimisticMgr->readOptimistic(optimisticFile, pageNo, [&](const Page& page) {
+					seen = page.getRecord(rid);
+				}, &threadLocation);
+				if(seen != "second")
+					numWrong++;
+			}
+		}));
+	}
+	for(std::size_t t = 0; t < readers.size(); t++)
+		readers[t].join();
+	int wrong = numWrong;
+	checkPassFail(wrong, 0)
+
+	optimisticMgr->flushFile(optimisticFile);
+	delete optimisticMgr;
+	delete optimisticFile;
+	File::remove(optimisticRelationName);
 }
 
 void test1()
@@ -203,6 +2050,82 @@ void test3()
 	deleteRelation();
 }
 
+void compressedIndexTests()
+{
+	// Build an index compressed and uncompressed and check the compressed file
+	// is smaller, then run the index tests against compressed indexes.
+	std::cout << "--------------------" << std::endl;
+	std::cout << "compressedIndexTests" << std::endl;
+	createRelationForward();
+	std::streamoff indexFileSize[2];
+	for(int compressed = 0; compressed < 2; compressed++)
+	{
+		std::string indexName;
+		{
+			BTreeIndex index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER, compressed == 1);
+		}
+		std::ifstream indexFile(indexName, std::ios::binary | std::ios::ate);
+		indexFileSize[compressed] = indexFile.tellg();
+		indexFile.close();
+		File::remove(indexName);
+	}
+	bool compressedIsSmaller = indexFileSize[1] < indexFileSize[0];
+	checkPassFail(compressedIsSmaller, true)
+
+	compressIndexes = true;
+	indexTests();
+	compressIndexes = false;
+	deleteRelation();
+}
+
+void tryScanNextTests()
+{
+	// The non-throwing scans must return the same records as scanNext() does,
+	// in key order for an index, and keep returning false once they end.
+	std::cout << "--------------------" << std::endl;
+	std::cout << "tryScanNextTests" << std::endl;
+	createRelationForward();
+
+	{
+		FileScan fscan(relationName, bufMgr);
+		RecordId scanRid;
+		int numRecords = 0;
+		while(fscan.tryScanNext(scanRid))
+			numRecords++;
+		checkPassFail(numRecords, relationSize)
+		bool stillEnded = !fscan.tryScanNext(scanRid);
+		checkPassFail(stillEnded, true)
+	}
+
+	std::string indexName;
+	{
+		BTreeIndex index(relationName, indexName, bufMgr, offsetof(tuple,i), INTEGER);
+		int lowVal = 300;
+		int highVal = 400;
+		index.startScan(&lowVal, GT, &highVal, LT);
+		RecordId scanRid;
+		int numResults = 0;
+		int numOutOfOrder = 0;
+		int lastKey = lowVal;
+		while(index.tryScanNext(scanRid))
+		{
+			PageHandle page = bufMgr->readPage(file1, scanRid.page_number);
+			int key = reinterpret_cast<const RECORD*>(page.get()->getRecord(scanRid).data())->i;
+			if(key <= lastKey || key >= highVal)
+				numOutOfOrder++;
+			lastKey = key;
+			numResults++;
+		}
+		checkPassFail(numResults, 99)
+		checkPassFail(numOutOfOrder, 0)
+		bool stillEnded = !index.tryScanNext(scanRid);
+		checkPassFail(stillEnded, true)
+		index.endScan();
+	}
+	File::remove(indexName);
+	deleteRelation();
+}
+
 void test4()
 {
   // Create a relation with tuples valued 0 to relationSize in random order and perform index tests
@@ -224,43 +2147,30 @@ void createRelationForward()
   // destroy any old copies of relation file
 	try
 	{
-		File::remove(relationName);
+		HeapFile::remove(relationName);
 	}
 	catch(FileNotFoundException e)
 	{
 	}
 
-  file1 = new PageFile(relationName, true);
+  HeapFile* relation = new HeapFile(relationName, bufMgr);
 
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-  Page new_page = file1->allocatePage(new_page_number);
 
-  // Insert a bunch of tuples into the relation.
+  // Insert a bunch of tuples into the relation, a whole batch at a time.
+	std::vector<std::string> records;
+	records.reserve(relationSize);
   for(int i = 0; i < relationSize; i++ )
 	{
     sprintf(record1.s, "%05d string record", i);
     record1.i = i;
     record1.d = (double)i;
-    std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
-
-		while(1)
-		{
-			try
-			{
-    		new_page.insertRecord(new_data);
-				break;
-			}
-			catch(InsufficientSpaceException e)
-			{
-				file1->writePage(new_page_number, new_page);
-  			new_page = file1->allocatePage(new_page_number);
-			}
-		}
+    records.push_back(std::string(reinterpret_cast<char*>(&record1), sizeof(record1)));
   }
-
-	file1->writePage(new_page_number, new_page);
+	ridVec = relation->insertRecords(records);
+	delete relation;
+  file1 = new PageFile(relationName, false);
 }
 
 // -----------------------------------------------------------------------------
@@ -272,17 +2182,15 @@ void createRelationBackward()
   // destroy any old copies of relation file
 	try
 	{
-		File::remove(relationName);
+		HeapFile::remove(relationName);
 	}
 	catch(FileNotFoundException e)
 	{
 	}
-  file1 = new PageFile(relationName, true);
+  HeapFile* relation = new HeapFile(relationName, bufMgr);
 
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-  Page new_page = file1->allocatePage(new_page_number);
 
   // Insert a bunch of tuples into the relation.
   for(int i = relationSize - 1; i >= 0; i-- )
@@ -293,22 +2201,10 @@ void createRelationBackward()
 
     std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
 
-		while(1)
-		{
-			try
-			{
-    		new_page.insertRecord(new_data);
-				break;
-			}
-			catch(InsufficientSpaceException e)
-			{
-				file1->writePage(new_page_number, new_page);
-  			new_page = file1->allocatePage(new_page_number);
-			}
-		}
+		relation->insertRecord(new_data);
   }
-
-	file1->writePage(new_page_number, new_page);
+	delete relation;
+  file1 = new PageFile(relationName, false);
 }
 
 // -----------------------------------------------------------------------------
@@ -320,17 +2216,15 @@ void createRelationRandom()
   // destroy any old copies of relation file
 	try
 	{
-		File::remove(relationName);
+		HeapFile::remove(relationName);
 	}
 	catch(FileNotFoundException e)
 	{
 	}
-  file1 = new PageFile(relationName, true);
+  HeapFile* relation = new HeapFile(relationName, bufMgr);
 
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-  Page new_page = file1->allocatePage(new_page_number);
 
   // insert records in random order
 
@@ -353,27 +2247,15 @@ void createRelationRandom()
 
     std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
 
-		while(1)
-		{
-			try
-			{
-    		new_page.insertRecord(new_data);
-				break;
-			}
-			catch(InsufficientSpaceException e)
-			{
-      	file1->writePage(new_page_number, new_page);
-  			new_page = file1->allocatePage(new_page_number);
-			}
-		}
+		relation->insertRecord(new_data);
 
 		int temp = intvec[relationSize-1-i];
 		intvec[relationSize-1-i] = intvec[pos];
 		intvec[pos] = temp;
 		i++;
   }
-  
-	file1->writePage(new_page_number, new_page);
+	delete relation;
+  file1 = new PageFile(relationName, false);
 }
 
 // -----------------------------------------------------------------------------
@@ -460,7 +2342,7 @@ void indexDeleteTests()
 void intTests()
 {
   std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, compressIndexes);
 
 	// run some tests
 	checkPassFail(intScan(&index,25,GT,40,LT), 14)
@@ -532,7 +2414,7 @@ void doubleDeleteTests()
 int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
 {
   RecordId scanRid;
-	Page *curPage;
+	PageHandle curPage;
 
   std::cout << "Scan for ";
   if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
@@ -557,9 +2439,9 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
 		try
 		{
 			index->scanNext(scanRid);
-			bufMgr->readPage(file1, scanRid.page_number, curPage);
-			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
-			bufMgr->unPinPage(file1, scanRid.page_number, false);
+			curPage = bufMgr->readPage(file1, scanRid.page_number);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage.get()->getRecord(scanRid).data()));
+			curPage.release();
 
 			if( numResults < 5 )
 			{
@@ -596,7 +2478,7 @@ int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operato
 void doubleTests()
 {
   std::cout << "Create a B+ Tree index on the double field" << std::endl;
-  BTreeIndex index(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE);
+  BTreeIndex index(relationName, doubleIndexName, bufMgr, offsetof(tuple,d), DOUBLE, compressIndexes);
 
 	// run some tests
 	checkPassFail(doubleScan(&index,25,GT,40,LT), 14)
@@ -614,7 +2496,7 @@ void doubleTests()
 int doubleScan(BTreeIndex * index, double lowVal, Operator lowOp, double highVal, Operator highOp)
 {
   RecordId scanRid;
-	Page *curPage;
+	PageHandle curPage;
 
   std::cout << "Scan for ";
   if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
@@ -639,9 +2521,9 @@ int doubleScan(BTreeIndex * index, double lowVal, Operator lowOp, double highVal
 		try
 		{
 			index->scanNext(scanRid);
-			bufMgr->readPage(file1, scanRid.page_number, curPage);
-			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
-			bufMgr->unPinPage(file1, scanRid.page_number, false);
+			curPage = bufMgr->readPage(file1, scanRid.page_number);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage.get()->getRecord(scanRid).data()));
+			curPage.release();
 
 			if( numResults < 5 )
 			{
@@ -678,7 +2560,7 @@ int doubleScan(BTreeIndex * index, double lowVal, Operator lowOp, double highVal
 void stringTests()
 {
   std::cout << "Create a B+ Tree index on the string field" << std::endl;
-  BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING);
+  BTreeIndex index(relationName, stringIndexName, bufMgr, offsetof(tuple,s), STRING, compressIndexes);
 
 	// run some tests
 	checkPassFail(stringScan(&index,25,GT,40,LT), 14)
@@ -696,7 +2578,7 @@ void stringTests()
 int stringScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
 {
   RecordId scanRid;
-	Page *curPage;
+	PageHandle curPage;
 
   std::cout << "Scan for ";
   if( lowOp == GT ) { std::cout << "("; } else { std::cout << "["; }
@@ -726,9 +2608,9 @@ int stringScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Oper
 		try
 		{
 			index->scanNext(scanRid);
-			bufMgr->readPage(file1, scanRid.page_number, curPage);
-			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(scanRid).data()));
-			bufMgr->unPinPage(file1, scanRid.page_number, false);
+			curPage = bufMgr->readPage(file1, scanRid.page_number);
+			RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage.get()->getRecord(scanRid).data()));
+			curPage.release();
 
 			if( numResults < 5 )
 			{
@@ -770,18 +2652,16 @@ void errorTests()
 
 	try
 	{
-		File::remove(relationName);
+		HeapFile::remove(relationName);
 	}
 	catch(FileNotFoundException e)
 	{
 	}
 
-  file1 = new PageFile(relationName, true);
-	
+  HeapFile* relation = new HeapFile(relationName, bufMgr);
+
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-  Page new_page = file1->allocatePage(new_page_number);
 
   // Insert a bunch of tuples into the relation.
 	for(int i = 0; i <10; i++ ) 
@@ -791,22 +2671,10 @@ void errorTests()
     record1.d = (double)i;
     std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
 
-		while(1)
-		{
-			try
-			{
-    		new_page.insertRecord(new_data);
-				break;
-			}
-			catch(InsufficientSpaceException e)
-			{
-				file1->writePage(new_page_number, new_page);
-  			new_page = file1->allocatePage(new_page_number);
-			}
-		}
+		relation->insertRecord(new_data);
   }
-
-	file1->writePage(new_page_number, new_page);
+	delete relation;
+  file1 = new PageFile(relationName, false);
 
   BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
 	
@@ -837,6 +2705,26 @@ void errorTests()
 		std::cout << "ScanNotInitialized Test 2 Passed." << std::endl;
 	}
 	
+	std::cout << "Call scanNext after the scan is completed" << std::endl;
+	{
+		RecordId foo;
+		int numScanned = 0;
+		index.startScan(&int2, GTE, &int5, LTE);
+		while(index.tryScanNext(foo))
+			numScanned++;
+		try
+		{
+			index.scanNext(foo);
+			std::cout << "IndexScanCompletedException Test 1 Failed." << std::endl;
+		}
+		catch(const IndexScanCompletedException& e)
+		{
+			std::cout << "IndexScanCompletedException Test 1 Passed." << std::endl;
+		}
+		index.endScan();
+		checkPassFail(numScanned, 4)
+	}
+
 	std::cout << "Scan with bad lowOp" << std::endl;
 	try
 	{
@@ -871,6 +2759,37 @@ void errorTests()
 		std::cout << "BadScanrangeException Test 1 Passed." << std::endl;
 	}
 
+	std::cout << "Open a file created with a different page size" << std::endl;
+	{
+		const std::string otherName = relationName + ".other";
+		try
+		{
+			File::remove(otherName);
+		}
+		catch(const FileNotFoundException& e)
+		{
+		}
+		{
+			PageFile otherFile = PageFile::create(otherName);
+		}
+		{
+			std::fstream otherStream(otherName, std::fstream::in | std::fstream::out | std::fstream::binary);
+			std::uint32_t otherPageSize = Page::SIZE * 2;
+			otherStream.seekp(offsetof(FileHeader, page_size), std::ios::beg);
+			otherStream.write(reinterpret_cast<char*>(&otherPageSize), sizeof(otherPageSize));
+		}
+		try
+		{
+			PageFile otherFile = PageFile::open(otherName);
+			std::cout << "PageSizeMismatchException Test 1 Failed." << std::endl;
+		}
+		catch(const PageSizeMismatchException& e)
+		{
+			std::cout << "PageSizeMismatchException Test 1 Passed." << std::endl;
+		}
+		File::remove(otherName);
+	}
+
 	deleteRelation();
 }
 
@@ -884,7 +2803,7 @@ void deleteRelation()
 	}
 	try
 	{
-		File::remove(relationName);
+		HeapFile::remove(relationName);
 	}
 	catch(FileNotFoundException e)
 	{
@@ -5,7 +5,10 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <vector>
 
 #include <iostream>
 #include "exceptions/insufficient_space_exception.h"
@@ -27,6 +30,8 @@ void Page::initialize() {
   header_.free_space_upper_bound = DATA_SIZE;
   header_.num_slots = 0;
   header_.num_free_slots = 0;
+  header_.fragmented_bytes = 0;
+  header_.free_slot_hint = 1;
   header_.current_page_number = INVALID_NUMBER;
   header_.next_page_number = INVALID_NUMBER;
   //data_.assign(DATA_SIZE, char());
@@ -38,17 +43,77 @@ RecordId Page::insertRecord(const std::string& record_data) {
     throw InsufficientSpaceException(
         page_number(), record_data.length(), getFreeSpace());
   }
+  // A new slot has to come out of the contiguous free space as well, so make
+  // room for both before the slot array grows.
+  std::size_t record_size = record_data.length();
+  if (header_.num_free_slots == 0) {
+    record_size += sizeof(PageSlot);
+  }
+  if (getContiguousFreeSpace() < record_size) {
+    compact();
+  }
   const SlotId slot_number = getAvailableSlot();
   insertRecordInSlot(slot_number, record_data);
   return {page_number(), slot_number};
 }
 
+std::size_t Page::insertRecords(const std::vector<std::string>& records,
+                                const std::size_t first,
+                                std::vector<RecordId>& record_ids) {
+  std::size_t next = first;
+  // Free slots only exist after deletes; fill them one record at a time.
+  while (next < records.size() && header_.num_free_slots > 0 &&
+         hasSpaceForRecord(records[next])) {
+    record_ids.push_back(insertRecord(records[next]));
+    ++next;
+  }
+  if (header_.num_free_slots > 0) {
+    return next - first;
+  }
+
+  // Every remaining record needs a new slot.  Work out how many fit before
+  // touching the page.
+  std::size_t free_space = getFreeSpace();
+  std::size_t batch_size = 0;
+  std::size_t last = next;
+  while (last < records.size() &&
+         records[last].length() + sizeof(PageSlot) <= free_space) {
+    free_space -= records[last].length() + sizeof(PageSlot);
+    batch_size += records[last].length() + sizeof(PageSlot);
+    ++last;
+  }
+  if (last == next) {
+    return next - first;
+  }
+  if (getContiguousFreeSpace() < batch_size) {
+    compact();
+  }
+
+  std::uint16_t upper_bound = header_.free_space_upper_bound;
+  SlotId slot_number = header_.num_slots;
+  record_ids.reserve(record_ids.size() + (last - next));
+  for (; next < last; ++next) {
+    const std::string& record_data = records[next];
+    ++slot_number;
+    upper_bound -= record_data.length();
+    PageSlot* slot = getSlot(slot_number);
+    slot->used = true;
+    slot->item_offset = upper_bound;
+    slot->item_length = record_data.length();
+    memcpy(&data_[upper_bound], record_data.data(), record_data.length());
+    record_ids.push_back({page_number(), slot_number});
+  }
+  header_.num_slots = slot_number;
+  header_.free_space_lower_bound = sizeof(PageSlot) * slot_number;
+  header_.free_space_upper_bound = upper_bound;
+  header_.free_slot_hint = slot_number + 1;
+  return next - first;
+}
+
 std::string Page::getRecord(const RecordId& record_id) const {
   validateRecordId(record_id);
   const PageSlot& slot = getSlot(record_id.slot_number);
-	std::string retStr = std::string(data_, DATA_SIZE).substr(slot.item_offset, slot.item_length);
-
-	return retStr;
+  return std::string(&data_[slot.item_offset], slot.item_length);
 }
 
 void Page::updateRecord(const RecordId& record_id,
@@ -77,42 +142,23 @@ void Page::deleteRecord(const RecordId& record_id,
   validateRecordId(record_id);
   PageSlot* slot = getSlot(record_id.slot_number);
 
-	for(int i = 0; i < slot->item_length; i++)
-		data_[i + slot->item_offset] = '\0';
-
-  //data_.replace(slot->item_offset, slot->item_length, slot->item_length, '\0');
-
-  // Compact the data by removing the hole left by this record (if necessary).
-  std::uint16_t move_offset = slot->item_offset; 
-  std::size_t move_bytes = 0;
-  for (SlotId i = 1; i <= header_.num_slots; ++i) {
-    PageSlot* other_slot = getSlot(i);
-    if (other_slot->used && other_slot->item_offset < slot->item_offset) {
-      if (other_slot->item_offset < move_offset) {
-        move_offset = other_slot->item_offset;
-      }
-      move_bytes += other_slot->item_length;
-      // Update the slot for the other data to reflect the soon-to-be-new
-      // location.
-      other_slot->item_offset += slot->item_length;
-    }
-  }
-  // If we have data to move, shift it to the right.
-  if (move_bytes > 0) {
-    const std::string& data_to_move = std::string(data_, DATA_SIZE).substr(move_offset, move_bytes);
-
-		for(std::uint16_t i = 0; i < move_bytes; i++)
-			data_[i + move_offset + slot->item_length] = data_to_move[i];
-
-    //data_.replace(move_offset + slot->item_length, move_bytes, data_to_move);
+  // The record is left where it is.  If it borders the free space it can be
+  // handed back right away, otherwise it becomes a hole that is reclaimed by
+  // compact() once an insert runs out of contiguous space.
+  if (slot->item_offset == header_.free_space_upper_bound) {
+    header_.free_space_upper_bound += slot->item_length;
+  } else {
+    header_.fragmented_bytes += slot->item_length;
   }
-  header_.free_space_upper_bound += slot->item_length;
 
   // Mark slot as unused.
   slot->used = false;
   slot->item_offset = 0;
   slot->item_length = 0;
   ++header_.num_free_slots;
+  if (record_id.slot_number < header_.free_slot_hint) {
+    header_.free_slot_hint = record_id.slot_number;
+  }
 
   if (allow_slot_compaction && record_id.slot_number == header_.num_slots) {
     // Last slot in the list, so we need to free any unused slots that are at
@@ -132,7 +178,39 @@ void Page::deleteRecord(const RecordId& record_id,
     header_.num_slots -= num_slots_to_delete;
     header_.num_free_slots -= num_slots_to_delete;
     header_.free_space_lower_bound -= sizeof(PageSlot) * num_slots_to_delete;
+    if (header_.free_slot_hint > header_.num_slots) {
+      header_.free_slot_hint = header_.num_slots + 1;
+    }
+  }
+}
+
+void Page::compact() {
+  std::vector<SlotId> used_slots;
+  used_slots.reserve(header_.num_slots - header_.num_free_slots);
+  for (SlotId i = 1; i <= header_.num_slots; ++i) {
+    if (getSlot(i)->used) {
+      used_slots.push_back(i);
+    }
+  }
+  // Walk the records from the end of the page towards the slot array.  Each
+  // record only ever moves towards the end, so it can never overwrite a record
+  // that has not been moved yet.
+  std::sort(used_slots.begin(), used_slots.end(),
+            [this](const SlotId a, const SlotId b) {
+              return getSlot(a)->item_offset > getSlot(b)->item_offset;
+            });
+  std::uint16_t upper_bound = DATA_SIZE;
+  for (std::size_t i = 0; i < used_slots.size(); ++i) {
+    PageSlot* slot = getSlot(used_slots[i]);
+    upper_bound -= slot->item_length;
+    if (slot->item_offset != upper_bound) {
+      memmove(&data_[upper_bound], &data_[slot->item_offset],
+              slot->item_length);
+      slot->item_offset = upper_bound;
+    }
   }
+  header_.free_space_upper_bound = upper_bound;
+  header_.fragmented_bytes = 0;
 }
 
 bool Page::hasSpaceForRecord(const std::string& record_data) const {
@@ -154,13 +232,15 @@ const PageSlot& Page::getSlot(const SlotId slot_number) const {
 SlotId Page::getAvailableSlot() {
   SlotId slot_number = INVALID_SLOT;
   if (header_.num_free_slots > 0) {
-    // Have an allocated but unused slot that we can reuse.
-    for (SlotId i = 1; i <= header_.num_slots; ++i) {
+    // Have an allocated but unused slot that we can reuse.  Nothing below the
+    // hint is free, so start looking there.
+    for (SlotId i = header_.free_slot_hint; i <= header_.num_slots; ++i) {
       const PageSlot* slot = getSlot(i);
       if (!slot->used) {
         // We don't decrement the number of free slots until someone actually
         // puts data in the slot.
         slot_number = i;
+        header_.free_slot_hint = i;
         break;
       }
     }
@@ -186,22 +266,29 @@ void Page::insertRecordInSlot(const SlotId slot_number,
     throw SlotInUseException(page_number(), slot_number);
   }
   const int record_length = record_data.length();
+  if (getContiguousFreeSpace() < record_length) {
+    compact();
+  }
   slot->used = true;
   slot->item_length = record_length;
   slot->item_offset = header_.free_space_upper_bound - record_length;
   header_.free_space_upper_bound = slot->item_offset;
   --header_.num_free_slots;
+  if (slot_number == header_.free_slot_hint) {
+    ++header_.free_slot_hint;
+  }
 
-	for(int i = 0; i < slot->item_length; i++)
-		data_[i + slot->item_offset] = record_data[i];
-
-  //data_.replace(slot->item_offset, slot->item_length, record_data);
+  memcpy(&data_[slot->item_offset], record_data.data(), slot->item_length);
 }
 
 void Page::validateRecordId(const RecordId& record_id) const {
   if (record_id.page_number != page_number()) {
     throw InvalidRecordException(record_id, page_number());
   }
+  if (record_id.slot_number == INVALID_SLOT ||
+      record_id.slot_number > header_.num_slots) {
+    throw InvalidRecordException(record_id, page_number());
+  }
   const PageSlot& slot = getSlot(record_id.slot_number);
   if (!slot.used) {
     throw InvalidRecordException(record_id, page_number());
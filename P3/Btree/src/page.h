@@ -11,10 +11,19 @@
 #include <stdint.h>
 #include <memory>
 #include <string>
+#include <vector>
 
 //#include <gtest/gtest.h>
 #include "types.h"
 
+/**
+ * Size of a page in bytes.  Pass -DBADGERDB_PAGE_SIZE=<bytes> to build with a
+ * different page size.
+ */
+#ifndef BADGERDB_PAGE_SIZE
+#define BADGERDB_PAGE_SIZE 8192
+#endif
+
 namespace badgerdb {
 
 /**
@@ -48,6 +57,18 @@ struct PageHeader {
    */
   SlotId num_free_slots;
 
+  /**
+   * Number of bytes held by deleted records that have not been reclaimed yet.
+   * The data area is only compacted once an insert needs the space.
+   */
+  std::uint16_t fragmented_bytes;
+
+  /**
+   * No unused slot has a number lower than this one, so searches for a
+   * reusable slot can start here instead of at the first slot.
+   */
+  SlotId free_slot_hint;
+
   /**
    * Number of the page within the file.
    */
@@ -108,10 +129,11 @@ class PageIterator;
 class Page {
  public:
   /**
-   * Page size in bytes.  If this is changed, database files created with a
-   * different page size value will be unreadable by the resulting binaries.
+   * Page size in bytes.  Set at build time through BADGERDB_PAGE_SIZE; files
+   * record the page size they were created with and are rejected by binaries
+   * built with a different one.
    */
-  static const std::size_t SIZE = 8192;
+  static const std::size_t SIZE = BADGERDB_PAGE_SIZE;
 
   /**
    * Size of page free space area in bytes.
@@ -141,6 +163,22 @@ class Page {
    */
   RecordId insertRecord(const std::string& record_data);
 
+  /**
+   * Inserts as many records as fit on the page, in order, starting with
+   * records[first].  Records that need a new slot are packed in a single pass
+   * and the page header is updated once for all of them, so this is much
+   * cheaper than calling insertRecord for each record when loading a page.
+   *
+   * @param records     Records to insert.
+   * @param first       Index of the first record in <records> to insert.
+   * @param record_ids  IDs of the inserted records are appended to this.
+   * @return  Number of records inserted; less than records.size() - first if
+   *          the page filled up.
+   */
+  std::size_t insertRecords(const std::vector<std::string>& records,
+                            const std::size_t first,
+                            std::vector<RecordId>& record_ids);
+
   /**
    * Returns the record with the given ID.  Returned data is a copy of what is
    * stored on the page; use updateRecord to change it.
@@ -162,9 +200,9 @@ class Page {
   void updateRecord(const RecordId& record_id, const std::string& record_data);
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array.
+   * Deletes the record with the given ID.  The slot is only marked unused; the
+   * space the record held is reclaimed by the next insert that needs it.  Slot
+   * array is compacted if the slot deleted is at the end of the slot array.
    *
    * @param record_id   ID of the record to delete.
    */
@@ -179,12 +217,13 @@ class Page {
   bool hasSpaceForRecord(const std::string& record_data) const;
 
   /**
-   * Returns this page's free space in bytes.
+   * Returns this page's free space in bytes.  This includes space left behind
+   * by deleted records, which is reclaimed when an insert needs it.
    *
    * @return  Free space in bytes.
    */
-  std::uint16_t getFreeSpace() const { return header_.free_space_upper_bound -
-                                              header_.free_space_lower_bound; }
+  std::uint16_t getFreeSpace() const { return getContiguousFreeSpace() +
+                                              header_.fragmented_bytes; }
 
   /**
    * Returns this page's number in its file.
@@ -240,10 +279,9 @@ class Page {
   }
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array and
-   * <allow_slot_compaction> is set.
+   * Deletes the record with the given ID.  The record's bytes are left in place
+   * and counted as fragmented space.  Slot array is compacted if the slot
+   * deleted is at the end of the slot array and <allow_slot_compaction> is set.
    *
    * @param record_id             ID of the record to delete.
    * @param allow_slot_compaction If true, the slot array will be compacted if
@@ -252,6 +290,23 @@ class Page {
   void deleteRecord(const RecordId& record_id,
                     const bool allow_slot_compaction);
 
+  /**
+   * Returns the number of unused bytes between the slot array and the first
+   * record, which is the space an insert can use without compacting.
+   *
+   * @return  Contiguous free space in bytes.
+   */
+  std::uint16_t getContiguousFreeSpace() const {
+    return header_.free_space_upper_bound - header_.free_space_lower_bound;
+  }
+
+  /**
+   * Moves all records to the end of the data area in a single pass so that
+   * the space left by deleted records becomes contiguous free space again.
+   * Record IDs are not affected.
+   */
+  void compact();
+
   /**
    * Returns the slot with the given number.  This method will return
    * unallocated slots if requested; it is up to the caller to ensure they
@@ -274,7 +329,8 @@ class Page {
 
   /**
    * Returns the slot number of an available slot.  If no slots are available
-   * to be reused, allocates a new slot.  Updates available slot count in the
+   * to be reused, allocates a new slot.  The search for a reusable slot starts
+   * at <header_.free_slot_hint>.  Updates available slot count in the
    * header metadata, but does not mark returned slot as used.  If a new slot is
    * allocated, updates the free space lower bound.
    *
@@ -290,7 +346,8 @@ class Page {
 
   /**
    * Inserts record data into the given slot.  The slot should not be currently
-   * in use.  <slot_number> must be less than <header_.num_slots>.
+   * in use.  <slot_number> must be less than <header_.num_slots>.  The page is
+   * compacted first if the record does not fit in the contiguous free space.
    *
    * Callers are responsible for making sure there is enough space to hold the
    * record before calling this method.
@@ -337,11 +394,15 @@ class Page {
   friend class PageFile;
   friend class BlobFile;
   friend class PageIterator;
+  friend class PaxPage;
 };
 
 static_assert(Page::SIZE > sizeof(PageHeader),
               "Page size must be large enough to hold header and data.");
 static_assert(Page::DATA_SIZE > 0,
               "Page must have some space to hold data.");
+static_assert(Page::DATA_SIZE <= UINT16_MAX,
+              "Offsets within a page are 16 bits wide, so a page can hold at "
+              "most 65535 bytes of data.");
 
 }
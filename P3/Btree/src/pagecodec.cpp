@@ -0,0 +1,188 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "pagecodec.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Shortest back reference worth encoding.
+ */
+const std::size_t MIN_MATCH = 4;
+
+/**
+ * Longest distance a back reference can reach.
+ */
+const std::size_t MAX_OFFSET = 65535;
+
+/**
+ * Log2 of the number of entries in the match finder's hash table.
+ */
+const int HASH_BITS = 12;
+
+std::uint32_t read32(const unsigned char* p) {
+  std::uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+std::uint32_t hashSequence(const std::uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/**
+ * Appends the part of a literal or match length that didn't fit in its token
+ * nibble: a run of 255 bytes followed by the remainder.
+ */
+void writeLength(std::string& out, std::size_t length) {
+  while (length >= 255) {
+    out.push_back(static_cast<char>(255));
+    length -= 255;
+  }
+  out.push_back(static_cast<char>(length));
+}
+
+/**
+ * Reads a length written by writeLength() and adds it to <length>.
+ */
+bool readLength(const unsigned char*& in, const unsigned char* in_end,
+                std::size_t& length) {
+  unsigned char byte;
+  do {
+    if (in == in_end) {
+      return false;
+    }
+    byte = *in++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/**
+ * Appends a token, its literals and, if <match_length> is non-zero, a back
+ * reference.
+ */
+void writeSequence(std::string& out, const unsigned char* literals,
+                   const std::size_t literal_length, const std::size_t offset,
+                   const std::size_t match_length) {
+  const std::size_t match_code = match_length == 0 ? 0 : match_length - MIN_MATCH;
+  const unsigned char token =
+      ((literal_length < 15 ? literal_length : 15) << 4) |
+      (match_code < 15 ? match_code : 15);
+  out.push_back(static_cast<char>(token));
+  if (literal_length >= 15) {
+    writeLength(out, literal_length - 15);
+  }
+  out.append(reinterpret_cast<const char*>(literals), literal_length);
+  if (match_length == 0) {
+    return;
+  }
+  out.push_back(static_cast<char>(offset & 0xFF));
+  out.push_back(static_cast<char>(offset >> 8));
+  if (match_code >= 15) {
+    writeLength(out, match_code - 15);
+  }
+}
+
+}
+
+void PageCodec::compress(const char* data, const std::size_t length,
+                         std::string& out) {
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(data);
+  out.clear();
+  out.reserve(length / 2);
+
+  // Most recent position at which each hashed 4-byte sequence was seen.
+  std::int32_t table[1 << HASH_BITS];
+  for (std::size_t i = 0; i < (1 << HASH_BITS); ++i) {
+    table[i] = -1;
+  }
+
+  std::size_t anchor = 0;
+  std::size_t pos = 0;
+  while (pos + MIN_MATCH <= length) {
+    const std::uint32_t sequence = read32(in + pos);
+    const std::uint32_t hash = hashSequence(sequence);
+    const std::int32_t candidate = table[hash];
+    table[hash] = pos;
+    if (candidate < 0 || pos - candidate > MAX_OFFSET ||
+        read32(in + candidate) != sequence) {
+      ++pos;
+      continue;
+    }
+    // The match may overlap the bytes it produces, which is how runs of a
+    // single value get encoded.
+    std::size_t match_length = MIN_MATCH;
+    while (pos + match_length < length &&
+           in[candidate + match_length] == in[pos + match_length]) {
+      ++match_length;
+    }
+    writeSequence(out, in + anchor, pos - anchor, pos - candidate,
+                  match_length);
+    pos += match_length;
+    anchor = pos;
+  }
+  // The last sequence carries the remaining literals and no match.
+  writeSequence(out, in + anchor, length - anchor, 0, 0);
+}
+
+bool PageCodec::decompress(const char* data, const std::size_t length,
+                           char* out, const std::size_t out_length) {
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(data);
+  const unsigned char* in_end = in + length;
+  unsigned char* op = reinterpret_cast<unsigned char*>(out);
+  unsigned char* const op_start = op;
+  unsigned char* const op_end = op + out_length;
+
+  while (in < in_end) {
+    const unsigned char token = *in++;
+    std::size_t literal_length = token >> 4;
+    if (literal_length == 15 && !readLength(in, in_end, literal_length)) {
+      return false;
+    }
+    if (literal_length > static_cast<std::size_t>(in_end - in) ||
+        literal_length > static_cast<std::size_t>(op_end - op)) {
+      return false;
+    }
+    memcpy(op, in, literal_length);
+    in += literal_length;
+    op += literal_length;
+    if (in == in_end) {
+      // Only the last sequence ends without a match.
+      break;
+    }
+
+    if (in_end - in < 2) {
+      return false;
+    }
+    const std::size_t offset = in[0] | (in[1] << 8);
+    in += 2;
+    std::size_t match_length = token & 0x0F;
+    if (match_length == 15 && !readLength(in, in_end, match_length)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (offset == 0 || offset > static_cast<std::size_t>(op - op_start) ||
+        match_length > static_cast<std::size_t>(op_end - op)) {
+      return false;
+    }
+    // Copy byte by byte, since the source may overlap what is being written.
+    const unsigned char* match = op - offset;
+    for (std::size_t i = 0; i < match_length; ++i) {
+      op[i] = match[i];
+    }
+    op += match_length;
+  }
+  return op == op_end;
+}
+
+}
@@ -0,0 +1,53 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace badgerdb {
+
+/**
+ * @brief Fast LZ77-style compressor for page images.
+ *
+ * The encoded form follows the LZ4 block format: a sequence of tokens, each
+ * giving a run of literal bytes followed by a back reference of at least four
+ * bytes into the output produced so far.  Compression uses a single hash
+ * table probe per position, which is enough to collapse the zeroed tails and
+ * repeated values that make up much of a typical index or data page, and
+ * decompression is a simple copy loop.
+ *
+ * Back references are limited to 65535 bytes, which covers any page.
+ */
+class PageCodec {
+ public:
+  /**
+   * Compresses a buffer.
+   *
+   * @param data    Bytes to compress.
+   * @param length  Number of bytes to compress.
+   * @param out     Replaced with the compressed bytes.
+   */
+  static void compress(const char* data, const std::size_t length,
+                       std::string& out);
+
+  /**
+   * Decompresses a buffer produced by compress().
+   *
+   * @param data        Compressed bytes.
+   * @param length      Number of compressed bytes.
+   * @param out         Buffer to decompress into.
+   * @param out_length  Exact number of bytes the data decompresses to.
+   * @return  False if the compressed data is corrupt or does not decompress
+   *          to exactly <out_length> bytes.
+   */
+  static bool decompress(const char* data, const std::size_t length,
+                         char* out, const std::size_t out_length);
+};
+
+}
@@ -0,0 +1,94 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "pagedirectory.h"
+
+namespace badgerdb {
+
+const PageId PageDirectory::SPAN;
+const std::size_t PageDirectory::WORDS_PER_PAGE;
+
+static_assert(Page::SIZE % sizeof(std::uint64_t) == 0,
+              "Directory pages must hold a whole number of bitmap words.");
+
+char* PageDirectory::directoryPageData(const PageId directory_page) {
+  const std::size_t first_word = (directory_page - 1) / 64;
+  if (words_.size() < first_word + WORDS_PER_PAGE) {
+    words_.resize(first_word + WORDS_PER_PAGE, 0);
+  }
+  return reinterpret_cast<char*>(&words_[first_word]);
+}
+
+std::uint64_t PageDirectory::wordFor(const PageId page_number) const {
+  const std::size_t word = (page_number - 1) / 64;
+  return word < words_.size() ? words_[word] : 0;
+}
+
+bool PageDirectory::isUsed(const PageId page_number) const {
+  if (page_number == Page::INVALID_NUMBER) {
+    return false;
+  }
+  return (wordFor(page_number) >> ((page_number - 1) % 64)) & 1;
+}
+
+void PageDirectory::setUsed(const PageId page_number, const bool used) {
+  // Keep the bitmap a whole number of directory pages long.
+  directoryPageData(directoryPageFor(page_number));
+  const std::uint64_t bit = std::uint64_t(1) << ((page_number - 1) % 64);
+  std::uint64_t& word = words_[(page_number - 1) / 64];
+  word = used ? (word | bit) : (word & ~bit);
+}
+
+PageId PageDirectory::previousUsed(const PageId page_number) const {
+  if (page_number <= 1) {
+    return Page::INVALID_NUMBER;
+  }
+  // Look at the bits below page_number's own bit, a word at a time.
+  std::size_t word = (page_number - 1) / 64;
+  std::uint64_t bits = 0;
+  if (word < words_.size()) {
+    const std::size_t bit = (page_number - 1) % 64;
+    bits = words_[word] & ((std::uint64_t(1) << bit) - 1);
+  } else {
+    word = words_.size();
+  }
+  while (bits == 0) {
+    if (word == 0) {
+      return Page::INVALID_NUMBER;
+    }
+    bits = words_[--word];
+  }
+  return word * 64 + (63 - __builtin_clzll(bits)) + 1;
+}
+
+void PageDirectory::usedPages(const PageId page_number,
+                              const std::size_t max_pages,
+                              std::vector<PageId>& pages) const {
+  if (page_number == Page::INVALID_NUMBER) {
+    return;
+  }
+  std::size_t word = (page_number - 1) / 64;
+  if (word >= words_.size()) {
+    return;
+  }
+  // Skip the bits below page_number in its word.
+  std::uint64_t bits = words_[word] & (~std::uint64_t(0) << ((page_number - 1) % 64));
+  std::size_t found = 0;
+  while (found < max_pages) {
+    while (bits == 0) {
+      if (++word == words_.size()) {
+        return;
+      }
+      bits = words_[word];
+    }
+    pages.push_back(word * 64 + __builtin_ctzll(bits) + 1);
+    bits &= bits - 1;
+    ++found;
+  }
+}
+
+}
@@ -0,0 +1,129 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Bitmap recording which pages of a PageFile are in use.
+ *
+ * Bit n - 1 of the bitmap is set when page n is in use.  On disk the bitmap
+ * is split over directory pages placed at regular intervals in the file: the
+ * first page of every run of SPAN pages is a directory page holding the bits
+ * for that run.  Directory pages are never handed out as data pages.
+ *
+ * The whole bitmap is read into memory when the file is opened, which lets a
+ * FileIterator find the used pages of a file in batches, and lets a page's
+ * neighbours in the used list be found without walking the list.
+ *
+ * @warning This class is not threadsafe.
+ */
+class PageDirectory {
+ public:
+  /**
+   * Number of pages covered by one directory page, including itself.
+   */
+  static const PageId SPAN = Page::SIZE * 8;
+
+  /**
+   * Number of bitmap words stored in one directory page.
+   */
+  static const std::size_t WORDS_PER_PAGE = Page::SIZE / sizeof(std::uint64_t);
+
+  /**
+   * Returns true if the given page number is reserved for a directory page.
+   *
+   * @param page_number  Number of page.
+   */
+  static bool isDirectoryPage(const PageId page_number) {
+    return (page_number - 1) % SPAN == 0;
+  }
+
+  /**
+   * Returns the number of the directory page holding the bit of a page.
+   *
+   * @param page_number  Number of page.
+   */
+  static PageId directoryPageFor(const PageId page_number) {
+    return (page_number - 1) / SPAN * SPAN + 1;
+  }
+
+  /**
+   * Returns the offset of the word holding the bit of a page within its
+   * directory page.
+   *
+   * @param page_number  Number of page.
+   */
+  static std::size_t wordOffsetFor(const PageId page_number) {
+    return ((page_number - 1) / 64 % WORDS_PER_PAGE) * sizeof(std::uint64_t);
+  }
+
+  /**
+   * Returns the start of the bits stored in the given directory page,
+   * growing the bitmap if needed.  Used to read directory pages from disk.
+   *
+   * @param directory_page  Number of a directory page.
+   */
+  char* directoryPageData(const PageId directory_page);
+
+  /**
+   * Returns the word holding the bit of a page.  Used to write a changed bit
+   * back to disk.
+   *
+   * @param page_number  Number of page.
+   */
+  std::uint64_t wordFor(const PageId page_number) const;
+
+  /**
+   * Returns true if the given page is in use.
+   *
+   * @param page_number  Number of page.
+   */
+  bool isUsed(const PageId page_number) const;
+
+  /**
+   * Marks a page as used or unused.
+   *
+   * @param page_number  Number of page.
+   * @param used         Whether the page is in use.
+   */
+  void setUsed(const PageId page_number, const bool used);
+
+  /**
+   * Returns the last used page before the given page, or Page::INVALID_NUMBER
+   * if there is none.
+   *
+   * @param page_number  Number of page.
+   */
+  PageId previousUsed(const PageId page_number) const;
+
+  /**
+   * Appends the numbers of up to <max_pages> used pages, starting at
+   * <page_number> and in ascending order, to a vector.
+   *
+   * @param page_number  Number of first page to consider.
+   * @param max_pages    Largest number of page numbers to append.
+   * @param pages        Vector to append the page numbers to.
+   */
+  void usedPages(const PageId page_number, const std::size_t max_pages,
+                 std::vector<PageId>& pages) const;
+
+ private:
+  /**
+   * The bitmap, 64 pages to a word.
+   */
+  std::vector<std::uint64_t> words_;
+};
+
+}
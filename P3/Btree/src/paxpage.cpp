@@ -0,0 +1,131 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "paxpage.h"
+
+#include <algorithm>
+
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/invalid_record_exception.h"
+
+namespace badgerdb {
+
+const std::uint32_t PaxPage::MAGIC;
+const std::uint16_t PaxPage::MAX_COLUMNS;
+
+void PaxPage::format(Page* page, const std::vector<PaxColumn>& columns,
+                     const std::uint16_t record_size) {
+  if (columns.empty() || columns.size() > MAX_COLUMNS) {
+    throw BadPageFormatException(page->page_number(),
+                                 "unsupported number of columns");
+  }
+  std::size_t row_width = 0;
+  for (std::size_t i = 0; i < columns.size(); ++i) {
+    if (columns[i].width == 0 ||
+        columns[i].offset + columns[i].width > record_size) {
+      throw BadPageFormatException(page->page_number(),
+                                   "column does not fit within the record");
+    }
+    row_width += columns[i].width;
+  }
+  const std::size_t metadata_size =
+      sizeof(PaxHeader) +
+      columns.size() * (sizeof(PaxColumn) + sizeof(std::uint16_t));
+  const std::size_t capacity = std::min<std::size_t>(
+      (Page::DATA_SIZE - metadata_size) / row_width, UINT16_MAX);
+  if (capacity == 0) {
+    throw BadPageFormatException(page->page_number(),
+                                 "no record fits on the page");
+  }
+
+  // Make the slotted view of the page an empty page with no free space.
+  page->header_.free_space_lower_bound = Page::DATA_SIZE;
+  page->header_.free_space_upper_bound = Page::DATA_SIZE;
+  page->header_.num_slots = 0;
+  page->header_.num_free_slots = 0;
+  page->header_.fragmented_bytes = 0;
+  page->header_.free_slot_hint = 1;
+  memset(page->data_, '\0', Page::DATA_SIZE);
+
+  PaxHeader* header = reinterpret_cast<PaxHeader*>(&page->data_[0]);
+  header->magic = MAGIC;
+  header->num_columns = columns.size();
+  header->record_size = record_size;
+  header->capacity = capacity;
+  header->num_records = 0;
+  PaxPage pax_page(page);
+  std::copy(columns.begin(), columns.end(), pax_page.columns());
+  std::uint16_t* minipage_offsets = pax_page.minipageOffsets();
+  std::size_t minipage_offset = metadata_size;
+  for (std::size_t i = 0; i < columns.size(); ++i) {
+    minipage_offsets[i] = minipage_offset;
+    minipage_offset += capacity * columns[i].width;
+  }
+}
+
+bool PaxPage::isPaxPage(const Page* page) {
+  std::uint32_t magic;
+  memcpy(&magic, &page->data_[0], sizeof(magic));
+  return page->header_.num_slots == 0 && magic == MAGIC;
+}
+
+PaxPage::PaxPage(Page* page) : page_(page) {
+  if (!isPaxPage(page)) {
+    throw BadPageFormatException(page->page_number(), "not a PAX page");
+  }
+}
+
+std::uint16_t PaxPage::insertRecord(const std::string& record_data) {
+  PaxHeader* pax_header = header();
+  if (record_data.length() != pax_header->record_size) {
+    throw BadPageFormatException(page_->page_number(),
+                                 "record size does not match the page layout");
+  }
+  if (isFull()) {
+    throw InsufficientSpaceException(page_->page_number(),
+                                     record_data.length(), 0);
+  }
+  const std::uint16_t row = pax_header->num_records;
+  const PaxColumn* pax_columns = columns();
+  const std::uint16_t* minipage_offsets = minipageOffsets();
+  for (std::uint16_t i = 0; i < pax_header->num_columns; ++i) {
+    memcpy(&page_->data_[minipage_offsets[i] + row * pax_columns[i].width],
+           record_data.data() + pax_columns[i].offset, pax_columns[i].width);
+  }
+  ++pax_header->num_records;
+  return row;
+}
+
+std::string PaxPage::getRecord(const std::uint16_t row) const {
+  const PaxHeader* pax_header = header();
+  if (row >= pax_header->num_records) {
+    throw InvalidRecordException({page_->page_number(), row},
+                                 page_->page_number());
+  }
+  std::string record_data(pax_header->record_size, '\0');
+  const PaxColumn* pax_columns = columns();
+  const std::uint16_t* minipage_offsets = minipageOffsets();
+  for (std::uint16_t i = 0; i < pax_header->num_columns; ++i) {
+    memcpy(&record_data[pax_columns[i].offset],
+           &page_->data_[minipage_offsets[i] + row * pax_columns[i].width],
+           pax_columns[i].width);
+  }
+  return record_data;
+}
+
+const char* PaxPage::getColumnData(const std::uint16_t column) const {
+  validateColumn(column);
+  return &page_->data_[minipageOffsets()[column]];
+}
+
+void PaxPage::validateColumn(const std::uint16_t column) const {
+  if (column >= header()->num_columns) {
+    throw BadPageFormatException(page_->page_number(), "no such column");
+  }
+}
+
+}
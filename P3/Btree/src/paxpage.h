@@ -0,0 +1,247 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "page.h"
+#include "exceptions/bad_page_format_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Describes one attribute of the fixed-size records kept on a PaxPage.
+ */
+struct PaxColumn {
+  /**
+   * Offset of the attribute within a record.
+   */
+  std::uint16_t offset;
+
+  /**
+   * Width of the attribute in bytes.
+   */
+  std::uint16_t width;
+};
+
+/**
+ * @brief Layout metadata stored at the start of the data area of a PaxPage.
+ *
+ * It is followed by <num_columns> PaxColumn entries and then by the offset of
+ * each column's minipage within the data area.
+ */
+struct PaxHeader {
+  /**
+   * Set to PaxPage::MAGIC on pages that use this layout.
+   */
+  std::uint32_t magic;
+
+  /**
+   * Number of attributes each record is split into.
+   */
+  std::uint16_t num_columns;
+
+  /**
+   * Size of a whole record in bytes.
+   */
+  std::uint16_t record_size;
+
+  /**
+   * Number of records the page can hold.
+   */
+  std::uint16_t capacity;
+
+  /**
+   * Number of records currently on the page.
+   */
+  std::uint16_t num_records;
+};
+
+/**
+ * @brief View of a Page that stores fixed-size records attribute by attribute.
+ *
+ * Instead of keeping whole records in slots, a PAX page splits the data area
+ * into one minipage per attribute, and the values of an attribute for all the
+ * records on the page are stored next to each other.  A scan that only needs
+ * one attribute reads a single contiguous array instead of pulling every
+ * record through the cache.
+ *
+ * The page header is left intact, so PAX pages live in an ordinary PageFile
+ * and are read and written through the BufMgr like any other page.  The
+ * slotted part of the header describes an empty page with no free space, so
+ * slotted-page calls such as Page::insertRecord and PageIterator treat a PAX
+ * page as a full page without records rather than corrupting it.
+ *
+ * Records are appended in order and identified by their row on the page; the
+ * layout does not support updating or deleting them.
+ *
+ * @warning This class is not threadsafe.
+ */
+class PaxPage {
+ public:
+  /**
+   * Value stored in PaxHeader::magic on PAX pages.
+   */
+  static const std::uint32_t MAGIC = 0x58415042;
+
+  /**
+   * Largest number of attributes a PAX page can be split into.
+   */
+  static const std::uint16_t MAX_COLUMNS = 32;
+
+  /**
+   * Lays out a page to hold records of the given size split into the given
+   * attributes.  Any records already on the page are lost; the page number
+   * and the link to the next page are kept.
+   *
+   * @param page         Page to lay out.
+   * @param columns      Attributes of each record.
+   * @param record_size  Size of a whole record in bytes.
+   * @throws  BadPageFormatException  If the attributes don't fit within a
+   *                                  record or not even one record fits.
+   */
+  static void format(Page* page, const std::vector<PaxColumn>& columns,
+                     const std::uint16_t record_size);
+
+  /**
+   * Returns true if the page is laid out as a PAX page.
+   *
+   * @param page  Page to check.
+   */
+  static bool isPaxPage(const Page* page);
+
+  /**
+   * Constructs a view over a page that has already been formatted.
+   *
+   * @param page  Page to view.  Must outlive this object.
+   * @throws  BadPageFormatException  If the page is not a PAX page.
+   */
+  explicit PaxPage(Page* page);
+
+  /**
+   * Returns the number of attributes records are split into.
+   */
+  std::uint16_t getNumColumns() const { return header()->num_columns; }
+
+  /**
+   * Returns the number of records on the page.
+   */
+  std::uint16_t getNumRecords() const { return header()->num_records; }
+
+  /**
+   * Returns the number of records the page can hold.
+   */
+  std::uint16_t getCapacity() const { return header()->capacity; }
+
+  /**
+   * Returns true if no more records fit on the page.
+   */
+  bool isFull() const { return getNumRecords() == getCapacity(); }
+
+  /**
+   * Appends a record to the page, spreading its attributes over the
+   * minipages.  Bytes of the record not covered by any attribute are dropped.
+   *
+   * @param record_data  Bytes of the record; must be exactly the record size.
+   * @return  Row of the new record on the page.
+   * @throws  InsufficientSpaceException  If the page is full.
+   * @throws  BadPageFormatException      If the record has the wrong size.
+   */
+  std::uint16_t insertRecord(const std::string& record_data);
+
+  /**
+   * Reassembles a whole record from its attributes.  Bytes not covered by any
+   * attribute are returned as zeros.
+   *
+   * @param row  Row of the record on the page.
+   * @return  The record.
+   * @throws  InvalidRecordException  If there is no record at that row.
+   */
+  std::string getRecord(const std::uint16_t row) const;
+
+  /**
+   * Returns the values of one attribute for every record on the page, stored
+   * back to back with no padding.  There are getNumRecords() values, each as
+   * wide as the attribute.  The pointer is only valid while the page is.
+   *
+   * @param column  Index of the attribute.
+   * @return  Start of the attribute's values.
+   * @throws  BadPageFormatException  If the page has no such attribute.
+   */
+  const char* getColumnData(const std::uint16_t column) const;
+
+  /**
+   * Appends the values of one attribute for every record on the page to a
+   * vector, in row order.
+   *
+   * @param column  Index of the attribute.
+   * @param values  Vector to append the values to.
+   * @throws  BadPageFormatException  If the page has no such attribute, or T
+   *                                  is not as wide as the attribute.
+   */
+  template <typename T>
+  void getColumn(const std::uint16_t column, std::vector<T>& values) const {
+    validateColumn(column);
+    if (sizeof(T) != columns()[column].width) {
+      throw BadPageFormatException(page_->page_number(),
+                                   "column width does not match value type");
+    }
+    if (getNumRecords() == 0) {
+      return;
+    }
+    const std::size_t first = values.size();
+    values.resize(first + getNumRecords());
+    // The data area is not aligned for T, so copy the values out rather than
+    // handing out a T pointer into the page.
+    std::memcpy(&values[first], getColumnData(column),
+                getNumRecords() * sizeof(T));
+  }
+
+ private:
+  /**
+   * Checks that the page has an attribute with the given index.
+   *
+   * @param column  Index of the attribute.
+   * @throws  BadPageFormatException  If the page has no such attribute.
+   */
+  void validateColumn(const std::uint16_t column) const;
+
+  /**
+   * Returns the PAX header at the start of the page's data area.
+   */
+  PaxHeader* header() const {
+    return reinterpret_cast<PaxHeader*>(&page_->data_[0]);
+  }
+
+  /**
+   * Returns the attribute descriptions, which follow the PAX header.
+   */
+  PaxColumn* columns() const {
+    return reinterpret_cast<PaxColumn*>(&page_->data_[sizeof(PaxHeader)]);
+  }
+
+  /**
+   * Returns the offsets of the minipages within the data area, which follow
+   * the attribute descriptions.
+   */
+  std::uint16_t* minipageOffsets() const {
+    return reinterpret_cast<std::uint16_t*>(
+        &page_->data_[sizeof(PaxHeader) +
+                      header()->num_columns * sizeof(PaxColumn)]);
+  }
+
+  /**
+   * Page being viewed.
+   */
+  Page* page_;
+};
+
+}
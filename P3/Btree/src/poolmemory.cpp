@@ -0,0 +1,167 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "poolmemory.h"
+
+#include <cstdint>
+#include <fstream>
+#include <new>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#endif
+
+namespace badgerdb {
+
+const std::size_t PoolMemory::HUGE_PAGE_SIZE;
+
+namespace {
+
+// Memory is reserved, not committed, so a pool with room to grow doesn't
+// count against the overcommit limit until it does.
+const int MAP_FLAGS = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+
+std::size_t roundUp(std::size_t n, std::size_t multiple) {
+  return (n + multiple - 1) / multiple * multiple;
+}
+
+}
+
+PoolMemory::PoolMemory(std::size_t size, PageKind kind)
+    : base_(NULL), size_(0), kind_(kind) {
+  if (size == 0)
+    size = 1;
+  if (kind == HUGE_PAGES && !map(size, HUGE_PAGES))
+    kind = TRANSPARENT_HUGE_PAGES;
+  if (base_ == NULL && !map(size, kind))
+    throw std::bad_alloc();
+  kind_ = kind;
+}
+
+PoolMemory::~PoolMemory() {
+  munmap(base_, size_);
+}
+
+bool PoolMemory::map(std::size_t size, PageKind kind) {
+  if (kind == SMALL_PAGES) {
+    size = roundUp(size, sysconf(_SC_PAGESIZE));
+    void* mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_FLAGS, -1, 0);
+    if (mem == MAP_FAILED)
+      return false;
+    base_ = mem;
+    size_ = size;
+    return true;
+  }
+
+  size = roundUp(size, HUGE_PAGE_SIZE);
+  if (kind == HUGE_PAGES) {
+#ifdef MAP_HUGETLB
+    // Reserved huge pages are claimed at once, so the mapping fails, and falls
+    // back, when too few are free rather than faulting on first touch.
+    void* mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     (MAP_FLAGS & ~MAP_NORESERVE) | MAP_HUGETLB, -1, 0);
+    if (mem == MAP_FAILED)
+      return false;
+    base_ = mem;
+    size_ = size;
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  // Transparent huge pages are only used for huge page aligned ranges, so map
+  // a huge page more than needed and trim the ends to an aligned range.
+  std::size_t mapped = size + HUGE_PAGE_SIZE;
+  void* mem = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_FLAGS, -1, 0);
+  if (mem == MAP_FAILED)
+    return false;
+  std::uintptr_t start = reinterpret_cast<std::uintptr_t>(mem);
+  std::uintptr_t aligned = roundUp(start, HUGE_PAGE_SIZE);
+  if (aligned > start)
+    munmap(mem, aligned - start);
+  if (start + mapped > aligned + size)
+    munmap(reinterpret_cast<void*>(aligned + size), start + mapped - (aligned + size));
+  base_ = reinterpret_cast<void*>(aligned);
+  size_ = size;
+#ifdef MADV_HUGEPAGE
+  // fails harmlessly if transparent huge pages are disabled
+  madvise(base_, size_, MADV_HUGEPAGE);
+#endif
+  return true;
+}
+
+std::size_t PoolMemory::pageSize() const {
+  return kind_ == SMALL_PAGES ? sysconf(_SC_PAGESIZE) : HUGE_PAGE_SIZE;
+}
+
+bool PoolMemory::bindToNode(std::size_t offset, std::size_t length, int node) {
+#if defined(__linux__) && defined(SYS_mbind)
+  const std::size_t page_size = pageSize();
+  std::size_t start = roundUp(offset, page_size);
+  std::size_t end = (offset + length) / page_size * page_size;
+  if (end > size_)
+    end = size_;
+  if (start >= end)
+    return true;
+  if (node < 0 || node >= static_cast<int>(8 * sizeof(unsigned long)))
+    return false;
+  unsigned long node_mask = 1UL << node;
+  // Preferred rather than bound, so a full node spills over instead of failing.
+  return syscall(SYS_mbind, static_cast<char*>(base_) + start, end - start,
+                 MPOL_PREFERRED, &node_mask, 8 * sizeof(node_mask), 0) == 0;
+#else
+  return false;
+#endif
+}
+
+void PoolMemory::release(std::size_t offset, std::size_t length) {
+  const std::size_t page_size = pageSize();
+  std::size_t start = roundUp(offset, page_size);
+  std::size_t end = (offset + length) / page_size * page_size;
+  if (end > size_)
+    end = size_;
+  if (start < end)
+    madvise(static_cast<char*>(base_) + start, end - start, MADV_DONTNEED);
+}
+
+int PoolMemory::numNodes() {
+  // The file lists node numbers and ranges of them, such as "0-1,3".
+  std::ifstream online("/sys/devices/system/node/online");
+  std::string list;
+  if (!(online >> list))
+    return 1;
+  int nodes = 0;
+  std::size_t pos = 0;
+  while (pos < list.size()) {
+    std::size_t comma = list.find(',', pos);
+    if (comma == std::string::npos)
+      comma = list.size();
+    std::string range = list.substr(pos, comma - pos);
+    std::size_t dash = range.find('-');
+    if (dash == std::string::npos)
+      nodes++;
+    else
+      nodes += std::stoi(range.substr(dash + 1)) - std::stoi(range.substr(0, dash)) + 1;
+    pos = comma + 1;
+  }
+  return nodes > 0 ? nodes : 1;
+}
+
+int PoolMemory::currentNode() {
+#if defined(__linux__) && defined(SYS_getcpu)
+  unsigned cpu, node;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+    return node;
+#endif
+  return 0;
+}
+
+}
@@ -0,0 +1,156 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+ * @brief Memory for the frames of the buffer pool and their descriptors,
+ * mapped straight from the operating system instead of the general heap.
+ *
+ * A large pool built from ordinary 4 KB pages needs a TLB entry for every few
+ * frames, so random accesses across it keep missing the TLB.  The memory is
+ * therefore backed by huge pages where the system allows it.  Ranges of it can
+ * also be placed on a given NUMA node, so that a partition of the pool is in
+ * memory local to the threads that use it.
+ *
+ * The memory is zero filled and page aligned.  Objects placed in it must be
+ * constructed and destroyed by the owner.  Physical memory is only taken as
+ * the pages are first touched, so a mapping can reserve room to grow into.
+ */
+class PoolMemory {
+ public:
+  /**
+   * Size of the huge pages the memory is aligned to.  2 MB on x86-64; other
+   * sizes only waste a little alignment.
+   */
+  static const std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+  /**
+   * Kinds of pages backing the memory.
+   */
+  enum PageKind {
+    /**
+     * Ordinary pages of the system's base page size.
+     */
+    SMALL_PAGES,
+
+    /**
+     * Ordinary pages the kernel is asked to merge into transparent huge pages
+     * in the background.  Needs no setup, so it is the default.
+     */
+    TRANSPARENT_HUGE_PAGES,
+
+    /**
+     * Huge pages reserved by the administrator (vm.nr_hugepages).  Falls back
+     * to TRANSPARENT_HUGE_PAGES if not enough of them are free.
+     */
+    HUGE_PAGES
+  };
+
+  /**
+   * Maps memory.
+   *
+   * @param size  Number of bytes needed
+   * @param kind  Kind of pages wanted
+   * @throws std::bad_alloc If no memory could be mapped
+   */
+  PoolMemory(std::size_t size, PageKind kind);
+
+  /**
+   * Unmaps the memory.
+   */
+  ~PoolMemory();
+
+  /**
+   * Returns the start of the memory.
+   */
+  void* base() const { return base_; }
+
+  /**
+   * Returns the number of bytes mapped, which is the size asked for rounded up
+   * to whole pages.
+   */
+  std::size_t size() const { return size_; }
+
+  /**
+   * Returns the kind of pages actually backing the memory.
+   */
+  PageKind pageKind() const { return kind_; }
+
+  /**
+   * Asks for the pages of a range of the memory to be placed on a NUMA node.
+   * Only pages wholly inside the range are moved; the pages at its ends may be
+   * shared with the neighbouring ranges and are left where they are.  Must be
+   * called before the range is first touched.
+   *
+   * @param offset  Offset of the range from the start of the memory
+   * @param length  Length of the range in bytes
+   * @param node    NUMA node to place the pages on
+   * @return  False if the system refused, in which case the pages are placed
+   *          as usual, on the node of the thread that first touches them
+   */
+  bool bindToNode(std::size_t offset, std::size_t length, int node);
+
+  /**
+   * Gives the pages of a range of the memory back to the system.  The range
+   * stays mapped and reads back as zeros.  Like bindToNode(), only pages
+   * wholly inside the range are affected.
+   *
+   * @param offset  Offset of the range from the start of the memory
+   * @param length  Length of the range in bytes
+   */
+  void release(std::size_t offset, std::size_t length);
+
+  /**
+   * Returns the number of NUMA nodes with memory, or 1 if the system doesn't
+   * say.
+   */
+  static int numNodes();
+
+  /**
+   * Returns the NUMA node the calling thread is running on, or 0 if the system
+   * doesn't say.
+   */
+  static int currentNode();
+
+ private:
+  /**
+   * Maps the memory with the given kind of pages.
+   *
+   * @return  False if the mapping failed
+   */
+  bool map(std::size_t size, PageKind kind);
+
+  /**
+   * Size of the pages backing the memory, which ranges are aligned to.
+   */
+  std::size_t pageSize() const;
+
+  /**
+   * Start of the memory.
+   */
+  void* base_;
+
+  /**
+   * Number of bytes mapped.
+   */
+  std::size_t size_;
+
+  /**
+   * Kind of pages backing the memory.
+   */
+  PageKind kind_;
+
+  PoolMemory(const PoolMemory&);
+  PoolMemory& operator=(const PoolMemory&);
+};
+
+}
@@ -0,0 +1,475 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "replacementpolicy.h"
+
+#include <algorithm>
+
+#include "bufHashTbl.h"
+
+namespace badgerdb {
+
+ReplacementPolicy* ReplacementPolicy::create(const Kind kind,
+                                             const std::uint32_t num_frames,
+                                             const std::uint32_t max_frames) {
+  switch (kind) {
+    case LRU_K:
+      return new LruKPolicy(num_frames);
+    case TWO_Q:
+      return new TwoQPolicy(num_frames);
+    case ARC:
+      return new ArcPolicy(num_frames);
+    case CLOCK:
+    default:
+      return new ClockPolicy(num_frames, max_frames);
+  }
+}
+
+ClockPolicy::ClockPolicy(const std::uint32_t num_frames,
+                         const std::uint32_t max_frames)
+    : num_frames_(num_frames),
+      hand_(0),
+      resident_(new std::atomic<bool>[std::max(num_frames, max_frames)]),
+      referenced_(new std::atomic<bool>[std::max(num_frames, max_frames)]) {
+  for (std::uint32_t i = 0; i < std::max(num_frames, max_frames); ++i) {
+    resident_[i] = false;
+    referenced_[i] = false;
+  }
+}
+
+void ClockPolicy::pageLoaded(const FrameId frame, const File* file,
+                             const PageId page_number, const AccessHint hint) {
+  referenced_[frame] = (hint == ACCESS_RANDOM);
+  resident_[frame] = true;
+}
+
+void ClockPolicy::pageAccessed(const FrameId frame) {
+  referenced_[frame] = true;
+}
+
+void ClockPolicy::pageRemoved(const FrameId frame, const File* file,
+                              const PageId page_number, const bool evicted) {
+  resident_[frame] = false;
+  referenced_[frame] = false;
+}
+
+void ClockPolicy::victimCandidates(std::vector<FrameId>& frames,
+                                   const std::size_t max_frames,
+                                   const PinnedPredicate& is_pinned) {
+  // Two turns of the hand clear every reference bit, so by then any unpinned
+  // page has been found.
+  const std::uint32_t num_frames = num_frames_;
+  for (std::uint32_t scanned = 0;
+       scanned < 2 * num_frames && frames.size() < max_frames; ++scanned) {
+    const FrameId frame = hand_.fetch_add(1) % num_frames;
+    if (!resident_[frame] || is_pinned(frame)) {
+      continue;
+    }
+    if (referenced_[frame].exchange(false)) {
+      continue;
+    }
+    if (std::find(frames.begin(), frames.end(), frame) == frames.end()) {
+      frames.push_back(frame);
+    }
+  }
+}
+
+void ClockPolicy::upcomingVictims(std::vector<FrameId>& frames,
+                                  const std::size_t max_frames,
+                                  const PinnedPredicate& is_pinned) {
+  // The hand takes unreferenced pages on its first turn and, having cleared
+  // the other reference bits, the rest on its second.
+  const std::uint32_t hand = hand_.load();
+  const std::uint32_t num_frames = num_frames_;
+  for (int turn = 0; turn < 2; ++turn) {
+    for (std::uint32_t i = 0; i < num_frames && frames.size() < max_frames;
+         ++i) {
+      const FrameId frame = (hand + i) % num_frames;
+      if (resident_[frame] && !is_pinned(frame) &&
+          referenced_[frame] == (turn == 1)) {
+        frames.push_back(frame);
+      }
+    }
+  }
+}
+
+void ClockPolicy::resize(const std::uint32_t num_frames) {
+  // Frames dropped hold no page, so a sweep still using the old size skips
+  // them.
+  num_frames_ = num_frames;
+}
+
+std::size_t PageKeyHash::operator()(const PageKey& key) const {
+  return BufHashTbl::hash(key.first, key.second);
+}
+
+FrameList::FrameList(const std::uint32_t num_frames)
+    : prev_(num_frames),
+      next_(num_frames),
+      on_list_(num_frames, false),
+      head_(num_frames),
+      tail_(num_frames),
+      size_(0) {}
+
+void FrameList::resize(const std::uint32_t num_frames) {
+  // The number of frames doubles as the end-of-list marker, so it changes too.
+  const FrameId old_none = prev_.size();
+  prev_.resize(num_frames);
+  next_.resize(num_frames);
+  on_list_.resize(num_frames, false);
+  for (FrameId frame = 0; frame < num_frames; ++frame) {
+    if (!on_list_[frame]) {
+      continue;
+    }
+    if (prev_[frame] == old_none) {
+      prev_[frame] = num_frames;
+    }
+    if (next_[frame] == old_none) {
+      next_[frame] = num_frames;
+    }
+  }
+  if (head_ == old_none) {
+    head_ = num_frames;
+  }
+  if (tail_ == old_none) {
+    tail_ = num_frames;
+  }
+}
+
+void FrameList::pushFront(const FrameId frame) {
+  const FrameId none = prev_.size();
+  prev_[frame] = none;
+  next_[frame] = head_;
+  if (head_ != none) {
+    prev_[head_] = frame;
+  } else {
+    tail_ = frame;
+  }
+  head_ = frame;
+  on_list_[frame] = true;
+  ++size_;
+}
+
+void FrameList::pushBack(const FrameId frame) {
+  const FrameId none = prev_.size();
+  next_[frame] = none;
+  prev_[frame] = tail_;
+  if (tail_ != none) {
+    next_[tail_] = frame;
+  } else {
+    head_ = frame;
+  }
+  tail_ = frame;
+  on_list_[frame] = true;
+  ++size_;
+}
+
+void FrameList::remove(const FrameId frame) {
+  if (!on_list_[frame]) {
+    return;
+  }
+  const FrameId none = prev_.size();
+  if (prev_[frame] != none) {
+    next_[prev_[frame]] = next_[frame];
+  } else {
+    head_ = next_[frame];
+  }
+  if (next_[frame] != none) {
+    prev_[next_[frame]] = prev_[frame];
+  } else {
+    tail_ = prev_[frame];
+  }
+  on_list_[frame] = false;
+  --size_;
+}
+
+void FrameList::appendOldest(
+    std::vector<FrameId>& frames, const std::size_t max_frames,
+    const ReplacementPolicy::PinnedPredicate& is_pinned) const {
+  const FrameId none = prev_.size();
+  for (FrameId frame = tail_; frame != none && frames.size() < max_frames;
+       frame = prev_[frame]) {
+    if (!is_pinned(frame)) {
+      frames.push_back(frame);
+    }
+  }
+}
+
+void GhostList::pushFront(const PageKey& key) {
+  remove(key);
+  order_.push_front(key);
+  positions_[key] = order_.begin();
+}
+
+bool GhostList::remove(const PageKey& key) {
+  const auto iter = positions_.find(key);
+  if (iter == positions_.end()) {
+    return false;
+  }
+  order_.erase(iter->second);
+  positions_.erase(iter);
+  return true;
+}
+
+void GhostList::popBack() {
+  if (order_.empty()) {
+    return;
+  }
+  positions_.erase(order_.back());
+  order_.pop_back();
+}
+
+LruKPolicy::LruKPolicy(const std::uint32_t num_frames)
+    : now_(0), resident_(num_frames, false), history_(num_frames) {}
+
+void LruKPolicy::pageLoaded(const FrameId frame, const File* file,
+                            const PageId page_number, const AccessHint hint) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  History history = {0, 0};
+  const auto iter = retained_.find(PageKey(file, page_number));
+  if (iter != retained_.end()) {
+    history = iter->second.history;
+    retained_order_.erase(iter->second.position);
+    retained_.erase(iter);
+  }
+  if (hint == ACCESS_RANDOM) {
+    history.previous = history.last;
+    history.last = ++now_;
+  }
+  history_[frame] = history;
+  resident_[frame] = true;
+}
+
+void LruKPolicy::pageAccessed(const FrameId frame) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!resident_[frame]) {
+    return;
+  }
+  history_[frame].previous = history_[frame].last;
+  history_[frame].last = ++now_;
+}
+
+void LruKPolicy::pageRemoved(const FrameId frame, const File* file,
+                             const PageId page_number, const bool evicted) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  resident_[frame] = false;
+  if (!evicted || history_[frame].last == 0) {
+    return;
+  }
+  const PageKey key(file, page_number);
+  retained_order_.push_front(key);
+  Retained& retained = retained_[key];
+  retained.history = history_[frame];
+  retained.position = retained_order_.begin();
+  while (retained_.size() > resident_.size()) {
+    retained_.erase(retained_order_.back());
+    retained_order_.pop_back();
+  }
+}
+
+void LruKPolicy::victimCandidates(std::vector<FrameId>& frames,
+                                  const std::size_t max_frames,
+                                  const PinnedPredicate& is_pinned) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Sorting by (previous, last) puts pages accessed only once first, least
+  // recently used first, followed by the rest by their second to last access.
+  std::vector<std::pair<std::pair<std::uint64_t, std::uint64_t>, FrameId> >
+      order;
+  for (FrameId frame = 0; frame < resident_.size(); ++frame) {
+    if (resident_[frame] && !is_pinned(frame)) {
+      order.push_back(std::make_pair(
+          std::make_pair(history_[frame].previous, history_[frame].last),
+          frame));
+    }
+  }
+  const std::size_t count =
+      std::min(order.size(), max_frames - std::min(max_frames, frames.size()));
+  std::partial_sort(order.begin(), order.begin() + count, order.end());
+  for (std::size_t i = 0; i < count; ++i) {
+    frames.push_back(order[i].second);
+  }
+}
+
+void LruKPolicy::resize(const std::uint32_t num_frames) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  resident_.resize(num_frames, false);
+  history_.resize(num_frames);
+  while (retained_.size() > resident_.size()) {
+    retained_.erase(retained_order_.back());
+    retained_order_.pop_back();
+  }
+}
+
+TwoQPolicy::TwoQPolicy(const std::uint32_t num_frames)
+    : in_size_(std::max<std::size_t>(1, num_frames / 4)),
+      out_size_(std::max<std::size_t>(1, num_frames / 2)),
+      a1in_(num_frames),
+      am_(num_frames),
+      once_(num_frames, false) {}
+
+void TwoQPolicy::pageLoaded(const FrameId frame, const File* file,
+                            const PageId page_number, const AccessHint hint) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  once_[frame] = (hint != ACCESS_RANDOM);
+  if (once_[frame]) {
+    a1in_.pushBack(frame);
+  } else if (a1out_.remove(PageKey(file, page_number))) {
+    am_.pushFront(frame);
+  } else {
+    a1in_.pushFront(frame);
+  }
+}
+
+void TwoQPolicy::pageAccessed(const FrameId frame) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  once_[frame] = false;
+  // A1in is a FIFO queue, so hits on its pages change nothing.
+  if (am_.contains(frame)) {
+    am_.remove(frame);
+    am_.pushFront(frame);
+  }
+}
+
+void TwoQPolicy::pageRemoved(const FrameId frame, const File* file,
+                             const PageId page_number, const bool evicted) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (a1in_.contains(frame)) {
+    a1in_.remove(frame);
+    if (evicted && !once_[frame]) {
+      a1out_.pushFront(PageKey(file, page_number));
+      while (a1out_.size() > out_size_) {
+        a1out_.popBack();
+      }
+    }
+  } else {
+    am_.remove(frame);
+  }
+}
+
+void TwoQPolicy::victimCandidates(std::vector<FrameId>& frames,
+                                  const std::size_t max_frames,
+                                  const PinnedPredicate& is_pinned) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (a1in_.size() > in_size_) {
+    a1in_.appendOldest(frames, max_frames, is_pinned);
+    am_.appendOldest(frames, max_frames, is_pinned);
+  } else {
+    am_.appendOldest(frames, max_frames, is_pinned);
+    a1in_.appendOldest(frames, max_frames, is_pinned);
+  }
+}
+
+void TwoQPolicy::resize(const std::uint32_t num_frames) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  in_size_ = std::max<std::size_t>(1, num_frames / 4);
+  out_size_ = std::max<std::size_t>(1, num_frames / 2);
+  a1in_.resize(num_frames);
+  am_.resize(num_frames);
+  once_.resize(num_frames, false);
+  while (a1out_.size() > out_size_) {
+    a1out_.popBack();
+  }
+}
+
+ArcPolicy::ArcPolicy(const std::uint32_t num_frames)
+    : capacity_(num_frames),
+      target_(0),
+      t1_(num_frames),
+      t2_(num_frames),
+      once_(num_frames, false) {}
+
+void ArcPolicy::pageLoaded(const FrameId frame, const File* file,
+                           const PageId page_number, const AccessHint hint) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  once_[frame] = (hint != ACCESS_RANDOM);
+  if (once_[frame]) {
+    t1_.pushBack(frame);
+    return;
+  }
+  const PageKey key(file, page_number);
+  const std::size_t b1_size = b1_.size();
+  const std::size_t b2_size = b2_.size();
+  if (b1_.remove(key)) {
+    // T1 was too small to keep the page; let it grow.
+    target_ = std::min(capacity_,
+                       target_ + std::max<std::size_t>(1, b2_size / b1_size));
+    t2_.pushFront(frame);
+  } else if (b2_.remove(key)) {
+    // T2 was too small to keep the page; let it grow.
+    target_ -= std::min(target_, std::max<std::size_t>(1, b1_size / b2_size));
+    t2_.pushFront(frame);
+  } else {
+    t1_.pushFront(frame);
+  }
+}
+
+void ArcPolicy::pageAccessed(const FrameId frame) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  once_[frame] = false;
+  if (t1_.contains(frame) || t2_.contains(frame)) {
+    t1_.remove(frame);
+    t2_.remove(frame);
+    t2_.pushFront(frame);
+  }
+}
+
+void ArcPolicy::pageRemoved(const FrameId frame, const File* file,
+                            const PageId page_number, const bool evicted) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const bool from_t1 = t1_.contains(frame);
+  t1_.remove(frame);
+  t2_.remove(frame);
+  if (!evicted || once_[frame]) {
+    return;
+  }
+  if (from_t1) {
+    b1_.pushFront(PageKey(file, page_number));
+  } else {
+    b2_.pushFront(PageKey(file, page_number));
+  }
+  trimGhosts();
+}
+
+void ArcPolicy::trimGhosts() {
+  // T1 and B1 together remember at most one pool's worth of pages, and all
+  // four lists at most two.
+  while (t1_.size() + b1_.size() > capacity_ && b1_.size() > 0) {
+    b1_.popBack();
+  }
+  while (t1_.size() + t2_.size() + b1_.size() + b2_.size() > 2 * capacity_) {
+    if (b2_.size() > 0) {
+      b2_.popBack();
+    } else {
+      b1_.popBack();
+    }
+  }
+}
+
+void ArcPolicy::victimCandidates(std::vector<FrameId>& frames,
+                                 const std::size_t max_frames,
+                                 const PinnedPredicate& is_pinned) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (t1_.size() > 0 && t1_.size() > target_) {
+    t1_.appendOldest(frames, max_frames, is_pinned);
+    t2_.appendOldest(frames, max_frames, is_pinned);
+  } else {
+    t2_.appendOldest(frames, max_frames, is_pinned);
+    t1_.appendOldest(frames, max_frames, is_pinned);
+  }
+}
+
+void ArcPolicy::resize(const std::uint32_t num_frames) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = num_frames;
+  target_ = std::min(target_, capacity_);
+  t1_.resize(num_frames);
+  t2_.resize(num_frames);
+  once_.resize(num_frames, false);
+  trimGhosts();
+}
+
+}
@@ -0,0 +1,489 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "file.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief How a page read through the buffer manager is going to be used.
+ */
+enum AccessHint {
+  /**
+   * Random access, such as an index lookup.  The page may well be read again.
+   */
+  ACCESS_RANDOM,
+
+  /**
+   * Part of a sequential scan.  The scan may pass a BufferRing to the buffer
+   * manager so it recycles a few frames of its own; without one this is the
+   * same as ACCESS_ONCE.
+   */
+  ACCESS_SEQUENTIAL,
+
+  /**
+   * The page is used once and not needed again.
+   */
+  ACCESS_ONCE
+};
+
+/**
+ * @brief Decides which page the buffer manager evicts when it needs a frame.
+ *
+ * The buffer manager tells the policy when a frame is loaded with a page, when
+ * a resident page is accessed again and when a page leaves its frame.  When it
+ * needs a frame and has none free, it asks the policy for a few candidate
+ * frames, best victim first, and evicts the first one it can claim.  The
+ * candidates are only advice: a candidate may be pinned or accessed again by
+ * the time the buffer manager gets to it, in which case it tries the next.
+ *
+ * Implementations must be threadsafe, and must not call back into the buffer
+ * manager other than through the <is_pinned> predicate.
+ */
+class ReplacementPolicy {
+ public:
+  /**
+   * Policies the buffer manager can be built with.
+   */
+  enum Kind {
+    /**
+     * Second-chance clock sweep.  Hits only set a reference bit, so it is the
+     * cheapest policy, but a single large scan flushes the whole pool.
+     */
+    CLOCK,
+
+    /**
+     * LRU-2: evicts the page whose second most recent access is oldest.
+     * Pages seen only once, like those of a scan, go first.
+     */
+    LRU_K,
+
+    /**
+     * 2Q: pages seen once sit in a small FIFO queue and only move to the main
+     * LRU queue when they are requested again after being evicted.
+     */
+    TWO_Q,
+
+    /**
+     * Adaptive replacement cache: balances recency against frequency by
+     * learning from recently evicted pages.
+     */
+    ARC
+  };
+
+  /**
+   * Predicate telling whether a frame is pinned.
+   */
+  typedef std::function<bool(FrameId)> PinnedPredicate;
+
+  /**
+   * Creates a policy.
+   *
+   * @param kind        Which policy to create.
+   * @param num_frames  Number of frames in the buffer pool.
+   * @param max_frames  Largest number of frames the pool may be resized to,
+   *                    or 0 if it won't grow beyond <num_frames>.
+   * @return  The new policy, owned by the caller.
+   */
+  static ReplacementPolicy* create(const Kind kind,
+                                   const std::uint32_t num_frames,
+                                   const std::uint32_t max_frames = 0);
+
+  virtual ~ReplacementPolicy() {}
+
+  /**
+   * Called when a frame has been loaded with a page, either read from disk or
+   * newly allocated.  Pages loaded with any hint but ACCESS_RANDOM are not
+   * expected to be needed again, so they go first and are not remembered
+   * once evicted, unless they are accessed again while resident.
+   *
+   * @param frame        Frame holding the page.
+   * @param file         File the page belongs to.
+   * @param page_number  Number of the page.
+   * @param hint         How the page is going to be used.
+   */
+  virtual void pageLoaded(const FrameId frame, const File* file,
+                          const PageId page_number, const AccessHint hint) = 0;
+
+  /**
+   * Called when a page already in the buffer pool is requested again for
+   * random access.  Hits by scans are not reported, so a scan never makes a
+   * page look hot.
+   *
+   * @param frame  Frame holding the page.
+   */
+  virtual void pageAccessed(const FrameId frame) = 0;
+
+  /**
+   * Called when a page leaves its frame.
+   *
+   * @param frame        Frame that held the page.
+   * @param file         File the page belongs to.
+   * @param page_number  Number of the page.
+   * @param evicted      True if the page was evicted to make room for another,
+   *                     false if it was flushed or deleted.
+   */
+  virtual void pageRemoved(const FrameId frame, const File* file,
+                           const PageId page_number, const bool evicted) = 0;
+
+  /**
+   * Appends up to <max_frames> frames holding unpinned pages to a vector,
+   * best victim first.  Appends nothing only if every page is pinned.
+   *
+   * @param frames      Vector to append the frames to.
+   * @param max_frames  Largest number of frames to append.
+   * @param is_pinned   Tells whether a frame is pinned.
+   */
+  virtual void victimCandidates(std::vector<FrameId>& frames,
+                                const std::size_t max_frames,
+                                const PinnedPredicate& is_pinned) = 0;
+
+  /**
+   * Appends up to <max_frames> frames holding unpinned pages to a vector, in
+   * the order they would be evicted if no page were accessed in the meantime.
+   * Unlike victimCandidates(), doesn't change the state of the policy, so the
+   * page writer can look ahead for dirty pages to write back.
+   *
+   * By default the same frames victimCandidates() would return, for policies
+   * where asking for victims changes nothing.
+   *
+   * @param frames      Vector to append the frames to.
+   * @param max_frames  Largest number of frames to append.
+   * @param is_pinned   Tells whether a frame is pinned.
+   */
+  virtual void upcomingVictims(std::vector<FrameId>& frames,
+                               const std::size_t max_frames,
+                               const PinnedPredicate& is_pinned) {
+    victimCandidates(frames, max_frames, is_pinned);
+  }
+
+  /**
+   * Called when the buffer pool is resized, while other threads may still be
+   * using it.  When shrinking, the frames being dropped have already had their
+   * pages removed.
+   *
+   * @param num_frames  New number of frames in the buffer pool.
+   */
+  virtual void resize(const std::uint32_t num_frames) = 0;
+};
+
+/**
+ * @brief Second-chance clock replacement.
+ *
+ * Reference bits are atomic and the clock hand is an atomic counter, so
+ * neither hits nor the sweep take a lock.  For the same reason the bits are
+ * allocated for the largest size the pool may grow to up front, and resizing
+ * only changes how far the hand goes.
+ */
+class ClockPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * @param num_frames  Number of frames in the buffer pool.
+   * @param max_frames  Largest number of frames the pool may be resized to,
+   *                    or 0 if it won't grow beyond <num_frames>.
+   */
+  explicit ClockPolicy(const std::uint32_t num_frames,
+                       const std::uint32_t max_frames = 0);
+
+  void pageLoaded(const FrameId frame, const File* file,
+                  const PageId page_number, const AccessHint hint);
+  void pageAccessed(const FrameId frame);
+  void pageRemoved(const FrameId frame, const File* file,
+                   const PageId page_number, const bool evicted);
+  void victimCandidates(std::vector<FrameId>& frames,
+                        const std::size_t max_frames,
+                        const PinnedPredicate& is_pinned);
+  void upcomingVictims(std::vector<FrameId>& frames,
+                       const std::size_t max_frames,
+                       const PinnedPredicate& is_pinned);
+  void resize(const std::uint32_t num_frames);
+
+ private:
+  /**
+   * Number of frames in the buffer pool.
+   */
+  std::atomic<std::uint32_t> num_frames_;
+
+  /**
+   * Position of the clock hand.  Only ever advanced; taken modulo the number
+   * of frames.
+   */
+  std::atomic<std::uint32_t> hand_;
+
+  /**
+   * Whether each frame holds a page.
+   */
+  std::unique_ptr<std::atomic<bool>[]> resident_;
+
+  /**
+   * Whether each frame has been referenced since the hand last passed it.
+   */
+  std::unique_ptr<std::atomic<bool>[]> referenced_;
+};
+
+/**
+ * @brief Identifies a page by its file and page number.
+ */
+typedef std::pair<const File*, PageId> PageKey;
+
+/**
+ * @brief Hash function for PageKey.
+ */
+struct PageKeyHash {
+  std::size_t operator()(const PageKey& key) const;
+};
+
+/**
+ * @brief Recency-ordered list of frames, supporting constant time removal of
+ *        any frame.  Each frame can be on at most one list at a time.
+ */
+class FrameList {
+ public:
+  /**
+   * @param num_frames  Number of frames in the buffer pool.
+   */
+  explicit FrameList(const std::uint32_t num_frames);
+
+  /**
+   * Changes the number of frames the list can hold.  Frames at or above the
+   * new number must not be on the list.
+   */
+  void resize(const std::uint32_t num_frames);
+
+  /**
+   * Adds a frame at the most recently used end.
+   */
+  void pushFront(const FrameId frame);
+
+  /**
+   * Adds a frame at the least recently used end.
+   */
+  void pushBack(const FrameId frame);
+
+  /**
+   * Removes a frame from the list.  Does nothing if it isn't on the list.
+   */
+  void remove(const FrameId frame);
+
+  /**
+   * Returns true if the frame is on the list.
+   */
+  bool contains(const FrameId frame) const { return on_list_[frame]; }
+
+  /**
+   * Returns the number of frames on the list.
+   */
+  std::size_t size() const { return size_; }
+
+  /**
+   * Appends unpinned frames to <frames>, least recently used first, until it
+   * holds <max_frames> frames.
+   */
+  void appendOldest(std::vector<FrameId>& frames, const std::size_t max_frames,
+                    const ReplacementPolicy::PinnedPredicate& is_pinned) const;
+
+ private:
+  std::vector<FrameId> prev_;
+  std::vector<FrameId> next_;
+  std::vector<bool> on_list_;
+  FrameId head_;
+  FrameId tail_;
+  std::size_t size_;
+};
+
+/**
+ * @brief Recency-ordered list of pages that are no longer in the buffer pool.
+ */
+class GhostList {
+ public:
+  /**
+   * Adds a page at the most recently used end.
+   */
+  void pushFront(const PageKey& key);
+
+  /**
+   * Removes a page from the list.
+   *
+   * @return  True if the page was on the list.
+   */
+  bool remove(const PageKey& key);
+
+  /**
+   * Drops the least recently used page.
+   */
+  void popBack();
+
+  /**
+   * Returns the number of pages on the list.
+   */
+  std::size_t size() const { return order_.size(); }
+
+ private:
+  std::list<PageKey> order_;
+  std::unordered_map<PageKey, std::list<PageKey>::iterator, PageKeyHash>
+      positions_;
+};
+
+/**
+ * @brief LRU-K replacement with K = 2.
+ *
+ * The times of the last two accesses to each page are kept, also for a while
+ * after the page is evicted, so a page that comes back soon is recognised.
+ * The victim is the page whose second to last access is oldest; pages
+ * accessed only once count as infinitely old and are evicted least recently
+ * used first.  Finding the victim scans every frame.
+ */
+class LruKPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * @param num_frames  Number of frames in the buffer pool.
+   */
+  explicit LruKPolicy(const std::uint32_t num_frames);
+
+  void pageLoaded(const FrameId frame, const File* file,
+                  const PageId page_number, const AccessHint hint);
+  void pageAccessed(const FrameId frame);
+  void pageRemoved(const FrameId frame, const File* file,
+                   const PageId page_number, const bool evicted);
+  void victimCandidates(std::vector<FrameId>& frames,
+                        const std::size_t max_frames,
+                        const PinnedPredicate& is_pinned);
+  void resize(const std::uint32_t num_frames);
+
+ private:
+  /**
+   * Access times of a page; 0 means no access.  A page loaded for a single
+   * use has no accesses at all until it is accessed again.
+   */
+  struct History {
+    std::uint64_t last;
+    std::uint64_t previous;
+  };
+
+  /**
+   * History of an evicted page, with its place in the order of evictions.
+   */
+  struct Retained {
+    History history;
+    std::list<PageKey>::iterator position;
+  };
+
+  std::mutex mutex_;
+  std::uint64_t now_;
+  std::vector<bool> resident_;
+  std::vector<History> history_;
+
+  /**
+   * Histories of recently evicted pages, at most one per frame, and the order
+   * to forget them in.
+   */
+  std::unordered_map<PageKey, Retained, PageKeyHash> retained_;
+  std::list<PageKey> retained_order_;
+};
+
+/**
+ * @brief The full version of the 2Q replacement algorithm.
+ *
+ * Pages enter A1in, a FIFO queue of about a quarter of the pool.  When a page
+ * is evicted from A1in it is remembered in A1out, and only if it is requested
+ * again while remembered does it enter Am, the LRU queue for hot pages.  Pages
+ * read by a scan therefore never get to push hot pages out of Am.
+ */
+class TwoQPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * @param num_frames  Number of frames in the buffer pool.
+   */
+  explicit TwoQPolicy(const std::uint32_t num_frames);
+
+  void pageLoaded(const FrameId frame, const File* file,
+                  const PageId page_number, const AccessHint hint);
+  void pageAccessed(const FrameId frame);
+  void pageRemoved(const FrameId frame, const File* file,
+                   const PageId page_number, const bool evicted);
+  void victimCandidates(std::vector<FrameId>& frames,
+                        const std::size_t max_frames,
+                        const PinnedPredicate& is_pinned);
+  void resize(const std::uint32_t num_frames);
+
+ private:
+  std::mutex mutex_;
+  std::size_t in_size_;
+  std::size_t out_size_;
+  FrameList a1in_;
+  FrameList am_;
+  GhostList a1out_;
+
+  /**
+   * Whether each frame holds a page loaded for a single use.
+   */
+  std::vector<bool> once_;
+};
+
+/**
+ * @brief Adaptive replacement cache (Megiddo and Modha).
+ *
+ * Resident pages are split between T1, pages seen once recently, and T2,
+ * pages seen at least twice.  B1 and B2 remember pages recently evicted from
+ * each, and a request for a remembered page shifts the target size of T1
+ * towards whichever list would have kept it.
+ */
+class ArcPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * @param num_frames  Number of frames in the buffer pool.
+   */
+  explicit ArcPolicy(const std::uint32_t num_frames);
+
+  void pageLoaded(const FrameId frame, const File* file,
+                  const PageId page_number, const AccessHint hint);
+  void pageAccessed(const FrameId frame);
+  void pageRemoved(const FrameId frame, const File* file,
+                   const PageId page_number, const bool evicted);
+  void victimCandidates(std::vector<FrameId>& frames,
+                        const std::size_t max_frames,
+                        const PinnedPredicate& is_pinned);
+  void resize(const std::uint32_t num_frames);
+
+ private:
+  /**
+   * Forgets the oldest evicted pages until B1 and B2 fit the pool.
+   */
+  void trimGhosts();
+
+  std::mutex mutex_;
+  std::size_t capacity_;
+
+  /**
+   * Target size of T1.
+   */
+  std::size_t target_;
+  FrameList t1_;
+  FrameList t2_;
+  GhostList b1_;
+  GhostList b2_;
+
+  /**
+   * Whether each frame holds a page loaded for a single use.
+   */
+  std::vector<bool> once_;
+};
+
+}
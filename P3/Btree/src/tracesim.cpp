@@ -0,0 +1,165 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "tracesim.h"
+
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "accesstrace.h"
+#include "exceptions/badgerdb_exception.h"
+#include "exceptions/file_not_found_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * File standing in for a traced file.  Pages read are blank, writes go
+ * nowhere, and allocations hand out the page number the trace recorded.
+ */
+class SimFile : public File {
+ public:
+  explicit SimFile(const std::string& name)
+      : File(name, true), next_page_number_(Page::INVALID_NUMBER) {}
+
+  /**
+   * Sets the page number the next allocatePage() hands out.
+   */
+  void setNextPage(const PageId page_number) {
+    next_page_number_ = page_number;
+  }
+
+  Page allocatePage(PageId& new_page_number) {
+    new_page_number = next_page_number_;
+    return Page();
+  }
+
+  Page readPage(const PageId page_number) const { return Page(); }
+
+  void writePage(const PageId page_number, const Page& new_page) {}
+
+  void deletePage(const PageId page_number) {}
+
+ private:
+  PageId next_page_number_;
+};
+
+/**
+ * Removes a file if it exists.
+ */
+void removeIfExists(const std::string& name) {
+  try {
+    File::remove(name);
+  } catch (FileNotFoundException&) {
+  }
+}
+
+}
+
+BufStatsSnapshot TraceSimulator::replay(const std::string& trace_name,
+                                        const ReplacementPolicy::Kind policy,
+                                        const std::uint32_t num_frames) {
+  AccessTraceReader reader(trace_name);
+  std::vector<std::unique_ptr<SimFile> > files;
+  // Pins the replay holds, so unpins of pages pinned before the trace started,
+  // or whose read failed in the smaller pool, are skipped.
+  std::map<std::pair<std::uint32_t, PageId>, int> pins;
+  BufStatsSnapshot snapshot;
+  {
+    BufMgr buf_mgr(num_frames, NULL, policy);
+    TraceEvent event;
+    while (reader.next(event)) {
+      while (files.size() < reader.fileNames().size()) {
+        std::ostringstream name;
+        name << trace_name << ".sim." << files.size();
+        removeIfExists(name.str());
+        files.push_back(std::unique_ptr<SimFile>(new SimFile(name.str())));
+      }
+      SimFile* file = files[event.file].get();
+      const std::pair<std::uint32_t, PageId> key(event.file, event.page_number);
+
+      try {
+        Page* page;
+        PageId page_number;
+        switch (event.kind) {
+          case TraceEvent::READ:
+            buf_mgr.readPage(file, event.page_number, page, event.hint);
+            pins[key]++;
+            break;
+          case TraceEvent::ALLOC:
+            file->setNextPage(event.page_number);
+            buf_mgr.allocPage(file, page_number, page);
+            pins[key]++;
+            break;
+          case TraceEvent::UNPIN:
+            if (pins[key] > 0) {
+              buf_mgr.unPinPage(file, event.page_number, event.dirty);
+              pins[key]--;
+            }
+            break;
+          case TraceEvent::DISPOSE:
+            if (pins[key] == 0) {
+              buf_mgr.disposePage(file, event.page_number);
+            }
+            break;
+          case TraceEvent::FLUSH:
+            buf_mgr.flushFile(file);
+            break;
+        }
+      } catch (BadgerDbException&) {
+        // every frame pinned, or a flush of a file with pinned pages; the
+        // call had no effect, as it would have had none in production
+      }
+    }
+
+    snapshot = buf_mgr.getStatsSnapshot();
+    // the buffer manager still holds the pages; unpin them so it can go
+    for (std::map<std::pair<std::uint32_t, PageId>, int>::const_iterator it =
+             pins.begin(); it != pins.end(); ++it) {
+      for (int i = 0; i < it->second; ++i) {
+        buf_mgr.unPinPage(files[it->first.first].get(), it->first.second, false);
+      }
+    }
+    for (std::size_t i = 0; i < files.size(); ++i) {
+      buf_mgr.flushFile(files[i].get());
+    }
+  }
+
+  // report the files by their traced names
+  std::map<std::string, BufPageCounts> traced;
+  for (std::size_t i = 0; i < files.size(); ++i) {
+    std::map<std::string, BufPageCounts>::const_iterator it =
+        snapshot.files.find(files[i]->filename());
+    if (it != snapshot.files.end()) {
+      traced[reader.fileNames()[i]].add(it->second);
+    }
+    const std::string name = files[i]->filename();
+    files[i].reset();
+    removeIfExists(name);
+  }
+  snapshot.files.swap(traced);
+  return snapshot;
+}
+
+std::uint32_t TraceSimulator::countPages(const std::string& trace_name) {
+  AccessTraceReader reader(trace_name);
+  std::set<std::pair<std::uint32_t, PageId> > pages;
+  TraceEvent event;
+  while (reader.next(event)) {
+    if (event.kind == TraceEvent::READ || event.kind == TraceEvent::ALLOC) {
+      pages.insert(std::make_pair(event.file, event.page_number));
+    }
+  }
+  return pages.size();
+}
+
+}
@@ -0,0 +1,58 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Replays an access trace recorded by BufMgr::startTrace() against a
+ * buffer pool of a given size and replacement policy, to see how it would
+ * have fared.
+ *
+ * The replay runs the real buffer manager, so frame allocation, victim
+ * selection and the policies behave exactly as in production.  Only the files
+ * are stand-ins: they hand out blank pages and ignore writes, so no page is
+ * read from or written to disk.  Each replay creates a small placeholder file
+ * per traced file next to the trace and removes it afterwards.
+ *
+ * Calls the trace shows failing or that can't apply to the smaller pool are
+ * skipped: a read with every frame pinned, an unpin of a page read before the
+ * trace started, and flushes or disposals of pinned pages.
+ */
+class TraceSimulator {
+ public:
+  /**
+   * Replays a trace.
+   *
+   * @param trace_name  Name of the trace file.
+   * @param policy      Replacement policy to simulate.
+   * @param num_frames  Number of frames to simulate.
+   * @return  Statistics of the simulated pool, with hits and misses counted
+   *          for each traced file by its traced name.
+   * @throws TraceIOException If the trace can't be read.
+   */
+  static BufStatsSnapshot replay(const std::string& trace_name,
+                                 const ReplacementPolicy::Kind policy,
+                                 const std::uint32_t num_frames);
+
+  /**
+   * Returns the number of different pages a trace reads or allocates, which
+   * is the pool size beyond which only the first access to a page misses.
+   *
+   * @param trace_name  Name of the trace file.
+   * @throws TraceIOException If the trace can't be read.
+   */
+  static std::uint32_t countPages(const std::string& trace_name);
+};
+
+}
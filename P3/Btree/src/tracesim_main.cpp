@@ -0,0 +1,127 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Replays an access trace recorded with BufMgr::startTrace() against
+// replacement policies and pool sizes, and prints a hit ratio curve for each
+// policy: one tab separated line per policy and size.
+//
+//   badgerdb_tracesim TRACE [-p clock,lru-k,2q,arc] [-s FRAMES,FRAMES,...]
+//
+// Without -s, the sizes are powers of two from 16 frames up to the first that
+// holds every page of the trace.
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tracesim.h"
+#include "exceptions/badgerdb_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+struct PolicyName {
+  const char* name;
+  ReplacementPolicy::Kind kind;
+};
+
+const PolicyName POLICIES[] = {{"clock", ReplacementPolicy::CLOCK},
+                               {"lru-k", ReplacementPolicy::LRU_K},
+                               {"2q", ReplacementPolicy::TWO_Q},
+                               {"arc", ReplacementPolicy::ARC}};
+const int NUM_POLICIES = sizeof(POLICIES) / sizeof(POLICIES[0]);
+
+std::vector<std::string> splitList(const std::string& list) {
+  std::vector<std::string> items;
+  std::istringstream in(list);
+  std::string item;
+  while (std::getline(in, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+int usage() {
+  std::cerr << "usage: badgerdb_tracesim TRACE [-p clock,lru-k,2q,arc] "
+               "[-s FRAMES,FRAMES,...]" << std::endl;
+  return 2;
+}
+
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    return usage();
+  }
+  const std::string trace_name = argv[1];
+  std::vector<std::string> policy_names;
+  std::vector<std::uint32_t> sizes;
+  for (int i = 2; i < argc; ++i) {
+    if (i + 1 < argc && strcmp(argv[i], "-p") == 0) {
+      policy_names = splitList(argv[++i]);
+    } else if (i + 1 < argc && strcmp(argv[i], "-s") == 0) {
+      std::vector<std::string> items = splitList(argv[++i]);
+      for (std::size_t j = 0; j < items.size(); ++j) {
+        const long frames = std::atol(items[j].c_str());
+        if (frames <= 0) {
+          return usage();
+        }
+        sizes.push_back(frames);
+      }
+    } else {
+      return usage();
+    }
+  }
+
+  std::vector<PolicyName> policies;
+  if (policy_names.empty()) {
+    policies.assign(POLICIES, POLICIES + NUM_POLICIES);
+  }
+  for (std::size_t i = 0; i < policy_names.size(); ++i) {
+    int p = 0;
+    while (p < NUM_POLICIES && policy_names[i] != POLICIES[p].name) {
+      ++p;
+    }
+    if (p == NUM_POLICIES) {
+      return usage();
+    }
+    policies.push_back(POLICIES[p]);
+  }
+
+  try {
+    if (sizes.empty()) {
+      const std::uint32_t pages = TraceSimulator::countPages(trace_name);
+      std::uint32_t frames = 16;
+      sizes.push_back(frames);
+      while (frames < pages) {
+        frames *= 2;
+        sizes.push_back(frames);
+      }
+    }
+
+    std::cout << "policy\tframes\thits\tmisses\thit_ratio" << std::endl;
+    for (std::size_t p = 0; p < policies.size(); ++p) {
+      for (std::size_t s = 0; s < sizes.size(); ++s) {
+        const BufStatsSnapshot stats =
+            TraceSimulator::replay(trace_name, policies[p].kind, sizes[s]);
+        std::cout << policies[p].name << "\t" << sizes[s] << "\t"
+                  << stats.total.hits << "\t" << stats.total.misses << "\t"
+                  << stats.hitRatio() << std::endl;
+      }
+    }
+  } catch (BadgerDbException& e) {
+    std::cerr << e.message() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,113 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "victimcache.h"
+
+#include "pagecodec.h"
+
+namespace badgerdb {
+
+const std::size_t VictimCache::ENTRY_OVERHEAD;
+const std::size_t VictimCache::MAX_ENTRY_SIZE;
+
+VictimCache::VictimCache(const std::size_t capacity)
+    : capacity_(capacity), size_(0) {}
+
+bool VictimCache::compress(const Page& page, std::string& data) {
+  PageCodec::compress(reinterpret_cast<const char*>(&page), Page::SIZE, data);
+  // a page that barely compresses is kept about as cheaply by a frame of the
+  // pool
+  return data.size() + ENTRY_OVERHEAD <= MAX_ENTRY_SIZE;
+}
+
+bool VictimCache::put(const File* file, const PageId page_number,
+                      const Page& page) {
+  // compress before taking the lock, so other threads aren't held up by it
+  std::string data;
+  if (!compress(page, data)) {
+    erase(file, page_number);
+    return false;
+  }
+  return put(file, page_number, data);
+}
+
+bool VictimCache::put(const File* file, const PageId page_number,
+                      std::string& data) {
+  const Key key(file, page_number);
+  const std::size_t bytes = data.size() + ENTRY_OVERHEAD;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<Key, Entry>::iterator it = entries_.find(key);
+  if (it != entries_.end()) {
+    remove(it);
+  }
+  if (bytes > capacity_) {
+    return false;
+  }
+  while (size_ + bytes > capacity_) {
+    remove(entries_.find(lru_.front()));
+  }
+
+  lru_.push_back(key);
+  Entry& entry = entries_[key];
+  entry.data.swap(data);
+  entry.lru = --lru_.end();
+  size_ += bytes;
+  return true;
+}
+
+bool VictimCache::take(const File* file, const PageId page_number,
+                       Page& page) {
+  std::string data;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::map<Key, Entry>::iterator it =
+        entries_.find(Key(file, page_number));
+    if (it == entries_.end()) {
+      return false;
+    }
+    data.swap(it->second.data);
+    size_ -= data.size();
+    remove(it);
+  }
+  return PageCodec::decompress(data.data(), data.size(),
+                               reinterpret_cast<char*>(&page), Page::SIZE);
+}
+
+void VictimCache::erase(const File* file, const PageId page_number) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<Key, Entry>::iterator it = entries_.find(Key(file, page_number));
+  if (it != entries_.end()) {
+    remove(it);
+  }
+}
+
+void VictimCache::eraseFile(const File* file) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<Key, Entry>::iterator it = entries_.lower_bound(Key(file, 0));
+  while (it != entries_.end() && it->first.first == file) {
+    remove(it++);
+  }
+}
+
+std::size_t VictimCache::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return size_;
+}
+
+std::size_t VictimCache::numPages() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+void VictimCache::remove(std::map<Key, Entry>::iterator it) {
+  size_ -= it->second.data.size() + ENTRY_OVERHEAD;
+  lru_.erase(it->second.lru);
+  entries_.erase(it);
+}
+
+}
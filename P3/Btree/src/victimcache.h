@@ -0,0 +1,178 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Second tier behind the buffer pool that keeps recently evicted pages
+ * compressed in memory, so reading one of them again costs a decompression
+ * instead of a disk read.
+ *
+ * The buffer manager hands a page to put() as it leaves its frame, once it is
+ * clean, and asks take() for a page before reading it from disk.  A page is
+ * in at most one of the pool and the cache: take() removes the page it
+ * returns.  When the cache is full, the pages put least recently go first.
+ *
+ * The cache only ever holds the image the page has on disk, so a page that is
+ * deleted, or whose file may be closed, must be erased from it.
+ *
+ * Pages are compressed with PageCodec.  Index and sparse pages shrink to a
+ * fraction of their size, so the cache holds several times as many pages as
+ * frames of the same memory would; pages that hardly compress are not kept.
+ *
+ * The cache is threadsafe, and never calls out while holding its lock.
+ */
+class VictimCache {
+ public:
+  /**
+   * Bytes each cached page costs on top of its compressed image, for the
+   * bookkeeping that goes with it.
+   */
+  static const std::size_t ENTRY_OVERHEAD = 96;
+
+  /**
+   * Most bytes a page may cost, overhead included, to be kept.  Pages that
+   * shrink by less than a quarter are left to the buffer pool.
+   */
+  static const std::size_t MAX_ENTRY_SIZE = Page::SIZE * 3 / 4;
+
+  /**
+   * Constructor.
+   *
+   * @param capacity  Bytes of memory the cache may use.
+   */
+  explicit VictimCache(const std::size_t capacity);
+
+  /**
+   * Keeps a copy of a page, replacing any copy kept already, unless the page
+   * doesn't compress.
+   *
+   * @param file         File the page belongs to.
+   * @param page_number  Number of the page.
+   * @param page         Image of the page, as it is on disk.
+   * @return  True if the page was kept.
+   */
+  bool put(const File* file, const PageId page_number, const Page& page);
+
+  /**
+   * Keeps a copy of a page compressed by compress(), replacing any copy kept
+   * already.  This leaves the compression, the slow part, to the caller, who
+   * may do it before taking locks of its own.
+   *
+   * @param file         File the page belongs to.
+   * @param page_number  Number of the page.
+   * @param data         Compressed image of the page, as it is on disk.
+   *                     Taken over by the cache if the page is kept.
+   * @return  True if the page was kept.
+   */
+  bool put(const File* file, const PageId page_number, std::string& data);
+
+  /**
+   * Compresses a page for put().
+   *
+   * @param page  Page to compress.
+   * @param data  Replaced with the compressed image.
+   * @return  False if the page compresses too little to be worth keeping.
+   */
+  static bool compress(const Page& page, std::string& data);
+
+  /**
+   * Removes a page from the cache and returns it.
+   *
+   * @param file         File the page belongs to.
+   * @param page_number  Number of the page.
+   * @param page         Set to the page, if the cache holds it.
+   * @return  True if the cache held the page.
+   */
+  bool take(const File* file, const PageId page_number, Page& page);
+
+  /**
+   * Drops a page from the cache, if it holds it.
+   *
+   * @param file         File the page belongs to.
+   * @param page_number  Number of the page.
+   */
+  void erase(const File* file, const PageId page_number);
+
+  /**
+   * Drops all pages of a file from the cache.
+   *
+   * @param file  File whose pages to drop.
+   */
+  void eraseFile(const File* file);
+
+  /**
+   * Returns the bytes the cache may use.
+   */
+  std::size_t capacity() const { return capacity_; }
+
+  /**
+   * Returns the bytes the pages in the cache use, including their overhead.
+   */
+  std::size_t size() const;
+
+  /**
+   * Returns the number of pages in the cache.
+   */
+  std::size_t numPages() const;
+
+ private:
+  typedef std::pair<const File*, PageId> Key;
+
+  struct Entry {
+    /**
+     * Compressed image of the page.
+     */
+    std::string data;
+
+    /**
+     * Position of the page in lru_.
+     */
+    std::list<Key>::iterator lru;
+  };
+
+  /**
+   * Removes an entry and its bytes.  Requires mutex_.
+   */
+  void remove(std::map<Key, Entry>::iterator it);
+
+  const std::size_t capacity_;
+
+  /**
+   * Bytes used by the entries.
+   */
+  std::size_t size_;
+
+  /**
+   * Pages in the cache, ordered by file so a file's pages can be erased
+   * together.
+   */
+  std::map<Key, Entry> entries_;
+
+  /**
+   * Keys of the entries, least recently put first.
+   */
+  std::list<Key> lru_;
+
+  mutable std::mutex mutex_;
+};
+
+}